@@ -177,6 +177,34 @@ shp_le64_to_int64(const char *bytes)
     return n;
 }
 
+/**
+ * Convert bytes in big-endian order to double
+ *
+ * Converts eight bytes in big-endian order to a double value.
+ *
+ * @param bytes a buffer with eight bytes.
+ * @return a double value.
+ */
+static inline double
+shp_be64_to_double(const char *bytes)
+{
+    double n;
+
+#ifdef WORDS_BIGENDIAN
+    memcpy(&n, bytes, sizeof(n)); /* NOLINT */
+#else
+    ((char *) &n)[0] = bytes[7];
+    ((char *) &n)[1] = bytes[6];
+    ((char *) &n)[2] = bytes[5];
+    ((char *) &n)[3] = bytes[4];
+    ((char *) &n)[4] = bytes[3];
+    ((char *) &n)[5] = bytes[2];
+    ((char *) &n)[6] = bytes[1];
+    ((char *) &n)[7] = bytes[0];
+#endif
+    return n;
+}
+
 /**
  * Convert bytes in little-endian order to double
  *
@@ -205,4 +233,71 @@ shp_le64_to_double(const char *bytes)
     return n;
 }
 
+/**
+ * Convert uint32_t to bytes in big-endian order
+ *
+ * Converts a uint32_t value to four bytes in big-endian order.
+ *
+ * @param n a uint32_t value.
+ * @param[out] bytes a buffer with room for four bytes.
+ */
+static inline void
+shp_uint32_to_be32(uint32_t n, char *bytes)
+{
+#ifdef WORDS_BIGENDIAN
+    memcpy(bytes, &n, sizeof(n)); /* NOLINT */
+#else
+    bytes[0] = ((char *) &n)[3];
+    bytes[1] = ((char *) &n)[2];
+    bytes[2] = ((char *) &n)[1];
+    bytes[3] = ((char *) &n)[0];
+#endif
+}
+
+/**
+ * Convert uint32_t to bytes in little-endian order
+ *
+ * Converts a uint32_t value to four bytes in little-endian order.
+ *
+ * @param n a uint32_t value.
+ * @param[out] bytes a buffer with room for four bytes.
+ */
+static inline void
+shp_uint32_to_le32(uint32_t n, char *bytes)
+{
+#ifdef WORDS_BIGENDIAN
+    bytes[0] = ((char *) &n)[3];
+    bytes[1] = ((char *) &n)[2];
+    bytes[2] = ((char *) &n)[1];
+    bytes[3] = ((char *) &n)[0];
+#else
+    memcpy(bytes, &n, sizeof(n)); /* NOLINT */
+#endif
+}
+
+/**
+ * Convert double to bytes in little-endian order
+ *
+ * Converts a double value to eight bytes in little-endian order.
+ *
+ * @param n a double value.
+ * @param[out] bytes a buffer with room for eight bytes.
+ */
+static inline void
+shp_double_to_le64(double n, char *bytes)
+{
+#ifdef WORDS_BIGENDIAN
+    bytes[0] = ((char *) &n)[7];
+    bytes[1] = ((char *) &n)[6];
+    bytes[2] = ((char *) &n)[5];
+    bytes[3] = ((char *) &n)[4];
+    bytes[4] = ((char *) &n)[3];
+    bytes[5] = ((char *) &n)[2];
+    bytes[6] = ((char *) &n)[1];
+    bytes[7] = ((char *) &n)[0];
+#else
+    memcpy(bytes, &n, sizeof(n)); /* NOLINT */
+#endif
+}
+
 #endif
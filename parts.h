@@ -0,0 +1,297 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#ifndef _SHAPEREADER_PARTS_H
+#define _SHAPEREADER_PARTS_H
+
+#include "byteorder.h"
+#include "shp-buffer.h"
+#include "shp-point.h"
+#include <stddef.h>
+
+/*
+ * The PolyLine, Polygon and MultiPatch types and their M and Z variants
+ * share the layout of the parts index and the X and Y coordinates.  The
+ * functions in this file work on the raw buffers so that the algorithms do
+ * not have to be written for every shape type.
+ */
+
+/**
+ * Parts and X, Y coordinates of a shape
+ */
+typedef struct shp_parts_t {
+    size_t num_parts;   /**< Number of parts */
+    size_t num_points;  /**< Total number of points */
+    const char *parts;  /**< Index to first point in part */
+    const char *points; /**< X and Y coordinates */
+} shp_parts_t;
+
+/**
+ * Initialize a view on the parts of a shape
+ *
+ * @param view an uninitialized view.
+ * @param num_parts the number of parts.
+ * @param num_points the total number of points.
+ * @param parts the index to the first point in each part.
+ * @param points the X and Y coordinates.
+ * @return the initialized view.
+ */
+static inline shp_parts_t *
+shp_parts_init(shp_parts_t *view, size_t num_parts, size_t num_points,
+               const char *parts, const char *points)
+{
+    view->num_parts = num_parts;
+    view->num_points = num_points;
+    view->parts = parts;
+    view->points = points;
+    return view;
+}
+
+/**
+ * Get the points that form a part
+ *
+ * @param view a view on the parts of a shape.
+ * @param part_num a zero-based part number.
+ * @param[out] start the range start.
+ * @param[out] end the range end (exclusive).
+ * @return the number of points in the part or 0 if the range is invalid.
+ */
+static inline size_t
+shp_parts_points(const shp_parts_t *view, size_t part_num, size_t *start,
+                 size_t *end)
+{
+    size_t i, j, m;
+    const char *buf;
+
+    m = view->num_points;
+
+    buf = view->parts + 4 * part_num;
+    i = shp_le32_to_uint32(&buf[0]);
+    if (part_num + 1 < view->num_parts) {
+        j = shp_le32_to_uint32(&buf[4]);
+    }
+    else {
+        j = m;
+    }
+
+    *start = i;
+    *end = j;
+
+    if (i < m && j <= m && i < j) {
+        return j - i;
+    }
+    return 0;
+}
+
+/**
+ * Get the X coordinate of a point
+ *
+ * @param view a view on the parts of a shape.
+ * @param point_num a zero-based point number.
+ * @return the X coordinate.
+ */
+static inline double
+shp_parts_x(const shp_parts_t *view, size_t point_num)
+{
+    return shp_le64_to_double(view->points + 16 * point_num);
+}
+
+/**
+ * Get the Y coordinate of a point
+ *
+ * @param view a view on the parts of a shape.
+ * @param point_num a zero-based point number.
+ * @return the Y coordinate.
+ */
+static inline double
+shp_parts_y(const shp_parts_t *view, size_t point_num)
+{
+    return shp_le64_to_double(view->points + 16 * point_num + 8);
+}
+
+/**
+ * Compute the signed area and the bounding box of a ring
+ *
+ * Rings in counterclockwise order have a positive area.  The coordinates are
+ * translated to the first point to reduce rounding errors.  The area and the
+ * bounding box are computed in a single pass over the points.
+ *
+ * @param view a view on the parts of a shape.
+ * @param start the first point of the ring.
+ * @param end the end of the ring (exclusive).  The ring must not be empty.
+ * @param[out] box the minimum X, minimum Y, maximum X and maximum Y.
+ * @return the signed area.
+ */
+static inline double
+shp_parts_signed_area(const shp_parts_t *view, size_t start, size_t end,
+                      double *box)
+{
+    const char *buf;
+    size_t i;
+    double x, y, x0, y0, x1, y1, x2, y2, sum;
+
+    buf = view->points + 16 * start;
+    x0 = shp_le64_to_double(&buf[0]);
+    y0 = shp_le64_to_double(&buf[8]);
+
+    sum = 0.0;
+    x1 = 0.0;
+    y1 = 0.0;
+    box[0] = box[2] = x0;
+    box[1] = box[3] = y0;
+    for (i = start + 1; i < end; ++i) {
+        buf += 16;
+        x = shp_le64_to_double(&buf[0]);
+        y = shp_le64_to_double(&buf[8]);
+        box[0] = (x < box[0]) ? x : box[0];
+        box[1] = (y < box[1]) ? y : box[1];
+        box[2] = (x > box[2]) ? x : box[2];
+        box[3] = (y > box[3]) ? y : box[3];
+        x2 = x - x0;
+        y2 = y - y0;
+        sum += x1 * y2 - x2 * y1;
+        x1 = x2;
+        y1 = y2;
+    }
+
+    return sum / 2.0;
+}
+
+/**
+ * Check whether a point is in a ring
+ *
+ * Uses the same algorithm as shp_point_in_polygon for a single part.
+ *
+ * @param view a view on the parts of a shape.
+ * @param start the first point of the ring.
+ * @param end the end of the ring (exclusive).
+ * @param x X coordinate of the point.
+ * @param y Y coordinate of the point.
+ * @retval 1 if the point is in the ring.
+ * @retval 0 if the point is not in the ring.
+ * @retval -1 if the point is on the ring.
+ */
+static inline int
+shp_parts_point_in_ring(const shp_parts_t *view, size_t start, size_t end,
+                        double x, double y)
+{
+    size_t i, k;
+    double f, u1, v1, u2, v2;
+
+    if (start >= end) {
+        return 0;
+    }
+
+    k = 0;
+    i = start;
+    u1 = shp_parts_x(view, i) - x;
+    v1 = shp_parts_y(view, i) - y;
+
+    while (++i < end) {
+        u2 = shp_parts_x(view, i) - x;
+        v2 = shp_parts_y(view, i) - y;
+
+        if ((v1 < 0.0 && v2 < 0.0) || (v1 > 0.0 && v2 > 0.0)) {
+            u1 = u2;
+            v1 = v2;
+            continue;
+        }
+
+        f = u1 * v2 - u2 * v1;
+        if (v2 > 0.0 && v1 <= 0.0) {
+            if (f > 0.0) {
+                ++k;
+            }
+            else if (f == 0.0) {
+                return -1;
+            }
+        }
+        else if (v1 > 0.0 && v2 <= 0.0) {
+            if (f < 0.0) {
+                ++k;
+            }
+            else if (f == 0.0) {
+                return -1;
+            }
+        }
+        else if (v2 == 0.0 && v1 < 0.0) {
+            if (f == 0.0) {
+                return -1;
+            }
+        }
+        else if (v1 == 0.0 && v2 < 0.0) {
+            if (f == 0.0) {
+                return -1;
+            }
+        }
+        else if (v1 == 0.0 && v2 == 0.0) {
+            if ((u2 <= 0.0 && u1 >= 0.0) || (u1 <= 0.0 && u2 >= 0.0)) {
+                return -1;
+            }
+        }
+
+        u1 = u2;
+        v1 = v2;
+    }
+
+    return (k % 2 == 0) ? 0 : 1;
+}
+
+/**
+ * Start a new part in an output buffer
+ *
+ * @param buffer an output buffer.
+ * @return the index of the part's first point.
+ */
+static inline size_t
+shp_buffer_add_part(shp_buffer_t *buffer)
+{
+    if (buffer->num_parts < buffer->max_parts) {
+        buffer->parts[buffer->num_parts] = buffer->num_points;
+    }
+    ++buffer->num_parts;
+    return buffer->num_points;
+}
+
+/**
+ * Remove the last part from an output buffer
+ *
+ * @param buffer an output buffer.
+ * @param start the index of the part's first point.
+ */
+static inline void
+shp_buffer_remove_part(shp_buffer_t *buffer, size_t start)
+{
+    --buffer->num_parts;
+    buffer->num_points = start;
+}
+
+/**
+ * Append a point to an output buffer
+ *
+ * @param buffer an output buffer.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ */
+static inline void
+shp_buffer_add_point(shp_buffer_t *buffer, double x, double y)
+{
+    shp_point_t *point;
+
+    if (buffer->num_points < buffer->max_points) {
+        point = &buffer->points[buffer->num_points];
+        point->x = x;
+        point->y = y;
+    }
+    ++buffer->num_points;
+}
+
+#endif
@@ -0,0 +1,716 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "qix.h"
+#include "byteorder.h"
+#include "record.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void) (x)
+
+#define MAX_DEPTH 64
+#define MAX_SUBNODES 4
+#define SPLIT_RATIO 0.55
+
+/* Byte orders in the file header */
+#define LSB_ORDER 1
+#define MSB_ORDER 2
+
+typedef struct search_t {
+    qix_file_t *fh;
+    int msb_order;
+    size_t file_offset;
+    double x_min;
+    double y_min;
+    double x_max;
+    double y_max;
+    size_t num_records;
+    size_t max_records;
+    size_t *record_numbers;
+} search_t;
+
+typedef struct box_t {
+    double x_min;
+    double y_min;
+    double x_max;
+    double y_max;
+} box_t;
+
+typedef struct item_t {
+    size_t record_number;
+    size_t node_num;
+    box_t box;
+} item_t;
+
+typedef struct node_t {
+    box_t box;
+    size_t children;
+    size_t num_items;
+    size_t first_item;
+    size_t num_subnodes;
+    size_t subtree_size;
+} node_t;
+
+typedef struct tree_t {
+    shp_file_t *fh;
+    FILE *stream;
+    box_t box;
+    size_t num_records;
+    size_t num_items;
+    size_t max_items;
+    item_t *items;
+    size_t num_nodes;
+    size_t max_nodes;
+    node_t *nodes;
+    size_t *record_numbers;
+} tree_t;
+
+qix_file_t *
+qix_init_file(qix_file_t *fh, FILE *stream, void *user_data)
+{
+    return shp_init_file(fh, stream, user_data);
+}
+
+void
+qix_set_error(qix_file_t *fh, const char *format, ...)
+{
+    va_list ap;
+
+    assert(fh != NULL);
+    assert(format != NULL);
+
+    va_start(ap, format);
+    vsnprintf(fh->error, sizeof(fh->error), format, ap); /* NOLINT */
+    va_end(ap);
+}
+
+static int
+read_bytes(search_t *search, char *buf, size_t size, const char *what)
+{
+    qix_file_t *fh = search->fh;
+    size_t nr;
+
+    nr = (*fh->fread)(fh, buf, size);
+    search->file_offset += nr;
+    if ((*fh->ferror)(fh)) {
+        qix_set_error(fh, "Cannot read %s", what);
+        return -1;
+    }
+    if (nr != size) {
+        qix_set_error(fh, "Expected %s of %zu bytes, got %zu", what, size,
+                      nr);
+        errno = EINVAL;
+        return -1;
+    }
+    return 1;
+}
+
+static long
+get_int32(const search_t *search, const char *buf)
+{
+    return search->msb_order ? shp_be32_to_int32(buf)
+                             : shp_le32_to_int32(buf);
+}
+
+static double
+get_double(const search_t *search, const char *buf)
+{
+    return search->msb_order ? shp_be64_to_double(buf)
+                             : shp_le64_to_double(buf);
+}
+
+static int
+add_record(search_t *search, size_t record_number)
+{
+    size_t max_records, *record_numbers;
+
+    if (search->num_records == search->max_records) {
+        max_records = (search->max_records > 0) ? 2 * search->max_records
+                                                : 64;
+        if (max_records > SIZE_MAX / sizeof(*record_numbers)) {
+            qix_set_error(search->fh, "Cannot allocate memory");
+            errno = ENOMEM;
+            return -1;
+        }
+        record_numbers = (size_t *) realloc(
+            search->record_numbers, max_records * sizeof(*record_numbers));
+        if (record_numbers == NULL) {
+            qix_set_error(search->fh, "Cannot allocate %zu bytes",
+                          max_records * sizeof(*record_numbers));
+            return -1;
+        }
+        search->record_numbers = record_numbers;
+        search->max_records = max_records;
+    }
+    search->record_numbers[search->num_records] = record_number;
+    ++search->num_records;
+    return 1;
+}
+
+static int
+search_node(search_t *search, unsigned int depth)
+{
+    qix_file_t *fh = search->fh;
+    char buf[4 * 64];
+    long offset, num_shapes, num_subnodes, id;
+    size_t n, count, i, skip;
+    double x_min, y_min, x_max, y_max;
+
+    if (depth > MAX_DEPTH) {
+        qix_set_error(fh, "Quadtree is deeper than %d levels", MAX_DEPTH);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (read_bytes(search, buf, 40, "node") < 0) {
+        return -1;
+    }
+    offset = get_int32(search, &buf[0]);
+    x_min = get_double(search, &buf[4]);
+    y_min = get_double(search, &buf[12]);
+    x_max = get_double(search, &buf[20]);
+    y_max = get_double(search, &buf[28]);
+    num_shapes = get_int32(search, &buf[36]);
+    if (offset < 0 || num_shapes < 0) {
+        qix_set_error(fh, "Node at file offset %zu is invalid",
+                      search->file_offset - 40);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (x_max < search->x_min || x_min > search->x_max ||
+        y_max < search->y_min || y_min > search->y_max) {
+        /* Skip the shape ids, the number of subnodes and the subnodes. */
+        skip = 4 * (size_t) num_shapes + 4 + (size_t) offset;
+        if ((*fh->fsetpos)(fh, search->file_offset + skip) != 0) {
+            qix_set_error(fh, "Cannot set file position to %zu",
+                          search->file_offset + skip);
+            return -1;
+        }
+        search->file_offset += skip;
+        return 1;
+    }
+
+    n = (size_t) num_shapes;
+    while (n > 0) {
+        count = (n < 64) ? n : 64;
+        if (read_bytes(search, buf, 4 * count, "shape ids") < 0) {
+            return -1;
+        }
+        for (i = 0; i < count; ++i) {
+            id = get_int32(search, &buf[4 * i]);
+            if (id < 0) {
+                qix_set_error(fh, "Shape id %ld is invalid", id);
+                errno = EINVAL;
+                return -1;
+            }
+            if (add_record(search, (size_t) id) < 0) {
+                return -1;
+            }
+        }
+        n -= count;
+    }
+
+    if (read_bytes(search, buf, 4, "number of subnodes") < 0) {
+        return -1;
+    }
+    num_subnodes = get_int32(search, &buf[0]);
+    if (num_subnodes < 0 || num_subnodes > MAX_SUBNODES) {
+        qix_set_error(fh, "Number of subnodes %ld is invalid", num_subnodes);
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < (size_t) num_subnodes; ++i) {
+        if (search_node(search, depth + 1) < 0) {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+static int
+compare_sizes(const void *a, const void *b)
+{
+    size_t x = *(const size_t *) a;
+    size_t y = *(const size_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+int
+qix_search(qix_file_t *fh, double x_min, double y_min, double x_max,
+           double y_max, size_t **precord_numbers, size_t *pnum_records)
+{
+    int rc = -1;
+    char buf[8];
+    search_t search;
+
+    assert(fh != NULL);
+    assert(precord_numbers != NULL);
+    assert(pnum_records != NULL);
+
+    *precord_numbers = NULL;
+    *pnum_records = 0;
+
+    search.fh = fh;
+    search.msb_order = 0;
+    search.file_offset = 0;
+    search.x_min = x_min;
+    search.y_min = y_min;
+    search.x_max = x_max;
+    search.y_max = y_max;
+    search.num_records = 0;
+    search.max_records = 0;
+    search.record_numbers = NULL;
+
+    if ((*fh->fsetpos)(fh, 0) != 0) {
+        qix_set_error(fh, "Cannot set file position to %zu", (size_t) 0);
+        goto cleanup;
+    }
+
+    /*
+     * Newer files begin with a signature, the byte order and the version.
+     * Older files begin with the number of shapes in little-endian order.
+     */
+    if (read_bytes(&search, buf, 8, "file header") < 0) {
+        goto cleanup;
+    }
+    if (memcmp(buf, "SQT", 3) == 0) {
+        if (buf[3] != LSB_ORDER && buf[3] != MSB_ORDER) {
+            qix_set_error(fh, "Byte order %d is not supported", buf[3]);
+            errno = EINVAL;
+            goto cleanup;
+        }
+        if (buf[4] != 1) {
+            qix_set_error(fh, "Version %d is not supported", buf[4]);
+            errno = EINVAL;
+            goto cleanup;
+        }
+        search.msb_order = (buf[3] == MSB_ORDER);
+        /* Skip the number of shapes and the maximum depth. */
+        if (read_bytes(&search, buf, 8, "file header") < 0) {
+            goto cleanup;
+        }
+    }
+
+    if (search_node(&search, 1) < 0) {
+        goto cleanup;
+    }
+
+    if (search.record_numbers == NULL) {
+        search.record_numbers = (size_t *) malloc(sizeof(size_t));
+        if (search.record_numbers == NULL) {
+            qix_set_error(fh, "Cannot allocate %zu bytes", sizeof(size_t));
+            goto cleanup;
+        }
+    }
+    qsort(search.record_numbers, search.num_records,
+          sizeof(*search.record_numbers), compare_sizes);
+
+    *precord_numbers = search.record_numbers;
+    *pnum_records = search.num_records;
+    search.record_numbers = NULL;
+    rc = 1;
+
+cleanup:
+
+    free(search.record_numbers);
+
+    return rc;
+}
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    tree_t *tree = (tree_t *) fh->user_data;
+
+    tree->box.x_min = header->x_min;
+    tree->box.y_min = header->y_min;
+    tree->box.x_max = header->x_max;
+    tree->box.y_max = header->y_max;
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    tree_t *tree = (tree_t *) fh->user_data;
+    size_t max_items;
+    item_t *items, *item;
+    double box[4];
+
+    UNUSED(header);
+    UNUSED(file_offset);
+
+    ++tree->num_records;
+    if (!shp_record_box(record, box)) {
+        return 1;
+    }
+
+    if (tree->num_items == tree->max_items) {
+        max_items = (tree->max_items > 0) ? 2 * tree->max_items : 64;
+        if (max_items > SIZE_MAX / sizeof(*items)) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            errno = ENOMEM;
+            return -1;
+        }
+        items = (item_t *) realloc(tree->items, max_items * sizeof(*items));
+        if (items == NULL) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            return -1;
+        }
+        tree->items = items;
+        tree->max_items = max_items;
+    }
+
+    item = &tree->items[tree->num_items];
+    item->record_number = tree->num_records - 1;
+    item->node_num = 0;
+    item->box.x_min = box[0];
+    item->box.y_min = box[1];
+    item->box.x_max = box[2];
+    item->box.y_max = box[3];
+    ++tree->num_items;
+    return 1;
+}
+
+static int
+add_node(tree_t *tree, const box_t *box)
+{
+    size_t max_nodes;
+    node_t *nodes, *node;
+
+    if (tree->num_nodes == tree->max_nodes) {
+        max_nodes = (tree->max_nodes > 0) ? 2 * tree->max_nodes : 64;
+        if (max_nodes > SIZE_MAX / sizeof(*nodes)) {
+            shp_set_error(tree->fh, "Cannot allocate memory");
+            errno = ENOMEM;
+            return -1;
+        }
+        nodes = (node_t *) realloc(tree->nodes, max_nodes * sizeof(*nodes));
+        if (nodes == NULL) {
+            shp_set_error(tree->fh, "Cannot allocate %zu bytes",
+                          max_nodes * sizeof(*nodes));
+            return -1;
+        }
+        tree->nodes = nodes;
+        tree->max_nodes = max_nodes;
+    }
+
+    node = &tree->nodes[tree->num_nodes];
+    node->box = *box;
+    node->children = 0;
+    node->num_items = 0;
+    node->first_item = 0;
+    node->num_subnodes = 0;
+    node->subtree_size = 0;
+    ++tree->num_nodes;
+    return 1;
+}
+
+static int
+box_contains(const box_t *outer, const box_t *inner)
+{
+    return inner->x_min >= outer->x_min && inner->x_max <= outer->x_max &&
+           inner->y_min >= outer->y_min && inner->y_max <= outer->y_max;
+}
+
+/*
+ * Splits a box along its longer side into two halves that overlap by 10
+ * percent.
+ */
+static void
+split_box(const box_t *box, box_t *half1, box_t *half2)
+{
+    double range;
+
+    *half1 = *box;
+    *half2 = *box;
+    if (box->x_max - box->x_min > box->y_max - box->y_min) {
+        range = box->x_max - box->x_min;
+        half1->x_max = box->x_min + range * SPLIT_RATIO;
+        half2->x_min = box->x_max - range * SPLIT_RATIO;
+    }
+    else {
+        range = box->y_max - box->y_min;
+        half1->y_max = box->y_min + range * SPLIT_RATIO;
+        half2->y_min = box->y_max - range * SPLIT_RATIO;
+    }
+}
+
+/*
+ * Moves an item down to the deepest node that contains its bounding box.
+ * Nodes are split into quadrants on demand.
+ */
+static int
+insert_item(tree_t *tree, item_t *item, unsigned int max_depth)
+{
+    box_t half1, half2, quads[MAX_SUBNODES];
+    size_t node_num = 0, children, i;
+    unsigned int depth;
+
+    for (depth = max_depth; depth > 1; --depth) {
+        children = tree->nodes[node_num].children;
+        if (children == 0) {
+            split_box(&tree->nodes[node_num].box, &half1, &half2);
+            split_box(&half1, &quads[0], &quads[1]);
+            split_box(&half2, &quads[2], &quads[3]);
+            for (i = 0; i < MAX_SUBNODES; ++i) {
+                if (box_contains(&quads[i], &item->box)) {
+                    break;
+                }
+            }
+            if (i == MAX_SUBNODES) {
+                break;
+            }
+            children = tree->num_nodes;
+            for (i = 0; i < MAX_SUBNODES; ++i) {
+                if (add_node(tree, &quads[i]) < 0) {
+                    return -1;
+                }
+            }
+            tree->nodes[node_num].children = children;
+        }
+
+        for (i = 0; i < MAX_SUBNODES; ++i) {
+            if (box_contains(&tree->nodes[children + i].box, &item->box)) {
+                break;
+            }
+        }
+        if (i == MAX_SUBNODES) {
+            break;
+        }
+        node_num = children + i;
+    }
+
+    item->node_num = node_num;
+    ++tree->nodes[node_num].num_items;
+    return 1;
+}
+
+static int
+is_empty(const node_t *node)
+{
+    return node->num_items == 0 && node->num_subnodes == 0;
+}
+
+/*
+ * Sorts the records by node and computes the size of each subtree without
+ * empty nodes.  Children are created after their parents, so the nodes are
+ * processed in reverse order.
+ */
+static int
+finish_tree(tree_t *tree)
+{
+    node_t *node, *child;
+    size_t i, j, offset, size;
+
+    if (tree->num_items > SIZE_MAX / sizeof(*tree->record_numbers)) {
+        shp_set_error(tree->fh, "Cannot allocate memory");
+        errno = ENOMEM;
+        return -1;
+    }
+    size = (tree->num_items > 0 ? tree->num_items : 1) *
+           sizeof(*tree->record_numbers);
+    tree->record_numbers = (size_t *) malloc(size);
+    if (tree->record_numbers == NULL) {
+        shp_set_error(tree->fh, "Cannot allocate %zu bytes", size);
+        return -1;
+    }
+
+    offset = 0;
+    for (i = 0; i < tree->num_nodes; ++i) {
+        tree->nodes[i].first_item = offset;
+        offset += tree->nodes[i].num_items;
+        tree->nodes[i].num_items = 0;
+    }
+    for (i = 0; i < tree->num_items; ++i) {
+        node = &tree->nodes[tree->items[i].node_num];
+        tree->record_numbers[node->first_item + node->num_items] =
+            tree->items[i].record_number;
+        ++node->num_items;
+    }
+
+    i = tree->num_nodes;
+    while (i > 0) {
+        node = &tree->nodes[--i];
+        if (node->children == 0) {
+            continue;
+        }
+        for (j = 0; j < MAX_SUBNODES; ++j) {
+            child = &tree->nodes[node->children + j];
+            if (!is_empty(child)) {
+                ++node->num_subnodes;
+                node->subtree_size +=
+                    44 + 4 * child->num_items + child->subtree_size;
+                if (node->subtree_size > INT32_MAX) {
+                    shp_set_error(tree->fh, "Quadtree is too big");
+                    errno = EFBIG;
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+static int
+write_bytes(tree_t *tree, const char *buf, size_t size)
+{
+    if (fwrite(buf, 1, size, tree->stream) != size) {
+        shp_set_error(tree->fh, "Cannot write quadtree");
+        return -1;
+    }
+    return 1;
+}
+
+static int
+write_node(tree_t *tree, const node_t *node)
+{
+    char buf[4 * 64];
+    size_t n, count, i;
+
+    shp_uint32_to_le32((uint32_t) node->subtree_size, &buf[0]);
+    shp_double_to_le64(node->box.x_min, &buf[4]);
+    shp_double_to_le64(node->box.y_min, &buf[12]);
+    shp_double_to_le64(node->box.x_max, &buf[20]);
+    shp_double_to_le64(node->box.y_max, &buf[28]);
+    shp_uint32_to_le32((uint32_t) node->num_items, &buf[36]);
+    if (write_bytes(tree, buf, 40) < 0) {
+        return -1;
+    }
+
+    for (n = 0; n < node->num_items; n += count) {
+        count = node->num_items - n;
+        if (count > 64) {
+            count = 64;
+        }
+        for (i = 0; i < count; ++i) {
+            shp_uint32_to_le32(
+                (uint32_t) tree->record_numbers[node->first_item + n + i],
+                &buf[4 * i]);
+        }
+        if (write_bytes(tree, buf, 4 * count) < 0) {
+            return -1;
+        }
+    }
+
+    shp_uint32_to_le32((uint32_t) node->num_subnodes, &buf[0]);
+    if (write_bytes(tree, buf, 4) < 0) {
+        return -1;
+    }
+
+    for (i = 0; node->num_subnodes > 0 && i < MAX_SUBNODES; ++i) {
+        if (!is_empty(&tree->nodes[node->children + i]) &&
+            write_node(tree, &tree->nodes[node->children + i]) < 0) {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int
+qix_write_index(shp_file_t *fh, unsigned int max_depth, FILE *stream)
+{
+    int rc = -1;
+    void *user_data;
+    tree_t tree;
+    char buf[16];
+    size_t num_nodes, i;
+
+    assert(fh != NULL);
+    assert(stream != NULL);
+
+    memset(&tree, 0, sizeof(tree));
+    tree.fh = fh;
+    tree.stream = stream;
+
+    if (max_depth > MAX_DEPTH) {
+        shp_set_error(fh, "Depth %u is greater than %d", max_depth,
+                      MAX_DEPTH);
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    user_data = fh->user_data;
+    fh->user_data = &tree;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc < 0) {
+        goto cleanup;
+    }
+    rc = -1;
+
+    if (tree.num_records > INT32_MAX) {
+        shp_set_error(fh, "Too many records");
+        errno = EFBIG;
+        goto cleanup;
+    }
+
+    /* Let the number of nodes grow with the number of records. */
+    if (max_depth == 0) {
+        num_nodes = 1;
+        while (num_nodes * 4 < tree.num_records) {
+            ++max_depth;
+            num_nodes *= 2;
+        }
+    }
+
+    if (add_node(&tree, &tree.box) < 0) {
+        goto cleanup;
+    }
+    for (i = 0; i < tree.num_items; ++i) {
+        if (insert_item(&tree, &tree.items[i], max_depth) < 0) {
+            goto cleanup;
+        }
+    }
+    if (finish_tree(&tree) < 0) {
+        goto cleanup;
+    }
+
+    memcpy(&buf[0], "SQT", 3);
+    buf[3] = LSB_ORDER;
+    buf[4] = 1;
+    buf[5] = 0;
+    buf[6] = 0;
+    buf[7] = 0;
+    shp_uint32_to_le32((uint32_t) tree.num_records, &buf[8]);
+    shp_uint32_to_le32(max_depth, &buf[12]);
+    if (write_bytes(&tree, buf, 16) < 0) {
+        goto cleanup;
+    }
+    if (write_node(&tree, &tree.nodes[0]) < 0) {
+        goto cleanup;
+    }
+
+    rc = 1;
+
+cleanup:
+
+    free(tree.record_numbers);
+    free(tree.nodes);
+    free(tree.items);
+
+    return rc;
+}
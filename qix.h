@@ -0,0 +1,116 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_QIX_H
+#define _SHAPEREADER_QIX_H
+
+#include "shp.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * File handle
+ */
+typedef shp_file_t qix_file_t;
+
+/**
+ * Initialize a file handle
+ *
+ * Initializes a qix_file_t structure.
+ *
+ * @param fh an uninitialized file handle.
+ * @param fp a file pointer.
+ * @param user_data callback data or NULL.
+ * @return the initialized file handle.
+ */
+extern qix_file_t *qix_init_file(qix_file_t *fh, FILE *fp, void *user_data);
+
+/**
+ * Set an error message
+ *
+ * Formats and sets an error message.
+ *
+ * @param fh a file handle.
+ * @param format a printf format string followed by a variable number of
+ *               arguments.
+ */
+#ifdef __GNUC__
+extern void qix_set_error(qix_file_t *fh, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+#else
+extern void qix_set_error(qix_file_t *fh, const char *format, ...);
+#endif
+
+/**
+ * Search a quadtree
+ *
+ * Searches a file that has the file extension ".qix" for the records whose
+ * bounding boxes are stored in nodes that overlap a rectangle.  The records
+ * are candidates that have to be checked against the shapes.
+ *
+ * The file is read from the beginning.  Subtrees that do not overlap the
+ * rectangle are skipped, so only a small part of the file is read.
+ *
+ * The record numbers are sorted and zero-based so that they can be passed to
+ * shx_seek_record.
+ *
+ * @param fh a file handle.
+ * @param x_min the minimum x coordinate of the rectangle.
+ * @param y_min the minimum y coordinate of the rectangle.
+ * @param x_max the maximum x coordinate of the rectangle.
+ * @param y_max the maximum y coordinate of the rectangle.
+ * @param[out] precord_numbers on success, an array of zero-based record
+ *                             numbers.  Free the array with @c free() when
+ *                             you are done.
+ * @param[out] pnum_records the number of record numbers.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see sbn_search
+ */
+extern int qix_search(qix_file_t *fh, double x_min, double y_min,
+                      double x_max, double y_max, size_t **precord_numbers,
+                      size_t *pnum_records);
+
+/**
+ * Write a quadtree
+ *
+ * Reads a file that has the file extension ".shp" and writes a quadtree in
+ * the ".qix" format that is used by MapServer.
+ *
+ * The nodes are split into four quadrants that overlap by 10 percent.  The
+ * records are stored in the deepest node that contains their bounding box.
+ * Null shapes are left out.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_init_file(fh, shp_stream, NULL);
+ * rc = qix_write_index(fh, 0, qix_stream);
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param max_depth the maximum depth of the tree or 0 to choose a depth that
+ *                  depends on the number of records.
+ * @param stream a file pointer that is opened for writing.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see "shptree" @cite MapServer_shptree
+ */
+extern int qix_write_index(shp_file_t *fh, unsigned int max_depth,
+                           FILE *stream);
+
+#endif
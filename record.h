@@ -0,0 +1,235 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#ifndef _SHAPEREADER_RECORD_H
+#define _SHAPEREADER_RECORD_H
+
+#include "shp.h"
+#include <math.h>
+#include <stddef.h>
+
+/*
+ * Returns the number of points in a record.  Gets either the X and Y
+ * coordinates or a single point.  The point is set to 0, 0 if the record
+ * is not a point.
+ */
+static inline size_t
+shp_record_xy(const shp_record_t *record, const char **points,
+              shp_point_t *point)
+{
+    *points = NULL;
+    point->x = 0.0;
+    point->y = 0.0;
+    switch (record->type) {
+    case SHP_TYPE_POINT:
+        *point = record->shape.point;
+        return 1;
+    case SHP_TYPE_POINTM:
+        point->x = record->shape.pointm.x;
+        point->y = record->shape.pointm.y;
+        return 1;
+    case SHP_TYPE_POINTZ:
+        point->x = record->shape.pointz.x;
+        point->y = record->shape.pointz.y;
+        return 1;
+    case SHP_TYPE_MULTIPOINT:
+        *points = record->shape.multipoint.points;
+        return record->shape.multipoint.num_points;
+    case SHP_TYPE_MULTIPOINTM:
+        *points = record->shape.multipointm.points;
+        return record->shape.multipointm.num_points;
+    case SHP_TYPE_MULTIPOINTZ:
+        *points = record->shape.multipointz.points;
+        return record->shape.multipointz.num_points;
+    case SHP_TYPE_POLYLINE:
+        *points = record->shape.polyline.points;
+        return record->shape.polyline.num_points;
+    case SHP_TYPE_POLYLINEM:
+        *points = record->shape.polylinem.points;
+        return record->shape.polylinem.num_points;
+    case SHP_TYPE_POLYLINEZ:
+        *points = record->shape.polylinez.points;
+        return record->shape.polylinez.num_points;
+    case SHP_TYPE_POLYGON:
+        *points = record->shape.polygon.points;
+        return record->shape.polygon.num_points;
+    case SHP_TYPE_POLYGONM:
+        *points = record->shape.polygonm.points;
+        return record->shape.polygonm.num_points;
+    case SHP_TYPE_POLYGONZ:
+        *points = record->shape.polygonz.points;
+        return record->shape.polygonz.num_points;
+    case SHP_TYPE_MULTIPATCH:
+        *points = record->shape.multipatch.points;
+        return record->shape.multipatch.num_points;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Gets the bounding box of a record.  Returns 0 if the record has no points.
+ */
+static inline int
+shp_record_box(const shp_record_t *record, double box[4])
+{
+    const char *points;
+    shp_point_t point;
+
+    switch (record->type) {
+    case SHP_TYPE_MULTIPOINT:
+        box[0] = record->shape.multipoint.x_min;
+        box[1] = record->shape.multipoint.y_min;
+        box[2] = record->shape.multipoint.x_max;
+        box[3] = record->shape.multipoint.y_max;
+        return record->shape.multipoint.num_points > 0;
+    case SHP_TYPE_MULTIPOINTM:
+        box[0] = record->shape.multipointm.x_min;
+        box[1] = record->shape.multipointm.y_min;
+        box[2] = record->shape.multipointm.x_max;
+        box[3] = record->shape.multipointm.y_max;
+        return record->shape.multipointm.num_points > 0;
+    case SHP_TYPE_MULTIPOINTZ:
+        box[0] = record->shape.multipointz.x_min;
+        box[1] = record->shape.multipointz.y_min;
+        box[2] = record->shape.multipointz.x_max;
+        box[3] = record->shape.multipointz.y_max;
+        return record->shape.multipointz.num_points > 0;
+    case SHP_TYPE_POLYLINE:
+        box[0] = record->shape.polyline.x_min;
+        box[1] = record->shape.polyline.y_min;
+        box[2] = record->shape.polyline.x_max;
+        box[3] = record->shape.polyline.y_max;
+        return record->shape.polyline.num_points > 0;
+    case SHP_TYPE_POLYLINEM:
+        box[0] = record->shape.polylinem.x_min;
+        box[1] = record->shape.polylinem.y_min;
+        box[2] = record->shape.polylinem.x_max;
+        box[3] = record->shape.polylinem.y_max;
+        return record->shape.polylinem.num_points > 0;
+    case SHP_TYPE_POLYLINEZ:
+        box[0] = record->shape.polylinez.x_min;
+        box[1] = record->shape.polylinez.y_min;
+        box[2] = record->shape.polylinez.x_max;
+        box[3] = record->shape.polylinez.y_max;
+        return record->shape.polylinez.num_points > 0;
+    case SHP_TYPE_POLYGON:
+        box[0] = record->shape.polygon.x_min;
+        box[1] = record->shape.polygon.y_min;
+        box[2] = record->shape.polygon.x_max;
+        box[3] = record->shape.polygon.y_max;
+        return record->shape.polygon.num_points > 0;
+    case SHP_TYPE_POLYGONM:
+        box[0] = record->shape.polygonm.x_min;
+        box[1] = record->shape.polygonm.y_min;
+        box[2] = record->shape.polygonm.x_max;
+        box[3] = record->shape.polygonm.y_max;
+        return record->shape.polygonm.num_points > 0;
+    case SHP_TYPE_POLYGONZ:
+        box[0] = record->shape.polygonz.x_min;
+        box[1] = record->shape.polygonz.y_min;
+        box[2] = record->shape.polygonz.x_max;
+        box[3] = record->shape.polygonz.y_max;
+        return record->shape.polygonz.num_points > 0;
+    case SHP_TYPE_MULTIPATCH:
+        box[0] = record->shape.multipatch.x_min;
+        box[1] = record->shape.multipatch.y_min;
+        box[2] = record->shape.multipatch.x_max;
+        box[3] = record->shape.multipatch.y_max;
+        return record->shape.multipatch.num_points > 0;
+    default:
+        if (shp_record_xy(record, &points, &point) == 0) {
+            return 0;
+        }
+        box[0] = point.x;
+        box[1] = point.y;
+        box[2] = point.x;
+        box[3] = point.y;
+        return 1;
+    }
+}
+
+/*
+ * Gets the Z and M ranges of a record.  Missing ranges and measures that
+ * are all "no data" are returned as empty ranges from HUGE_VAL to
+ * -HUGE_VAL, which only overlap unbounded ranges.
+ */
+static inline void
+shp_record_zm(const shp_record_t *record, double range[4])
+{
+    range[0] = HUGE_VAL;
+    range[1] = -HUGE_VAL;
+    range[2] = HUGE_VAL;
+    range[3] = -HUGE_VAL;
+
+    switch (record->type) {
+    case SHP_TYPE_POINTM:
+        range[2] = record->shape.pointm.m;
+        range[3] = record->shape.pointm.m;
+        break;
+    case SHP_TYPE_POINTZ:
+        range[0] = record->shape.pointz.z;
+        range[1] = record->shape.pointz.z;
+        range[2] = record->shape.pointz.m;
+        range[3] = record->shape.pointz.m;
+        break;
+    case SHP_TYPE_MULTIPOINTM:
+        range[2] = record->shape.multipointm.m_min;
+        range[3] = record->shape.multipointm.m_max;
+        break;
+    case SHP_TYPE_MULTIPOINTZ:
+        range[0] = record->shape.multipointz.z_min;
+        range[1] = record->shape.multipointz.z_max;
+        range[2] = record->shape.multipointz.m_min;
+        range[3] = record->shape.multipointz.m_max;
+        break;
+    case SHP_TYPE_POLYLINEM:
+        range[2] = record->shape.polylinem.m_min;
+        range[3] = record->shape.polylinem.m_max;
+        break;
+    case SHP_TYPE_POLYLINEZ:
+        range[0] = record->shape.polylinez.z_min;
+        range[1] = record->shape.polylinez.z_max;
+        range[2] = record->shape.polylinez.m_min;
+        range[3] = record->shape.polylinez.m_max;
+        break;
+    case SHP_TYPE_POLYGONM:
+        range[2] = record->shape.polygonm.m_min;
+        range[3] = record->shape.polygonm.m_max;
+        break;
+    case SHP_TYPE_POLYGONZ:
+        range[0] = record->shape.polygonz.z_min;
+        range[1] = record->shape.polygonz.z_max;
+        range[2] = record->shape.polygonz.m_min;
+        range[3] = record->shape.polygonz.m_max;
+        break;
+    case SHP_TYPE_MULTIPATCH:
+        range[0] = record->shape.multipatch.z_min;
+        range[1] = record->shape.multipatch.z_max;
+        range[2] = record->shape.multipatch.m_min;
+        range[3] = record->shape.multipatch.m_max;
+        break;
+    default:
+        break;
+    }
+
+    /* NaN and ranges that end below -10^38 are empty. */
+    if (!(range[0] <= range[1])) {
+        range[0] = HUGE_VAL;
+        range[1] = -HUGE_VAL;
+    }
+    if (!(range[2] <= range[3]) || range[3] < -1e38) {
+        range[2] = HUGE_VAL;
+        range[3] = -HUGE_VAL;
+    }
+}
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "sbn.h"
+#include "byteorder.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The nodes are at most 30 levels deep. */
+#define MAX_STACK_SIZE 64
+
+typedef struct task_t {
+    size_t node_num;
+    unsigned int depth;
+    unsigned int x_min;
+    unsigned int y_min;
+    unsigned int x_max;
+    unsigned int y_max;
+} task_t;
+
+sbn_file_t *
+sbn_init_file(sbn_file_t *fh, FILE *stream, void *user_data)
+{
+    return shp_init_file(fh, stream, user_data);
+}
+
+void
+sbn_set_error(sbn_file_t *fh, const char *format, ...)
+{
+    va_list ap;
+
+    assert(fh != NULL);
+    assert(format != NULL);
+
+    va_start(ap, format);
+    vsnprintf(fh->error, sizeof(fh->error), format, ap); /* NOLINT */
+    va_end(ap);
+}
+
+static int
+read_bytes(sbn_file_t *fh, char *buf, size_t size, const char *what)
+{
+    size_t nr;
+
+    nr = (*fh->fread)(fh, buf, size);
+    if ((*fh->ferror)(fh)) {
+        sbn_set_error(fh, "Cannot read %s", what);
+        return -1;
+    }
+    if (nr != size) {
+        sbn_set_error(fh, "Expected %s of %zu bytes, got %zu", what, size,
+                      nr);
+        errno = EINVAL;
+        return -1;
+    }
+    return 1;
+}
+
+static int
+read_bins(sbn_file_t *fh, sbn_index_t *index)
+{
+    char buf[8];
+    size_t node_num, i, n, bin_num = 0;
+    size_t *offsets = index->offsets;
+    sbn_feature_t *feature = index->features;
+
+    for (node_num = 0; node_num < index->num_nodes; ++node_num) {
+        while (feature < index->features + offsets[node_num + 1]) {
+            ++bin_num;
+            if (read_bytes(fh, buf, 8, "bin header") < 0) {
+                return -1;
+            }
+
+            /* A bin has 8 bytes per feature. */
+            n = 2 * (size_t) shp_be32_to_uint32(&buf[4]);
+            if (n == 0 || n % 8 != 0 ||
+                n / 8 > (size_t) (index->features + offsets[node_num + 1] -
+                                  feature)) {
+                sbn_set_error(fh, "Bin %zu is invalid", bin_num);
+                errno = EINVAL;
+                return -1;
+            }
+
+            for (i = 0; i < n / 8; ++i) {
+                if (read_bytes(fh, buf, 8, "feature") < 0) {
+                    return -1;
+                }
+                feature->x_min = (unsigned char) buf[0];
+                feature->y_min = (unsigned char) buf[1];
+                feature->x_max = (unsigned char) buf[2];
+                feature->y_max = (unsigned char) buf[3];
+                feature->record_number = shp_be32_to_uint32(&buf[4]);
+                if (feature->record_number == 0) {
+                    sbn_set_error(fh, "Record number 0 in bin %zu is invalid",
+                                  bin_num);
+                    errno = EINVAL;
+                    return -1;
+                }
+                ++feature;
+            }
+        }
+    }
+
+    return 1;
+}
+
+int
+sbn_read_index(sbn_file_t *fh, sbn_index_t **pindex)
+{
+    int rc = -1;
+    char header[100], buf[8];
+    char *nodes = NULL;
+    sbn_index_t *index = NULL;
+    size_t nr, nodes_size, num_nodes, num_features, count, i, size;
+    long file_code;
+
+    assert(fh != NULL);
+    assert(pindex != NULL);
+
+    *pindex = NULL;
+
+    nr = (*fh->fread)(fh, header, 100);
+    if ((*fh->ferror)(fh)) {
+        sbn_set_error(fh, "Cannot read file header");
+        goto cleanup;
+    }
+    if (nr == 0 && (*fh->feof)(fh)) {
+        /* Reached end of file. */
+        rc = 0;
+        goto cleanup;
+    }
+    if (nr != 100) {
+        sbn_set_error(fh, "Expected file header of %zu bytes, got %zu",
+                      (size_t) 100, nr);
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    file_code = shp_be32_to_int32(&header[0]);
+    if (file_code != 9994) {
+        sbn_set_error(fh, "Expected file code 9994, got %ld", file_code);
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    if (shp_be32_to_int32(&header[4]) != -400) {
+        sbn_set_error(fh, "File is not a spatial index");
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    /* The bin index record has 8 bytes per node. */
+    if (read_bytes(fh, buf, 8, "bin index") < 0) {
+        goto cleanup;
+    }
+    nodes_size = 2 * (size_t) shp_be32_to_uint32(&buf[4]);
+    if (nodes_size == 0 || nodes_size % 8 != 0) {
+        sbn_set_error(fh, "Bin index of %zu bytes is invalid", nodes_size);
+        errno = EINVAL;
+        goto cleanup;
+    }
+    num_nodes = nodes_size / 8;
+
+    nodes = (char *) malloc(nodes_size);
+    if (nodes == NULL) {
+        sbn_set_error(fh, "Cannot allocate %zu bytes", nodes_size);
+        goto cleanup;
+    }
+    if (read_bytes(fh, nodes, nodes_size, "bin index") < 0) {
+        goto cleanup;
+    }
+
+    num_features = 0;
+    for (i = 0; i < num_nodes; ++i) {
+        count = shp_be32_to_uint32(&nodes[8 * i + 4]);
+        if (count > SIZE_MAX - num_features) {
+            goto overflow;
+        }
+        num_features += count;
+    }
+
+    size = sizeof(*index);
+    if (num_nodes + 1 > (SIZE_MAX - size) / sizeof(*index->offsets)) {
+        goto overflow;
+    }
+    size += (num_nodes + 1) * sizeof(*index->offsets);
+    if (num_features > (SIZE_MAX - size) / sizeof(*index->features)) {
+        goto overflow;
+    }
+    size += num_features * sizeof(*index->features);
+
+    index = (sbn_index_t *) malloc(size);
+    if (index == NULL) {
+        sbn_set_error(fh, "Cannot allocate %zu bytes", size);
+        goto cleanup;
+    }
+
+    index->num_shapes = shp_be32_to_uint32(&header[28]);
+    index->x_min = shp_be64_to_double(&header[32]);
+    index->y_min = shp_be64_to_double(&header[40]);
+    index->x_max = shp_be64_to_double(&header[48]);
+    index->y_max = shp_be64_to_double(&header[56]);
+    index->num_nodes = num_nodes;
+    index->num_features = num_features;
+    index->offsets = (size_t *) (index + 1);
+    index->features = (sbn_feature_t *) (index->offsets + num_nodes + 1);
+
+    index->offsets[0] = 0;
+    for (i = 0; i < num_nodes; ++i) {
+        count = shp_be32_to_uint32(&nodes[8 * i + 4]);
+        index->offsets[i + 1] = index->offsets[i] + count;
+    }
+
+    if (read_bins(fh, index) < 0) {
+        goto cleanup;
+    }
+
+    *pindex = index;
+    rc = 1;
+    goto cleanup;
+
+overflow:
+
+    sbn_set_error(fh, "Cannot allocate memory");
+    errno = ENOMEM;
+
+cleanup:
+
+    if (rc <= 0) {
+        free(index);
+    }
+    free(nodes);
+
+    return rc;
+}
+
+/*
+ * Scales a range of coordinates to the range 0 to 255.  The minimum is
+ * rounded down and the maximum is rounded up.
+ */
+static void
+scale_range(double min, double max, double extent_min, double extent_max,
+            unsigned int *pmin, unsigned int *pmax)
+{
+    double width = extent_max - extent_min, a, b;
+
+    if (!(width > 0.0)) {
+        *pmin = 0;
+        *pmax = 255;
+        return;
+    }
+
+    a = floor((min - extent_min) / width * 255.0);
+    b = ceil((max - extent_min) / width * 255.0);
+    *pmin = (a <= 0.0) ? 0 : (a >= 255.0) ? 255 : (unsigned int) a;
+    *pmax = (b <= 0.0) ? 0 : (b >= 255.0) ? 255 : (unsigned int) b;
+}
+
+static int
+compare_sizes(const void *a, const void *b)
+{
+    size_t x = *(const size_t *) a;
+    size_t y = *(const size_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+int
+sbn_search(const sbn_index_t *index, double x_min, double y_min,
+           double x_max, double y_max, size_t **precord_numbers,
+           size_t *pnum_records)
+{
+    task_t stack[MAX_STACK_SIZE], task, child;
+    const sbn_feature_t *feature, *end;
+    size_t *record_numbers;
+    size_t num_records = 0, n, i, j;
+    unsigned int qx_min, qy_min, qx_max, qy_max, mid;
+
+    assert(index != NULL);
+    assert(precord_numbers != NULL);
+    assert(pnum_records != NULL);
+
+    *precord_numbers = NULL;
+    *pnum_records = 0;
+
+    n = (index->num_features > 0) ? index->num_features : 1;
+    if (n > SIZE_MAX / sizeof(*record_numbers)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    record_numbers = (size_t *) malloc(n * sizeof(*record_numbers));
+    if (record_numbers == NULL) {
+        return -1;
+    }
+
+    if (x_max < index->x_min || x_min > index->x_max ||
+        y_max < index->y_min || y_min > index->y_max) {
+        goto done;
+    }
+
+    scale_range(x_min, x_max, index->x_min, index->x_max, &qx_min, &qx_max);
+    scale_range(y_min, y_max, index->y_min, index->y_max, &qy_min, &qy_max);
+
+    stack[0].node_num = 0;
+    stack[0].depth = 0;
+    stack[0].x_min = 0;
+    stack[0].y_min = 0;
+    stack[0].x_max = 255;
+    stack[0].y_max = 255;
+    n = 1;
+    while (n > 0) {
+        task = stack[--n];
+        if (task.x_max < qx_min || task.x_min > qx_max ||
+            task.y_max < qy_min || task.y_min > qy_max) {
+            continue;
+        }
+
+        feature = index->features + index->offsets[task.node_num];
+        end = index->features + index->offsets[task.node_num + 1];
+        for (; feature < end; ++feature) {
+            if (feature->x_max >= qx_min && feature->x_min <= qx_max &&
+                feature->y_max >= qy_min && feature->y_min <= qy_max) {
+                record_numbers[num_records] = feature->record_number - 1;
+                ++num_records;
+            }
+        }
+
+        if (2 * task.node_num + 1 >= index->num_nodes) {
+            continue;
+        }
+        assert(n + 2 <= MAX_STACK_SIZE);
+
+        /*
+         * Writers differ in whether the middle belongs to the lower or the
+         * upper half.  Let both halves overlap so that no feature is missed.
+         */
+        child = task;
+        child.depth = task.depth + 1;
+        if (task.depth % 2 == 0) {
+            mid = (task.x_min + task.x_max) / 2;
+            child.node_num = 2 * task.node_num + 2;
+            child.x_min = mid;
+            if (child.node_num < index->num_nodes) {
+                stack[n++] = child;
+            }
+            child.node_num = 2 * task.node_num + 1;
+            child.x_min = task.x_min;
+            child.x_max = (mid < task.x_max) ? mid + 1 : mid;
+            stack[n++] = child;
+        }
+        else {
+            mid = (task.y_min + task.y_max) / 2;
+            child.node_num = 2 * task.node_num + 2;
+            child.y_min = mid;
+            if (child.node_num < index->num_nodes) {
+                stack[n++] = child;
+            }
+            child.node_num = 2 * task.node_num + 1;
+            child.y_min = task.y_min;
+            child.y_max = (mid < task.y_max) ? mid + 1 : mid;
+            stack[n++] = child;
+        }
+    }
+
+    /* Remove duplicates. */
+    qsort(record_numbers, num_records, sizeof(*record_numbers),
+          compare_sizes);
+    j = 0;
+    for (i = 0; i < num_records; ++i) {
+        if (j == 0 || record_numbers[j - 1] != record_numbers[i]) {
+            record_numbers[j] = record_numbers[i];
+            ++j;
+        }
+    }
+    num_records = j;
+
+done:
+
+    *precord_numbers = record_numbers;
+    *pnum_records = num_records;
+
+    return 1;
+}
@@ -0,0 +1,152 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SBN_H
+#define _SHAPEREADER_SBN_H
+
+#include "shp.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Feature
+ *
+ * The bounding box of a shape scaled to the range 0 to 255 over the extent
+ * of the index.
+ */
+typedef struct sbn_feature_t {
+    unsigned char x_min;  /**< X minimum */
+    unsigned char y_min;  /**< Y minimum */
+    unsigned char x_max;  /**< X maximum */
+    unsigned char y_max;  /**< Y maximum */
+    size_t record_number; /**< Record number in the ".shp" file */
+} sbn_feature_t;
+
+/**
+ * Spatial index
+ *
+ * A binary tree whose nodes split the extent alternately along the x and
+ * the y axis.  The children of node @c i are the nodes @c 2i+1 and
+ * @c 2i+2.  The features of node @c i are stored in @a features from
+ * @c offsets[i] to @c offsets[i+1].
+ */
+typedef struct sbn_index_t {
+    size_t num_shapes;       /**< Number of shapes */
+    double x_min;            /**< X minimum */
+    double y_min;            /**< Y minimum */
+    double x_max;            /**< X maximum */
+    double y_max;            /**< Y maximum */
+    size_t num_nodes;        /**< Number of nodes */
+    size_t num_features;     /**< Number of features */
+    size_t *offsets;         /**< Offsets into @a features */
+    sbn_feature_t *features; /**< Features */
+} sbn_index_t;
+
+/**
+ * File handle
+ */
+typedef shp_file_t sbn_file_t;
+
+/**
+ * Initialize a file handle
+ *
+ * Initializes a sbn_file_t structure.
+ *
+ * @param fh an uninitialized file handle.
+ * @param fp a file pointer.
+ * @param user_data callback data or NULL.
+ * @return the initialized file handle.
+ */
+extern sbn_file_t *sbn_init_file(sbn_file_t *fh, FILE *fp, void *user_data);
+
+/**
+ * Set an error message
+ *
+ * Formats and sets an error message.
+ *
+ * @param fh a file handle.
+ * @param format a printf format string followed by a variable number of
+ *               arguments.
+ */
+#ifdef __GNUC__
+extern void sbn_set_error(sbn_file_t *fh, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+#else
+extern void sbn_set_error(sbn_file_t *fh, const char *format, ...);
+#endif
+
+/**
+ * Read a spatial index
+ *
+ * Reads a file that has the file extension ".sbn".  The bins are stored in
+ * node order and are read sequentially, so the ".sbx" file is not needed.
+ *
+ * @param fh a file handle.
+ * @param[out] pindex on success, a pointer to a sbn_index_t structure.
+ *                    Free the index with @c free() when you are done.
+ * @retval 1 on success.
+ * @retval 0 on end of file.
+ * @retval -1 on error.
+ */
+extern int sbn_read_index(sbn_file_t *fh, sbn_index_t **pindex);
+
+/**
+ * Search a spatial index
+ *
+ * Returns the records whose scaled bounding boxes overlap a rectangle.  The
+ * records are candidates that have to be checked against the shapes.
+ *
+ * The record numbers are sorted and zero-based so that they can be passed to
+ * shx_seek_record.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * size_t *record_numbers, num_records, i;
+ * shx_record_t index;
+ * shp_record_t *record;
+ *
+ * if (sbn_search(sbn, x_min, y_min, x_max, y_max, &record_numbers,
+ *                &num_records) > 0) {
+ *   for (i = 0; i < num_records; ++i) {
+ *     if (shx_seek_record(shx_fh, record_numbers[i], &index) > 0 &&
+ *         shp_seek_record(shp_fh, index.file_offset, &record) > 0) {
+ *       // Do something
+ *       free(record);
+ *     }
+ *   }
+ *   free(record_numbers);
+ * }
+ * @endcode
+ *
+ * @param index a spatial index.
+ * @param x_min the minimum x coordinate of the rectangle.
+ * @param y_min the minimum y coordinate of the rectangle.
+ * @param x_max the maximum x coordinate of the rectangle.
+ * @param y_max the maximum y coordinate of the rectangle.
+ * @param[out] precord_numbers on success, an array of zero-based record
+ *                             numbers.  Free the array with @c free() when
+ *                             you are done.
+ * @param[out] pnum_records the number of record numbers.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see shx_seek_record
+ */
+extern int sbn_search(const sbn_index_t *index, double x_min, double y_min,
+                      double x_max, double y_max, size_t **precord_numbers,
+                      size_t *pnum_records);
+
+#endif
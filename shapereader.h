@@ -17,6 +17,18 @@
 #define _SHAPEREADER_SHAPEREADER_H
 
 #include "dbf.h"
+#include "qix.h"
+#include "sbn.h"
+#include "shp-bvh.h"
+#include "shp-cover.h"
+#include "shp-density.h"
+#include "shp-graph.h"
+#include "shp-hull.h"
+#include "shp-index.h"
+#include "shp-knn.h"
+#include "shp-pointgrid.h"
+#include "shp-rtree.h"
+#include "shp-transform.h"
 #include "shp.h"
 #include "shx.h"
 #include <stdlib.h>
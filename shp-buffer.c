@@ -0,0 +1,76 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-buffer.h"
+#include <assert.h>
+
+shp_buffer_t *
+shp_buffer_init(shp_buffer_t *buffer, size_t *parts, size_t max_parts,
+                shp_point_t *points, size_t max_points)
+{
+    assert(buffer != NULL);
+    assert(parts != NULL || max_parts == 0);
+    assert(points != NULL || max_points == 0);
+
+    buffer->max_parts = max_parts;
+    buffer->max_points = max_points;
+    buffer->num_parts = 0;
+    buffer->num_points = 0;
+    buffer->parts = parts;
+    buffer->points = points;
+
+    return buffer;
+}
+
+size_t
+shp_buffer_points(const shp_buffer_t *buffer, size_t part_num,
+                  size_t *start, size_t *end)
+{
+    size_t i, j, m;
+
+    assert(buffer != NULL);
+    assert(part_num < buffer->num_parts);
+    assert(part_num < buffer->max_parts);
+    assert(start != NULL);
+    assert(end != NULL);
+
+    m = buffer->num_points;
+    if (m > buffer->max_points) {
+        m = buffer->max_points;
+    }
+
+    i = buffer->parts[part_num];
+    if (part_num + 1 < buffer->num_parts &&
+        part_num + 1 < buffer->max_parts) {
+        j = buffer->parts[part_num + 1];
+    }
+    else {
+        j = buffer->num_points;
+    }
+    if (j > m) {
+        j = m;
+    }
+
+    *start = i;
+    *end = j;
+
+    /* Is the range valid? */
+    return (i < j) ? j - i : 0;
+}
+
+int
+shp_buffer_is_complete(const shp_buffer_t *buffer)
+{
+    assert(buffer != NULL);
+
+    return buffer->num_parts <= buffer->max_parts &&
+           buffer->num_points <= buffer->max_points;
+}
@@ -0,0 +1,92 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_BUFFER_H
+#define _SHAPEREADER_SHP_BUFFER_H
+
+#include "shp-point.h"
+#include <stddef.h>
+
+/**
+ * Output buffer
+ *
+ * A buffer that is provided by the caller and receives the parts and points
+ * of a shape, for example a clipped PolyLine.  The functions that write to
+ * the buffer do not allocate memory.
+ *
+ * If the buffer is too small, @a num_parts and @a num_points are set to the
+ * required sizes, but only @a max_parts and @a max_points elements are
+ * stored.
+ */
+typedef struct shp_buffer_t {
+    size_t max_parts;    /**< Capacity of @a parts */
+    size_t max_points;   /**< Capacity of @a points */
+    size_t num_parts;    /**< Number of parts */
+    size_t num_points;   /**< Total number of points */
+    size_t *parts;       /**< Index to first point in part */
+    shp_point_t *points; /**< X and Y coordinates */
+} shp_buffer_t;
+
+/**
+ * Initialize an output buffer
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * size_t parts[64];
+ * shp_point_t points[4096];
+ * shp_buffer_t buffer;
+ *
+ * shp_buffer_init(&buffer, parts, 64, points, 4096);
+ * @endcode
+ *
+ * @memberof shp_buffer_t
+ * @param buffer an uninitialized buffer.
+ * @param parts an array for the part indices.
+ * @param max_parts the number of elements in @p parts.
+ * @param points an array for the points.
+ * @param max_points the number of elements in @p points.
+ * @return the initialized buffer.
+ */
+extern shp_buffer_t *shp_buffer_init(shp_buffer_t *buffer, size_t *parts,
+                                     size_t max_parts, shp_point_t *points,
+                                     size_t max_points);
+
+/**
+ * Get the points that form a part
+ *
+ * Gets the indices for the points specified by @p part_num.
+ *
+ * @memberof shp_buffer_t
+ * @param buffer a buffer.
+ * @param part_num a zero-based part number.
+ * @param[out] start the range start.
+ * @param[out] end the range end (exclusive).
+ * @return the number of points in the part.
+ */
+extern size_t shp_buffer_points(const shp_buffer_t *buffer, size_t part_num,
+                                size_t *start, size_t *end);
+
+/**
+ * Check whether the buffer is big enough
+ *
+ * @memberof shp_buffer_t
+ * @param buffer a buffer.
+ * @retval 1 if all parts and points were stored.
+ * @retval 0 if the buffer is too small.
+ */
+extern int shp_buffer_is_complete(const shp_buffer_t *buffer);
+
+#endif
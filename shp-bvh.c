@@ -0,0 +1,776 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-bvh.h"
+#include "shp-mesh.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void)(x)
+
+#define NUM_BINS 16
+#define MAX_LEAF_SIZE 4
+#define MAX_DEPTH 64
+
+typedef struct builder_t {
+    size_t num_triangles;
+    size_t max_triangles;
+    shp_triangle_t *triangles;
+} builder_t;
+
+typedef struct item_t {
+    double min[3];
+    double max[3];
+    double centroid[3];
+    size_t triangle_num;
+} item_t;
+
+typedef struct task_t {
+    size_t node_num;
+    size_t start;
+    size_t count;
+    size_t depth;
+} task_t;
+
+typedef struct bin_t {
+    double min[3];
+    double max[3];
+    size_t count;
+} bin_t;
+
+typedef struct ray_t {
+    double origin[3];
+    double direction[3];
+    double inverse[3];
+} ray_t;
+
+static void
+empty_box(double min[3], double max[3])
+{
+    int k;
+
+    for (k = 0; k < 3; ++k) {
+        min[k] = HUGE_VAL;
+        max[k] = -HUGE_VAL;
+    }
+}
+
+static void
+extend_box(double min[3], double max[3], const double other_min[3],
+           const double other_max[3])
+{
+    int k;
+
+    for (k = 0; k < 3; ++k) {
+        if (other_min[k] < min[k]) {
+            min[k] = other_min[k];
+        }
+        if (other_max[k] > max[k]) {
+            max[k] = other_max[k];
+        }
+    }
+}
+
+/* Half of the surface area */
+static double
+box_area(const double min[3], const double max[3])
+{
+    double dx, dy, dz;
+
+    if (min[0] > max[0]) {
+        return 0.0;
+    }
+    dx = max[0] - min[0];
+    dy = max[1] - min[1];
+    dz = max[2] - min[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static void
+get_node_box(const shp_bvh_node_t *node, double min[3], double max[3])
+{
+    min[0] = node->x_min;
+    min[1] = node->y_min;
+    min[2] = node->z_min;
+    max[0] = node->x_max;
+    max[1] = node->y_max;
+    max[2] = node->z_max;
+}
+
+static void
+set_node_box(shp_bvh_node_t *node, const double min[3], const double max[3])
+{
+    node->x_min = min[0];
+    node->y_min = min[1];
+    node->z_min = min[2];
+    node->x_max = max[0];
+    node->y_max = max[1];
+    node->z_max = max[2];
+}
+
+static void
+get_coords(const shp_pointz_t *point, double coords[3])
+{
+    coords[0] = point->x;
+    coords[1] = point->y;
+    coords[2] = point->z;
+}
+
+static size_t
+get_bin(const item_t *item, int axis, double c_min, double scale)
+{
+    size_t i;
+
+    i = (size_t) ((item->centroid[axis] - c_min) * scale);
+    return (i < NUM_BINS) ? i : NUM_BINS - 1;
+}
+
+/*
+ * Finds the split with the lowest surface area heuristic.  Returns 0 if the
+ * items cannot be split.
+ */
+static int
+find_split(const item_t *items, size_t count, int *split_axis,
+           size_t *split_bin, double *split_c_min, double *split_scale)
+{
+    bin_t bins[NUM_BINS];
+    double c_min[3], c_max[3], min[3], max[3];
+    double right_area[NUM_BINS], scale, cost, best_cost;
+    size_t right_count[NUM_BINS], left_count, i, b;
+    int axis, found = 0;
+
+    empty_box(c_min, c_max);
+    for (i = 0; i < count; ++i) {
+        extend_box(c_min, c_max, items[i].centroid, items[i].centroid);
+    }
+
+    best_cost = HUGE_VAL;
+    for (axis = 0; axis < 3; ++axis) {
+        if (!(c_max[axis] > c_min[axis])) {
+            continue;
+        }
+        scale = NUM_BINS / (c_max[axis] - c_min[axis]);
+
+        for (b = 0; b < NUM_BINS; ++b) {
+            empty_box(bins[b].min, bins[b].max);
+            bins[b].count = 0;
+        }
+        for (i = 0; i < count; ++i) {
+            b = get_bin(&items[i], axis, c_min[axis], scale);
+            extend_box(bins[b].min, bins[b].max, items[i].min, items[i].max);
+            ++bins[b].count;
+        }
+
+        /* Sweep from the right */
+        empty_box(min, max);
+        right_count[NUM_BINS - 1] = 0;
+        right_area[NUM_BINS - 1] = 0.0;
+        for (b = NUM_BINS - 1; b > 0; --b) {
+            extend_box(min, max, bins[b].min, bins[b].max);
+            right_count[b - 1] = right_count[b] + bins[b].count;
+            right_area[b - 1] = box_area(min, max);
+        }
+
+        /* Sweep from the left */
+        empty_box(min, max);
+        left_count = 0;
+        for (b = 0; b < NUM_BINS - 1; ++b) {
+            extend_box(min, max, bins[b].min, bins[b].max);
+            left_count += bins[b].count;
+            if (left_count == 0 || right_count[b] == 0) {
+                continue;
+            }
+            cost = box_area(min, max) * (double) left_count +
+                   right_area[b] * (double) right_count[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                *split_axis = axis;
+                *split_bin = b;
+                *split_c_min = c_min[axis];
+                *split_scale = scale;
+                found = 1;
+            }
+        }
+    }
+
+    return found;
+}
+
+static void
+build_nodes(shp_bvh_t *bvh, item_t *items, task_t *tasks)
+{
+    shp_bvh_node_t *node;
+    task_t task;
+    item_t tmp;
+    double min[3], max[3], c_min, scale;
+    size_t num_tasks, i, j, end, bin;
+    int axis;
+
+    if (bvh->num_triangles == 0) {
+        return;
+    }
+
+    bvh->num_nodes = 1;
+    tasks[0].node_num = 0;
+    tasks[0].start = 0;
+    tasks[0].count = bvh->num_triangles;
+    tasks[0].depth = 0;
+    num_tasks = 1;
+
+    while (num_tasks > 0) {
+        task = tasks[--num_tasks];
+        node = &bvh->nodes[task.node_num];
+        end = task.start + task.count;
+
+        empty_box(min, max);
+        for (i = task.start; i < end; ++i) {
+            extend_box(min, max, items[i].min, items[i].max);
+        }
+        set_node_box(node, min, max);
+        node->start = task.start;
+        node->count = task.count;
+
+        if (task.count <= MAX_LEAF_SIZE || task.depth >= MAX_DEPTH ||
+            !find_split(&items[task.start], task.count, &axis, &bin, &c_min,
+                        &scale)) {
+            continue;
+        }
+
+        /* Move the items in the left bins to the front */
+        i = task.start;
+        j = end;
+        while (i < j) {
+            if (get_bin(&items[i], axis, c_min, scale) <= bin) {
+                ++i;
+            }
+            else {
+                --j;
+                tmp = items[i];
+                items[i] = items[j];
+                items[j] = tmp;
+            }
+        }
+
+        node->start = bvh->num_nodes;
+        node->count = 0;
+        bvh->num_nodes += 2;
+
+        tasks[num_tasks].node_num = node->start + 1;
+        tasks[num_tasks].start = i;
+        tasks[num_tasks].count = end - i;
+        tasks[num_tasks].depth = task.depth + 1;
+        ++num_tasks;
+
+        tasks[num_tasks].node_num = node->start;
+        tasks[num_tasks].start = task.start;
+        tasks[num_tasks].count = i - task.start;
+        tasks[num_tasks].depth = task.depth + 1;
+        ++num_tasks;
+    }
+}
+
+static shp_bvh_t *
+build_bvh(shp_file_t *fh, const builder_t *builder)
+{
+    shp_bvh_t *bvh = NULL;
+    item_t *items = NULL;
+    task_t *tasks = NULL;
+    const shp_triangle_t *triangle;
+    double coords[3];
+    size_t n, max_nodes, size, i;
+    int j, k;
+
+    n = builder->num_triangles;
+    max_nodes = (n > 0) ? 2 * n - 1 : 0;
+
+    if (n > (SIZE_MAX - sizeof(*bvh)) /
+                (2 * sizeof(*bvh->nodes) + sizeof(*bvh->triangles)) ||
+        n > SIZE_MAX / (sizeof(*items) + sizeof(*tasks))) {
+        shp_set_error(fh, "Cannot allocate memory");
+        errno = ENOMEM;
+        goto cleanup;
+    }
+
+    size = sizeof(*bvh) + max_nodes * sizeof(*bvh->nodes) +
+           n * sizeof(*bvh->triangles);
+    bvh = (shp_bvh_t *) malloc(size);
+    if (bvh == NULL) {
+        shp_set_error(fh, "Cannot allocate %zu bytes", size);
+        goto cleanup;
+    }
+    bvh->num_nodes = 0;
+    bvh->num_triangles = n;
+    bvh->triangles = (shp_triangle_t *) (bvh + 1);
+    bvh->nodes = (shp_bvh_node_t *) (bvh->triangles + n);
+
+    if (n > 0) {
+        size = n * (sizeof(*items) + sizeof(*tasks));
+        items = (item_t *) malloc(n * sizeof(*items));
+        tasks = (task_t *) malloc(n * sizeof(*tasks));
+        if (items == NULL || tasks == NULL) {
+            shp_set_error(fh, "Cannot allocate %zu bytes", size);
+            free(bvh);
+            bvh = NULL;
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < n; ++i) {
+        triangle = &builder->triangles[i];
+        empty_box(items[i].min, items[i].max);
+        for (j = 0; j < 3; ++j) {
+            get_coords(&triangle->points[j], coords);
+            extend_box(items[i].min, items[i].max, coords, coords);
+        }
+        for (k = 0; k < 3; ++k) {
+            items[i].centroid[k] = 0.5 * (items[i].min[k] + items[i].max[k]);
+        }
+        items[i].triangle_num = i;
+    }
+
+    build_nodes(bvh, items, tasks);
+
+    for (i = 0; i < n; ++i) {
+        bvh->triangles[i] = builder->triangles[items[i].triangle_num];
+    }
+
+cleanup:
+
+    free(tasks);
+    free(items);
+
+    return bvh;
+}
+
+static int
+add_mesh(builder_t *builder, const shp_mesh_t *mesh, size_t record_number)
+{
+    size_t num_triangles, max_triangles, i;
+    shp_triangle_t *triangles, *triangle;
+    const size_t *indices;
+
+    if (mesh->num_triangles > SIZE_MAX / sizeof(*triangles) -
+                                  builder->num_triangles) {
+        errno = ENOMEM;
+        return -1;
+    }
+    num_triangles = builder->num_triangles + mesh->num_triangles;
+
+    if (num_triangles > builder->max_triangles) {
+        max_triangles = (builder->max_triangles > 0)
+                            ? builder->max_triangles
+                            : 64;
+        while (max_triangles < num_triangles &&
+               max_triangles <= SIZE_MAX / sizeof(*triangles) / 2) {
+            max_triangles *= 2;
+        }
+        if (max_triangles < num_triangles) {
+            max_triangles = num_triangles;
+        }
+        triangles = (shp_triangle_t *) realloc(
+            builder->triangles, max_triangles * sizeof(*triangles));
+        if (triangles == NULL) {
+            return -1;
+        }
+        builder->triangles = triangles;
+        builder->max_triangles = max_triangles;
+    }
+
+    for (i = 0; i < mesh->num_triangles; ++i) {
+        triangle = &builder->triangles[builder->num_triangles++];
+        indices = &mesh->indices[3 * i];
+        triangle->points[0] = mesh->vertices[indices[0]];
+        triangle->points[1] = mesh->vertices[indices[1]];
+        triangle->points[2] = mesh->vertices[indices[2]];
+        triangle->record_number = record_number;
+    }
+
+    return 1;
+}
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    UNUSED(fh);
+    UNUSED(header);
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    builder_t *builder = (builder_t *) fh->user_data;
+    shp_mesh_t *mesh;
+    int rc;
+
+    UNUSED(header);
+    UNUSED(file_offset);
+
+    switch (record->type) {
+    case SHP_TYPE_NULL:
+        return 1;
+    case SHP_TYPE_MULTIPATCH:
+        break;
+    default:
+        shp_set_error(fh, "Shape type %d is not a MultiPatch in record %zu",
+                      (int) record->type, record->record_number);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (shp_multipatch_mesh(&record->shape.multipatch, &mesh) < 0) {
+        shp_set_error(fh, "Cannot allocate memory in record %zu",
+                      record->record_number);
+        return -1;
+    }
+    rc = add_mesh(builder, mesh, record->record_number);
+    free(mesh);
+    if (rc < 0) {
+        shp_set_error(fh, "Cannot allocate memory in record %zu",
+                      record->record_number);
+    }
+    return rc;
+}
+
+int
+shp_bvh_read(shp_file_t *fh, shp_bvh_t **pbvh)
+{
+    int rc;
+    builder_t builder;
+    void *user_data;
+
+    assert(fh != NULL);
+    assert(pbvh != NULL);
+
+    *pbvh = NULL;
+
+    memset(&builder, 0, sizeof(builder));
+
+    user_data = fh->user_data;
+    fh->user_data = &builder;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc >= 0) {
+        *pbvh = build_bvh(fh, &builder);
+        rc = (*pbvh != NULL) ? 1 : -1;
+    }
+
+    free(builder.triangles);
+
+    return rc;
+}
+
+/*
+ * Returns the distance at which the ray enters the box or a negative value
+ * if the ray misses the box.
+ */
+static double
+hit_box(const shp_bvh_node_t *node, const ray_t *ray, double max_t)
+{
+    double min[3], max[3], t0, t1, a, b;
+    int k;
+
+    get_node_box(node, min, max);
+
+    t0 = 0.0;
+    t1 = max_t;
+    for (k = 0; k < 3; ++k) {
+        if (ray->direction[k] == 0.0) {
+            if (ray->origin[k] < min[k] || ray->origin[k] > max[k]) {
+                return -1.0;
+            }
+        }
+        else {
+            a = (min[k] - ray->origin[k]) * ray->inverse[k];
+            b = (max[k] - ray->origin[k]) * ray->inverse[k];
+            if (a > b) {
+                t0 = (b > t0) ? b : t0;
+                t1 = (a < t1) ? a : t1;
+            }
+            else {
+                t0 = (a > t0) ? a : t0;
+                t1 = (b < t1) ? b : t1;
+            }
+            if (t0 > t1) {
+                return -1.0;
+            }
+        }
+    }
+    return t0;
+}
+
+static void
+subtract(const double a[3], const double b[3], double c[3])
+{
+    c[0] = a[0] - b[0];
+    c[1] = a[1] - b[1];
+    c[2] = a[2] - b[2];
+}
+
+static void
+cross(const double a[3], const double b[3], double c[3])
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double
+dot(const double a[3], const double b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static int
+hit_triangle(const shp_triangle_t *triangle, const ray_t *ray, double max_t,
+             shp_hit_t *hit)
+{
+    double p0[3], p1[3], p2[3], e1[3], e2[3], p[3], q[3], s[3];
+    double det, inv_det, t, u, v;
+
+    get_coords(&triangle->points[0], p0);
+    get_coords(&triangle->points[1], p1);
+    get_coords(&triangle->points[2], p2);
+    subtract(p1, p0, e1);
+    subtract(p2, p0, e2);
+
+    cross(ray->direction, e2, p);
+    det = dot(e1, p);
+    if (det == 0.0) {
+        return 0;
+    }
+    inv_det = 1.0 / det;
+
+    subtract(ray->origin, p0, s);
+    u = dot(s, p) * inv_det;
+    if (u < 0.0 || u > 1.0) {
+        return 0;
+    }
+
+    cross(s, e1, q);
+    v = dot(ray->direction, q) * inv_det;
+    if (v < 0.0 || u + v > 1.0) {
+        return 0;
+    }
+
+    t = dot(e2, q) * inv_det;
+    if (!(t > 0.0 && t <= max_t)) {
+        return 0;
+    }
+
+    hit->t = t;
+    hit->u = u;
+    hit->v = v;
+    return 1;
+}
+
+int
+shp_bvh_ray(const shp_bvh_t *bvh, const double origin[3],
+            const double direction[3], double max_t, shp_hit_t *hit)
+{
+    size_t stack[MAX_DEPTH + 1], n, node_num, i, end;
+    const shp_bvh_node_t *node;
+    ray_t ray;
+    shp_hit_t candidate;
+    double t0, t1;
+    int k, found = 0;
+
+    assert(bvh != NULL);
+    assert(origin != NULL);
+    assert(direction != NULL);
+    assert(hit != NULL);
+
+    if (bvh->num_nodes == 0) {
+        return 0;
+    }
+
+    for (k = 0; k < 3; ++k) {
+        ray.origin[k] = origin[k];
+        ray.direction[k] = direction[k];
+        ray.inverse[k] =
+            (direction[k] != 0.0) ? 1.0 / direction[k] : HUGE_VAL;
+    }
+
+    n = 0;
+    if (hit_box(&bvh->nodes[0], &ray, max_t) >= 0.0) {
+        stack[n++] = 0;
+    }
+    while (n > 0) {
+        node = &bvh->nodes[stack[--n]];
+        if (node->count > 0) {
+            end = node->start + node->count;
+            for (i = node->start; i < end; ++i) {
+                if (hit_triangle(&bvh->triangles[i], &ray, max_t,
+                                 &candidate) &&
+                    (!found || candidate.t < hit->t)) {
+                    candidate.triangle_num = i;
+                    *hit = candidate;
+                    max_t = candidate.t;
+                    found = 1;
+                }
+            }
+        }
+        else {
+            /* Visit the nearer child first */
+            node_num = node->start;
+            t0 = hit_box(&bvh->nodes[node_num], &ray, max_t);
+            t1 = hit_box(&bvh->nodes[node_num + 1], &ray, max_t);
+            if (t0 >= 0.0 && t1 >= 0.0) {
+                if (t0 <= t1) {
+                    stack[n++] = node_num + 1;
+                    stack[n++] = node_num;
+                }
+                else {
+                    stack[n++] = node_num;
+                    stack[n++] = node_num + 1;
+                }
+            }
+            else if (t0 >= 0.0) {
+                stack[n++] = node_num;
+            }
+            else if (t1 >= 0.0) {
+                stack[n++] = node_num + 1;
+            }
+        }
+    }
+
+    return found;
+}
+
+static int
+is_separating_axis(double v[3][3], const double axis[3],
+                   const double half[3])
+{
+    double p0, p1, p2, p_min, p_max, r;
+
+    p0 = dot(v[0], axis);
+    p1 = dot(v[1], axis);
+    p2 = dot(v[2], axis);
+    p_min = (p0 < p1) ? p0 : p1;
+    p_min = (p2 < p_min) ? p2 : p_min;
+    p_max = (p0 > p1) ? p0 : p1;
+    p_max = (p2 > p_max) ? p2 : p_max;
+    r = half[0] * fabs(axis[0]) + half[1] * fabs(axis[1]) +
+        half[2] * fabs(axis[2]);
+    return p_min > r || p_max < -r;
+}
+
+static int
+overlaps_triangle(const shp_triangle_t *triangle, const double center[3],
+                  const double half[3])
+{
+    double v[3][3], e[3][3], axis[3], unit[3];
+    int i, k;
+
+    for (i = 0; i < 3; ++i) {
+        get_coords(&triangle->points[i], v[i]);
+        subtract(v[i], center, v[i]);
+    }
+    for (i = 0; i < 3; ++i) {
+        subtract(v[(i + 1) % 3], v[i], e[i]);
+    }
+
+    /* The box's face normals */
+    for (k = 0; k < 3; ++k) {
+        unit[0] = 0.0;
+        unit[1] = 0.0;
+        unit[2] = 0.0;
+        unit[k] = 1.0;
+        if (is_separating_axis(v, unit, half)) {
+            return 0;
+        }
+    }
+
+    /* The triangle's normal */
+    cross(e[0], e[1], axis);
+    if (is_separating_axis(v, axis, half)) {
+        return 0;
+    }
+
+    /* The cross products of the edges */
+    for (i = 0; i < 3; ++i) {
+        for (k = 0; k < 3; ++k) {
+            unit[0] = 0.0;
+            unit[1] = 0.0;
+            unit[2] = 0.0;
+            unit[k] = 1.0;
+            cross(e[i], unit, axis);
+            if (is_separating_axis(v, axis, half)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static int
+overlaps_box(const shp_bvh_node_t *node, const double box_min[3],
+             const double box_max[3])
+{
+    return node->x_min <= box_max[0] && node->x_max >= box_min[0] &&
+           node->y_min <= box_max[1] && node->y_max >= box_min[1] &&
+           node->z_min <= box_max[2] && node->z_max >= box_min[2];
+}
+
+int
+shp_bvh_box(const shp_bvh_t *bvh, const double box_min[3],
+            const double box_max[3], shp_bvh_callback_t callback,
+            void *user_data)
+{
+    size_t stack[MAX_DEPTH + 1], n, i, end;
+    const shp_bvh_node_t *node;
+    double center[3], half[3];
+    int k;
+
+    assert(bvh != NULL);
+    assert(box_min != NULL);
+    assert(box_max != NULL);
+    assert(callback != NULL);
+
+    if (bvh->num_nodes == 0) {
+        return 1;
+    }
+
+    for (k = 0; k < 3; ++k) {
+        center[k] = 0.5 * (box_min[k] + box_max[k]);
+        half[k] = 0.5 * (box_max[k] - box_min[k]);
+    }
+
+    n = 0;
+    stack[n++] = 0;
+    while (n > 0) {
+        node = &bvh->nodes[stack[--n]];
+        if (!overlaps_box(node, box_min, box_max)) {
+            continue;
+        }
+        if (node->count > 0) {
+            end = node->start + node->count;
+            for (i = node->start; i < end; ++i) {
+                if (overlaps_triangle(&bvh->triangles[i], center, half) &&
+                    !(*callback)(bvh, i, user_data)) {
+                    return 0;
+                }
+            }
+        }
+        else {
+            stack[n++] = node->start + 1;
+            stack[n++] = node->start;
+        }
+    }
+
+    return 1;
+}
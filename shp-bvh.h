@@ -0,0 +1,199 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_BVH_H
+#define _SHAPEREADER_SHP_BVH_H
+
+#include "shp-pointz.h"
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Triangle
+ */
+typedef struct shp_triangle_t {
+    shp_pointz_t points[3]; /**< Vertices */
+    size_t record_number;   /**< Record number (beginning at 1) */
+} shp_triangle_t;
+
+/**
+ * Node in a bounding volume hierarchy
+ *
+ * A leaf contains the triangles @a start to @a start + @a count - 1.  An
+ * inner node has the count 0 and the children @a start and @a start + 1.
+ */
+typedef struct shp_bvh_node_t {
+    double x_min; /**< Minimum X coordinate */
+    double y_min; /**< Minimum Y coordinate */
+    double z_min; /**< Minimum Z coordinate */
+    double x_max; /**< Maximum X coordinate */
+    double y_max; /**< Maximum Y coordinate */
+    double z_max; /**< Maximum Z coordinate */
+    size_t start; /**< First triangle or first child */
+    size_t count; /**< Number of triangles */
+} shp_bvh_node_t;
+
+/**
+ * Bounding volume hierarchy
+ *
+ * A tree of axis-aligned bounding boxes over the triangles of all
+ * MultiPatches in a file.  Node 0 is the root.
+ */
+typedef struct shp_bvh_t {
+    size_t num_nodes;          /**< Number of nodes */
+    size_t num_triangles;      /**< Number of triangles */
+    shp_bvh_node_t *nodes;     /**< Nodes */
+    shp_triangle_t *triangles; /**< Triangles ordered by leaf */
+} shp_bvh_t;
+
+/**
+ * Ray hit
+ *
+ * The hit point is @c origin + @a t * @c direction.
+ */
+typedef struct shp_hit_t {
+    size_t triangle_num; /**< Zero-based triangle number */
+    double t;            /**< Distance along the ray */
+    double u;            /**< Barycentric weight of the second vertex */
+    double v;            /**< Barycentric weight of the third vertex */
+} shp_hit_t;
+
+/**
+ * Callback for box queries
+ *
+ * @param bvh a bounding volume hierarchy.
+ * @param triangle_num a zero-based triangle number.
+ * @param user_data callback data.
+ * @retval 1 to continue the query.
+ * @retval 0 to stop the query.
+ */
+typedef int (*shp_bvh_callback_t)(const shp_bvh_t *bvh, size_t triangle_num,
+                                  void *user_data);
+
+/**
+ * Build a bounding volume hierarchy from a file with MultiPatches
+ *
+ * Reads a file that has the file extension ".shp" and contains
+ * MultiPatches.  The MultiPatches are converted into triangles with
+ * shp_multipatch_mesh, which takes the Z coordinates from the z_array.
+ * Null shapes are skipped.
+ *
+ * The triangles are split recursively along the axis and at the position
+ * that minimize the surface area heuristic.  The positions are taken from
+ * 16 bins per axis.  Leaves contain up to 4 triangles unless the triangles
+ * cannot be split.
+ *
+ * The hierarchy is allocated in a single block of memory that has to be
+ * freed with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_bvh_t *bvh;
+ *
+ * shp_init_file(&fh, stream, NULL);
+ * if (shp_bvh_read(&fh, &bvh) > 0) {
+ *   // Do something
+ *   free(bvh);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param[out] pbvh on success, a pointer to a shp_bvh_t structure.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see "On fast Construction of SAH-based Bounding Volume Hierarchies"
+ *      @cite Wald for a description of binning.
+ */
+extern int shp_bvh_read(shp_file_t *fh, shp_bvh_t **pbvh);
+
+/**
+ * Cast a ray
+ *
+ * Finds the nearest triangle that is hit by a ray at a distance greater
+ * than 0 and not greater than @p max_t.  The distance is measured in
+ * multiples of @p direction.  Triangles are hit from both sides.  The
+ * subtrees whose bounding boxes are missed by the ray or are farther away
+ * than the nearest hit so far are skipped.  No memory is allocated.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * // Check the line of sight between two points
+ * double direction[3];
+ * shp_hit_t hit;
+ *
+ * direction[0] = target[0] - origin[0];
+ * direction[1] = target[1] - origin[1];
+ * direction[2] = target[2] - origin[2];
+ * if (shp_bvh_ray(bvh, origin, direction, 1.0, &hit)) {
+ *   // The view is blocked by bvh->triangles[hit.triangle_num]
+ * }
+ * @endcode
+ *
+ * @memberof shp_bvh_t
+ * @param bvh a bounding volume hierarchy.
+ * @param origin the X, Y and Z coordinates of the ray's origin.
+ * @param direction the ray's direction.
+ * @param max_t the maximum distance.
+ * @param[out] hit the nearest hit.
+ * @retval 1 if a triangle is hit.
+ * @retval 0 if no triangle is hit.
+ *
+ * @see "Fast, Minimum Storage Ray-Triangle Intersection"
+ *      @cite Moller_Trumbore
+ */
+extern int shp_bvh_ray(const shp_bvh_t *bvh, const double origin[3],
+                       const double direction[3], double max_t,
+                       shp_hit_t *hit);
+
+/**
+ * Find the triangles that intersect a box
+ *
+ * Calls a function for every triangle that intersects or touches an
+ * axis-aligned box.  The triangles are tested with the separating axis
+ * theorem.  No memory is allocated.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * int
+ * count_triangles(const shp_bvh_t *bvh, size_t triangle_num, void *data)
+ * {
+ *   ++*(size_t *) data;
+ *   return 1;
+ * }
+ *
+ * size_t count = 0;
+ * shp_bvh_box(bvh, box_min, box_max, count_triangles, &count);
+ * @endcode
+ *
+ * @memberof shp_bvh_t
+ * @param bvh a bounding volume hierarchy.
+ * @param box_min the box's minimum X, Y and Z coordinates.
+ * @param box_max the box's maximum X, Y and Z coordinates.
+ * @param callback a function that is called for every triangle.
+ * @param user_data callback data or NULL.
+ * @retval 1 if all triangles were found.
+ * @retval 0 if the callback stopped the query.
+ *
+ * @see "Fast 3D Triangle-Box Overlap Testing" @cite Akenine-Moller
+ */
+extern int shp_bvh_box(const shp_bvh_t *bvh, const double box_min[3],
+                       const double box_max[3], shp_bvh_callback_t callback,
+                       void *user_data);
+
+#endif
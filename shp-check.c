@@ -0,0 +1,781 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-check.h"
+#include "parts.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NIL SIZE_MAX
+
+/* The end points are ordered from left to right and from bottom to top. */
+typedef struct segment_t {
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+    size_t part_num;
+    size_t point_num;
+} segment_t;
+
+typedef struct event_t {
+    double x;
+    double y;
+    size_t segment;
+    int is_end;
+} event_t;
+
+/*
+ * A segment that leaves a point.  The two edges of a vertex or of a segment
+ * that passes through the point form a pair.
+ */
+typedef struct edge_t {
+    double dx;
+    double dy;
+    size_t pair;
+    size_t part_num;
+    size_t point_num;
+} edge_t;
+
+/*
+ * The segments that intersect the sweep line are stored in a treap.  The
+ * nodes are identified by their segment numbers.
+ */
+typedef struct tree_t {
+    const segment_t *segments;
+    size_t *left;
+    size_t *right;
+    size_t *parent;
+    size_t root;
+    double x; /* Current event point */
+    double y;
+} tree_t;
+
+static void
+set_problem(shp_problem_t *problem, shp_problem_type_t type,
+            size_t part_num, size_t point_num)
+{
+    problem->type = type;
+    problem->part_num = part_num;
+    problem->point_num = point_num;
+    problem->other_part_num = part_num;
+    problem->other_point_num = point_num;
+}
+
+static int
+check_rings(const shp_parts_t *view, shp_problem_t *problem)
+{
+    size_t part_num, i, start, end;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) < 4) {
+            set_problem(problem, SHP_PROBLEM_TOO_FEW_POINTS, part_num,
+                        start);
+            return 0;
+        }
+        if (shp_parts_x(view, start) != shp_parts_x(view, end - 1) ||
+            shp_parts_y(view, start) != shp_parts_y(view, end - 1)) {
+            set_problem(problem, SHP_PROBLEM_UNCLOSED_RING, part_num,
+                        end - 1);
+            return 0;
+        }
+        for (i = start + 1; i < end; ++i) {
+            if (shp_parts_x(view, i) == shp_parts_x(view, i - 1) &&
+                shp_parts_y(view, i) == shp_parts_y(view, i - 1)) {
+                set_problem(problem, SHP_PROBLEM_DUPLICATE_POINT, part_num,
+                            i);
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static int
+is_before(double x0, double y0, double x1, double y1)
+{
+    return x0 < x1 || (x0 == x1 && y0 < y1);
+}
+
+static size_t
+get_segments(const shp_parts_t *view, segment_t *segments)
+{
+    size_t num_segments, part_num, i, start, end;
+    double x0, y0, x1, y1;
+    segment_t *segment;
+
+    num_segments = 0;
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        shp_parts_points(view, part_num, &start, &end);
+        for (i = start; i + 1 < end; ++i) {
+            x0 = shp_parts_x(view, i);
+            y0 = shp_parts_y(view, i);
+            x1 = shp_parts_x(view, i + 1);
+            y1 = shp_parts_y(view, i + 1);
+            segment = &segments[num_segments];
+            if (is_before(x0, y0, x1, y1)) {
+                segment->x0 = x0;
+                segment->y0 = y0;
+                segment->x1 = x1;
+                segment->y1 = y1;
+            }
+            else {
+                segment->x0 = x1;
+                segment->y0 = y1;
+                segment->x1 = x0;
+                segment->y1 = y0;
+            }
+            segment->part_num = part_num;
+            segment->point_num = i;
+            ++num_segments;
+        }
+    }
+
+    return num_segments;
+}
+
+static int
+compare_events(const void *a, const void *b)
+{
+    const event_t *e1 = (const event_t *) a;
+    const event_t *e2 = (const event_t *) b;
+
+    if (e1->x != e2->x) {
+        return (e1->x < e2->x) ? -1 : 1;
+    }
+    if (e1->y != e2->y) {
+        return (e1->y < e2->y) ? -1 : 1;
+    }
+    /* Remove segments before new segments are added */
+    if (e1->is_end != e2->is_end) {
+        return e1->is_end ? -1 : 1;
+    }
+    if (e1->segment != e2->segment) {
+        return (e1->segment < e2->segment) ? -1 : 1;
+    }
+    return 0;
+}
+
+static double
+get_y(const segment_t *segment, double x, double y)
+{
+    /* Vertical segments are cut where the sweep line currently is */
+    if (segment->x0 == segment->x1) {
+        if (y < segment->y0) {
+            return segment->y0;
+        }
+        if (y > segment->y1) {
+            return segment->y1;
+        }
+        return y;
+    }
+    if (x <= segment->x0) {
+        return segment->y0;
+    }
+    if (x >= segment->x1) {
+        return segment->y1;
+    }
+    return segment->y0 + (x - segment->x0) * (segment->y1 - segment->y0) /
+                             (segment->x1 - segment->x0);
+}
+
+static double
+get_slope(const segment_t *segment)
+{
+    if (segment->x0 == segment->x1) {
+        return HUGE_VAL;
+    }
+    return (segment->y1 - segment->y0) / (segment->x1 - segment->x0);
+}
+
+/*
+ * Compares two segments right of the current event point.
+ */
+static int
+compare_segments(const tree_t *tree, size_t a, size_t b)
+{
+    const segment_t *s1 = &tree->segments[a];
+    const segment_t *s2 = &tree->segments[b];
+    double y1, y2;
+
+    y1 = get_y(s1, tree->x, tree->y);
+    y2 = get_y(s2, tree->x, tree->y);
+    if (y1 != y2) {
+        return (y1 < y2) ? -1 : 1;
+    }
+    y1 = get_slope(s1);
+    y2 = get_slope(s2);
+    if (y1 != y2) {
+        return (y1 < y2) ? -1 : 1;
+    }
+    return (a < b) ? -1 : 1;
+}
+
+static uint32_t
+get_priority(size_t node)
+{
+    uint32_t h = (uint32_t) node;
+
+    h ^= h >> 16;
+    h *= UINT32_C(0x45d9f3b);
+    h ^= h >> 16;
+    h *= UINT32_C(0x45d9f3b);
+    h ^= h >> 16;
+    return h;
+}
+
+/*
+ * Moves a node above its parent.
+ */
+static void
+rotate(tree_t *tree, size_t node)
+{
+    size_t parent, grandparent, child;
+
+    parent = tree->parent[node];
+    grandparent = tree->parent[parent];
+    if (tree->left[parent] == node) {
+        child = tree->right[node];
+        tree->left[parent] = child;
+        tree->right[node] = parent;
+    }
+    else {
+        child = tree->left[node];
+        tree->right[parent] = child;
+        tree->left[node] = parent;
+    }
+    if (child != NIL) {
+        tree->parent[child] = parent;
+    }
+    tree->parent[parent] = node;
+    tree->parent[node] = grandparent;
+    if (grandparent == NIL) {
+        tree->root = node;
+    }
+    else if (tree->left[grandparent] == parent) {
+        tree->left[grandparent] = node;
+    }
+    else {
+        tree->right[grandparent] = node;
+    }
+}
+
+static void
+insert_node(tree_t *tree, size_t node)
+{
+    size_t parent, next;
+    int c = 0;
+
+    tree->left[node] = NIL;
+    tree->right[node] = NIL;
+
+    parent = NIL;
+    next = tree->root;
+    while (next != NIL) {
+        parent = next;
+        c = compare_segments(tree, node, next);
+        if (c < 0) {
+            next = tree->left[next];
+        }
+        else {
+            next = tree->right[next];
+        }
+    }
+
+    tree->parent[node] = parent;
+    if (parent == NIL) {
+        tree->root = node;
+    }
+    else if (c < 0) {
+        tree->left[parent] = node;
+    }
+    else {
+        tree->right[parent] = node;
+    }
+
+    while (tree->parent[node] != NIL &&
+           get_priority(node) > get_priority(tree->parent[node])) {
+        rotate(tree, node);
+    }
+}
+
+static void
+remove_node(tree_t *tree, size_t node)
+{
+    size_t left, right, parent;
+
+    /* Move the node down until it is a leaf */
+    for (;;) {
+        left = tree->left[node];
+        right = tree->right[node];
+        if (left == NIL && right == NIL) {
+            break;
+        }
+        if (right == NIL ||
+            (left != NIL && get_priority(left) > get_priority(right))) {
+            rotate(tree, left);
+        }
+        else {
+            rotate(tree, right);
+        }
+    }
+
+    parent = tree->parent[node];
+    if (parent == NIL) {
+        tree->root = NIL;
+    }
+    else if (tree->left[parent] == node) {
+        tree->left[parent] = NIL;
+    }
+    else {
+        tree->right[parent] = NIL;
+    }
+}
+
+static size_t
+get_prev(const tree_t *tree, size_t node)
+{
+    size_t next;
+
+    next = tree->left[node];
+    if (next != NIL) {
+        while (tree->right[next] != NIL) {
+            next = tree->right[next];
+        }
+        return next;
+    }
+    next = tree->parent[node];
+    while (next != NIL && tree->left[next] == node) {
+        node = next;
+        next = tree->parent[node];
+    }
+    return next;
+}
+
+static size_t
+get_next(const tree_t *tree, size_t node)
+{
+    size_t next;
+
+    next = tree->right[node];
+    if (next != NIL) {
+        while (tree->left[next] != NIL) {
+            next = tree->left[next];
+        }
+        return next;
+    }
+    next = tree->parent[node];
+    while (next != NIL && tree->right[next] == node) {
+        node = next;
+        next = tree->parent[node];
+    }
+    return next;
+}
+
+static double
+orient(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+/*
+ * Returns true if two segments cross or overlap.  Segments that touch each
+ * other in a single point do not intersect.
+ */
+static int
+is_intersection(const segment_t *a, const segment_t *b)
+{
+    double d1, d2, d3, d4;
+
+    d1 = orient(a->x0, a->y0, a->x1, a->y1, b->x0, b->y0);
+    d2 = orient(a->x0, a->y0, a->x1, a->y1, b->x1, b->y1);
+    if (d1 == 0.0 && d2 == 0.0) {
+        return is_before(a->x0, a->y0, b->x1, b->y1) &&
+               is_before(b->x0, b->y0, a->x1, a->y1);
+    }
+    if (!((d1 < 0.0 && d2 > 0.0) || (d1 > 0.0 && d2 < 0.0))) {
+        return 0;
+    }
+    d3 = orient(b->x0, b->y0, b->x1, b->y1, a->x0, a->y0);
+    d4 = orient(b->x0, b->y0, b->x1, b->y1, a->x1, a->y1);
+    return (d3 < 0.0 && d4 > 0.0) || (d3 > 0.0 && d4 < 0.0);
+}
+
+static void
+set_intersection(shp_problem_t *problem, size_t part_num, size_t point_num,
+                 size_t other_part_num, size_t other_point_num)
+{
+    if (point_num > other_point_num) {
+        set_intersection(problem, other_part_num, other_point_num, part_num,
+                         point_num);
+        return;
+    }
+    problem->type = (part_num == other_part_num)
+                        ? SHP_PROBLEM_SELF_INTERSECTION
+                        : SHP_PROBLEM_CROSSING_RINGS;
+    problem->part_num = part_num;
+    problem->point_num = point_num;
+    problem->other_part_num = other_part_num;
+    problem->other_point_num = other_point_num;
+}
+
+static int
+check_pair(const segment_t *segments, size_t a, size_t b,
+           shp_problem_t *problem)
+{
+    if (a == NIL || b == NIL) {
+        return 0;
+    }
+    if (!is_intersection(&segments[a], &segments[b])) {
+        return 0;
+    }
+
+    set_intersection(problem, segments[a].part_num, segments[a].point_num,
+                     segments[b].part_num, segments[b].point_num);
+    return 1;
+}
+
+static int
+is_on_segment(const segment_t *segment, double x, double y)
+{
+    if (x < segment->x0 || x > segment->x1) {
+        return 0;
+    }
+    if ((y < segment->y0 && y < segment->y1) ||
+        (y > segment->y0 && y > segment->y1)) {
+        return 0;
+    }
+    return orient(segment->x0, segment->y0, segment->x1, segment->y1, x,
+                  y) == 0.0;
+}
+
+/*
+ * Returns a segment in the tree that contains the current event point.
+ */
+static size_t
+find_segment(const tree_t *tree)
+{
+    const segment_t *segment;
+    size_t node;
+
+    node = tree->root;
+    while (node != NIL) {
+        segment = &tree->segments[node];
+        if (is_on_segment(segment, tree->x, tree->y)) {
+            break;
+        }
+        if (tree->y < get_y(segment, tree->x, tree->y)) {
+            node = tree->left[node];
+        }
+        else {
+            node = tree->right[node];
+        }
+    }
+
+    return node;
+}
+
+static void
+add_edge(edge_t *edge, double dx, double dy, size_t pair, size_t part_num,
+         size_t point_num)
+{
+    edge->dx = dx;
+    edge->dy = dy;
+    edge->pair = pair;
+    edge->part_num = part_num;
+    edge->point_num = point_num;
+}
+
+/*
+ * Adds the edge of a segment that starts or ends at the current event
+ * point.  The edges are paired by the ring's vertex.
+ */
+static void
+add_vertex_edge(const shp_parts_t *view, const tree_t *tree,
+                const segment_t *segment, edge_t *edge)
+{
+    size_t start, end, point_num;
+    double dx, dy;
+
+    point_num = segment->point_num;
+    if (shp_parts_x(view, point_num) != tree->x ||
+        shp_parts_y(view, point_num) != tree->y) {
+        ++point_num;
+    }
+
+    /* The first and the last point of a ring are the same vertex */
+    shp_parts_points(view, segment->part_num, &start, &end);
+    if (point_num == end - 1) {
+        point_num = start;
+    }
+
+    if (segment->x0 == tree->x && segment->y0 == tree->y) {
+        dx = segment->x1 - tree->x;
+        dy = segment->y1 - tree->y;
+    }
+    else {
+        dx = segment->x0 - tree->x;
+        dy = segment->y0 - tree->y;
+    }
+
+    add_edge(edge, dx, dy, point_num, segment->part_num, point_num);
+}
+
+static int
+compare_pairs(const void *a, const void *b)
+{
+    const edge_t *e1 = (const edge_t *) a;
+    const edge_t *e2 = (const edge_t *) b;
+
+    if (e1->part_num != e2->part_num) {
+        return (e1->part_num < e2->part_num) ? -1 : 1;
+    }
+    if (e1->pair != e2->pair) {
+        return (e1->pair < e2->pair) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int
+get_half(const edge_t *edge)
+{
+    return (edge->dy > 0.0 || (edge->dy == 0.0 && edge->dx > 0.0)) ? 0 : 1;
+}
+
+/*
+ * Sorts the edges counterclockwise, beginning at the positive X axis.
+ */
+static int
+compare_angles(const void *a, const void *b)
+{
+    const edge_t *e1 = (const edge_t *) a;
+    const edge_t *e2 = (const edge_t *) b;
+    int h1, h2;
+    double d;
+
+    h1 = get_half(e1);
+    h2 = get_half(e2);
+    if (h1 != h2) {
+        return (h1 < h2) ? -1 : 1;
+    }
+    d = e1->dx * e2->dy - e1->dy * e2->dx;
+    if (d != 0.0) {
+        return (d > 0.0) ? -1 : 1;
+    }
+    if (e1->pair != e2->pair) {
+        return (e1->pair < e2->pair) ? -1 : 1;
+    }
+    return 0;
+}
+
+/*
+ * Classifies the vertices and segments that meet at the current event
+ * point.  A ring must not touch itself.  Two rings may touch each other,
+ * but their pairs of edges must not interleave around the point, which
+ * would mean that the rings cross.
+ */
+static int
+check_point(const shp_parts_t *view, const tree_t *tree,
+            const event_t *events, size_t num_events, edge_t *edges,
+            shp_problem_t *problem)
+{
+    const segment_t *segment;
+    size_t num_edges, node, next, i, top;
+
+    num_edges = 0;
+    for (i = 0; i < num_events; ++i) {
+        segment = &tree->segments[events[i].segment];
+        add_vertex_edge(view, tree, segment, &edges[num_edges]);
+        ++num_edges;
+    }
+
+    /* Add the segments that pass through the point */
+    node = find_segment(tree);
+    if (node != NIL) {
+        while ((next = get_prev(tree, node)) != NIL &&
+               is_on_segment(&tree->segments[next], tree->x, tree->y)) {
+            node = next;
+        }
+    }
+    while (node != NIL &&
+           is_on_segment(&tree->segments[node], tree->x, tree->y)) {
+        segment = &tree->segments[node];
+        if ((segment->x0 != tree->x || segment->y0 != tree->y) &&
+            (segment->x1 != tree->x || segment->y1 != tree->y)) {
+            add_edge(&edges[num_edges], segment->x0 - tree->x,
+                     segment->y0 - tree->y, view->num_points + node,
+                     segment->part_num, segment->point_num);
+            add_edge(&edges[num_edges + 1], segment->x1 - tree->x,
+                     segment->y1 - tree->y, view->num_points + node,
+                     segment->part_num, segment->point_num);
+            num_edges += 2;
+        }
+        node = get_next(tree, node);
+    }
+
+    /* Is the point an ordinary vertex? */
+    if (num_edges <= 2) {
+        return 1;
+    }
+
+    qsort(edges, num_edges, sizeof(*edges), compare_pairs);
+    for (i = 1; i < num_edges; ++i) {
+        if (edges[i].part_num == edges[i - 1].part_num &&
+            edges[i].pair != edges[i - 1].pair) {
+            set_intersection(problem, edges[i - 1].part_num,
+                             edges[i - 1].point_num, edges[i].part_num,
+                             edges[i].point_num);
+            return 0;
+        }
+    }
+
+    qsort(edges, num_edges, sizeof(*edges), compare_angles);
+    for (i = 1; i < num_edges; ++i) {
+        /* Do two segments overlap? */
+        if (get_half(&edges[i - 1]) == get_half(&edges[i]) &&
+            edges[i - 1].dx * edges[i].dy == edges[i - 1].dy * edges[i].dx) {
+            set_intersection(problem, edges[i - 1].part_num,
+                             edges[i - 1].point_num, edges[i].part_num,
+                             edges[i].point_num);
+            return 0;
+        }
+    }
+
+    /* Remove the pairs whose edges are adjacent like parentheses.  The
+     * edges that remain belong to interleaving pairs. */
+    top = 0;
+    for (i = 0; i < num_edges; ++i) {
+        if (top > 0 && edges[top - 1].pair == edges[i].pair) {
+            --top;
+        }
+        else {
+            edges[top] = edges[i];
+            ++top;
+        }
+    }
+    if (top > 0) {
+        set_intersection(problem, edges[0].part_num, edges[0].point_num,
+                         edges[1].part_num, edges[1].point_num);
+        return 0;
+    }
+
+    return 1;
+}
+
+int
+shp_polygon_check(const shp_polygon_t *polygon, shp_problem_t *problem)
+{
+    int rc = -1;
+    shp_parts_t view;
+    segment_t *segments = NULL;
+    event_t *events, *event;
+    edge_t *edges;
+    tree_t tree;
+    size_t num_segments, n, i, first, prev, next;
+
+    assert(polygon != NULL);
+    assert(problem != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+
+    set_problem(problem, SHP_PROBLEM_NONE, 0, 0);
+    if (!check_rings(&view, problem)) {
+        return 0;
+    }
+
+    n = view.num_points;
+    if (n == 0) {
+        return 1;
+    }
+
+    if (n > SIZE_MAX / (sizeof(*segments) + 2 * sizeof(*events) +
+                        2 * sizeof(*edges) + 3 * sizeof(size_t))) {
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    segments = (segment_t *) malloc(
+        n * (sizeof(*segments) + 2 * sizeof(*events) + 2 * sizeof(*edges) +
+             3 * sizeof(size_t)));
+    if (segments == NULL) {
+        goto cleanup;
+    }
+    events = (event_t *) (segments + n);
+    edges = (edge_t *) (events + 2 * n);
+    tree.segments = segments;
+    tree.left = (size_t *) (edges + 2 * n);
+    tree.right = tree.left + n;
+    tree.parent = tree.right + n;
+    tree.root = NIL;
+
+    num_segments = get_segments(&view, segments);
+    for (i = 0; i < num_segments; ++i) {
+        event = &events[2 * i];
+        event->x = segments[i].x0;
+        event->y = segments[i].y0;
+        event->segment = i;
+        event->is_end = 0;
+        ++event;
+        event->x = segments[i].x1;
+        event->y = segments[i].y1;
+        event->segment = i;
+        event->is_end = 1;
+    }
+    qsort(events, 2 * num_segments, sizeof(*events), compare_events);
+
+    rc = 1;
+    first = 0;
+    for (i = 0; i < 2 * num_segments; ++i) {
+        event = &events[i];
+        tree.x = event->x;
+        tree.y = event->y;
+        if (event->is_end) {
+            prev = get_prev(&tree, event->segment);
+            next = get_next(&tree, event->segment);
+            remove_node(&tree, event->segment);
+            if (check_pair(segments, prev, next, problem)) {
+                rc = 0;
+                break;
+            }
+        }
+        else {
+            insert_node(&tree, event->segment);
+            prev = get_prev(&tree, event->segment);
+            next = get_next(&tree, event->segment);
+            if (check_pair(segments, prev, event->segment, problem) ||
+                check_pair(segments, event->segment, next, problem)) {
+                rc = 0;
+                break;
+            }
+        }
+
+        /* Check the point after all segments have been added */
+        if (i + 1 == 2 * num_segments || events[i + 1].x != event->x ||
+            events[i + 1].y != event->y) {
+            if (!check_point(&view, &tree, &events[first], i + 1 - first,
+                             edges, problem)) {
+                rc = 0;
+                break;
+            }
+            first = i + 1;
+        }
+    }
+
+cleanup:
+
+    free(segments);
+
+    return rc;
+}
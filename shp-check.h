@@ -0,0 +1,90 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_CHECK_H
+#define _SHAPEREADER_SHP_CHECK_H
+
+#include "shp-polygon.h"
+#include <stddef.h>
+
+/**
+ * Problem types
+ */
+typedef enum shp_problem_type_t {
+    SHP_PROBLEM_NONE = 0,          /**< No problem */
+    SHP_PROBLEM_TOO_FEW_POINTS,    /**< Ring with fewer than four points */
+    SHP_PROBLEM_UNCLOSED_RING,     /**< First and last point differ */
+    SHP_PROBLEM_DUPLICATE_POINT,   /**< Point equals its predecessor */
+    SHP_PROBLEM_SELF_INTERSECTION, /**< Ring intersects itself */
+    SHP_PROBLEM_CROSSING_RINGS     /**< Rings intersect each other */
+} shp_problem_type_t;
+
+/**
+ * Problem
+ *
+ * Describes why a polygon is invalid.  Intersections are reported as the
+ * two segments that start at the points @a point_num and
+ * @a other_point_num.
+ */
+typedef struct shp_problem_t {
+    shp_problem_type_t type; /**< Problem type */
+    size_t part_num;         /**< Ring */
+    size_t point_num;        /**< Point in the entire polygon */
+    size_t other_part_num;   /**< Other ring if the rings intersect */
+    size_t other_point_num;  /**< Other segment if the rings intersect */
+} shp_problem_t;
+
+/**
+ * Check a polygon's validity
+ *
+ * Checks that the rings have at least four points, that the rings are
+ * closed, that no point equals its predecessor and that the rings neither
+ * intersect themselves nor each other.  Rings may touch each other in single
+ * points, but they must not cross or overlap.  A ring must not touch
+ * itself.  The ring orientation is not checked.
+ *
+ * The rings are checked for intersections with a sweep line that visits the
+ * segments' end points from left to right.  The segments that intersect the
+ * sweep line are kept in a search tree that is ordered by Y coordinate.  Only
+ * neighbors in the tree are tested for intersections, so that a polygon with
+ * n points is checked in O(n log n) time.  Where vertices meet other
+ * vertices or segments, the edges that leave the point are sorted by angle.
+ * The rings cross if the edges of two rings alternate around the point.
+ * The search stops at the first intersection.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_problem_t problem;
+ *
+ * if (shp_polygon_check(polygon, &problem) == 0) {
+ *   printf("Problem %d in ring %zu at point %zu\n", (int) problem.type,
+ *          problem.part_num, problem.point_num);
+ * }
+ * @endcode
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param[out] problem the first problem that was found.
+ * @retval 1 if the polygon is valid.
+ * @retval 0 if the polygon is invalid.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see @cite Shamos_Hoey
+ */
+extern int shp_polygon_check(const shp_polygon_t *polygon,
+                             shp_problem_t *problem);
+
+#endif
@@ -0,0 +1,603 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-clip.h"
+#include "parts.h"
+#include <assert.h>
+
+#define CODE_INSIDE 0U
+#define CODE_LEFT 1U
+#define CODE_RIGHT 2U
+#define CODE_BOTTOM 4U
+#define CODE_TOP 8U
+
+typedef struct clip_t {
+    double x_min;
+    double y_min;
+    double x_max;
+    double y_max;
+    /* Precomputed grid cells or NULL */
+    const shp_cell_t *cells;
+    long col;
+    long row;
+    /* Output */
+    shp_buffer_t *buffer;
+    size_t part_start;
+    size_t part_size;
+    double first_x;
+    double first_y;
+    double last_x;
+    double last_y;
+    /* Sutherland-Hodgman stages */
+    int has_first[4];
+    double stage_first_x[4];
+    double stage_first_y[4];
+    double stage_prev_x[4];
+    double stage_prev_y[4];
+} clip_t;
+
+static void
+init_clip(clip_t *clip, double x_min, double y_min, double x_max,
+          double y_max, shp_buffer_t *buffer)
+{
+    clip->x_min = x_min;
+    clip->y_min = y_min;
+    clip->x_max = x_max;
+    clip->y_max = y_max;
+    clip->cells = NULL;
+    clip->col = 0;
+    clip->row = 0;
+    clip->buffer = buffer;
+    clip->part_start = 0;
+    clip->part_size = 0;
+
+    buffer->num_parts = 0;
+    buffer->num_points = 0;
+}
+
+static void
+init_clip_cell(clip_t *clip, const shp_grid_t *grid, const shp_cell_t *cells,
+               const shp_cell_t *tile, shp_buffer_t *buffer)
+{
+    double x_min, y_min, x_max, y_max;
+
+    shp_grid_cell_box(grid, tile, &x_min, &y_min, &x_max, &y_max);
+    init_clip(clip, x_min, y_min, x_max, y_max, buffer);
+    clip->cells = cells;
+    clip->col = tile->col;
+    clip->row = tile->row;
+}
+
+static int
+box_overlaps(const clip_t *clip, double x_min, double y_min, double x_max,
+             double y_max)
+{
+    return x_min <= clip->x_max && x_max >= clip->x_min &&
+           y_min <= clip->y_max && y_max >= clip->y_min;
+}
+
+static unsigned
+point_code(const clip_t *clip, double x, double y)
+{
+    unsigned code = CODE_INSIDE;
+
+    if (x < clip->x_min) {
+        code |= CODE_LEFT;
+    }
+    else if (x > clip->x_max) {
+        code |= CODE_RIGHT;
+    }
+    if (y < clip->y_min) {
+        code |= CODE_BOTTOM;
+    }
+    else if (y > clip->y_max) {
+        code |= CODE_TOP;
+    }
+
+    return code;
+}
+
+static unsigned
+vertex_code(const clip_t *clip, const shp_parts_t *view, size_t point_num)
+{
+    const shp_cell_t *cell;
+    unsigned code = CODE_INSIDE;
+
+    if (clip->cells == NULL) {
+        return point_code(clip, shp_parts_x(view, point_num),
+                          shp_parts_y(view, point_num));
+    }
+
+    /* Integer comparisons are sufficient if the grid cells are known. */
+    cell = &clip->cells[point_num];
+    if (cell->col < clip->col) {
+        code |= CODE_LEFT;
+    }
+    else if (cell->col > clip->col) {
+        code |= CODE_RIGHT;
+    }
+    if (cell->row < clip->row) {
+        code |= CODE_BOTTOM;
+    }
+    else if (cell->row > clip->row) {
+        code |= CODE_TOP;
+    }
+
+    return code;
+}
+
+static void
+begin_part(clip_t *clip)
+{
+    clip->part_start = shp_buffer_add_part(clip->buffer);
+    clip->part_size = 0;
+}
+
+static void
+add_point(clip_t *clip, double x, double y)
+{
+    if (clip->part_size > 0 && x == clip->last_x && y == clip->last_y) {
+        return;
+    }
+    if (clip->part_size == 0) {
+        clip->first_x = x;
+        clip->first_y = y;
+    }
+    shp_buffer_add_point(clip->buffer, x, y);
+    clip->last_x = x;
+    clip->last_y = y;
+    ++clip->part_size;
+}
+
+static void
+end_line(clip_t *clip)
+{
+    if (clip->part_size < 2) {
+        shp_buffer_remove_part(clip->buffer, clip->part_start);
+    }
+}
+
+static void
+end_ring(clip_t *clip)
+{
+    size_t n = clip->part_size;
+
+    if (n > 1 && clip->last_x == clip->first_x &&
+        clip->last_y == clip->first_y) {
+        /* The ring is already closed. */
+        --n;
+    }
+    else if (n >= 3) {
+        shp_buffer_add_point(clip->buffer, clip->first_x, clip->first_y);
+    }
+    if (n < 3) {
+        shp_buffer_remove_part(clip->buffer, clip->part_start);
+    }
+}
+
+static int
+clip_segment(const clip_t *clip, double x1, double y1, double x2, double y2,
+             double *pt0, double *pt1)
+{
+    double p[4], q[4], r, t0 = 0.0, t1 = 1.0;
+    double dx = x2 - x1, dy = y2 - y1;
+    int k;
+
+    p[0] = -dx;
+    q[0] = x1 - clip->x_min;
+    p[1] = dx;
+    q[1] = clip->x_max - x1;
+    p[2] = -dy;
+    q[2] = y1 - clip->y_min;
+    p[3] = dy;
+    q[3] = clip->y_max - y1;
+
+    for (k = 0; k < 4; ++k) {
+        if (p[k] == 0.0) {
+            if (q[k] < 0.0) {
+                return 0;
+            }
+        }
+        else {
+            r = q[k] / p[k];
+            if (p[k] < 0.0) {
+                if (r > t1) {
+                    return 0;
+                }
+                if (r > t0) {
+                    t0 = r;
+                }
+            }
+            else {
+                if (r < t0) {
+                    return 0;
+                }
+                if (r < t1) {
+                    t1 = r;
+                }
+            }
+        }
+    }
+
+    *pt0 = t0;
+    *pt1 = t1;
+
+    return 1;
+}
+
+static void
+clip_line(clip_t *clip, const shp_parts_t *view, size_t start, size_t end)
+{
+    size_t i;
+    unsigned c1, c2;
+    double x1, y1, x2, y2, t0, t1;
+    int is_open = 0;
+
+    x1 = shp_parts_x(view, start);
+    y1 = shp_parts_y(view, start);
+    c1 = vertex_code(clip, view, start);
+
+    for (i = start + 1; i < end; ++i) {
+        x2 = shp_parts_x(view, i);
+        y2 = shp_parts_y(view, i);
+        c2 = vertex_code(clip, view, i);
+
+        if ((c1 & c2) != 0) {
+            /* The segment is outside. */
+            if (is_open) {
+                end_line(clip);
+                is_open = 0;
+            }
+        }
+        else if ((c1 | c2) == 0) {
+            /* The segment is inside. */
+            if (!is_open) {
+                begin_part(clip);
+                add_point(clip, x1, y1);
+                is_open = 1;
+            }
+            add_point(clip, x2, y2);
+        }
+        else if (clip_segment(clip, x1, y1, x2, y2, &t0, &t1)) {
+            if (!is_open || t0 > 0.0) {
+                if (is_open) {
+                    end_line(clip);
+                }
+                begin_part(clip);
+                is_open = 1;
+                if (t0 > 0.0) {
+                    add_point(clip, x1 + t0 * (x2 - x1), y1 + t0 * (y2 - y1));
+                }
+                else {
+                    add_point(clip, x1, y1);
+                }
+            }
+            if (t1 < 1.0) {
+                add_point(clip, x1 + t1 * (x2 - x1), y1 + t1 * (y2 - y1));
+                end_line(clip);
+                is_open = 0;
+            }
+            else {
+                add_point(clip, x2, y2);
+            }
+        }
+        else if (is_open) {
+            end_line(clip);
+            is_open = 0;
+        }
+
+        x1 = x2;
+        y1 = y2;
+        c1 = c2;
+    }
+
+    if (is_open) {
+        end_line(clip);
+    }
+}
+
+static int
+stage_inside(const clip_t *clip, int k, double x, double y)
+{
+    switch (k) {
+    case 0:
+        return x >= clip->x_min;
+    case 1:
+        return x <= clip->x_max;
+    case 2:
+        return y >= clip->y_min;
+    default:
+        return y <= clip->y_max;
+    }
+}
+
+static void
+stage_intersect(const clip_t *clip, int k, double x1, double y1, double x2,
+                double y2, double *x, double *y)
+{
+    double bound;
+
+    if (k < 2) {
+        bound = (k == 0) ? clip->x_min : clip->x_max;
+        *x = bound;
+        *y = y1 + (y2 - y1) * (bound - x1) / (x2 - x1);
+    }
+    else {
+        bound = (k == 2) ? clip->y_min : clip->y_max;
+        *x = x1 + (x2 - x1) * (bound - y1) / (y2 - y1);
+        *y = bound;
+    }
+}
+
+/*
+ * The Sutherland-Hodgman algorithm is implemented as a pipeline of four
+ * stages, one for each edge of the rectangle.  Every point is passed through
+ * the stages immediately, so that no intermediate polygons need to be
+ * stored.
+ */
+
+static void
+stage_push(clip_t *clip, int k, double x, double y)
+{
+    double ix, iy;
+    int is_inside;
+
+    if (k == 4) {
+        add_point(clip, x, y);
+        return;
+    }
+
+    is_inside = stage_inside(clip, k, x, y);
+
+    if (!clip->has_first[k]) {
+        clip->has_first[k] = 1;
+        clip->stage_first_x[k] = x;
+        clip->stage_first_y[k] = y;
+    }
+    else if (stage_inside(clip, k, clip->stage_prev_x[k],
+                          clip->stage_prev_y[k]) != is_inside) {
+        stage_intersect(clip, k, clip->stage_prev_x[k], clip->stage_prev_y[k],
+                        x, y, &ix, &iy);
+        stage_push(clip, k + 1, ix, iy);
+    }
+
+    if (is_inside) {
+        stage_push(clip, k + 1, x, y);
+    }
+
+    clip->stage_prev_x[k] = x;
+    clip->stage_prev_y[k] = y;
+}
+
+static void
+stage_close(clip_t *clip)
+{
+    double ix, iy, px, py, fx, fy;
+    int k;
+
+    for (k = 0; k < 4; ++k) {
+        if (!clip->has_first[k]) {
+            continue;
+        }
+        px = clip->stage_prev_x[k];
+        py = clip->stage_prev_y[k];
+        fx = clip->stage_first_x[k];
+        fy = clip->stage_first_y[k];
+        if (stage_inside(clip, k, px, py) != stage_inside(clip, k, fx, fy)) {
+            stage_intersect(clip, k, px, py, fx, fy, &ix, &iy);
+            stage_push(clip, k + 1, ix, iy);
+        }
+        clip->has_first[k] = 0;
+    }
+}
+
+static void
+clip_ring(clip_t *clip, const shp_parts_t *view, size_t start, size_t end)
+{
+    size_t i;
+    unsigned code, and_code = ~0U, or_code = 0U;
+    int k;
+
+    for (i = start; i < end; ++i) {
+        code = vertex_code(clip, view, i);
+        and_code &= code;
+        or_code |= code;
+    }
+
+    if (and_code != 0) {
+        /* The ring is outside. */
+        return;
+    }
+
+    begin_part(clip);
+
+    if (or_code == 0) {
+        /* The ring is inside. */
+        for (i = start; i < end; ++i) {
+            add_point(clip, shp_parts_x(view, i), shp_parts_y(view, i));
+        }
+        end_ring(clip);
+        return;
+    }
+
+    /* Skip the closing point. */
+    if (shp_parts_x(view, start) == shp_parts_x(view, end - 1) &&
+        shp_parts_y(view, start) == shp_parts_y(view, end - 1)) {
+        --end;
+    }
+
+    for (k = 0; k < 4; ++k) {
+        clip->has_first[k] = 0;
+    }
+    for (i = start; i < end; ++i) {
+        stage_push(clip, 0, shp_parts_x(view, i), shp_parts_y(view, i));
+    }
+    stage_close(clip);
+
+    end_ring(clip);
+}
+
+static void
+clip_lines(clip_t *clip, const shp_parts_t *view)
+{
+    size_t part_num, i, n;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &i, &n) >= 2) {
+            clip_line(clip, view, i, n);
+        }
+    }
+}
+
+static void
+clip_rings(clip_t *clip, const shp_parts_t *view)
+{
+    size_t part_num, i, n;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &i, &n) >= 3) {
+            clip_ring(clip, view, i, n);
+        }
+    }
+}
+
+static void
+get_cells(const shp_parts_t *view, const shp_grid_t *grid, shp_cell_t *cells)
+{
+    size_t i;
+
+    for (i = 0; i < view->num_points; ++i) {
+        shp_grid_cell(grid, shp_parts_x(view, i), shp_parts_y(view, i),
+                      &cells[i]);
+    }
+}
+
+int
+shp_polyline_clip(const shp_polyline_t *polyline, double x_min, double y_min,
+                  double x_max, double y_max, shp_buffer_t *buffer)
+{
+    clip_t clip;
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(buffer != NULL);
+
+    init_clip(&clip, x_min, y_min, x_max, y_max, buffer);
+    if (box_overlaps(&clip, polyline->x_min, polyline->y_min,
+                     polyline->x_max, polyline->y_max)) {
+        shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                       polyline->parts, polyline->points);
+        clip_lines(&clip, &view);
+    }
+
+    return shp_buffer_is_complete(buffer);
+}
+
+int
+shp_polygon_clip(const shp_polygon_t *polygon, double x_min, double y_min,
+                 double x_max, double y_max, shp_buffer_t *buffer)
+{
+    clip_t clip;
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(buffer != NULL);
+
+    init_clip(&clip, x_min, y_min, x_max, y_max, buffer);
+    if (box_overlaps(&clip, polygon->x_min, polygon->y_min, polygon->x_max,
+                     polygon->y_max)) {
+        shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                       polygon->parts, polygon->points);
+        clip_rings(&clip, &view);
+    }
+
+    return shp_buffer_is_complete(buffer);
+}
+
+void
+shp_polyline_cells(const shp_polyline_t *polyline, const shp_grid_t *grid,
+                   shp_cell_t *cells)
+{
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(grid != NULL);
+    assert(cells != NULL);
+
+    shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                   polyline->parts, polyline->points);
+    get_cells(&view, grid, cells);
+}
+
+int
+shp_polyline_clip_cell(const shp_polyline_t *polyline, const shp_grid_t *grid,
+                       const shp_cell_t *cells, const shp_cell_t *tile,
+                       shp_buffer_t *buffer)
+{
+    clip_t clip;
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(grid != NULL);
+    assert(cells != NULL);
+    assert(tile != NULL);
+    assert(buffer != NULL);
+
+    init_clip_cell(&clip, grid, cells, tile, buffer);
+    if (box_overlaps(&clip, polyline->x_min, polyline->y_min,
+                     polyline->x_max, polyline->y_max)) {
+        shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                       polyline->parts, polyline->points);
+        clip_lines(&clip, &view);
+    }
+
+    return shp_buffer_is_complete(buffer);
+}
+
+void
+shp_polygon_cells(const shp_polygon_t *polygon, const shp_grid_t *grid,
+                  shp_cell_t *cells)
+{
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(grid != NULL);
+    assert(cells != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    get_cells(&view, grid, cells);
+}
+
+int
+shp_polygon_clip_cell(const shp_polygon_t *polygon, const shp_grid_t *grid,
+                      const shp_cell_t *cells, const shp_cell_t *tile,
+                      shp_buffer_t *buffer)
+{
+    clip_t clip;
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(grid != NULL);
+    assert(cells != NULL);
+    assert(tile != NULL);
+    assert(buffer != NULL);
+
+    init_clip_cell(&clip, grid, cells, tile, buffer);
+    if (box_overlaps(&clip, polygon->x_min, polygon->y_min, polygon->x_max,
+                     polygon->y_max)) {
+        shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                       polygon->parts, polygon->points);
+        clip_rings(&clip, &view);
+    }
+
+    return shp_buffer_is_complete(buffer);
+}
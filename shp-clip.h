@@ -0,0 +1,167 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_CLIP_H
+#define _SHAPEREADER_SHP_CLIP_H
+
+#include "shp-buffer.h"
+#include "shp-grid.h"
+#include "shp-polygon.h"
+#include "shp-polyline.h"
+#include <stddef.h>
+
+/**
+ * Clip a PolyLine to a rectangle
+ *
+ * Clips the segments of a PolyLine to an axis-aligned rectangle and writes
+ * the resulting parts to a buffer.  A part is split if it leaves the
+ * rectangle.  No memory is allocated.
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param x_min X coordinate of the bottom left corner.
+ * @param y_min Y coordinate of the bottom left corner.
+ * @param x_max X coordinate of the top right corner.
+ * @param y_max Y coordinate of the top right corner.
+ * @param[out] buffer a buffer that receives the clipped parts.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see "A New Concept and Method for Line Clipping" @cite Liang_Barsky for a
+ *      description of the clipping algorithm.
+ */
+extern int shp_polyline_clip(const shp_polyline_t *polyline, double x_min,
+                             double y_min, double x_max, double y_max,
+                             shp_buffer_t *buffer);
+
+/**
+ * Clip a polygon to a rectangle
+ *
+ * Clips the rings of a polygon to an axis-aligned rectangle and writes the
+ * resulting rings to a buffer.  The rings keep their orientation.  Rings
+ * that are outside the rectangle are omitted.  Concave rings may produce
+ * degenerate edges along the rectangle's boundary.  No memory is allocated.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param x_min X coordinate of the bottom left corner.
+ * @param y_min Y coordinate of the bottom left corner.
+ * @param x_max X coordinate of the top right corner.
+ * @param y_max Y coordinate of the top right corner.
+ * @param[out] buffer a buffer that receives the clipped rings.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see "Reentrant Polygon Clipping" @cite Sutherland_Hodgman for a
+ *      description of the clipping algorithm.
+ */
+extern int shp_polygon_clip(const shp_polygon_t *polygon, double x_min,
+                            double y_min, double x_max, double y_max,
+                            shp_buffer_t *buffer);
+
+/**
+ * Get the grid cells of a PolyLine's points
+ *
+ * Determines the grid cell of every point.  The cells can be passed to
+ * shp_polyline_clip_cell to clip a PolyLine to many tiles without comparing
+ * the coordinates again.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_cell_t *cells, tile;
+ *
+ * cells = malloc(polyline->num_points * sizeof(*cells));
+ * shp_polyline_cells(polyline, grid, cells);
+ * for (tile.row = 0; tile.row < (long) grid->num_rows; ++tile.row) {
+ *   for (tile.col = 0; tile.col < (long) grid->num_cols; ++tile.col) {
+ *     if (shp_polyline_clip_cell(polyline, grid, cells, &tile, buffer)) {
+ *       // Do something
+ *     }
+ *   }
+ * }
+ * free(cells);
+ * @endcode
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param grid a grid of tiles.
+ * @param[out] cells an array with room for @a num_points shp_cell_t
+ *                   structures.
+ */
+extern void shp_polyline_cells(const shp_polyline_t *polyline,
+                               const shp_grid_t *grid, shp_cell_t *cells);
+
+/**
+ * Clip a PolyLine to a tile
+ *
+ * Works like shp_polyline_clip, but segments that are entirely inside or
+ * outside the tile are detected by comparing the precomputed grid cells.
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param grid a grid of tiles.
+ * @param cells the grid cells from shp_polyline_cells.
+ * @param tile a cell in the grid.
+ * @param[out] buffer a buffer that receives the clipped parts.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see shp_polyline_cells
+ */
+extern int shp_polyline_clip_cell(const shp_polyline_t *polyline,
+                                  const shp_grid_t *grid,
+                                  const shp_cell_t *cells,
+                                  const shp_cell_t *tile,
+                                  shp_buffer_t *buffer);
+
+/**
+ * Get the grid cells of a polygon's points
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param grid a grid of tiles.
+ * @param[out] cells an array with room for @a num_points shp_cell_t
+ *                   structures.
+ *
+ * @see shp_polyline_cells
+ */
+extern void shp_polygon_cells(const shp_polygon_t *polygon,
+                              const shp_grid_t *grid, shp_cell_t *cells);
+
+/**
+ * Clip a polygon to a tile
+ *
+ * Works like shp_polygon_clip, but rings that are entirely inside or outside
+ * the tile are detected by comparing the precomputed grid cells.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param grid a grid of tiles.
+ * @param cells the grid cells from shp_polygon_cells.
+ * @param tile a cell in the grid.
+ * @param[out] buffer a buffer that receives the clipped rings.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see shp_polygon_cells
+ */
+extern int shp_polygon_clip_cell(const shp_polygon_t *polygon,
+                                 const shp_grid_t *grid,
+                                 const shp_cell_t *cells,
+                                 const shp_cell_t *tile,
+                                 shp_buffer_t *buffer);
+
+#endif
@@ -0,0 +1,559 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-cover.h"
+#include "parts.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PI 3.14159265358979323846
+
+/* Web Mercator is only defined up to this latitude */
+#define MAX_LATITUDE 85.051128779806592
+
+#define MAX_QUADKEY_LEVEL 31
+#define MAX_GEOHASH_LEVEL 12
+
+static const char base32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+/*
+ * The coordinates are converted to cell units, i.e. column 0 and row 0
+ * start at 0.0 and every cell has the size 1.0.  Every cell is stored as
+ * its interleaved column and row bits, which sort like the keys.
+ */
+
+typedef struct cover_t {
+    shp_cover_type_t type;
+    unsigned int level;
+    unsigned int col_bits;
+    unsigned int row_bits;
+    double num_cols;
+    double num_rows;
+    size_t num_cells;
+    size_t max_cells;
+    uint64_t *cells;
+} cover_t;
+
+typedef struct edge_t {
+    double y0;   /* Lower end */
+    double y1;   /* Upper end */
+    double x0;   /* X coordinate at y0 */
+    double dxdy; /* Inverse slope */
+} edge_t;
+
+static double
+clamp(double value, double min, double max)
+{
+    if (value < min) {
+        return min;
+    }
+    if (value > max) {
+        return max;
+    }
+    return value;
+}
+
+static void
+to_cell_units(const cover_t *cover, double lon, double lat, double *x,
+              double *y)
+{
+    double s;
+
+    *x = clamp((lon + 180.0) / 360.0 * cover->num_cols, 0.0, cover->num_cols);
+    if (cover->type == SHP_COVER_QUADKEY) {
+        /* Tile rows are counted from north to south */
+        lat = clamp(lat, -MAX_LATITUDE, MAX_LATITUDE);
+        s = sin(lat * PI / 180.0);
+        *y = (0.5 - log((1.0 + s) / (1.0 - s)) / (4.0 * PI)) *
+             cover->num_rows;
+    }
+    else {
+        *y = (lat + 90.0) / 180.0 * cover->num_rows;
+    }
+    *y = clamp(*y, 0.0, cover->num_rows);
+}
+
+static uint64_t
+get_code(const cover_t *cover, double x, double y)
+{
+    uint64_t col, row, code;
+    unsigned int i, c, r;
+
+    x = clamp(floor(x), 0.0, cover->num_cols - 1.0);
+    y = clamp(floor(y), 0.0, cover->num_rows - 1.0);
+    col = (uint64_t) x;
+    row = (uint64_t) y;
+
+    /* Geohashes start with a column bit, quadkeys with a row bit */
+    code = 0;
+    c = cover->col_bits;
+    r = cover->row_bits;
+    for (i = 0; i < cover->col_bits + cover->row_bits; ++i) {
+        if ((cover->type == SHP_COVER_GEOHASH) == (i % 2 == 0)) {
+            code = (code << 1) | ((col >> --c) & 1);
+        }
+        else {
+            code = (code << 1) | ((row >> --r) & 1);
+        }
+    }
+    return code;
+}
+
+static int
+add_cell(cover_t *cover, double x, double y)
+{
+    size_t max_cells;
+    uint64_t *cells;
+
+    if (cover->num_cells == cover->max_cells) {
+        max_cells = (cover->max_cells > 0) ? 2 * cover->max_cells : 64;
+        if (max_cells > SIZE_MAX / sizeof(*cells)) {
+            errno = ENOMEM;
+            return -1;
+        }
+        cells = (uint64_t *) realloc(cover->cells,
+                                     max_cells * sizeof(*cells));
+        if (cells == NULL) {
+            return -1;
+        }
+        cover->cells = cells;
+        cover->max_cells = max_cells;
+    }
+    cover->cells[cover->num_cells++] = get_code(cover, x, y);
+    return 1;
+}
+
+/*
+ * Adds the cells that a segment passes through.
+ */
+static int
+trace_segment(cover_t *cover, double x0, double y0, double x1, double y1)
+{
+    double dx, dy, x, y, step_x, step_y, t_x, t_y, dt_x, dt_y;
+    size_t n;
+
+    dx = x1 - x0;
+    dy = y1 - y0;
+    x = floor(x0);
+    y = floor(y0);
+    n = (size_t) (fabs(floor(x1) - x) + fabs(floor(y1) - y));
+
+    step_x = (dx > 0.0) ? 1.0 : -1.0;
+    step_y = (dy > 0.0) ? 1.0 : -1.0;
+    if (dx != 0.0) {
+        t_x = (((dx > 0.0) ? x + 1.0 : x) - x0) / dx;
+        dt_x = step_x / dx;
+    }
+    else {
+        t_x = HUGE_VAL;
+        dt_x = HUGE_VAL;
+    }
+    if (dy != 0.0) {
+        t_y = (((dy > 0.0) ? y + 1.0 : y) - y0) / dy;
+        dt_y = step_y / dy;
+    }
+    else {
+        t_y = HUGE_VAL;
+        dt_y = HUGE_VAL;
+    }
+
+    if (add_cell(cover, x, y) < 0) {
+        return -1;
+    }
+    for (; n > 0; --n) {
+        if (t_x <= t_y) {
+            x += step_x;
+            t_x += dt_x;
+        }
+        else {
+            y += step_y;
+            t_y += dt_y;
+        }
+        if (add_cell(cover, x, y) < 0) {
+            return -1;
+        }
+    }
+
+    /* Rounding errors could end the walk in a neighboring cell */
+    if (floor(x1) != x || floor(y1) != y) {
+        return add_cell(cover, x1, y1);
+    }
+    return 1;
+}
+
+static int
+compare_edges(const void *a, const void *b)
+{
+    const edge_t *e1 = (const edge_t *) a;
+    const edge_t *e2 = (const edge_t *) b;
+
+    if (e1->y0 < e2->y0) {
+        return -1;
+    }
+    if (e1->y0 > e2->y0) {
+        return 1;
+    }
+    return 0;
+}
+
+static int
+compare_cells(const void *a, const void *b)
+{
+    uint64_t c1 = *(const uint64_t *) a;
+    uint64_t c2 = *(const uint64_t *) b;
+
+    if (c1 < c2) {
+        return -1;
+    }
+    if (c1 > c2) {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Adds the cells whose centers are inside the polygon.
+ */
+static int
+fill_rows(cover_t *cover, edge_t *edges, size_t num_edges, size_t *active,
+          double *xs)
+{
+    const edge_t *edge;
+    double y_min, y_max, yc, x, col, last_col;
+    size_t num_active, next, i, j, n;
+
+    if (num_edges == 0) {
+        return 1;
+    }
+
+    qsort(edges, num_edges, sizeof(*edges), compare_edges);
+
+    y_max = 0.0;
+    for (i = 0; i < num_edges; ++i) {
+        if (edges[i].y1 > y_max) {
+            y_max = edges[i].y1;
+        }
+    }
+
+    next = 0;
+    num_active = 0;
+    for (y_min = floor(edges[0].y0); y_min < y_max; y_min += 1.0) {
+        yc = y_min + 0.5;
+
+        /* Add the edges that start below the cell centers */
+        while (next < num_edges && edges[next].y0 <= yc) {
+            active[num_active] = next;
+            ++num_active;
+            ++next;
+        }
+
+        /* Remove the edges that end below the cell centers and compute the
+         * intersections */
+        n = 0;
+        for (i = 0; i < num_active; ++i) {
+            edge = &edges[active[i]];
+            if (edge->y1 > yc) {
+                active[n] = active[i];
+                x = edge->x0 + (yc - edge->y0) * edge->dxdy;
+                for (j = n; j > 0 && xs[j - 1] > x; --j) {
+                    xs[j] = xs[j - 1];
+                }
+                xs[j] = x;
+                ++n;
+            }
+        }
+        num_active = n;
+
+        for (i = 0; i + 1 < n; i += 2) {
+            last_col = ceil(xs[i + 1] - 0.5);
+            for (col = ceil(xs[i] - 0.5); col < last_col; col += 1.0) {
+                if (add_cell(cover, col, y_min) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+static int
+cover_parts(cover_t *cover, const shp_parts_t *view, int is_polygon)
+{
+    int rc = -1;
+    edge_t *edges = NULL, *edge;
+    size_t *active = NULL;
+    double *xs = NULL;
+    size_t num_edges, part_num, i, start, end;
+    double x0, y0, x1, y1;
+
+    if (is_polygon) {
+        if (view->num_points >
+            SIZE_MAX / (sizeof(*edges) + sizeof(*active) + sizeof(*xs))) {
+            errno = ENOMEM;
+            goto cleanup;
+        }
+        edges = (edge_t *) malloc(view->num_points * (sizeof(*edges) +
+                                                      sizeof(*active) +
+                                                      sizeof(*xs)));
+        if (edges == NULL) {
+            goto cleanup;
+        }
+        xs = (double *) (edges + view->num_points);
+        active = (size_t *) (xs + view->num_points);
+    }
+
+    num_edges = 0;
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) == 0) {
+            continue;
+        }
+        /* Rings are closed implicitly */
+        i = (is_polygon) ? end - 1 : start;
+        to_cell_units(cover, shp_parts_x(view, i), shp_parts_y(view, i), &x1,
+                      &y1);
+        if (add_cell(cover, x1, y1) < 0) {
+            goto cleanup;
+        }
+        for (i = (is_polygon) ? start : start + 1; i < end; ++i) {
+            x0 = x1;
+            y0 = y1;
+            to_cell_units(cover, shp_parts_x(view, i), shp_parts_y(view, i),
+                          &x1, &y1);
+            if (trace_segment(cover, x0, y0, x1, y1) < 0) {
+                goto cleanup;
+            }
+
+            /* Skip horizontal edges */
+            if (is_polygon && y0 != y1) {
+                edge = &edges[num_edges];
+                if (y0 < y1) {
+                    edge->y0 = y0;
+                    edge->y1 = y1;
+                    edge->x0 = x0;
+                }
+                else {
+                    edge->y0 = y1;
+                    edge->y1 = y0;
+                    edge->x0 = x1;
+                }
+                edge->dxdy = (x1 - x0) / (y1 - y0);
+                ++num_edges;
+            }
+        }
+    }
+
+    if (is_polygon && fill_rows(cover, edges, num_edges, active, xs) < 0) {
+        goto cleanup;
+    }
+
+    rc = 1;
+
+cleanup:
+
+    free(edges);
+
+    return rc;
+}
+
+static int
+cover_points(cover_t *cover, size_t num_points, const char *points)
+{
+    size_t i;
+    double x, y;
+
+    for (i = 0; i < num_points; ++i) {
+        to_cell_units(cover, shp_le64_to_double(points + 16 * i),
+                      shp_le64_to_double(points + 16 * i + 8), &x, &y);
+        if (add_cell(cover, x, y) < 0) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static int
+cover_point(cover_t *cover, double lon, double lat)
+{
+    double x, y;
+
+    to_cell_units(cover, lon, lat, &x, &y);
+    return add_cell(cover, x, y);
+}
+
+static int
+cover_record(cover_t *cover, const shp_record_t *record)
+{
+    shp_parts_t view;
+
+    switch (record->type) {
+    case SHP_TYPE_POINT:
+        return cover_point(cover, record->shape.point.x,
+                           record->shape.point.y);
+    case SHP_TYPE_POINTM:
+        return cover_point(cover, record->shape.pointm.x,
+                           record->shape.pointm.y);
+    case SHP_TYPE_POINTZ:
+        return cover_point(cover, record->shape.pointz.x,
+                           record->shape.pointz.y);
+    case SHP_TYPE_MULTIPOINT:
+        return cover_points(cover, record->shape.multipoint.num_points,
+                            record->shape.multipoint.points);
+    case SHP_TYPE_MULTIPOINTM:
+        return cover_points(cover, record->shape.multipointm.num_points,
+                            record->shape.multipointm.points);
+    case SHP_TYPE_MULTIPOINTZ:
+        return cover_points(cover, record->shape.multipointz.num_points,
+                            record->shape.multipointz.points);
+    case SHP_TYPE_POLYLINE:
+        shp_parts_init(&view, record->shape.polyline.num_parts,
+                       record->shape.polyline.num_points,
+                       record->shape.polyline.parts,
+                       record->shape.polyline.points);
+        return cover_parts(cover, &view, 0);
+    case SHP_TYPE_POLYLINEM:
+        shp_parts_init(&view, record->shape.polylinem.num_parts,
+                       record->shape.polylinem.num_points,
+                       record->shape.polylinem.parts,
+                       record->shape.polylinem.points);
+        return cover_parts(cover, &view, 0);
+    case SHP_TYPE_POLYLINEZ:
+        shp_parts_init(&view, record->shape.polylinez.num_parts,
+                       record->shape.polylinez.num_points,
+                       record->shape.polylinez.parts,
+                       record->shape.polylinez.points);
+        return cover_parts(cover, &view, 0);
+    case SHP_TYPE_POLYGON:
+        shp_parts_init(&view, record->shape.polygon.num_parts,
+                       record->shape.polygon.num_points,
+                       record->shape.polygon.parts,
+                       record->shape.polygon.points);
+        return cover_parts(cover, &view, 1);
+    case SHP_TYPE_POLYGONM:
+        shp_parts_init(&view, record->shape.polygonm.num_parts,
+                       record->shape.polygonm.num_points,
+                       record->shape.polygonm.parts,
+                       record->shape.polygonm.points);
+        return cover_parts(cover, &view, 1);
+    case SHP_TYPE_POLYGONZ:
+        shp_parts_init(&view, record->shape.polygonz.num_parts,
+                       record->shape.polygonz.num_points,
+                       record->shape.polygonz.parts,
+                       record->shape.polygonz.points);
+        return cover_parts(cover, &view, 1);
+    default:
+        return 1;
+    }
+}
+
+static void
+write_key(const cover_t *cover, uint64_t code, char *key)
+{
+    unsigned int i;
+
+    if (cover->type == SHP_COVER_QUADKEY) {
+        for (i = cover->level; i > 0; --i) {
+            key[i - 1] = (char) ('0' + (code & 3));
+            code >>= 2;
+        }
+    }
+    else {
+        for (i = cover->level; i > 0; --i) {
+            key[i - 1] = base32[code & 31];
+            code >>= 5;
+        }
+    }
+    key[cover->level] = '\0';
+}
+
+int
+shp_record_cover(const shp_record_t *record, shp_cover_type_t type,
+                 unsigned int level, shp_cover_t **pcover)
+{
+    int rc = -1;
+    cover_t cover;
+    shp_cover_t *result = NULL;
+    size_t key_size, num_keys, i, size;
+
+    assert(record != NULL);
+    assert(pcover != NULL);
+
+    *pcover = NULL;
+
+    cover.type = type;
+    cover.level = level;
+    cover.num_cells = 0;
+    cover.max_cells = 0;
+    cover.cells = NULL;
+
+    if (type == SHP_COVER_QUADKEY) {
+        if (level < 1 || level > MAX_QUADKEY_LEVEL) {
+            errno = EINVAL;
+            goto cleanup;
+        }
+        cover.col_bits = level;
+        cover.row_bits = level;
+    }
+    else {
+        if (level < 1 || level > MAX_GEOHASH_LEVEL) {
+            errno = EINVAL;
+            goto cleanup;
+        }
+        /* Every character encodes 5 bits, starting with a column bit */
+        cover.col_bits = (5 * level + 1) / 2;
+        cover.row_bits = 5 * level / 2;
+    }
+    cover.num_cols = ldexp(1.0, (int) cover.col_bits);
+    cover.num_rows = ldexp(1.0, (int) cover.row_bits);
+
+    if (cover_record(&cover, record) < 0) {
+        goto cleanup;
+    }
+
+    qsort(cover.cells, cover.num_cells, sizeof(*cover.cells),
+          compare_cells);
+    num_keys = 0;
+    for (i = 0; i < cover.num_cells; ++i) {
+        if (num_keys == 0 || cover.cells[i] != cover.cells[num_keys - 1]) {
+            cover.cells[num_keys] = cover.cells[i];
+            ++num_keys;
+        }
+    }
+
+    key_size = level + 1;
+    if (num_keys > (SIZE_MAX - sizeof(*result)) / key_size) {
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    size = sizeof(*result) + num_keys * key_size;
+    result = (shp_cover_t *) malloc(size);
+    if (result == NULL) {
+        goto cleanup;
+    }
+    result->num_keys = num_keys;
+    result->key_size = key_size;
+    result->keys = (char *) (result + 1);
+    for (i = 0; i < num_keys; ++i) {
+        write_key(&cover, cover.cells[i], result->keys + i * key_size);
+    }
+
+    *pcover = result;
+    rc = 1;
+
+cleanup:
+
+    free(cover.cells);
+
+    return rc;
+}
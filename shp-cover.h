@@ -0,0 +1,88 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_COVER_H
+#define _SHAPEREADER_SHP_COVER_H
+
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Cell systems
+ */
+typedef enum shp_cover_type_t {
+    SHP_COVER_QUADKEY = 0, /**< Web Mercator tiles, levels 1 to 31 */
+    SHP_COVER_GEOHASH      /**< Geohashes, precisions 1 to 12 */
+} shp_cover_type_t;
+
+/**
+ * Cell cover
+ *
+ * The keys of the cells are stored in ascending order.  Key @c i starts at
+ * @c keys + @c i * @a key_size and is terminated with a null character.
+ */
+typedef struct shp_cover_t {
+    size_t num_keys; /**< Number of cells */
+    size_t key_size; /**< Level or precision plus 1 */
+    char *keys;      /**< Null-terminated keys */
+} shp_cover_t;
+
+/**
+ * Compute the cells that cover a shape
+ *
+ * Gets the quadkeys or geohashes of the cells that a shape intersects.  The
+ * coordinates are longitudes and latitudes in degrees.  Quadkeys are
+ * computed for Web Mercator tiles at the zoom level @p level.  Geohashes
+ * have @p level characters.
+ *
+ * The shape's points are converted into cell units.  The segments of
+ * PolyLines and polygons are traced through the grid of cells.  The cells
+ * inside polygons are found by scanning the rows of cells and testing the
+ * cells' centers with the even-odd rule, so that holes are left out.
+ * Points and multipoints are covered by the cells that contain the points.
+ * A cell includes its western edge and its southern edge if it is a
+ * geohash or its northern edge if it is a tile.  Null shapes and
+ * MultiPatches have no cells.
+ *
+ * The cover is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_cover_t *cover;
+ * size_t i;
+ *
+ * if (shp_record_cover(record, SHP_COVER_GEOHASH, 5, &cover) > 0) {
+ *   for (i = 0; i < cover->num_keys; ++i) {
+ *     puts(cover->keys + i * cover->key_size);
+ *   }
+ *   free(cover);
+ * }
+ * @endcode
+ *
+ * @memberof shp_record_t
+ * @param record a record.
+ * @param type the cell system.
+ * @param level the zoom level or the number of geohash characters.
+ * @param[out] pcover on success, a pointer to a shp_cover_t structure.
+ * @retval 1 on success.
+ * @retval -1 if the level is invalid or memory could not be allocated.
+ */
+extern int shp_record_cover(const shp_record_t *record,
+                            shp_cover_type_t type, unsigned int level,
+                            shp_cover_t **pcover);
+
+#endif
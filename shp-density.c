@@ -0,0 +1,215 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-density.h"
+#include "byteorder.h"
+#include "record.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define UNUSED(x) (void)(x)
+
+typedef struct density_t {
+    const shp_grid_t *grid;
+    dbf_file_t *dbf_fh;
+    const dbf_field_t *field;
+    size_t *counts;
+    double *sums;
+} density_t;
+
+static int
+is_numeric(const dbf_field_t *field)
+{
+    switch (field->type) {
+    case DBF_TYPE_AUTOINCREMENT:
+    case DBF_TYPE_BINARY_OR_DOUBLE:
+    case DBF_TYPE_CURRENCY:
+    case DBF_TYPE_DOUBLE:
+    case DBF_TYPE_FLOAT:
+    case DBF_TYPE_INTEGER:
+    case DBF_TYPE_NUMBER:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Returns 0 if the field is null.
+ */
+static int
+get_weight(const dbf_record_t *record, const dbf_field_t *field,
+           double *weight)
+{
+    int32_t i32;
+    int64_t i64;
+    int ok;
+
+    *weight = 0.0;
+    switch (field->type) {
+    case DBF_TYPE_AUTOINCREMENT:
+    case DBF_TYPE_INTEGER:
+        ok = dbf_record_int32(record, field, &i32);
+        *weight = (double) i32;
+        break;
+    case DBF_TYPE_CURRENCY:
+        ok = dbf_record_int64(record, field, &i64);
+        *weight = (double) i64 / pow(10.0, (double) field->decimal_places);
+        break;
+    case DBF_TYPE_DOUBLE:
+        ok = dbf_record_double(record, field, weight);
+        break;
+    case DBF_TYPE_BINARY_OR_DOUBLE:
+        /* FoxPro stores doubles, dBase stores numeric strings */
+        if (field->length == 8) {
+            ok = dbf_record_double(record, field, weight);
+        }
+        else {
+            ok = dbf_record_strtod(record, field, weight);
+        }
+        break;
+    default:
+        ok = !dbf_record_is_null(record, field) &&
+             dbf_record_strtod(record, field, weight);
+        break;
+    }
+    return ok;
+}
+
+static void
+add_point(density_t *density, double x, double y, double weight)
+{
+    const shp_grid_t *grid = density->grid;
+    shp_cell_t cell;
+    size_t i;
+
+    if (shp_grid_cell(grid, x, y, &cell)) {
+        i = (size_t) cell.row * grid->num_cols + (size_t) cell.col;
+        if (density->counts != NULL) {
+            ++density->counts[i];
+        }
+        if (density->sums != NULL) {
+            density->sums[i] += weight;
+        }
+    }
+}
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    UNUSED(fh);
+    UNUSED(header);
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    density_t *density = (density_t *) fh->user_data;
+    dbf_record_t *dbf_record;
+    const char *points;
+    shp_point_t point;
+    size_t num_points, i;
+    double weight = 1.0;
+    int deleted, rc;
+
+    UNUSED(header);
+    UNUSED(file_offset);
+
+    if (density->dbf_fh != NULL) {
+        rc = dbf_read_record(density->dbf_fh, &dbf_record);
+        if (rc <= 0) {
+            if (rc < 0) {
+                shp_set_error(fh, "%s", density->dbf_fh->error);
+            }
+            else {
+                shp_set_error(fh, "The dBase record for record %zu is "
+                              "missing", record->record_number);
+                errno = EINVAL;
+            }
+            return -1;
+        }
+        deleted = dbf_record_is_deleted(dbf_record);
+        if (!get_weight(dbf_record, density->field, &weight)) {
+            weight = 0.0;
+        }
+        free(dbf_record);
+        if (deleted) {
+            return 1;
+        }
+    }
+
+    switch (record->type) {
+    case SHP_TYPE_NULL:
+        return 1;
+    case SHP_TYPE_POINT:
+    case SHP_TYPE_POINTM:
+    case SHP_TYPE_POINTZ:
+    case SHP_TYPE_MULTIPOINT:
+    case SHP_TYPE_MULTIPOINTM:
+    case SHP_TYPE_MULTIPOINTZ:
+        break;
+    default:
+        shp_set_error(fh, "Shape type %d is not a point in record %zu",
+                      (int) record->type, record->record_number);
+        errno = EINVAL;
+        return -1;
+    }
+
+    num_points = shp_record_xy(record, &points, &point);
+    if (points == NULL) {
+        add_point(density, point.x, point.y, weight);
+    }
+    else {
+        for (i = 0; i < num_points; ++i) {
+            add_point(density, shp_le64_to_double(points + 16 * i),
+                      shp_le64_to_double(points + 16 * i + 8), weight);
+        }
+    }
+
+    return 1;
+}
+
+int
+shp_density_read(shp_file_t *fh, const shp_grid_t *grid, dbf_file_t *dbf_fh,
+                 const dbf_field_t *field, size_t *counts, double *sums)
+{
+    int rc;
+    density_t density;
+    void *user_data;
+
+    assert(fh != NULL);
+    assert(grid != NULL);
+    assert(dbf_fh == NULL || field != NULL);
+
+    if (dbf_fh != NULL && !is_numeric(field)) {
+        shp_set_error(fh, "Field \"%s\" is not numeric", field->name);
+        errno = EINVAL;
+        return -1;
+    }
+
+    density.grid = grid;
+    density.dbf_fh = dbf_fh;
+    density.field = field;
+    density.counts = counts;
+    density.sums = sums;
+
+    user_data = fh->user_data;
+    fh->user_data = &density;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+
+    return (rc < 0) ? -1 : 1;
+}
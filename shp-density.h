@@ -0,0 +1,83 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_DENSITY_H
+#define _SHAPEREADER_SHP_DENSITY_H
+
+#include "dbf.h"
+#include "shp-grid.h"
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Aggregate points into grid cells
+ *
+ * Reads a file that has the file extension ".shp" and contains points or
+ * multipoints of any shape type.  Counts the points in every grid cell and
+ * sums up their weights.  The counts and sums are stored row by row
+ * starting with row 0.  The values are added to the arrays, so that several
+ * files can be aggregated into the same grids.  Points outside the grid and
+ * null shapes are skipped.
+ *
+ * If @p dbf_fh is not NULL, a point's weight is the value of @p field in
+ * the dBase record that belongs to the shape.  The dBase header must have
+ * been read so that the next dBase record belongs to the next shape.  The
+ * field may be a number, float, double, integer, autoincrement or currency
+ * field.  Points whose weight is null are counted but do not change the
+ * sums.  Shapes whose dBase record is deleted are skipped.  If @p dbf_fh is
+ * NULL, every point has the weight 1.
+ *
+ * The file is read once with shp_read.  The coordinates are decoded from
+ * the record buffers and are not copied.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * dbf_header_t *header;
+ * const dbf_field_t *field;
+ * size_t *counts;
+ * double *sums;
+ *
+ * counts = calloc(grid->num_cols * grid->num_rows, sizeof(*counts));
+ * sums = calloc(grid->num_cols * grid->num_rows, sizeof(*sums));
+ * if (dbf_read_header(dbf_fh, &header) > 0) {
+ *   field = header->fields; // Or another numeric field
+ *   if (shp_density_read(shp_fh, grid, dbf_fh, field, counts, sums) > 0) {
+ *     // Do something
+ *   }
+ *   free(header);
+ * }
+ * free(sums);
+ * free(counts);
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param grid a grid.
+ * @param dbf_fh a dBase file handle or NULL.
+ * @param field a numeric field if @p dbf_fh is not NULL.
+ * @param[in,out] counts NULL or an array with room for
+ *                       @a num_cols * @a num_rows counts.
+ * @param[in,out] sums NULL or an array with room for
+ *                     @a num_cols * @a num_rows sums.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see shp_read
+ */
+extern int shp_density_read(shp_file_t *fh, const shp_grid_t *grid,
+                            dbf_file_t *dbf_fh, const dbf_field_t *field,
+                            size_t *counts, double *sums);
+
+#endif
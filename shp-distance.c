@@ -0,0 +1,161 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-distance.h"
+#include "parts.h"
+#include <assert.h>
+#include <math.h>
+
+#define BLOCK_SIZE 64
+
+typedef struct search_t {
+    double x;
+    double y;
+    double d2;
+    double t;
+    size_t part_num;
+    size_t point_num;
+} search_t;
+
+static void
+search_part(const shp_parts_t *view, size_t part_num, size_t start,
+            size_t end, search_t *search)
+{
+    double xs[BLOCK_SIZE + 1], ys[BLOCK_SIZE + 1], d2[BLOCK_SIZE],
+        ts[BLOCK_SIZE];
+    double dx, dy, len2, t, ex, ey;
+    size_t i, k, n;
+
+    if (end - start == 1) {
+        dx = shp_parts_x(view, start) - search->x;
+        dy = shp_parts_y(view, start) - search->y;
+        if (dx * dx + dy * dy < search->d2) {
+            search->d2 = dx * dx + dy * dy;
+            search->t = 0.0;
+            search->part_num = part_num;
+            search->point_num = start;
+        }
+        return;
+    }
+
+    for (i = start; i + 1 < end; i += n) {
+        n = end - 1 - i;
+        if (n > BLOCK_SIZE) {
+            n = BLOCK_SIZE;
+        }
+
+        /* Decode the coordinates relative to the search point */
+        for (k = 0; k <= n; ++k) {
+            xs[k] = shp_parts_x(view, i + k) - search->x;
+            ys[k] = shp_parts_y(view, i + k) - search->y;
+        }
+
+        /* Project the origin onto the segments */
+        for (k = 0; k < n; ++k) {
+            dx = xs[k + 1] - xs[k];
+            dy = ys[k + 1] - ys[k];
+            len2 = dx * dx + dy * dy;
+            /* Clamp before dividing so that the loop has no branches.  The
+             * dot product is 0 if the segment has no length. */
+            t = -(xs[k] * dx + ys[k] * dy);
+            t = (t > 0.0) ? t : 0.0;
+            t = (t < len2) ? t : len2;
+            t = t / (len2 + (double) (len2 == 0.0));
+            ex = xs[k] + t * dx;
+            ey = ys[k] + t * dy;
+            d2[k] = ex * ex + ey * ey;
+            ts[k] = t;
+        }
+
+        for (k = 0; k < n; ++k) {
+            if (d2[k] < search->d2) {
+                search->d2 = d2[k];
+                search->t = ts[k];
+                search->part_num = part_num;
+                search->point_num = i + k;
+            }
+        }
+    }
+}
+
+static int
+search_parts(const shp_parts_t *view, double x, double y,
+             shp_nearest_t *nearest)
+{
+    search_t search;
+    size_t part_num, i, start, end;
+    double x0, y0;
+
+    search.x = x;
+    search.y = y;
+    search.d2 = HUGE_VAL;
+    search.t = 0.0;
+    search.part_num = 0;
+    search.point_num = 0;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) > 0) {
+            search_part(view, part_num, start, end, &search);
+        }
+    }
+
+    if (search.d2 == HUGE_VAL) {
+        return 0;
+    }
+
+    i = search.point_num;
+    x0 = shp_parts_x(view, i);
+    y0 = shp_parts_y(view, i);
+    if (search.t >= 1.0) {
+        x0 = shp_parts_x(view, i + 1);
+        y0 = shp_parts_y(view, i + 1);
+    }
+    else if (search.t > 0.0) {
+        x0 += search.t * (shp_parts_x(view, i + 1) - x0);
+        y0 += search.t * (shp_parts_y(view, i + 1) - y0);
+    }
+
+    nearest->distance = sqrt(search.d2);
+    nearest->part_num = search.part_num;
+    nearest->point_num = i;
+    nearest->point.x = x0;
+    nearest->point.y = y0;
+
+    return 1;
+}
+
+int
+shp_polyline_nearest(const shp_polyline_t *polyline, double x, double y,
+                     shp_nearest_t *nearest)
+{
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(nearest != NULL);
+
+    shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                   polyline->parts, polyline->points);
+    return search_parts(&view, x, y, nearest);
+}
+
+int
+shp_polygon_nearest(const shp_polygon_t *polygon, double x, double y,
+                    shp_nearest_t *nearest)
+{
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(nearest != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    return search_parts(&view, x, y, nearest);
+}
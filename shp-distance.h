@@ -0,0 +1,85 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_DISTANCE_H
+#define _SHAPEREADER_SHP_DISTANCE_H
+
+#include "shp-point.h"
+#include "shp-polygon.h"
+#include "shp-polyline.h"
+#include <stddef.h>
+
+/**
+ * Nearest location on a shape
+ */
+typedef struct shp_nearest_t {
+    double distance;   /**< Euclidean distance */
+    size_t part_num;   /**< Part that contains the nearest segment */
+    size_t point_num;  /**< First point of the nearest segment */
+    shp_point_t point; /**< Nearest location on the segment */
+} shp_nearest_t;
+
+/**
+ * Get the nearest location on a PolyLine
+ *
+ * Projects a point onto every segment of a PolyLine and returns the nearest
+ * location.  The segment that starts with @a point_num ends with the
+ * following point.  If several segments are equally near, the first one is
+ * returned.
+ *
+ * The coordinates are decoded in blocks and the distances are computed in
+ * loops without branches that compilers can vectorize.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_nearest_t nearest;
+ *
+ * if (shp_polyline_nearest(polyline, x, y, &nearest)) {
+ *   printf("%f %zu\n", nearest.distance, nearest.point_num);
+ * }
+ * @endcode
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param[out] nearest the nearest location.
+ * @retval 1 on success.
+ * @retval 0 if the PolyLine has no points.
+ */
+extern int shp_polyline_nearest(const shp_polyline_t *polyline, double x,
+                                double y, shp_nearest_t *nearest);
+
+/**
+ * Get the nearest location on the boundary of a polygon
+ *
+ * Works like shp_polyline_nearest for the rings of a polygon.  The distance
+ * is also computed for points inside the polygon.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param[out] nearest the nearest location.
+ * @retval 1 on success.
+ * @retval 0 if the polygon has no points.
+ *
+ * @see shp_polyline_nearest
+ */
+extern int shp_polygon_nearest(const shp_polygon_t *polygon, double x,
+                               double y, shp_nearest_t *nearest);
+
+#endif
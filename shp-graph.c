@@ -0,0 +1,480 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-graph.h"
+#include "parts.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void)(x)
+
+#define NIL SIZE_MAX
+
+/*
+ * The nodes are stored in a hash table of grid cells.  Every table entry
+ * points to the first node in a cell.  The other nodes in the cell are
+ * linked through the "next" array.
+ */
+typedef struct builder_t {
+    double tolerance;
+    size_t num_nodes;
+    size_t max_nodes;
+    shp_point_t *nodes;
+    size_t *next;
+    size_t table_size;
+    size_t num_cells;
+    size_t *table;
+    size_t num_edges;
+    size_t max_edges;
+    shp_edge_t *edges;
+} builder_t;
+
+static void
+get_cell(const builder_t *builder, double x, double y, double *cx,
+         double *cy)
+{
+    if (builder->tolerance > 0.0) {
+        *cx = floor(x / builder->tolerance);
+        *cy = floor(y / builder->tolerance);
+    }
+    else {
+        *cx = x;
+        *cy = y;
+    }
+    /* Turn -0.0 into 0.0 */
+    *cx += 0.0;
+    *cy += 0.0;
+}
+
+static size_t
+hash_cell(double cx, double cy)
+{
+    uint64_t a, b, h;
+
+    memcpy(&a, &cx, sizeof(a));
+    memcpy(&b, &cy, sizeof(b));
+    h = (a * UINT64_C(0x9e3779b97f4a7c15)) ^ b;
+    h ^= h >> 32;
+    h *= UINT64_C(0xd6e8feb86659fd93);
+    h ^= h >> 32;
+    return (size_t) h;
+}
+
+/*
+ * Returns the table entry for a cell or the empty entry where the cell has
+ * to be inserted.
+ */
+static size_t
+find_cell(const builder_t *builder, double cx, double cy)
+{
+    size_t mask, i, node;
+    double x, y;
+
+    mask = builder->table_size - 1;
+    i = hash_cell(cx, cy) & mask;
+    while ((node = builder->table[i]) != NIL) {
+        get_cell(builder, builder->nodes[node].x, builder->nodes[node].y, &x,
+                 &y);
+        if (x == cx && y == cy) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int
+grow_table(builder_t *builder)
+{
+    size_t table_size, i, node;
+    size_t *table;
+    double cx, cy;
+
+    table_size = (builder->table_size > 0) ? 2 * builder->table_size : 64;
+    if (table_size > SIZE_MAX / sizeof(*table)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    table = (size_t *) malloc(table_size * sizeof(*table));
+    if (table == NULL) {
+        return -1;
+    }
+    free(builder->table);
+    builder->table = table;
+    builder->table_size = table_size;
+    for (i = 0; i < table_size; ++i) {
+        table[i] = NIL;
+    }
+
+    builder->num_cells = 0;
+    for (node = 0; node < builder->num_nodes; ++node) {
+        get_cell(builder, builder->nodes[node].x, builder->nodes[node].y, &cx,
+                 &cy);
+        i = find_cell(builder, cx, cy);
+        if (table[i] == NIL) {
+            ++builder->num_cells;
+        }
+        builder->next[node] = table[i];
+        table[i] = node;
+    }
+
+    return 1;
+}
+
+static int
+grow_nodes(builder_t *builder)
+{
+    size_t max_nodes;
+    shp_point_t *nodes;
+    size_t *next;
+
+    max_nodes = (builder->max_nodes > 0) ? 2 * builder->max_nodes : 64;
+    if (max_nodes > SIZE_MAX / sizeof(*nodes)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    nodes = (shp_point_t *) realloc(builder->nodes,
+                                    max_nodes * sizeof(*nodes));
+    if (nodes == NULL) {
+        return -1;
+    }
+    builder->nodes = nodes;
+    next = (size_t *) realloc(builder->next, max_nodes * sizeof(*next));
+    if (next == NULL) {
+        return -1;
+    }
+    builder->next = next;
+    builder->max_nodes = max_nodes;
+    return 1;
+}
+
+/*
+ * Returns the nearest node within the tolerance or NIL.
+ */
+static size_t
+find_node(const builder_t *builder, double x, double y)
+{
+    size_t best, node;
+    double cx, cy, dx, dy, d, best_d, t2;
+    int i, j;
+
+    get_cell(builder, x, y, &cx, &cy);
+    if (builder->tolerance <= 0.0) {
+        return builder->table[find_cell(builder, cx, cy)];
+    }
+
+    t2 = builder->tolerance * builder->tolerance;
+    best = NIL;
+    best_d = HUGE_VAL;
+    for (i = -1; i <= 1; ++i) {
+        for (j = -1; j <= 1; ++j) {
+            node = builder->table[find_cell(builder, cx + i, cy + j)];
+            for (; node != NIL; node = builder->next[node]) {
+                dx = builder->nodes[node].x - x;
+                dy = builder->nodes[node].y - y;
+                d = dx * dx + dy * dy;
+                if (d <= t2 && d < best_d) {
+                    best = node;
+                    best_d = d;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+/*
+ * Returns the node at a point.  Adds a node if there is no node within the
+ * tolerance.
+ */
+static size_t
+snap(builder_t *builder, double x, double y)
+{
+    size_t node, i;
+    double cx, cy;
+
+    node = find_node(builder, x, y);
+    if (node != NIL) {
+        return node;
+    }
+
+    if (builder->num_nodes == builder->max_nodes &&
+        grow_nodes(builder) < 0) {
+        return NIL;
+    }
+    node = builder->num_nodes;
+    builder->nodes[node].x = x;
+    builder->nodes[node].y = y;
+    ++builder->num_nodes;
+
+    get_cell(builder, x, y, &cx, &cy);
+    i = find_cell(builder, cx, cy);
+    if (builder->table[i] == NIL) {
+        ++builder->num_cells;
+    }
+    builder->next[node] = builder->table[i];
+    builder->table[i] = node;
+
+    /* Keep the table at most half full */
+    if (2 * builder->num_cells > builder->table_size &&
+        grow_table(builder) < 0) {
+        return NIL;
+    }
+
+    return node;
+}
+
+static shp_edge_t *
+add_edge(builder_t *builder)
+{
+    size_t max_edges;
+    shp_edge_t *edges;
+
+    if (builder->num_edges == builder->max_edges) {
+        max_edges = (builder->max_edges > 0) ? 2 * builder->max_edges : 64;
+        if (max_edges > SIZE_MAX / sizeof(*edges)) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        edges = (shp_edge_t *) realloc(builder->edges,
+                                       max_edges * sizeof(*edges));
+        if (edges == NULL) {
+            return NULL;
+        }
+        builder->edges = edges;
+        builder->max_edges = max_edges;
+    }
+    return &builder->edges[builder->num_edges++];
+}
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    UNUSED(fh);
+    UNUSED(header);
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    builder_t *builder = (builder_t *) fh->user_data;
+    shp_parts_t view;
+    const char *m_array = NULL;
+    shp_edge_t *edge;
+    size_t part_num, i, start, end, from, to;
+    double x0, y0, x1, y1, length, m, m_min, m_max;
+
+    UNUSED(header);
+    UNUSED(file_offset);
+
+    switch (record->type) {
+    case SHP_TYPE_NULL:
+        return 1;
+    case SHP_TYPE_POLYLINE:
+        shp_parts_init(&view, record->shape.polyline.num_parts,
+                       record->shape.polyline.num_points,
+                       record->shape.polyline.parts,
+                       record->shape.polyline.points);
+        break;
+    case SHP_TYPE_POLYLINEM:
+        shp_parts_init(&view, record->shape.polylinem.num_parts,
+                       record->shape.polylinem.num_points,
+                       record->shape.polylinem.parts,
+                       record->shape.polylinem.points);
+        m_array = record->shape.polylinem.m_array;
+        break;
+    case SHP_TYPE_POLYLINEZ:
+        shp_parts_init(&view, record->shape.polylinez.num_parts,
+                       record->shape.polylinez.num_points,
+                       record->shape.polylinez.parts,
+                       record->shape.polylinez.points);
+        m_array = record->shape.polylinez.m_array;
+        break;
+    default:
+        shp_set_error(fh, "Shape type %d is not a PolyLine in record %zu",
+                      (int) record->type, record->record_number);
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (part_num = 0; part_num < view.num_parts; ++part_num) {
+        if (shp_parts_points(&view, part_num, &start, &end) < 2) {
+            continue;
+        }
+
+        length = 0.0;
+        x1 = shp_parts_x(&view, start);
+        y1 = shp_parts_y(&view, start);
+        for (i = start + 1; i < end; ++i) {
+            x0 = x1;
+            y0 = y1;
+            x1 = shp_parts_x(&view, i);
+            y1 = shp_parts_y(&view, i);
+            length += sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+        }
+
+        m_min = 0.0;
+        m_max = 0.0;
+        if (m_array != NULL) {
+            m_min = HUGE_VAL;
+            m_max = -HUGE_VAL;
+            for (i = start; i < end; ++i) {
+                m = shp_le64_to_double(m_array + 8 * i);
+                /* Skip "no data" values */
+                if (m < -1e38) {
+                    continue;
+                }
+                m_min = (m < m_min) ? m : m_min;
+                m_max = (m > m_max) ? m : m_max;
+            }
+        }
+
+        from = snap(builder, shp_parts_x(&view, start),
+                    shp_parts_y(&view, start));
+        to = snap(builder, shp_parts_x(&view, end - 1),
+                  shp_parts_y(&view, end - 1));
+        if (from == NIL || to == NIL || (edge = add_edge(builder)) == NULL) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            return -1;
+        }
+        edge->from = from;
+        edge->to = to;
+        edge->record_number = record->record_number;
+        edge->part_num = part_num;
+        edge->length = length;
+        edge->m_min = m_min;
+        edge->m_max = m_max;
+    }
+
+    return 1;
+}
+
+static shp_graph_t *
+build_graph(shp_file_t *fh, const builder_t *builder)
+{
+    shp_graph_t *graph = NULL;
+    size_t n, m, node_size, edge_size, size, i, node, *pos;
+    const shp_edge_t *edge;
+
+    n = builder->num_nodes;
+    m = builder->num_edges;
+
+    /* The structure is followed by the edges, nodes, offsets and adjacency */
+    node_size = sizeof(*graph->nodes) + sizeof(size_t);
+    edge_size = sizeof(*graph->edges) + 2 * sizeof(size_t);
+    size = sizeof(*graph) + sizeof(size_t);
+    if (n > (SIZE_MAX - size) / node_size) {
+        shp_set_error(fh, "Cannot allocate memory");
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    size += n * node_size;
+    if (m > (SIZE_MAX - size) / edge_size) {
+        shp_set_error(fh, "Cannot allocate memory");
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    size += m * edge_size;
+
+    graph = (shp_graph_t *) malloc(size);
+    if (graph == NULL) {
+        shp_set_error(fh, "Cannot allocate %zu bytes", size);
+        goto cleanup;
+    }
+    graph->num_nodes = n;
+    graph->num_edges = m;
+    graph->edges = (shp_edge_t *) (graph + 1);
+    graph->nodes = (shp_point_t *) (graph->edges + m);
+    graph->offsets = (size_t *) (graph->nodes + n);
+    graph->adjacency = graph->offsets + n + 1;
+
+    for (i = 0; i < m; ++i) {
+        graph->edges[i] = builder->edges[i];
+    }
+    for (i = 0; i < n; ++i) {
+        graph->nodes[i] = builder->nodes[i];
+    }
+
+    /* Count the edges at every node and compute the offsets */
+    for (i = 0; i <= n; ++i) {
+        graph->offsets[i] = 0;
+    }
+    for (i = 0; i < m; ++i) {
+        edge = &graph->edges[i];
+        ++graph->offsets[edge->from + 1];
+        ++graph->offsets[edge->to + 1];
+    }
+    for (i = 0; i < n; ++i) {
+        graph->offsets[i + 1] += graph->offsets[i];
+    }
+
+    /* Use the "next" array as the insert positions */
+    pos = builder->next;
+    for (node = 0; node < n; ++node) {
+        pos[node] = graph->offsets[node];
+    }
+    for (i = 0; i < m; ++i) {
+        edge = &graph->edges[i];
+        graph->adjacency[pos[edge->from]++] = i;
+        graph->adjacency[pos[edge->to]++] = i;
+    }
+
+cleanup:
+
+    return graph;
+}
+
+int
+shp_graph_read(shp_file_t *fh, double tolerance, shp_graph_t **pgraph)
+{
+    int rc = -1;
+    builder_t builder;
+    void *user_data;
+
+    assert(fh != NULL);
+    assert(pgraph != NULL);
+
+    *pgraph = NULL;
+
+    memset(&builder, 0, sizeof(builder));
+    builder.tolerance = tolerance;
+    if (grow_table(&builder) < 0) {
+        shp_set_error(fh, "Cannot allocate memory");
+        goto cleanup;
+    }
+
+    user_data = fh->user_data;
+    fh->user_data = &builder;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc < 0) {
+        goto cleanup;
+    }
+
+    *pgraph = build_graph(fh, &builder);
+    rc = (*pgraph != NULL) ? 1 : -1;
+
+cleanup:
+
+    free(builder.edges);
+    free(builder.table);
+    free(builder.next);
+    free(builder.nodes);
+
+    return rc;
+}
@@ -0,0 +1,102 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_GRAPH_H
+#define _SHAPEREADER_SHP_GRAPH_H
+
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Edge
+ *
+ * An edge is a part of a PolyLine, PolyLineM or PolyLineZ.  The edge
+ * connects the nodes at the part's first and last point.
+ */
+typedef struct shp_edge_t {
+    size_t from;          /**< Node at the first point */
+    size_t to;            /**< Node at the last point */
+    size_t record_number; /**< Record number (beginning at 1) */
+    size_t part_num;      /**< Zero-based part number */
+    double length;        /**< Length of the part */
+    double m_min;         /**< Smallest measure, HUGE_VAL or 0 */
+    double m_max;         /**< Largest measure, -HUGE_VAL or 0 */
+} shp_edge_t;
+
+/**
+ * Graph
+ *
+ * The graph is stored in compressed sparse row format.  The edges that
+ * start or end at node @c i are @c edges[adjacency[j]] for @c j from
+ * @c offsets[i] to @c offsets[i + 1] - 1.  Edges are undirected and are
+ * listed at both nodes.
+ */
+typedef struct shp_graph_t {
+    size_t num_nodes;   /**< Number of nodes */
+    size_t num_edges;   /**< Number of edges */
+    shp_point_t *nodes; /**< Node coordinates */
+    size_t *offsets;    /**< Start of each node's edges in adjacency */
+    size_t *adjacency;  /**< Edge numbers ordered by node */
+    shp_edge_t *edges;  /**< Edges */
+} shp_graph_t;
+
+/**
+ * Build a graph from a file with lines
+ *
+ * Reads a file that has the file extension ".shp" and contains PolyLines,
+ * PolyLineMs or PolyLineZs.  Every part becomes an edge.  The parts' end
+ * points are snapped to nodes.  End points that are at most @p tolerance
+ * apart are merged.  If @p tolerance is 0, only identical end points are
+ * merged.
+ *
+ * The file is read once with shp_read.  The nodes are found through a hash
+ * table of grid cells that are as large as the tolerance, so that only the
+ * nodes in the neighboring cells have to be compared.  The edge lengths and
+ * measure ranges are computed while the records are read.  "No data"
+ * measures below -10^38 are ignored, and parts without measures get the
+ * empty range from HUGE_VAL to -HUGE_VAL.  Null shapes are skipped.
+ *
+ * The graph is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_graph_t *graph;
+ * const shp_edge_t *edge;
+ * size_t node, j;
+ *
+ * shp_init_file(&fh, stream, NULL);
+ * if (shp_graph_read(&fh, 0.5, &graph) > 0) {
+ *   for (j = graph->offsets[node]; j < graph->offsets[node + 1]; ++j) {
+ *     edge = &graph->edges[graph->adjacency[j]];
+ *     // Do something
+ *   }
+ *   free(graph);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param tolerance the snapping distance.
+ * @param[out] pgraph on success, a pointer to a shp_graph_t structure.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see shp_read
+ */
+extern int shp_graph_read(shp_file_t *fh, double tolerance,
+                          shp_graph_t **pgraph);
+
+#endif
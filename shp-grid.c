@@ -0,0 +1,59 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-grid.h"
+#include <assert.h>
+#include <math.h>
+
+static long
+get_index(double d, size_t n)
+{
+    /* Clamp the index to [-1, n] so that it cannot overflow. */
+    if (!(d >= 0.0)) {
+        return -1;
+    }
+    if (d >= (double) n) {
+        return (long) n;
+    }
+    return (long) floor(d);
+}
+
+int
+shp_grid_cell(const shp_grid_t *grid, double x, double y, shp_cell_t *cell)
+{
+    assert(grid != NULL);
+    assert(cell != NULL);
+
+    cell->col = get_index((x - grid->x_min) / grid->cell_width,
+                          grid->num_cols);
+    cell->row = get_index((y - grid->y_min) / grid->cell_height,
+                          grid->num_rows);
+
+    return cell->col >= 0 && cell->col < (long) grid->num_cols &&
+           cell->row >= 0 && cell->row < (long) grid->num_rows;
+}
+
+void
+shp_grid_cell_box(const shp_grid_t *grid, const shp_cell_t *cell,
+                  double *x_min, double *y_min, double *x_max, double *y_max)
+{
+    assert(grid != NULL);
+    assert(cell != NULL);
+    assert(x_min != NULL);
+    assert(y_min != NULL);
+    assert(x_max != NULL);
+    assert(y_max != NULL);
+
+    *x_min = grid->x_min + (double) cell->col * grid->cell_width;
+    *y_min = grid->y_min + (double) cell->row * grid->cell_height;
+    *x_max = grid->x_min + (double) (cell->col + 1) * grid->cell_width;
+    *y_max = grid->y_min + (double) (cell->row + 1) * grid->cell_height;
+}
@@ -0,0 +1,77 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_GRID_H
+#define _SHAPEREADER_SHP_GRID_H
+
+#include <stddef.h>
+
+/**
+ * Grid
+ *
+ * A regular grid of cells, for example map tiles.  Column 0 and row 0 are
+ * in the bottom left corner.  A cell includes its bottom and left edges.
+ */
+typedef struct shp_grid_t {
+    double x_min;       /**< X coordinate of the bottom left corner */
+    double y_min;       /**< Y coordinate of the bottom left corner */
+    double cell_width;  /**< Width of a cell */
+    double cell_height; /**< Height of a cell */
+    size_t num_cols;    /**< Number of columns */
+    size_t num_rows;    /**< Number of rows */
+} shp_grid_t;
+
+/**
+ * Grid cell
+ *
+ * Cells to the left of or below the grid have the column or row -1.  Cells
+ * to the right of or above the grid have the column @a num_cols or the row
+ * @a num_rows.
+ */
+typedef struct shp_cell_t {
+    long col; /**< Column */
+    long row; /**< Row */
+} shp_cell_t;
+
+/**
+ * Get the cell that contains a point
+ *
+ * @memberof shp_grid_t
+ * @param grid a grid.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param[out] cell a shp_cell_t structure.
+ * @retval 1 if the point is in the grid.
+ * @retval 0 if the point is outside the grid.
+ */
+extern int shp_grid_cell(const shp_grid_t *grid, double x, double y,
+                         shp_cell_t *cell);
+
+/**
+ * Get the bounding box of a cell
+ *
+ * @memberof shp_grid_t
+ * @param grid a grid.
+ * @param cell a cell.
+ * @param[out] x_min X coordinate of the bottom left corner.
+ * @param[out] y_min Y coordinate of the bottom left corner.
+ * @param[out] x_max X coordinate of the top right corner.
+ * @param[out] y_max Y coordinate of the top right corner.
+ */
+extern void shp_grid_cell_box(const shp_grid_t *grid, const shp_cell_t *cell,
+                              double *x_min, double *y_min, double *x_max,
+                              double *y_max);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-hull.h"
+#include "byteorder.h"
+#include "record.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static int
+compare_points(const void *a, const void *b)
+{
+    const shp_point_t *p1 = (const shp_point_t *) a;
+    const shp_point_t *p2 = (const shp_point_t *) b;
+
+    if (p1->x != p2->x) {
+        return (p1->x < p2->x) ? -1 : 1;
+    }
+    if (p1->y != p2->y) {
+        return (p1->y < p2->y) ? -1 : 1;
+    }
+    return 0;
+}
+
+static double
+cross(const shp_point_t *o, const shp_point_t *a, const shp_point_t *b)
+{
+    return (a->x - o->x) * (b->y - o->y) - (a->y - o->y) * (b->x - o->x);
+}
+
+int
+shp_record_hull(const shp_record_t *record, shp_hull_t **phull)
+{
+    int rc = -1;
+    shp_hull_t *hull;
+    shp_point_t point, *sorted = NULL, *stack;
+    const char *points;
+    size_t n, m, i, k, lower;
+
+    assert(record != NULL);
+    assert(phull != NULL);
+
+    *phull = NULL;
+
+    n = shp_record_xy(record, &points, &point);
+    if (n > (SIZE_MAX / sizeof(*sorted) - 1) / 2) {
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    sorted = (shp_point_t *) malloc((2 * n + 1) * sizeof(*sorted));
+    if (sorted == NULL) {
+        goto cleanup;
+    }
+    stack = sorted + n;
+
+    if (points == NULL) {
+        if (n > 0) {
+            sorted[0] = point;
+        }
+    }
+    else {
+        for (i = 0; i < n; ++i) {
+            sorted[i].x = shp_le64_to_double(points + 16 * i);
+            sorted[i].y = shp_le64_to_double(points + 16 * i + 8);
+        }
+    }
+    qsort(sorted, n, sizeof(*sorted), compare_points);
+
+    /* Remove duplicate points */
+    m = 0;
+    for (i = 0; i < n; ++i) {
+        if (m == 0 || compare_points(&sorted[m - 1], &sorted[i]) != 0) {
+            sorted[m] = sorted[i];
+            ++m;
+        }
+    }
+
+    /* Build the lower hull from left to right and the upper hull from right
+     * to left */
+    k = 0;
+    for (i = 0; i < m; ++i) {
+        while (k >= 2 &&
+               cross(&stack[k - 2], &stack[k - 1], &sorted[i]) <= 0) {
+            --k;
+        }
+        stack[k] = sorted[i];
+        ++k;
+    }
+    lower = k + 1;
+    for (i = m; i > 1; --i) {
+        while (k >= lower &&
+               cross(&stack[k - 2], &stack[k - 1], &sorted[i - 2]) <= 0) {
+            --k;
+        }
+        stack[k] = sorted[i - 2];
+        ++k;
+    }
+    /* The last point equals the first point */
+    if (k > 1) {
+        --k;
+    }
+
+    hull = (shp_hull_t *) malloc(sizeof(*hull) + k * sizeof(*stack));
+    if (hull == NULL) {
+        goto cleanup;
+    }
+    hull->num_points = k;
+    hull->points = (shp_point_t *) (hull + 1);
+    for (i = 0; i < k; ++i) {
+        hull->points[i] = stack[i];
+    }
+
+    *phull = hull;
+    rc = 1;
+
+cleanup:
+
+    free(sorted);
+
+    return rc;
+}
+
+static double
+dot(const shp_point_t *o, const shp_point_t *a, double ux, double uy)
+{
+    return (a->x - o->x) * ux + (a->y - o->y) * uy;
+}
+
+static double
+perp(const shp_point_t *o, const shp_point_t *a, double ux, double uy)
+{
+    return (a->y - o->y) * ux - (a->x - o->x) * uy;
+}
+
+void
+shp_hull_rectangle(const shp_hull_t *hull, shp_rectangle_t *rectangle)
+{
+    const shp_point_t *points, *p, *q;
+    size_t n, i, j, k, l;
+    double ux, uy, len, u_min, u_max, h, area;
+
+    assert(hull != NULL);
+    assert(rectangle != NULL);
+
+    n = hull->num_points;
+    points = hull->points;
+
+    if (n < 3) {
+        for (i = 0; i < 4; ++i) {
+            if (n == 0) {
+                rectangle->points[i].x = 0.0;
+                rectangle->points[i].y = 0.0;
+            }
+            else {
+                rectangle->points[i] = points[(i == 1 || i == 2) ? n - 1 : 0];
+            }
+        }
+        rectangle->area = 0.0;
+        return;
+    }
+
+    rectangle->area = HUGE_VAL;
+    j = 1;
+    k = 1;
+    l = 1;
+    for (i = 0; i < n; ++i) {
+        p = &points[i];
+        q = &points[(i + 1) % n];
+        ux = q->x - p->x;
+        uy = q->y - p->y;
+        len = sqrt(ux * ux + uy * uy);
+        ux /= len;
+        uy /= len;
+
+        /* Find the farthest points in the edge's direction, from the edge
+         * and in the opposite direction.  The points only move forward. */
+        while (dot(p, &points[(j + 1) % n], ux, uy) >
+               dot(p, &points[j], ux, uy)) {
+            j = (j + 1) % n;
+        }
+        if (i == 0) {
+            k = j;
+        }
+        while (perp(p, &points[(k + 1) % n], ux, uy) >
+               perp(p, &points[k], ux, uy)) {
+            k = (k + 1) % n;
+        }
+        if (i == 0) {
+            l = k;
+        }
+        while (dot(p, &points[(l + 1) % n], ux, uy) <
+               dot(p, &points[l], ux, uy)) {
+            l = (l + 1) % n;
+        }
+
+        u_max = dot(p, &points[j], ux, uy);
+        u_min = dot(p, &points[l], ux, uy);
+        h = perp(p, &points[k], ux, uy);
+        area = (u_max - u_min) * h;
+        if (area < rectangle->area) {
+            rectangle->area = area;
+            rectangle->points[0].x = p->x + u_min * ux;
+            rectangle->points[0].y = p->y + u_min * uy;
+            rectangle->points[1].x = p->x + u_max * ux;
+            rectangle->points[1].y = p->y + u_max * uy;
+            rectangle->points[2].x = rectangle->points[1].x - h * uy;
+            rectangle->points[2].y = rectangle->points[1].y + h * ux;
+            rectangle->points[3].x = rectangle->points[0].x - h * uy;
+            rectangle->points[3].y = rectangle->points[0].y + h * ux;
+        }
+    }
+}
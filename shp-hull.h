@@ -0,0 +1,94 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_HULL_H
+#define _SHAPEREADER_SHP_HULL_H
+
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Convex hull
+ *
+ * The points are in counterclockwise order and start with the point that
+ * has the smallest X and Y coordinates.  The first point is not repeated at
+ * the end.  Collinear points are omitted.
+ */
+typedef struct shp_hull_t {
+    size_t num_points;   /**< Number of points */
+    shp_point_t *points; /**< Points */
+} shp_hull_t;
+
+/**
+ * Oriented rectangle
+ */
+typedef struct shp_rectangle_t {
+    shp_point_t points[4]; /**< Corners in counterclockwise order */
+    double area;           /**< Area */
+} shp_rectangle_t;
+
+/**
+ * Compute a record's convex hull
+ *
+ * Computes the convex hull of all points in a record of any shape type.
+ * The points are sorted by their X and Y coordinates and the lower and upper
+ * hulls are built with Andrew's monotone chain algorithm in O(n log n) time.
+ * The M and Z coordinates are ignored.
+ *
+ * The hull of a null shape has no points.  The hull of a single point or of
+ * collinear points has one or two points.
+ *
+ * The hull is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_hull_t *hull;
+ * shp_rectangle_t rectangle;
+ *
+ * if (shp_record_hull(record, &hull) > 0) {
+ *   shp_hull_rectangle(hull, &rectangle);
+ *   free(hull);
+ * }
+ * @endcode
+ *
+ * @memberof shp_record_t
+ * @param record a record.
+ * @param[out] phull on success, a pointer to a shp_hull_t structure.
+ * @retval 1 on success.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see @cite Andrew
+ */
+extern int shp_record_hull(const shp_record_t *record, shp_hull_t **phull);
+
+/**
+ * Compute the minimum-area rectangle that encloses a convex hull
+ *
+ * One of the rectangle's sides is collinear with one of the hull's edges.
+ * The edges are visited with rotating calipers in O(n) time.  The rectangle
+ * is degenerate if the hull has fewer than three points.
+ *
+ * @memberof shp_hull_t
+ * @param hull a convex hull.
+ * @param[out] rectangle the rectangle.
+ *
+ * @see @cite Toussaint
+ */
+extern void shp_hull_rectangle(const shp_hull_t *hull,
+                               shp_rectangle_t *rectangle);
+
+#endif
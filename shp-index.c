@@ -0,0 +1,633 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-index.h"
+#include "record.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void) (x)
+
+#define MAGIC "SHPINDEX"
+#define VERSION 2
+#define BYTE_ORDER_MARK 0x01020304U
+
+/*
+ * The file begins with this header, which is followed by the offsets and
+ * content lengths, the levels, the nodes and the entries of the R-tree.
+ * Each section begins on an 8-byte boundary.
+ */
+typedef struct file_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t size_size;
+    uint32_t entry_size;
+    uint64_t file_size;
+    int64_t mtime;
+    uint64_t shp_file_size;
+    int64_t shp_type;
+    double shp_box[8];
+    uint64_t num_records;
+    uint64_t node_size;
+    uint64_t num_entries;
+    uint64_t num_nodes;
+    uint64_t num_levels;
+} file_header_t;
+
+typedef struct layout_t {
+    size_t offsets;
+    size_t levels;
+    size_t nodes;
+    size_t entries;
+    size_t size;
+} layout_t;
+
+typedef struct index_data_t {
+    shp_header_t header;
+    size_t num_records;
+    size_t max_records;
+    uint32_t *offsets;
+    size_t num_entries;
+    size_t max_entries;
+    shp_rtree_entry_t *entries;
+} index_data_t;
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    index_data_t *data = (index_data_t *) fh->user_data;
+
+    data->header = *header;
+    return 1;
+}
+
+static int
+grow(void **pitems, size_t *max_items, size_t item_size)
+{
+    size_t n;
+    void *items;
+
+    n = (*max_items > 0) ? 2 * *max_items : 64;
+    if (n > SIZE_MAX / item_size) {
+        errno = ENOMEM;
+        return -1;
+    }
+    items = realloc(*pitems, n * item_size);
+    if (items == NULL) {
+        return -1;
+    }
+    *pitems = items;
+    *max_items = n;
+    return 1;
+}
+
+static int
+add_record(shp_file_t *fh, index_data_t *data, const shp_record_t *record,
+           size_t file_offset)
+{
+    shp_rtree_entry_t *entry;
+    void *items;
+    double box[4], range[4];
+
+    if (file_offset / 2 > UINT32_MAX ||
+        record->record_size / 2 > UINT32_MAX) {
+        shp_set_error(fh, "File offset %zu is too big in record %zu",
+                      file_offset, record->record_number);
+        errno = EFBIG;
+        return -1;
+    }
+
+    if (data->num_records == data->max_records) {
+        items = data->offsets;
+        if (grow(&items, &data->max_records, 2 * sizeof(*data->offsets)) <
+            0) {
+            goto nomem;
+        }
+        data->offsets = (uint32_t *) items;
+    }
+    data->offsets[2 * data->num_records] = (uint32_t) (file_offset / 2);
+    data->offsets[2 * data->num_records + 1] =
+        (uint32_t) (record->record_size / 2);
+    ++data->num_records;
+
+    if (!shp_record_box(record, box)) {
+        return 1;
+    }
+
+    if (data->num_entries == data->max_entries) {
+        items = data->entries;
+        if (grow(&items, &data->max_entries, sizeof(*data->entries)) < 0) {
+            goto nomem;
+        }
+        data->entries = (shp_rtree_entry_t *) items;
+    }
+    entry = &data->entries[data->num_entries];
+    entry->x_min = box[0];
+    entry->y_min = box[1];
+    entry->x_max = box[2];
+    entry->y_max = box[3];
+    shp_record_zm(record, range);
+    entry->z_min = range[0];
+    entry->z_max = range[1];
+    entry->m_min = range[2];
+    entry->m_max = range[3];
+    entry->record_number = data->num_records;
+    entry->file_offset = file_offset;
+    ++data->num_entries;
+    return 1;
+
+nomem:
+
+    shp_set_error(fh, "Cannot allocate memory in record %zu",
+                  record->record_number);
+    return -1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    index_data_t *data = (index_data_t *) fh->user_data;
+
+    UNUSED(header);
+
+    return add_record(fh, data, record, file_offset);
+}
+
+static void
+set_key(file_header_t *fhdr, const shp_header_t *header, size_t file_size,
+        int64_t mtime)
+{
+    fhdr->file_size = file_size;
+    fhdr->mtime = mtime;
+    fhdr->shp_file_size = header->file_size;
+    fhdr->shp_type = header->type;
+    fhdr->shp_box[0] = header->x_min;
+    fhdr->shp_box[1] = header->y_min;
+    fhdr->shp_box[2] = header->x_max;
+    fhdr->shp_box[3] = header->y_max;
+    fhdr->shp_box[4] = header->z_min;
+    fhdr->shp_box[5] = header->z_max;
+    fhdr->shp_box[6] = header->m_min;
+    fhdr->shp_box[7] = header->m_max;
+}
+
+static size_t
+align(size_t n)
+{
+    return (n + 7) & ~(size_t) 7;
+}
+
+/*
+ * Computes the positions of the sections.  Returns 0 if the counts are too
+ * big.
+ */
+static int
+get_layout(const file_header_t *fhdr, layout_t *layout)
+{
+    const uint64_t max = SIZE_MAX / 2;
+    size_t pos;
+
+    if (fhdr->num_records > max / 8 || fhdr->num_levels > max / 8 ||
+        fhdr->num_nodes > max / sizeof(shp_rtree_node_t) ||
+        fhdr->num_entries > max / sizeof(shp_rtree_entry_t)) {
+        return 0;
+    }
+
+    pos = sizeof(*fhdr);
+    layout->offsets = pos;
+    pos = align(pos + 8 * (size_t) fhdr->num_records);
+    layout->levels = pos;
+    pos += ((size_t) fhdr->num_levels + 1) * sizeof(size_t);
+    layout->nodes = pos;
+    pos += (size_t) fhdr->num_nodes * sizeof(shp_rtree_node_t);
+    if (pos > max) {
+        return 0;
+    }
+    layout->entries = pos;
+    pos += (size_t) fhdr->num_entries * sizeof(shp_rtree_entry_t);
+    if (pos > max) {
+        return 0;
+    }
+    layout->size = pos;
+    return 1;
+}
+
+static int
+write_data(shp_file_t *fh, FILE *stream, const void *buf, size_t size)
+{
+    if (size > 0 && fwrite(buf, 1, size, stream) != size) {
+        shp_set_error(fh, "Cannot write index");
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Packs the collected entries into an R-tree and writes the index.
+ */
+static int
+write_index(shp_file_t *fh, const index_data_t *data, size_t node_size,
+            size_t file_size, int64_t mtime, FILE *stream)
+{
+    int rc = -1;
+    shp_rtree_t *rtree = NULL;
+    file_header_t fhdr;
+    layout_t layout;
+    const char padding[8] = {0};
+
+    if (shp_rtree_pack(data->entries, data->num_entries, node_size,
+                       &rtree) < 0) {
+        shp_set_error(fh, "Cannot allocate memory");
+        goto cleanup;
+    }
+
+    memset(&fhdr, 0, sizeof(fhdr));
+    memcpy(fhdr.magic, MAGIC, sizeof(fhdr.magic));
+    fhdr.version = VERSION;
+    fhdr.byte_order = BYTE_ORDER_MARK;
+    fhdr.size_size = sizeof(size_t);
+    fhdr.entry_size = sizeof(shp_rtree_entry_t);
+    set_key(&fhdr, &data->header, file_size, mtime);
+    fhdr.num_records = data->num_records;
+    fhdr.node_size = rtree->node_size;
+    fhdr.num_entries = rtree->num_entries;
+    fhdr.num_nodes = rtree->num_nodes;
+    fhdr.num_levels = rtree->num_levels;
+    if (!get_layout(&fhdr, &layout)) {
+        shp_set_error(fh, "Index is too big");
+        errno = EFBIG;
+        goto cleanup;
+    }
+
+    if (write_data(fh, stream, &fhdr, sizeof(fhdr)) < 0 ||
+        write_data(fh, stream, data->offsets,
+                   2 * data->num_records * sizeof(*data->offsets)) < 0 ||
+        write_data(fh, stream, padding,
+                   layout.levels - layout.offsets -
+                       2 * data->num_records * sizeof(*data->offsets)) < 0 ||
+        write_data(fh, stream, rtree->levels,
+                   (rtree->num_levels + 1) * sizeof(*rtree->levels)) < 0 ||
+        write_data(fh, stream, rtree->nodes,
+                   rtree->num_nodes * sizeof(*rtree->nodes)) < 0 ||
+        write_data(fh, stream, rtree->entries,
+                   rtree->num_entries * sizeof(*rtree->entries)) < 0) {
+        goto cleanup;
+    }
+
+    rc = 1;
+
+cleanup:
+
+    free(rtree);
+
+    return rc;
+}
+
+int
+shp_index_write(shp_file_t *fh, size_t node_size, size_t file_size,
+                int64_t mtime, FILE *stream)
+{
+    int rc = -1;
+    void *user_data;
+    index_data_t data;
+
+    assert(fh != NULL);
+    assert(stream != NULL);
+
+    memset(&data, 0, sizeof(data));
+
+    if (node_size == 1) {
+        shp_set_error(fh, "Node size %zu is too small", node_size);
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    user_data = fh->user_data;
+    fh->user_data = &data;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc >= 0) {
+        rc = write_index(fh, &data, node_size, file_size, mtime, stream);
+    }
+
+cleanup:
+
+    free(data.entries);
+    free(data.offsets);
+
+    return rc;
+}
+
+/*
+ * Checks that the levels have the sizes of a packed R-tree.
+ */
+static int
+check_levels(const shp_rtree_t *rtree)
+{
+    size_t n = rtree->num_entries, i;
+
+    if (rtree->levels[0] != 0) {
+        return 0;
+    }
+    for (i = 0; i < rtree->num_levels; ++i) {
+        n = n / rtree->node_size + (n % rtree->node_size != 0);
+        if (rtree->levels[i + 1] - rtree->levels[i] != n) {
+            return 0;
+        }
+    }
+    return n <= 1 && rtree->levels[rtree->num_levels] == rtree->num_nodes &&
+           (rtree->num_entries == 0) == (rtree->num_levels == 0);
+}
+
+/*
+ * Initializes a view of the data without looking at the ".shp" file.
+ * Returns 0 if the data was written for another version or platform.
+ */
+static int
+map_index(shp_index_t *index, void *data, size_t size)
+{
+    const file_header_t *fhdr = (const file_header_t *) data;
+    layout_t layout;
+    char *bytes = (char *) data;
+    shp_rtree_t *rtree = &index->rtree;
+
+    if ((uintptr_t) data % 8 != 0 || size < sizeof(*fhdr) ||
+        memcmp(fhdr->magic, MAGIC, sizeof(fhdr->magic)) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (fhdr->version != VERSION || fhdr->byte_order != BYTE_ORDER_MARK ||
+        fhdr->size_size != sizeof(size_t) ||
+        fhdr->entry_size != sizeof(shp_rtree_entry_t)) {
+        return 0;
+    }
+
+    if (!get_layout(fhdr, &layout) || layout.size != size ||
+        fhdr->node_size < 2 || fhdr->node_size > SIZE_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    index->num_records = (size_t) fhdr->num_records;
+    index->offsets = (const uint32_t *) (void *) (bytes + layout.offsets);
+    rtree->node_size = (size_t) fhdr->node_size;
+    rtree->num_entries = (size_t) fhdr->num_entries;
+    rtree->num_nodes = (size_t) fhdr->num_nodes;
+    rtree->num_levels = (size_t) fhdr->num_levels;
+    rtree->levels = (size_t *) (void *) (bytes + layout.levels);
+    rtree->nodes = (shp_rtree_node_t *) (void *) (bytes + layout.nodes);
+    rtree->entries = (shp_rtree_entry_t *) (void *) (bytes + layout.entries);
+    if (!check_levels(rtree)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 1;
+}
+
+static int
+is_current(const file_header_t *fhdr, const shp_header_t *header,
+           size_t file_size, int64_t mtime)
+{
+    file_header_t key;
+
+    set_key(&key, header, file_size, mtime);
+    return fhdr->file_size == key.file_size && fhdr->mtime == key.mtime &&
+           fhdr->shp_file_size == key.shp_file_size &&
+           fhdr->shp_type == key.shp_type &&
+           memcmp(fhdr->shp_box, key.shp_box, sizeof(key.shp_box)) == 0;
+}
+
+int
+shp_index_open(shp_index_t *index, void *data, size_t size,
+               const shp_header_t *header, size_t file_size, int64_t mtime)
+{
+    int rc;
+
+    assert(index != NULL);
+    assert(data != NULL);
+    assert(header != NULL);
+
+    rc = map_index(index, data, size);
+    if (rc > 0 &&
+        !is_current((const file_header_t *) data, header, file_size,
+                    mtime)) {
+        rc = 0;
+    }
+    return rc;
+}
+
+/*
+ * Checks that the new bounding box contains the old one.  The Z and M
+ * ranges are compared, too.
+ */
+static int
+box_contains(const file_header_t *fhdr, const shp_header_t *header)
+{
+    return header->x_min <= fhdr->shp_box[0] &&
+           header->y_min <= fhdr->shp_box[1] &&
+           header->x_max >= fhdr->shp_box[2] &&
+           header->y_max >= fhdr->shp_box[3] &&
+           header->z_min <= fhdr->shp_box[4] &&
+           header->z_max >= fhdr->shp_box[5] &&
+           header->m_min <= fhdr->shp_box[6] &&
+           header->m_max >= fhdr->shp_box[7];
+}
+
+/*
+ * Checks that the file has grown and that the last indexed record is still
+ * where the index expects it.  Files with the same size are indexed again
+ * since records might have been rewritten in place.
+ */
+static int
+is_appended(shp_file_t *fh, const shp_index_t *index,
+            const file_header_t *fhdr, const shp_header_t *header)
+{
+    shx_record_t last;
+    shp_record_t *record;
+    int ok;
+
+    if (fhdr->shp_type != (int64_t) header->type) {
+        return 0;
+    }
+    if (header->file_size <= fhdr->shp_file_size ||
+        !box_contains(fhdr, header)) {
+        return 0;
+    }
+
+    if (index->num_records == 0) {
+        return fhdr->shp_file_size == 100;
+    }
+
+    shp_index_record(index, index->num_records - 1, &last);
+    if (last.file_offset + 8 + last.record_size != fhdr->shp_file_size ||
+        shp_seek_record(fh, last.file_offset, &record) <= 0) {
+        return 0;
+    }
+    ok = record->record_size == last.record_size;
+    free(record);
+    return ok;
+}
+
+/*
+ * Copies the offsets and the entries of an index.
+ */
+static int
+copy_index(const shp_index_t *index, index_data_t *data)
+{
+    const shp_rtree_t *rtree = &index->rtree;
+    size_t n;
+
+    n = index->num_records;
+    if (n > 0) {
+        data->offsets = (uint32_t *) malloc(2 * n * sizeof(*data->offsets));
+        if (data->offsets == NULL) {
+            return -1;
+        }
+        memcpy(data->offsets, index->offsets,
+               2 * n * sizeof(*data->offsets));
+        data->num_records = n;
+        data->max_records = n;
+    }
+
+    n = rtree->num_entries;
+    if (n > 0) {
+        data->entries =
+            (shp_rtree_entry_t *) malloc(n * sizeof(*data->entries));
+        if (data->entries == NULL) {
+            return -1;
+        }
+        memcpy(data->entries, rtree->entries, n * sizeof(*data->entries));
+        data->num_entries = n;
+        data->max_entries = n;
+    }
+
+    return 1;
+}
+
+/*
+ * Reads the records from an offset up to the end of the file that is
+ * given in the file header.
+ */
+static int
+read_records(shp_file_t *fh, index_data_t *data, size_t file_offset)
+{
+    shp_record_t *record;
+    size_t file_size = data->header.file_size;
+    int rc;
+
+    if (file_offset < file_size) {
+        rc = shp_seek_record(fh, file_offset, &record);
+        while (rc > 0) {
+            rc = add_record(fh, data, record, file_offset);
+            file_offset += 8 + record->record_size;
+            free(record);
+            if (rc < 0) {
+                return -1;
+            }
+            if (file_offset >= file_size) {
+                break;
+            }
+            rc = shp_read_record(fh, &record);
+        }
+        if (rc == 0) {
+            shp_set_error(fh, "Expected record at file offset %zu",
+                          file_offset);
+        }
+        if (rc <= 0) {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+int
+shp_index_update(shp_file_t *fh, void *data, size_t size, size_t file_size,
+                 int64_t mtime, FILE *stream)
+{
+    int rc = -1;
+    shp_index_t index;
+    index_data_t new_data;
+    const file_header_t *fhdr = (const file_header_t *) data;
+    size_t node_size = 0;
+
+    assert(fh != NULL);
+    assert(data != NULL);
+    assert(stream != NULL);
+
+    memset(&new_data, 0, sizeof(new_data));
+
+    if (shp_read_header(fh, &new_data.header) <= 0) {
+        goto cleanup;
+    }
+
+    rc = map_index(&index, data, size);
+    if (rc > 0) {
+        node_size = index.rtree.node_size;
+        if (is_current(fhdr, &new_data.header, file_size, mtime)) {
+            rc = 0;
+            goto cleanup;
+        }
+        if (is_appended(fh, &index, fhdr, &new_data.header)) {
+            if (copy_index(&index, &new_data) < 0) {
+                shp_set_error(fh, "Cannot allocate memory");
+                rc = -1;
+                goto cleanup;
+            }
+            rc = read_records(fh, &new_data, (size_t) fhdr->shp_file_size);
+            if (rc > 0) {
+                rc = write_index(fh, &new_data, node_size, file_size, mtime,
+                                 stream);
+            }
+            goto cleanup;
+        }
+    }
+
+    /* Rebuild the index if the file was not only appended to. */
+    if ((*fh->fsetpos)(fh, 0) != 0) {
+        shp_set_error(fh, "Cannot set file position to %zu", (size_t) 0);
+        rc = -1;
+        goto cleanup;
+    }
+    fh->num_bytes = 0;
+    rc = shp_index_write(fh, node_size, file_size, mtime, stream);
+
+cleanup:
+
+    free(new_data.entries);
+    free(new_data.offsets);
+
+    return rc;
+}
+
+int
+shp_index_record(const shp_index_t *index, size_t record_number,
+                 shx_record_t *record)
+{
+    assert(index != NULL);
+    assert(record != NULL);
+
+    if (record_number >= index->num_records) {
+        return 0;
+    }
+
+    record->file_offset = 2 * (size_t) index->offsets[2 * record_number];
+    record->record_size =
+        2 * (size_t) index->offsets[2 * record_number + 1];
+    return 1;
+}
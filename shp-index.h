@@ -0,0 +1,183 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_INDEX_H
+#define _SHAPEREADER_SHP_INDEX_H
+
+#include "shp-rtree.h"
+#include "shp.h"
+#include "shx.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Sidecar index
+ *
+ * A view of a sidecar file that combines the index records of a ".shx"
+ * file with an R-tree over the bounding boxes of the records.  The offset
+ * and the content length of the zero-based record @c i are stored in
+ * @c offsets[2*i] and @c offsets[2*i+1] in 16-bit words like in a ".shx"
+ * file.  The pointers refer to the file's data, which must not be modified
+ * or freed while the index is used.
+ */
+typedef struct shp_index_t {
+    size_t num_records;      /**< Number of records */
+    const uint32_t *offsets; /**< Offsets and content lengths */
+    shp_rtree_t rtree;       /**< R-tree over the records */
+} shp_index_t;
+
+/**
+ * Write a sidecar index
+ *
+ * Reads a file that has the file extension ".shp" and writes the offsets and
+ * content lengths of the records, the bounding boxes and a packed R-tree to
+ * a file.  The data is written in the machine's byte order and layout so
+ * that it can be mapped into memory and used without conversion.
+ *
+ * The size and the modification time of the ".shp" file are stored together
+ * with the file header.  shp_index_open compares them to detect changes.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * struct stat st;
+ *
+ * if (fstat(fileno(shp_stream), &st) == 0) {
+ *   shp_init_file(fh, shp_stream, NULL);
+ *   rc = shp_index_write(fh, 0, st.st_size, st.st_mtime, index_stream);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param node_size the maximum number of children per node or 0 for the
+ *                  default of 16.
+ * @param file_size the size of the ".shp" file in bytes.
+ * @param mtime the modification time of the ".shp" file.
+ * @param stream a file pointer that is opened for writing.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see shp_rtree_pack
+ */
+extern int shp_index_write(shp_file_t *fh, size_t node_size,
+                           size_t file_size, int64_t mtime, FILE *stream);
+
+/**
+ * Open a sidecar index
+ *
+ * Checks the data from a file that was written by shp_index_write and
+ * initializes a view of the data.  Nothing is copied, so the data is
+ * typically mapped into memory with mmap().  The data must be aligned on an
+ * 8-byte boundary.
+ *
+ * The index is stale if it was written by another version of the library,
+ * on a machine with a different byte order or layout, or for a ".shp" file
+ * with another size, modification time or file header.  Stale indexes have
+ * to be rebuilt.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_index_t index;
+ * shp_header_t header;
+ * void *data;
+ *
+ * data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+ * if (data != MAP_FAILED &&
+ *     shp_read_header(fh, &header) > 0 &&
+ *     shp_index_open(&index, data, size, &header, st.st_size,
+ *                    st.st_mtime) > 0) {
+ *   shp_rtree_search(&index.rtree, x_min, y_min, x_max, y_max, callback,
+ *                    user_data);
+ * }
+ * @endcode
+ *
+ * @param[out] index a shp_index_t structure.
+ * @param data the data from a sidecar file.
+ * @param size the size of the data in bytes.
+ * @param header the file header of the ".shp" file.
+ * @param file_size the size of the ".shp" file in bytes.
+ * @param mtime the modification time of the ".shp" file.
+ * @retval 1 on success.
+ * @retval 0 if the index is stale.
+ * @retval -1 if the data is not a valid index.
+ */
+extern int shp_index_open(shp_index_t *index, void *data, size_t size,
+                          const shp_header_t *header, size_t file_size,
+                          int64_t mtime);
+
+/**
+ * Update a sidecar index
+ *
+ * Writes a new index if the data from a sidecar file is stale.  If the
+ * ".shp" file has only grown since the index was written, for example
+ * because records were appended to a feed, the records after the indexed
+ * part are read and added to the offsets and the R-tree of the old index.
+ * The file size in the ".shp" file header tells where the new records end.
+ * The new bounding box in the file header must contain the old one.
+ * Otherwise, and if the file has the same size but another modification
+ * time, the whole file is read like by shp_index_write.
+ *
+ * The file handle has to be positioned at the beginning of the file.  The
+ * new index cannot be written to the file that contains the old data.
+ * Write it to a temporary file and rename the file when you are done.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * rc = shp_index_update(fh, data, size, st.st_size, st.st_mtime,
+ *                       tmp_stream);
+ * if (rc > 0) {
+ *   // Replace the old index file
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param data the data from a sidecar file.
+ * @param size the size of the data in bytes.
+ * @param file_size the size of the ".shp" file in bytes.
+ * @param mtime the modification time of the ".shp" file.
+ * @param stream a file pointer that is opened for writing.
+ * @retval 1 if a new index was written.
+ * @retval 0 if the index is up to date.
+ * @retval -1 on error.
+ *
+ * @see shp_index_write
+ */
+extern int shp_index_update(shp_file_t *fh, void *data, size_t size,
+                            size_t file_size, int64_t mtime, FILE *stream);
+
+/**
+ * Get an index record
+ *
+ * Gets an index record by record number without reading from a file.
+ *
+ * Please note that this function uses zero-based record numbers, whereas the
+ * record numbers in shapefiles begin at 1.
+ *
+ * @memberof shp_index_t
+ * @param index a sidecar index.
+ * @param record_number a zero-based record number.
+ * @param[out] record a shx_record_t structure.
+ * @retval 1 on success.
+ * @retval 0 if the record number is too big.
+ *
+ * @see shx_seek_record
+ */
+extern int shp_index_record(const shp_index_t *index, size_t record_number,
+                            shx_record_t *record);
+
+#endif
@@ -0,0 +1,490 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-knn.h"
+#include "shp-distance.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Items with this level are entries whose exact distance is known. */
+#define EXACT SIZE_MAX
+
+/*
+ * The priority queue holds nodes, entries and entries with an exact
+ * distance.  Levels above 0 denote the nodes of level - 1.
+ */
+typedef struct item_t {
+    double distance;
+    size_t level;
+    size_t num;
+} item_t;
+
+typedef struct queue_t {
+    size_t num_items;
+    size_t max_items;
+    item_t *items;
+} queue_t;
+
+static int
+is_less(const item_t *a, const item_t *b)
+{
+    /* Exact distances come first so that ties end the search early. */
+    return a->distance < b->distance ||
+           (a->distance == b->distance && a->level == EXACT &&
+            b->level != EXACT);
+}
+
+static int
+push(queue_t *queue, double distance, size_t level, size_t num)
+{
+    item_t *items, item;
+    size_t n, i, parent;
+
+    if (queue->num_items == queue->max_items) {
+        n = (queue->max_items > 0) ? 2 * queue->max_items : 64;
+        if (n > SIZE_MAX / sizeof(*items)) {
+            errno = ENOMEM;
+            return -1;
+        }
+        items = (item_t *) realloc(queue->items, n * sizeof(*items));
+        if (items == NULL) {
+            return -1;
+        }
+        queue->items = items;
+        queue->max_items = n;
+    }
+
+    item.distance = distance;
+    item.level = level;
+    item.num = num;
+
+    items = queue->items;
+    i = queue->num_items++;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!is_less(&item, &items[parent])) {
+            break;
+        }
+        items[i] = items[parent];
+        i = parent;
+    }
+    items[i] = item;
+    return 1;
+}
+
+static item_t
+pop(queue_t *queue)
+{
+    item_t *items = queue->items, top, last;
+    size_t n, i, child;
+
+    assert(queue->num_items > 0);
+
+    top = items[0];
+    n = --queue->num_items;
+    last = items[n];
+    i = 0;
+    while ((child = 2 * i + 1) < n) {
+        if (child + 1 < n && is_less(&items[child + 1], &items[child])) {
+            ++child;
+        }
+        if (!is_less(&items[child], &last)) {
+            break;
+        }
+        items[i] = items[child];
+        i = child;
+    }
+    items[i] = last;
+    return top;
+}
+
+static double
+box_distance(double x_min, double y_min, double x_max, double y_max,
+             double x, double y)
+{
+    double dx = 0.0, dy = 0.0;
+
+    if (x < x_min) {
+        dx = x_min - x;
+    }
+    else if (x > x_max) {
+        dx = x - x_max;
+    }
+    if (y < y_min) {
+        dy = y_min - y;
+    }
+    else if (y > y_max) {
+        dy = y - y_max;
+    }
+    return sqrt(dx * dx + dy * dy);
+}
+
+static double
+point_distance(double px, double py, double x, double y)
+{
+    return sqrt((px - x) * (px - x) + (py - y) * (py - y));
+}
+
+static double
+multipoint_distance(const shp_multipoint_t *multipoint, double x, double y)
+{
+    shp_point_t point;
+    size_t i;
+    double distance = HUGE_VAL, d;
+
+    for (i = 0; i < multipoint->num_points; ++i) {
+        shp_multipoint_point(multipoint, i, &point);
+        d = point_distance(point.x, point.y, x, y);
+        if (d < distance) {
+            distance = d;
+        }
+    }
+    return distance;
+}
+
+static double
+polyline_distance(const shp_polyline_t *polyline, double x, double y)
+{
+    shp_nearest_t nearest;
+
+    if (!shp_polyline_nearest(polyline, x, y, &nearest)) {
+        return HUGE_VAL;
+    }
+    return nearest.distance;
+}
+
+static double
+polygon_distance(const shp_polygon_t *polygon, double x, double y)
+{
+    shp_nearest_t nearest;
+    shp_point_t point;
+
+    point.x = x;
+    point.y = y;
+    if (shp_point_in_polygon(&point, polygon) != 0) {
+        return 0.0;
+    }
+    if (!shp_polygon_nearest(polygon, x, y, &nearest)) {
+        return HUGE_VAL;
+    }
+    return nearest.distance;
+}
+
+static double
+multipointm_distance(const shp_multipointm_t *multipointm, double x,
+                     double y)
+{
+    shp_multipoint_t multipoint;
+
+    multipoint.x_min = multipointm->x_min;
+    multipoint.x_max = multipointm->x_max;
+    multipoint.y_min = multipointm->y_min;
+    multipoint.y_max = multipointm->y_max;
+    multipoint.num_points = multipointm->num_points;
+    multipoint.points = multipointm->points;
+    return multipoint_distance(&multipoint, x, y);
+}
+
+static double
+multipointz_distance(const shp_multipointz_t *multipointz, double x,
+                     double y)
+{
+    shp_multipoint_t multipoint;
+
+    multipoint.x_min = multipointz->x_min;
+    multipoint.x_max = multipointz->x_max;
+    multipoint.y_min = multipointz->y_min;
+    multipoint.y_max = multipointz->y_max;
+    multipoint.num_points = multipointz->num_points;
+    multipoint.points = multipointz->points;
+    return multipoint_distance(&multipoint, x, y);
+}
+
+static double
+polylinem_distance(const shp_polylinem_t *polylinem, double x, double y)
+{
+    shp_polyline_t polyline;
+
+    polyline.x_min = polylinem->x_min;
+    polyline.x_max = polylinem->x_max;
+    polyline.y_min = polylinem->y_min;
+    polyline.y_max = polylinem->y_max;
+    polyline.num_parts = polylinem->num_parts;
+    polyline.num_points = polylinem->num_points;
+    polyline.parts = polylinem->parts;
+    polyline.points = polylinem->points;
+    return polyline_distance(&polyline, x, y);
+}
+
+static double
+polylinez_distance(const shp_polylinez_t *polylinez, double x, double y)
+{
+    shp_polyline_t polyline;
+
+    polyline.x_min = polylinez->x_min;
+    polyline.x_max = polylinez->x_max;
+    polyline.y_min = polylinez->y_min;
+    polyline.y_max = polylinez->y_max;
+    polyline.num_parts = polylinez->num_parts;
+    polyline.num_points = polylinez->num_points;
+    polyline.parts = polylinez->parts;
+    polyline.points = polylinez->points;
+    return polyline_distance(&polyline, x, y);
+}
+
+static double
+polygonm_distance(const shp_polygonm_t *polygonm, double x, double y)
+{
+    shp_polygon_t polygon;
+
+    polygon.x_min = polygonm->x_min;
+    polygon.x_max = polygonm->x_max;
+    polygon.y_min = polygonm->y_min;
+    polygon.y_max = polygonm->y_max;
+    polygon.num_parts = polygonm->num_parts;
+    polygon.num_points = polygonm->num_points;
+    polygon.parts = polygonm->parts;
+    polygon.points = polygonm->points;
+    return polygon_distance(&polygon, x, y);
+}
+
+static double
+polygonz_distance(const shp_polygonz_t *polygonz, double x, double y)
+{
+    shp_polygon_t polygon;
+
+    polygon.x_min = polygonz->x_min;
+    polygon.x_max = polygonz->x_max;
+    polygon.y_min = polygonz->y_min;
+    polygon.y_max = polygonz->y_max;
+    polygon.num_parts = polygonz->num_parts;
+    polygon.num_points = polygonz->num_points;
+    polygon.parts = polygonz->parts;
+    polygon.points = polygonz->points;
+    return polygon_distance(&polygon, x, y);
+}
+
+/*
+ * Computes the distance to a shape.  Returns the distance to the bounding
+ * box for shapes that have no points.
+ */
+static double
+record_distance(const shp_record_t *record, const shp_rtree_entry_t *entry,
+                double x, double y)
+{
+    double distance = HUGE_VAL;
+
+    switch (record->type) {
+    case SHP_TYPE_POINT:
+        distance = point_distance(record->shape.point.x,
+                                  record->shape.point.y, x, y);
+        break;
+    case SHP_TYPE_POINTM:
+        distance = point_distance(record->shape.pointm.x,
+                                  record->shape.pointm.y, x, y);
+        break;
+    case SHP_TYPE_POINTZ:
+        distance = point_distance(record->shape.pointz.x,
+                                  record->shape.pointz.y, x, y);
+        break;
+    case SHP_TYPE_MULTIPOINT:
+        distance = multipoint_distance(&record->shape.multipoint, x, y);
+        break;
+    case SHP_TYPE_MULTIPOINTM:
+        distance = multipointm_distance(&record->shape.multipointm, x, y);
+        break;
+    case SHP_TYPE_MULTIPOINTZ:
+        distance = multipointz_distance(&record->shape.multipointz, x, y);
+        break;
+    case SHP_TYPE_POLYLINE:
+        distance = polyline_distance(&record->shape.polyline, x, y);
+        break;
+    case SHP_TYPE_POLYLINEM:
+        distance = polylinem_distance(&record->shape.polylinem, x, y);
+        break;
+    case SHP_TYPE_POLYLINEZ:
+        distance = polylinez_distance(&record->shape.polylinez, x, y);
+        break;
+    case SHP_TYPE_POLYGON:
+        distance = polygon_distance(&record->shape.polygon, x, y);
+        break;
+    case SHP_TYPE_POLYGONM:
+        distance = polygonm_distance(&record->shape.polygonm, x, y);
+        break;
+    case SHP_TYPE_POLYGONZ:
+        distance = polygonz_distance(&record->shape.polygonz, x, y);
+        break;
+    default:
+        break;
+    }
+
+    if (distance == HUGE_VAL) {
+        distance = box_distance(entry->x_min, entry->y_min, entry->x_max,
+                                entry->y_max, x, y);
+    }
+    return distance;
+}
+
+/*
+ * Reads the record of an entry and computes the exact distance.
+ */
+static int
+refine(shp_file_t *fh, const shp_rtree_entry_t *entry, double x, double y,
+       double *distance)
+{
+    shp_record_t *record = NULL;
+    int rc;
+
+    /* A shape with a point as its bounding box is the point. */
+    if (entry->x_min == entry->x_max && entry->y_min == entry->y_max) {
+        *distance = point_distance(entry->x_min, entry->y_min, x, y);
+        return 1;
+    }
+
+    rc = shp_seek_record(fh, entry->file_offset, &record);
+    if (rc <= 0) {
+        if (rc == 0) {
+            shp_set_error(fh, "Record %zu is missing",
+                          entry->record_number);
+        }
+        return -1;
+    }
+    *distance = record_distance(record, entry, x, y);
+    free(record);
+    return 1;
+}
+
+static int
+push_children(queue_t *queue, const shp_rtree_t *rtree, size_t level,
+              size_t num, double x, double y)
+{
+    const shp_rtree_node_t *node;
+    const shp_rtree_entry_t *entry;
+    size_t node_size = rtree->node_size, first, end, i;
+    double distance;
+
+    /* Children are counted from the beginning of their level. */
+    first = num * node_size;
+    end = first + node_size;
+    if (level == 0) {
+        if (end > rtree->num_entries) {
+            end = rtree->num_entries;
+        }
+        for (i = first; i < end; ++i) {
+            entry = &rtree->entries[i];
+            distance = box_distance(entry->x_min, entry->y_min,
+                                    entry->x_max, entry->y_max, x, y);
+            if (push(queue, distance, 0, i) < 0) {
+                return -1;
+            }
+        }
+    }
+    else {
+        if (end > rtree->levels[level] - rtree->levels[level - 1]) {
+            end = rtree->levels[level] - rtree->levels[level - 1];
+        }
+        for (i = first; i < end; ++i) {
+            node = &rtree->nodes[rtree->levels[level - 1] + i];
+            distance = box_distance(node->x_min, node->y_min, node->x_max,
+                                    node->y_max, x, y);
+            if (push(queue, distance, level, i) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 1;
+}
+
+int
+shp_knn_search(const shp_rtree_t *rtree, shp_file_t *fh, double x,
+               double y, size_t k, shp_knn_neighbor_t **pneighbors,
+               size_t *pnum_neighbors)
+{
+    int rc = -1;
+    queue_t queue = {0, 0, NULL};
+    shp_knn_neighbor_t *neighbors = NULL;
+    const shp_rtree_entry_t *entry;
+    size_t num_neighbors = 0, top;
+    item_t item;
+    double distance;
+
+    assert(rtree != NULL);
+    assert(fh != NULL);
+    assert(pneighbors != NULL);
+    assert(pnum_neighbors != NULL);
+
+    *pneighbors = NULL;
+    *pnum_neighbors = 0;
+
+    if (k > rtree->num_entries) {
+        k = rtree->num_entries;
+    }
+
+    neighbors = (shp_knn_neighbor_t *) malloc((k > 0 ? k : 1) *
+                                              sizeof(*neighbors));
+    if (neighbors == NULL) {
+        shp_set_error(fh, "Cannot allocate memory");
+        goto cleanup;
+    }
+
+    if (k > 0) {
+        /* Start with the root, which is the only node of the top level. */
+        top = rtree->num_levels - 1;
+        if (push(&queue, 0.0, top + 1, 0) < 0) {
+            goto nomem;
+        }
+    }
+
+    while (num_neighbors < k && queue.num_items > 0) {
+        item = pop(&queue);
+        if (item.level == EXACT) {
+            entry = &rtree->entries[item.num];
+            neighbors[num_neighbors].distance = item.distance;
+            neighbors[num_neighbors].record_number = entry->record_number;
+            neighbors[num_neighbors].file_offset = entry->file_offset;
+            ++num_neighbors;
+        }
+        else if (item.level == 0) {
+            if (refine(fh, &rtree->entries[item.num], x, y, &distance) < 0) {
+                goto cleanup;
+            }
+            if (push(&queue, distance, EXACT, item.num) < 0) {
+                goto nomem;
+            }
+        }
+        else {
+            if (push_children(&queue, rtree, item.level - 1, item.num, x,
+                              y) < 0) {
+                goto nomem;
+            }
+        }
+    }
+
+    *pneighbors = neighbors;
+    *pnum_neighbors = num_neighbors;
+    neighbors = NULL;
+    rc = 1;
+    goto cleanup;
+
+nomem:
+
+    shp_set_error(fh, "Cannot allocate memory");
+
+cleanup:
+
+    free(queue.items);
+    free(neighbors);
+
+    return rc;
+}
@@ -0,0 +1,80 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_KNN_H
+#define _SHAPEREADER_SHP_KNN_H
+
+#include "shp-rtree.h"
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Nearest neighbor
+ */
+typedef struct shp_knn_neighbor_t {
+    double distance;      /**< Euclidean distance to the shape */
+    size_t record_number; /**< Record number (beginning at 1) */
+    size_t file_offset;   /**< Offset in the ".shp" file in bytes */
+} shp_knn_neighbor_t;
+
+/**
+ * Find the k nearest shapes
+ *
+ * Searches an R-tree best-first for the @a k shapes that are nearest to a
+ * point.  Nodes and entries are visited in the order of the distance to
+ * their bounding boxes.  When an entry is reached, its record is read and
+ * the exact distance to the shape is computed with shp_polyline_nearest,
+ * shp_polygon_nearest and shp_point_in_polygon.  The search ends as soon as
+ * k shapes are nearer than all remaining bounding boxes, so only records
+ * near the point are read.
+ *
+ * The distance is 0 for points inside polygons.  MultiPatches are measured
+ * to their bounding boxes.  The neighbors are sorted by distance and have
+ * to be freed with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_knn_neighbor_t *neighbors;
+ * size_t i, n;
+ *
+ * if (shp_knn_search(rtree, fh, x, y, 5, &neighbors, &n) > 0) {
+ *   for (i = 0; i < n; ++i) {
+ *     printf("%zu %f\n", neighbors[i].record_number,
+ *            neighbors[i].distance);
+ *   }
+ *   free(neighbors);
+ * }
+ * @endcode
+ *
+ * @memberof shp_rtree_t
+ * @param rtree an R-tree over the records of the file.
+ * @param fh a file handle.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param k the maximum number of neighbors.
+ * @param[out] pneighbors on success, a pointer to an array of neighbors.
+ * @param[out] pnum_neighbors on success, the number of neighbors.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see "Distance Browsing in Spatial Databases" @cite Hjaltason_Samet
+ */
+extern int shp_knn_search(const shp_rtree_t *rtree, shp_file_t *fh,
+                          double x, double y, size_t k,
+                          shp_knn_neighbor_t **pneighbors,
+                          size_t *pnum_neighbors);
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-measure.h"
+#include "parts.h"
+#include <assert.h>
+
+static double
+get_m(const shp_polylinem_t *polylinem, size_t point_num)
+{
+    return shp_le64_to_double(polylinem->m_array + 8 * point_num);
+}
+
+int
+shp_polylinem_order(const shp_polylinem_t *polylinem)
+{
+    size_t n, i;
+    int increasing = 1, decreasing = 1;
+    double m0, m1;
+
+    assert(polylinem != NULL);
+
+    n = polylinem->num_points;
+    if (n < 2) {
+        return 0;
+    }
+
+    /* Cheap rejection before the points are compared. */
+    m0 = get_m(polylinem, 0);
+    m1 = get_m(polylinem, n - 1);
+    if (!(m0 <= m1 ? m0 == polylinem->m_min && m1 == polylinem->m_max
+                   : m0 == polylinem->m_max && m1 == polylinem->m_min)) {
+        return 0;
+    }
+
+    for (i = 1; i < n && (increasing || decreasing); ++i) {
+        m1 = get_m(polylinem, i);
+        if (!(m0 <= m1)) {
+            increasing = 0;
+        }
+        if (!(m0 >= m1)) {
+            decreasing = 0;
+        }
+        m0 = m1;
+    }
+
+    return increasing ? 1 : (decreasing ? -1 : 0);
+}
+
+/*
+ * Returns the first point whose measure is not before m, or if strict is
+ * set, the first point whose measure is after m.
+ */
+static size_t
+bisect(const shp_polylinem_t *polylinem, int order, double m, int strict)
+{
+    size_t lo, hi, mid;
+    double d;
+    int before;
+
+    lo = 0;
+    hi = polylinem->num_points;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        d = get_m(polylinem, mid);
+        if (order > 0) {
+            before = strict ? d <= m : d < m;
+        }
+        else {
+            before = strict ? d >= m : d > m;
+        }
+        if (before) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+ * Returns the last part that starts before or at a point.
+ */
+static size_t
+find_part(const shp_parts_t *view, size_t point_num)
+{
+    size_t lo, hi, mid;
+
+    lo = 0;
+    hi = view->num_parts;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (shp_le32_to_uint32(view->parts + 4 * mid) <= point_num) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static void
+get_pointm(const shp_polylinem_t *polylinem, const shp_parts_t *view,
+           size_t point_num, shp_pointm_t *pointm)
+{
+    pointm->x = shp_parts_x(view, point_num);
+    pointm->y = shp_parts_y(view, point_num);
+    pointm->m = get_m(polylinem, point_num);
+}
+
+static void
+interpolate(const shp_polylinem_t *polylinem, const shp_parts_t *view,
+            size_t point_num, double m, shp_pointm_t *pointm)
+{
+    double x0, y0, m0, t;
+
+    x0 = shp_parts_x(view, point_num);
+    y0 = shp_parts_y(view, point_num);
+    m0 = get_m(polylinem, point_num);
+    t = (m - m0) / (get_m(polylinem, point_num + 1) - m0);
+
+    pointm->x = x0 + t * (shp_parts_x(view, point_num + 1) - x0);
+    pointm->y = y0 + t * (shp_parts_y(view, point_num + 1) - y0);
+    pointm->m = m;
+}
+
+int
+shp_polylinem_locate(const shp_polylinem_t *polylinem, int order, double m,
+                     shp_pointm_t *pointm)
+{
+    shp_parts_t view;
+    size_t part_num, i, start, end;
+    double m0, m1;
+
+    assert(polylinem != NULL);
+    assert(pointm != NULL);
+
+    if (polylinem->num_parts == 0 || polylinem->num_points == 0) {
+        return 0;
+    }
+
+    shp_parts_init(&view, polylinem->num_parts, polylinem->num_points,
+                   polylinem->parts, polylinem->points);
+
+    if (order != 0) {
+        i = bisect(polylinem, order, m, 0);
+        if (i == view.num_points) {
+            return 0;
+        }
+        part_num = find_part(&view, i);
+        if (shp_parts_points(&view, part_num, &start, &end) == 0 ||
+            i < start || i >= end) {
+            return 0;
+        }
+        if (get_m(polylinem, i) == m) {
+            get_pointm(polylinem, &view, i, pointm);
+            return 1;
+        }
+        /* Is m between two parts? */
+        if (i == start) {
+            return 0;
+        }
+        interpolate(polylinem, &view, i - 1, m, pointm);
+        return 1;
+    }
+
+    for (part_num = 0; part_num < view.num_parts; ++part_num) {
+        if (shp_parts_points(&view, part_num, &start, &end) == 0) {
+            continue;
+        }
+        m1 = get_m(polylinem, start);
+        if (m1 == m) {
+            get_pointm(polylinem, &view, start, pointm);
+            return 1;
+        }
+        for (i = start + 1; i < end; ++i) {
+            m0 = m1;
+            m1 = get_m(polylinem, i);
+            if ((m0 < m && m < m1) || (m1 < m && m < m0)) {
+                interpolate(polylinem, &view, i - 1, m, pointm);
+                return 1;
+            }
+            if (m1 == m) {
+                get_pointm(polylinem, &view, i, pointm);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void
+add_point(shp_buffer_t *buffer, double *measures, const shp_pointm_t *pointm)
+{
+    if (measures != NULL && buffer->num_points < buffer->max_points) {
+        measures[buffer->num_points] = pointm->m;
+    }
+    shp_buffer_add_point(buffer, pointm->x, pointm->y);
+}
+
+static void
+extract_part(const shp_polylinem_t *polylinem, const shp_parts_t *view,
+             size_t start, size_t end, double lo, double hi,
+             shp_buffer_t *buffer, double *measures)
+{
+    shp_pointm_t pointm;
+    size_t i;
+    double ma, mb, m0, m1;
+    int open, inside;
+
+    open = 0;
+    for (i = start; i + 1 < end; ++i) {
+        ma = get_m(polylinem, i);
+        mb = get_m(polylinem, i + 1);
+
+        /* Clip the segment to the measure range.  Segments that touch the
+         * range in a single point are skipped. */
+        if (ma < mb) {
+            m0 = (ma > lo) ? ma : lo;
+            m1 = (mb < hi) ? mb : hi;
+            inside = m0 < m1;
+        }
+        else if (ma > mb) {
+            m0 = (ma < hi) ? ma : hi;
+            m1 = (mb > lo) ? mb : lo;
+            inside = m0 > m1;
+        }
+        else {
+            m0 = ma;
+            m1 = mb;
+            inside = ma >= lo && ma <= hi;
+        }
+        if (!inside) {
+            open = 0;
+            continue;
+        }
+
+        if (!open) {
+            shp_buffer_add_part(buffer);
+            if (m0 == ma) {
+                get_pointm(polylinem, view, i, &pointm);
+            }
+            else {
+                interpolate(polylinem, view, i, m0, &pointm);
+            }
+            add_point(buffer, measures, &pointm);
+        }
+
+        if (m1 == mb) {
+            get_pointm(polylinem, view, i + 1, &pointm);
+            open = 1;
+        }
+        else {
+            interpolate(polylinem, view, i, m1, &pointm);
+            open = 0;
+        }
+        add_point(buffer, measures, &pointm);
+    }
+}
+
+int
+shp_polylinem_extract(const shp_polylinem_t *polylinem, int order,
+                      double m1, double m2, shp_buffer_t *buffer,
+                      double *measures)
+{
+    shp_parts_t view;
+    size_t part_num, from, to, start, end;
+    double lo, hi;
+
+    assert(polylinem != NULL);
+    assert(buffer != NULL);
+
+    buffer->num_parts = 0;
+    buffer->num_points = 0;
+
+    if (polylinem->num_parts == 0 || polylinem->num_points == 0) {
+        return 1;
+    }
+
+    shp_parts_init(&view, polylinem->num_parts, polylinem->num_points,
+                   polylinem->parts, polylinem->points);
+
+    if (m1 < m2) {
+        lo = m1;
+        hi = m2;
+    }
+    else {
+        lo = m2;
+        hi = m1;
+    }
+
+    /* Only the points between the measures and their neighbors have to be
+     * visited if the measures are monotonic */
+    from = 0;
+    to = view.num_points;
+    if (order != 0) {
+        from = bisect(polylinem, order, (order > 0) ? lo : hi, 0);
+        to = bisect(polylinem, order, (order > 0) ? hi : lo, 1);
+        if (from > 0) {
+            --from;
+        }
+        if (to < view.num_points) {
+            ++to;
+        }
+    }
+
+    for (part_num = find_part(&view, from); part_num < view.num_parts;
+         ++part_num) {
+        if (shp_parts_points(&view, part_num, &start, &end) == 0) {
+            continue;
+        }
+        if (start >= to) {
+            break;
+        }
+        extract_part(polylinem, &view, (start > from) ? start : from,
+                     (end < to) ? end : to, lo, hi, buffer, measures);
+    }
+
+    return shp_buffer_is_complete(buffer);
+}
@@ -0,0 +1,106 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_MEASURE_H
+#define _SHAPEREADER_SHP_MEASURE_H
+
+#include "shp-buffer.h"
+#include "shp-pointm.h"
+#include "shp-polylinem.h"
+#include <stddef.h>
+
+/**
+ * Get the order of the measures
+ *
+ * Compares the measures of a PolyLineM in a single pass.  Call this function
+ * once per record and pass the result to shp_polylinem_locate and
+ * shp_polylinem_extract, which do not scan the measures again.
+ *
+ * @memberof shp_polylinem_t
+ * @param polylinem a PolyLineM.
+ * @retval 1 if the measures never decrease.
+ * @retval -1 if the measures never increase.
+ * @retval 0 if the measures are not monotonic or not numbers.
+ */
+extern int shp_polylinem_order(const shp_polylinem_t *polylinem);
+
+/**
+ * Locate a point by measure
+ *
+ * Finds the location on a PolyLineM that has the measure @p m.  The location
+ * is interpolated linearly between two points.
+ *
+ * If @p order is not zero, the m_array is searched by bisection.
+ * Otherwise, the parts are scanned and the first location is returned.  If
+ * the measures are not monotonic, a measure may occur more than once.  The
+ * results are undefined if @p order does not match the measures.
+ *
+ * @memberof shp_polylinem_t
+ * @param polylinem a PolyLineM.
+ * @param order the order returned by shp_polylinem_order or 0.
+ * @param m a measure.
+ * @param[out] pointm the location.
+ * @retval 1 if the measure was found.
+ * @retval 0 if no point has the measure.
+ *
+ * @see shp_polylinem_order
+ */
+extern int shp_polylinem_locate(const shp_polylinem_t *polylinem, int order,
+                                double m, shp_pointm_t *pointm);
+
+/**
+ * Extract the lines between two measures
+ *
+ * Copies the sections of a PolyLineM whose measures are between @p m1 and
+ * @p m2 to a buffer.  The end points of the sections are interpolated.  A
+ * new part is started whenever the PolyLineM leaves the measure range.  The
+ * measures are searched by bisection like in shp_polylinem_locate if
+ * @p order is not zero.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * // Get the road between kilometer 12 and 15
+ * size_t parts[10];
+ * shp_point_t points[1000];
+ * double measures[1000];
+ * shp_buffer_t buffer;
+ * int order = shp_polylinem_order(polylinem);
+ *
+ * shp_buffer_init(&buffer, parts, 10, points, 1000);
+ * if (shp_polylinem_extract(polylinem, order, 12.0, 15.0, &buffer,
+ *                           measures)) {
+ *   // Do something
+ * }
+ * @endcode
+ *
+ * @memberof shp_polylinem_t
+ * @param polylinem a PolyLineM.
+ * @param order the order returned by shp_polylinem_order or 0.
+ * @param m1 a measure.
+ * @param m2 another measure.
+ * @param[out] buffer a buffer that receives the sections.
+ * @param[out] measures NULL or an array with room for @a max_points values
+ *                      that receives the measures of the points.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see shp_polylinem_locate
+ */
+extern int shp_polylinem_extract(const shp_polylinem_t *polylinem,
+                                 int order, double m1, double m2,
+                                 shp_buffer_t *buffer, double *measures);
+
+#endif
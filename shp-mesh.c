@@ -0,0 +1,747 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-mesh.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE ((size_t) -1)
+
+/*
+ * The rings of a polygon are projected onto the coordinate plane that is
+ * most parallel to the outer ring and are stored in doubly linked lists.
+ */
+typedef struct node_t {
+    double u;
+    double v;
+    size_t index;
+    size_t prev;
+    size_t next;
+} node_t;
+
+typedef struct mesher_t {
+    const shp_multipatch_t *multipatch;
+    shp_mesh_t *mesh;
+    size_t *vertex_of;
+    size_t *holes;
+    node_t *nodes;
+    size_t num_nodes;
+    int axis;
+    int flip;
+} mesher_t;
+
+static size_t
+point_hash(const shp_multipatch_t *multipatch, size_t point_num)
+{
+    const unsigned char *buf;
+    uint32_t h = UINT32_C(2166136261);
+    size_t i;
+
+    /* FNV-1a hash of the X, Y and Z coordinates */
+    buf = (const unsigned char *) multipatch->points + 16 * point_num;
+    for (i = 0; i < 16; ++i) {
+        h = (h ^ buf[i]) * UINT32_C(16777619);
+    }
+    buf = (const unsigned char *) multipatch->z_array + 8 * point_num;
+    for (i = 0; i < 8; ++i) {
+        h = (h ^ buf[i]) * UINT32_C(16777619);
+    }
+
+    return h;
+}
+
+static int
+point_equals(const shp_multipatch_t *multipatch, size_t i, size_t j)
+{
+    return memcmp(multipatch->points + 16 * i, multipatch->points + 16 * j,
+                  16) == 0 &&
+           memcmp(multipatch->z_array + 8 * i, multipatch->z_array + 8 * j,
+                  8) == 0;
+}
+
+static int
+add_vertices(mesher_t *ctx)
+{
+    const shp_multipatch_t *multipatch = ctx->multipatch;
+    shp_mesh_t *mesh = ctx->mesh;
+    size_t *table, num_points, mask, i, j, k;
+
+    num_points = multipatch->num_points;
+
+    mask = 1;
+    while (mask < 2 * num_points) {
+        mask *= 2;
+    }
+    table = (size_t *) malloc(mask * sizeof(*table));
+    if (table == NULL) {
+        return -1;
+    }
+    for (k = 0; k < mask; ++k) {
+        table[k] = NONE;
+    }
+    --mask;
+
+    for (i = 0; i < num_points; ++i) {
+        k = point_hash(multipatch, i) & mask;
+        while ((j = table[k]) != NONE && !point_equals(multipatch, i, j)) {
+            k = (k + 1) & mask;
+        }
+        if (j == NONE) {
+            table[k] = i;
+            ctx->vertex_of[i] = mesh->num_vertices;
+            shp_multipatch_pointz(multipatch, i,
+                                  &mesh->vertices[mesh->num_vertices]);
+            ++mesh->num_vertices;
+        }
+        else {
+            ctx->vertex_of[i] = ctx->vertex_of[j];
+        }
+    }
+
+    free(table);
+
+    return 1;
+}
+
+static void
+add_triangle(mesher_t *ctx, size_t a, size_t b, size_t c)
+{
+    shp_mesh_t *mesh = ctx->mesh;
+    size_t *indices;
+
+    /* Skip degenerate triangles, e.g. in triangle strips */
+    if (a == b || b == c || c == a) {
+        return;
+    }
+
+    indices = &mesh->indices[3 * mesh->num_triangles];
+    indices[0] = a;
+    indices[1] = b;
+    indices[2] = c;
+    ++mesh->num_triangles;
+}
+
+static void
+add_strip(mesher_t *ctx, size_t start, size_t end)
+{
+    const size_t *v = ctx->vertex_of;
+    size_t i;
+
+    /* Every other triangle is reversed to keep the orientation */
+    for (i = start; i + 2 < end; ++i) {
+        if ((i - start) % 2 == 0) {
+            add_triangle(ctx, v[i], v[i + 1], v[i + 2]);
+        }
+        else {
+            add_triangle(ctx, v[i + 1], v[i], v[i + 2]);
+        }
+    }
+}
+
+static void
+add_fan(mesher_t *ctx, size_t start, size_t end)
+{
+    const size_t *v = ctx->vertex_of;
+    size_t i;
+
+    for (i = start + 1; i + 1 < end; ++i) {
+        add_triangle(ctx, v[start], v[i], v[i + 1]);
+    }
+}
+
+static double
+cross(const node_t *p, const node_t *q, const node_t *r)
+{
+    return (q->u - p->u) * (r->v - p->v) - (q->v - p->v) * (r->u - p->u);
+}
+
+static int
+in_triangle(double ax, double ay, double bx, double by, double cx, double cy,
+            double px, double py)
+{
+    return (cx - px) * (ay - py) - (ax - px) * (cy - py) >= 0.0 &&
+           (ax - px) * (by - py) - (bx - px) * (ay - py) >= 0.0 &&
+           (bx - px) * (cy - py) - (cx - px) * (by - py) >= 0.0;
+}
+
+static void
+set_axis(mesher_t *ctx, size_t start, size_t end)
+{
+    const shp_pointz_t *vertices = ctx->mesh->vertices, *p, *q;
+    size_t i;
+    double nx, ny, nz;
+
+    /* Compute the normal vector with Newell's method */
+    nx = 0.0;
+    ny = 0.0;
+    nz = 0.0;
+    for (i = start; i < end; ++i) {
+        p = &vertices[ctx->vertex_of[i]];
+        q = &vertices[ctx->vertex_of[(i + 1 < end) ? i + 1 : start]];
+        nx += (p->y - q->y) * (p->z + q->z);
+        ny += (p->z - q->z) * (p->x + q->x);
+        nz += (p->x - q->x) * (p->y + q->y);
+    }
+
+    nx = fabs(nx);
+    ny = fabs(ny);
+    nz = fabs(nz);
+    if (nx > ny && nx > nz) {
+        ctx->axis = 0;
+    }
+    else if (ny > nz) {
+        ctx->axis = 1;
+    }
+    else {
+        ctx->axis = 2;
+    }
+}
+
+static void
+project(const mesher_t *ctx, const shp_pointz_t *p, double *u, double *v)
+{
+    switch (ctx->axis) {
+    case 0:
+        *u = p->y;
+        *v = p->z;
+        break;
+    case 1:
+        *u = p->z;
+        *v = p->x;
+        break;
+    default:
+        *u = p->x;
+        *v = p->y;
+        break;
+    }
+}
+
+static size_t
+add_ring(mesher_t *ctx, size_t start, size_t end)
+{
+    node_t *nodes = ctx->nodes, *node;
+    size_t first, n, i, index;
+
+    first = ctx->num_nodes;
+    n = first;
+    for (i = start; i < end; ++i) {
+        index = ctx->vertex_of[i];
+        if (n > first && nodes[n - 1].index == index) {
+            continue;
+        }
+        node = &nodes[n];
+        node->index = index;
+        project(ctx, &ctx->mesh->vertices[index], &node->u, &node->v);
+        node->prev = n - 1;
+        node->next = n + 1;
+        ++n;
+    }
+
+    /* Remove the closing point */
+    if (n - first > 1 && nodes[n - 1].index == nodes[first].index) {
+        --n;
+    }
+
+    if (n - first < 3) {
+        return NONE;
+    }
+
+    nodes[first].prev = n - 1;
+    nodes[n - 1].next = first;
+    ctx->num_nodes = n;
+
+    return first;
+}
+
+static double
+ring_area(const node_t *nodes, size_t ring)
+{
+    size_t i, j;
+    double u0, v0, sum;
+
+    u0 = nodes[ring].u;
+    v0 = nodes[ring].v;
+    sum = 0.0;
+    i = ring;
+    do {
+        j = nodes[i].next;
+        sum += (nodes[i].u - u0) * (nodes[j].v - v0) -
+               (nodes[j].u - u0) * (nodes[i].v - v0);
+        i = j;
+    } while (i != ring);
+
+    return sum / 2.0;
+}
+
+static void
+reverse_ring(node_t *nodes, size_t ring)
+{
+    size_t i, next;
+
+    i = ring;
+    do {
+        next = nodes[i].next;
+        nodes[i].next = nodes[i].prev;
+        nodes[i].prev = next;
+        i = next;
+    } while (i != ring);
+}
+
+static int
+point_in_ring(const node_t *nodes, size_t ring, double u, double v)
+{
+    const node_t *p, *q;
+    size_t i;
+    int inside = 0;
+
+    i = ring;
+    do {
+        p = &nodes[i];
+        q = &nodes[p->next];
+        if ((p->v > v) != (q->v > v) &&
+            u < (q->u - p->u) * (v - p->v) / (q->v - p->v) + p->u) {
+            inside = !inside;
+        }
+        i = p->next;
+    } while (i != ring);
+
+    return inside;
+}
+
+static size_t
+leftmost_node(const node_t *nodes, size_t ring)
+{
+    size_t i, leftmost;
+
+    leftmost = ring;
+    i = nodes[ring].next;
+    while (i != ring) {
+        if (nodes[i].u < nodes[leftmost].u ||
+            (nodes[i].u == nodes[leftmost].u &&
+             nodes[i].v < nodes[leftmost].v)) {
+            leftmost = i;
+        }
+        i = nodes[i].next;
+    }
+
+    return leftmost;
+}
+
+static int
+locally_inside(const node_t *nodes, size_t a, size_t b)
+{
+    const node_t *p = &nodes[a], *prev, *next, *q = &nodes[b];
+
+    prev = &nodes[p->prev];
+    next = &nodes[p->next];
+    if (cross(prev, p, next) > 0.0) {
+        return cross(p, q, next) <= 0.0 && cross(p, prev, q) <= 0.0;
+    }
+    return cross(p, q, prev) > 0.0 || cross(p, next, q) > 0.0;
+}
+
+/*
+ * Find a vertex of the outer ring that can be connected with the leftmost
+ * vertex of a hole.  A ray is cast from the hole to the left.
+ */
+static size_t
+find_bridge(const node_t *nodes, size_t hole, size_t outer)
+{
+    const node_t *p, *q;
+    size_t i, m, stop;
+    double hu, hv, qu, u, mu, mv, t, t_min;
+
+    hu = nodes[hole].u;
+    hv = nodes[hole].v;
+    qu = -HUGE_VAL;
+    m = NONE;
+
+    i = outer;
+    do {
+        p = &nodes[i];
+        q = &nodes[p->next];
+        if (hv <= p->v && hv >= q->v && q->v != p->v) {
+            u = p->u + (hv - p->v) * (q->u - p->u) / (q->v - p->v);
+            if (u <= hu && u > qu) {
+                qu = u;
+                m = (p->u < q->u) ? i : p->next;
+                if (u == hu) {
+                    return m;
+                }
+            }
+        }
+        i = p->next;
+    } while (i != outer);
+
+    if (m == NONE) {
+        return NONE;
+    }
+
+    /* Prefer a vertex inside the triangle hole, intersection, m that has
+     * the smallest angle to the ray. */
+    stop = m;
+    mu = nodes[m].u;
+    mv = nodes[m].v;
+    t_min = HUGE_VAL;
+    i = m;
+    do {
+        p = &nodes[i];
+        if (hu >= p->u && p->u >= mu && hu != p->u &&
+            in_triangle(hv < mv ? hu : qu, hv, mu, mv, hv < mv ? qu : hu, hv,
+                        p->u, p->v)) {
+            t = fabs(hv - p->v) / (hu - p->u);
+            if (locally_inside(nodes, i, hole) &&
+                (t < t_min || (t == t_min && p->u > nodes[m].u))) {
+                m = i;
+                t_min = t;
+            }
+        }
+        i = p->next;
+    } while (i != stop);
+
+    return m;
+}
+
+/*
+ * Connect two vertices of a ring and duplicate them, so that the ring is
+ * traversed a -> b ... b2 -> a2 ...
+ */
+static void
+split_ring(mesher_t *ctx, size_t a, size_t b)
+{
+    node_t *nodes = ctx->nodes;
+    size_t a2, b2, an, bp;
+
+    a2 = ctx->num_nodes++;
+    b2 = ctx->num_nodes++;
+    an = nodes[a].next;
+    bp = nodes[b].prev;
+
+    nodes[a2] = nodes[a];
+    nodes[b2] = nodes[b];
+
+    nodes[a].next = b;
+    nodes[b].prev = a;
+    nodes[a2].next = an;
+    nodes[an].prev = a2;
+    nodes[b2].next = a2;
+    nodes[a2].prev = b2;
+    nodes[bp].next = b2;
+    nodes[b2].prev = bp;
+}
+
+static int
+is_ear(const node_t *nodes, size_t ear)
+{
+    const node_t *a, *b, *c, *p;
+    size_t i;
+
+    b = &nodes[ear];
+    a = &nodes[b->prev];
+    c = &nodes[b->next];
+    if (cross(a, b, c) <= 0.0) {
+        return 0;
+    }
+
+    for (i = c->next; i != b->prev; i = p->next) {
+        p = &nodes[i];
+        if (p->index != a->index && p->index != b->index &&
+            p->index != c->index &&
+            in_triangle(a->u, a->v, b->u, b->v, c->u, c->v, p->u, p->v) &&
+            cross(&nodes[p->prev], p, &nodes[p->next]) <= 0.0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static size_t
+remove_node(mesher_t *ctx, size_t i, int add)
+{
+    node_t *nodes = ctx->nodes;
+    size_t prev = nodes[i].prev, next = nodes[i].next;
+
+    if (add) {
+        if (ctx->flip) {
+            add_triangle(ctx, nodes[prev].index, nodes[next].index,
+                         nodes[i].index);
+        }
+        else {
+            add_triangle(ctx, nodes[prev].index, nodes[i].index,
+                         nodes[next].index);
+        }
+    }
+
+    nodes[prev].next = next;
+    nodes[next].prev = prev;
+
+    return next;
+}
+
+static size_t
+find_collinear(const node_t *nodes, size_t ring)
+{
+    size_t i;
+
+    i = ring;
+    do {
+        if (cross(&nodes[nodes[i].prev], &nodes[i], &nodes[nodes[i].next]) ==
+            0.0) {
+            return i;
+        }
+        i = nodes[i].next;
+    } while (i != ring);
+
+    return NONE;
+}
+
+static void
+clip_ears(mesher_t *ctx, size_t ear)
+{
+    const node_t *nodes = ctx->nodes;
+    size_t count, stop, i;
+
+    count = 1;
+    for (i = nodes[ear].next; i != ear; i = nodes[i].next) {
+        ++count;
+    }
+
+    stop = ear;
+    while (count > 2) {
+        if (is_ear(nodes, ear)) {
+            /* Skipping the next vertex leads to less sliver triangles */
+            ear = nodes[remove_node(ctx, ear, 1)].next;
+            stop = ear;
+            --count;
+            continue;
+        }
+
+        ear = nodes[ear].next;
+        if (ear == stop) {
+            /* No ear was found.  Remove a collinear vertex or, if the ring
+             * intersects itself, clip the current vertex anyway. */
+            i = find_collinear(nodes, ear);
+            if (i != NONE) {
+                ear = remove_node(ctx, i, 0);
+            }
+            else {
+                ear = remove_node(ctx, ear, 1);
+            }
+            stop = ear;
+            --count;
+        }
+    }
+}
+
+static void
+add_polygon(mesher_t *ctx, size_t first_part, size_t last_part,
+            int test_holes)
+{
+    const shp_multipatch_t *multipatch = ctx->multipatch;
+    node_t *nodes = ctx->nodes;
+    shp_part_type_t part_type;
+    size_t part_num, outer, hole, start, end, num_holes, num_others, i, j;
+    double u, v;
+
+    ctx->num_nodes = 0;
+
+    if (shp_multipatch_points(multipatch, first_part, &part_type, &start,
+                              &end) == 0) {
+        return;
+    }
+
+    set_axis(ctx, start, end);
+    outer = add_ring(ctx, start, end);
+    if (outer == NONE) {
+        return;
+    }
+
+    /* The outer ring is traversed counterclockwise */
+    ctx->flip = ring_area(nodes, outer) < 0.0;
+    if (ctx->flip) {
+        reverse_ring(nodes, outer);
+    }
+
+    num_holes = 0;
+    num_others = 0;
+    for (part_num = first_part + 1; part_num < last_part; ++part_num) {
+        if (shp_multipatch_points(multipatch, part_num, &part_type, &start,
+                                  &end) == 0) {
+            continue;
+        }
+        if (test_holes) {
+            project(ctx, &ctx->mesh->vertices[ctx->vertex_of[start]], &u,
+                    &v);
+            if (!point_in_ring(nodes, outer, u, v)) {
+                ctx->holes[multipatch->num_parts - 1 - num_others] = part_num;
+                ++num_others;
+                continue;
+            }
+        }
+        hole = add_ring(ctx, start, end);
+        if (hole != NONE) {
+            /* Holes are traversed clockwise */
+            if (ring_area(nodes, hole) > 0.0) {
+                reverse_ring(nodes, hole);
+            }
+            ctx->holes[num_holes] = leftmost_node(nodes, hole);
+            ++num_holes;
+        }
+    }
+
+    /* Connect the holes from left to right with the outer ring */
+    for (i = 1; i < num_holes; ++i) {
+        hole = ctx->holes[i];
+        for (j = i; j > 0 && nodes[ctx->holes[j - 1]].u > nodes[hole].u;
+             --j) {
+            ctx->holes[j] = ctx->holes[j - 1];
+        }
+        ctx->holes[j] = hole;
+    }
+    for (i = 0; i < num_holes; ++i) {
+        j = find_bridge(nodes, ctx->holes[i], outer);
+        if (j != NONE) {
+            split_ring(ctx, j, ctx->holes[i]);
+        }
+    }
+
+    clip_ears(ctx, outer);
+
+    /* Rings that are not inside the first ring are separate polygons */
+    for (i = 0; i < num_others; ++i) {
+        part_num = ctx->holes[multipatch->num_parts - 1 - i];
+        add_polygon(ctx, part_num, part_num + 1, 0);
+    }
+}
+
+static shp_part_type_t
+get_part_type(const shp_multipatch_t *multipatch, size_t part_num)
+{
+    shp_part_type_t part_type;
+    size_t start, end;
+
+    shp_multipatch_points(multipatch, part_num, &part_type, &start, &end);
+
+    return part_type;
+}
+
+int
+shp_multipatch_mesh(const shp_multipatch_t *multipatch, shp_mesh_t **pmesh)
+{
+    int rc = -1;
+    mesher_t ctx;
+    shp_mesh_t *mesh = NULL;
+    void *scratch = NULL;
+    shp_part_type_t part_type, hole_type;
+    size_t num_parts, num_points, max_nodes, size, part_num, last, start,
+        end, n;
+
+    assert(multipatch != NULL);
+    assert(pmesh != NULL);
+
+    num_parts = multipatch->num_parts;
+    num_points = multipatch->num_points;
+
+    /* Every part yields at most two triangles more than it has points */
+    max_nodes = num_points + 2 * num_parts;
+    if (num_points > SIZE_MAX / 64 || max_nodes > SIZE_MAX / 64) {
+        errno = ENOMEM;
+        goto cleanup;
+    }
+
+    size = sizeof(*mesh) + num_points * sizeof(*mesh->vertices) +
+           3 * max_nodes * sizeof(*mesh->indices);
+    mesh = (shp_mesh_t *) malloc(size);
+    if (mesh == NULL) {
+        goto cleanup;
+    }
+
+    mesh->num_vertices = 0;
+    mesh->num_triangles = 0;
+    mesh->vertices = (shp_pointz_t *) (mesh + 1);
+    mesh->indices = (size_t *) (mesh->vertices + num_points);
+
+    if (num_points > 0) {
+        size = max_nodes * sizeof(*ctx.nodes) +
+               (num_points + num_parts) * sizeof(size_t);
+        scratch = malloc(size);
+        if (scratch == NULL) {
+            goto cleanup;
+        }
+
+        ctx.multipatch = multipatch;
+        ctx.mesh = mesh;
+        ctx.nodes = (node_t *) scratch;
+        ctx.vertex_of = (size_t *) (ctx.nodes + max_nodes);
+        ctx.holes = ctx.vertex_of + num_points;
+        ctx.num_nodes = 0;
+        ctx.axis = 2;
+        ctx.flip = 0;
+
+        if (add_vertices(&ctx) < 0) {
+            goto cleanup;
+        }
+
+        part_num = 0;
+        while (part_num < num_parts) {
+            n = shp_multipatch_points(multipatch, part_num, &part_type,
+                                      &start, &end);
+            last = part_num + 1;
+            switch (part_type) {
+            case SHP_PART_TYPE_TRIANGLE_STRIP:
+                if (n > 0) {
+                    add_strip(&ctx, start, end);
+                }
+                break;
+            case SHP_PART_TYPE_TRIANGLE_FAN:
+                if (n > 0) {
+                    add_fan(&ctx, start, end);
+                }
+                break;
+            case SHP_PART_TYPE_OUTER_RING:
+            case SHP_PART_TYPE_FIRST_RING:
+                hole_type = (part_type == SHP_PART_TYPE_OUTER_RING)
+                                ? SHP_PART_TYPE_INNER_RING
+                                : SHP_PART_TYPE_RING;
+                while (last < num_parts &&
+                       get_part_type(multipatch, last) == hole_type) {
+                    ++last;
+                }
+                add_polygon(&ctx, part_num, last,
+                            part_type == SHP_PART_TYPE_FIRST_RING);
+                break;
+            case SHP_PART_TYPE_INNER_RING:
+            case SHP_PART_TYPE_RING:
+                add_polygon(&ctx, part_num, last, 0);
+                break;
+            default:
+                break;
+            }
+            part_num = last;
+        }
+    }
+
+    *pmesh = mesh;
+    mesh = NULL;
+    rc = 1;
+
+cleanup:
+
+    free(scratch);
+    free(mesh);
+
+    return rc;
+}
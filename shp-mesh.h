@@ -0,0 +1,78 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_MESH_H
+#define _SHAPEREADER_SHP_MESH_H
+
+#include "shp-multipatch.h"
+#include "shp-pointz.h"
+#include <stddef.h>
+
+/**
+ * Indexed triangle mesh
+ *
+ * Points with identical X, Y and Z coordinates are stored once.  Each
+ * triangle is described by three consecutive vertex indices.
+ */
+typedef struct shp_mesh_t {
+    size_t num_vertices;    /**< Number of vertices */
+    size_t num_triangles;   /**< Number of triangles */
+    shp_pointz_t *vertices; /**< Vertices */
+    size_t *indices;        /**< Three vertex indices per triangle */
+} shp_mesh_t;
+
+/**
+ * Convert a MultiPatch into a triangle mesh
+ *
+ * Converts the triangle strips, triangle fans and rings of a MultiPatch into
+ * a list of triangles.  An outer ring is triangulated together with the
+ * inner rings that follow it.  A first ring is triangulated together with
+ * the following rings that are inside the first ring.  Other rings are
+ * triangulated on their own.  The triangles have the same orientation as
+ * the parts they are made of.  A vertex has the measure of the first point
+ * with the vertex's coordinates.
+ *
+ * The mesh is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_mesh_t *mesh;
+ * size_t i;
+ *
+ * if (shp_multipatch_mesh(multipatch, &mesh) > 0) {
+ *   for (i = 0; i < mesh->num_triangles; ++i) {
+ *     draw_triangle(&mesh->vertices[mesh->indices[3 * i]],
+ *                   &mesh->vertices[mesh->indices[3 * i + 1]],
+ *                   &mesh->vertices[mesh->indices[3 * i + 2]]);
+ *   }
+ *   free(mesh);
+ * }
+ * @endcode
+ *
+ * @memberof shp_multipatch_t
+ * @param multipatch a MultiPatch.
+ * @param[out] pmesh on success, a pointer to a shp_mesh_t structure.
+ * @retval 1 on success.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see "Triangulation by Ear Clipping" @cite Eberly for a description of the
+ *      triangulation of polygons with holes.
+ */
+extern int shp_multipatch_mesh(const shp_multipatch_t *multipatch,
+                               shp_mesh_t **pmesh);
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-pointgrid.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define UNUSED(x) (void) (x)
+
+#define DEFAULT_BUCKET_SIZE 8
+
+typedef struct points_t {
+    size_t num_points;
+    size_t max_points;
+    shp_pointgrid_point_t *points;
+} points_t;
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    UNUSED(fh);
+    UNUSED(header);
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    points_t *points = (points_t *) fh->user_data;
+    shp_pointgrid_point_t *point, *items;
+    shp_pointz_t p;
+    size_t n;
+
+    UNUSED(header);
+
+    p.z = 0.0;
+    p.m = 0.0;
+    switch (record->type) {
+    case SHP_TYPE_NULL:
+        return 1;
+    case SHP_TYPE_POINT:
+        p.x = record->shape.point.x;
+        p.y = record->shape.point.y;
+        break;
+    case SHP_TYPE_POINTM:
+        p.x = record->shape.pointm.x;
+        p.y = record->shape.pointm.y;
+        p.m = record->shape.pointm.m;
+        break;
+    case SHP_TYPE_POINTZ:
+        p = record->shape.pointz;
+        break;
+    default:
+        shp_set_error(fh, "Shape type %d is not a Point in record %zu",
+                      (int) record->type, record->record_number);
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Points without coordinates cannot be found. */
+    if (isnan(p.x) || isnan(p.y)) {
+        return 1;
+    }
+
+    if (points->num_points == points->max_points) {
+        n = (points->max_points > 0) ? 2 * points->max_points : 64;
+        if (n > SIZE_MAX / sizeof(*items)) {
+            errno = ENOMEM;
+            goto nomem;
+        }
+        items = (shp_pointgrid_point_t *) realloc(points->points,
+                                                  n * sizeof(*items));
+        if (items == NULL) {
+            goto nomem;
+        }
+        points->points = items;
+        points->max_points = n;
+    }
+
+    point = &points->points[points->num_points];
+    point->point = p;
+    point->record_number = record->record_number;
+    point->file_offset = file_offset;
+    ++points->num_points;
+    return 1;
+
+nomem:
+
+    shp_set_error(fh, "Cannot allocate memory in record %zu",
+                  record->record_number);
+    return -1;
+}
+
+static size_t
+get_index(double d, size_t n)
+{
+    /* Clamp the index to [0, n - 1]. */
+    if (!(d >= 0.0)) {
+        return 0;
+    }
+    if (d >= (double) (n - 1)) {
+        return n - 1;
+    }
+    return (size_t) d;
+}
+
+static size_t
+get_col(const shp_grid_t *grid, double x)
+{
+    return get_index((x - grid->x_min) / grid->cell_width, grid->num_cols);
+}
+
+static size_t
+get_row(const shp_grid_t *grid, double y)
+{
+    return get_index((y - grid->y_min) / grid->cell_height, grid->num_rows);
+}
+
+/*
+ * Chooses about n / bucket_size cells with the aspect ratio of the points'
+ * bounding box.
+ */
+static void
+init_grid(shp_grid_t *grid, const points_t *points, size_t bucket_size)
+{
+    const shp_pointgrid_point_t *p = points->points;
+    double x_min = 0.0, y_min = 0.0, x_max = 0.0, y_max = 0.0, w, h, c;
+    size_t num_cells, i;
+
+    if (points->num_points > 0) {
+        x_min = x_max = p[0].point.x;
+        y_min = y_max = p[0].point.y;
+    }
+    for (i = 1; i < points->num_points; ++i) {
+        if (p[i].point.x < x_min) {
+            x_min = p[i].point.x;
+        }
+        if (p[i].point.x > x_max) {
+            x_max = p[i].point.x;
+        }
+        if (p[i].point.y < y_min) {
+            y_min = p[i].point.y;
+        }
+        if (p[i].point.y > y_max) {
+            y_max = p[i].point.y;
+        }
+    }
+
+    num_cells = points->num_points / bucket_size;
+    if (num_cells == 0) {
+        num_cells = 1;
+    }
+
+    w = x_max - x_min;
+    h = y_max - y_min;
+    if (w > 0.0 && h > 0.0) {
+        c = ceil(sqrt((double) num_cells * w / h));
+        grid->num_cols = (c < (double) num_cells) ? (size_t) c : num_cells;
+        if (grid->num_cols == 0) {
+            grid->num_cols = 1;
+        }
+        grid->num_rows = (num_cells + grid->num_cols - 1) / grid->num_cols;
+    }
+    else if (w > 0.0) {
+        grid->num_cols = num_cells;
+        grid->num_rows = 1;
+    }
+    else if (h > 0.0) {
+        grid->num_cols = 1;
+        grid->num_rows = num_cells;
+    }
+    else {
+        grid->num_cols = 1;
+        grid->num_rows = 1;
+    }
+
+    grid->x_min = x_min;
+    grid->y_min = y_min;
+    grid->cell_width = (w > 0.0) ? w / (double) grid->num_cols : 1.0;
+    grid->cell_height = (h > 0.0) ? h / (double) grid->num_rows : 1.0;
+}
+
+static shp_pointgrid_t *
+build_pointgrid(shp_file_t *fh, const points_t *points, size_t bucket_size)
+{
+    shp_pointgrid_t *pointgrid;
+    shp_grid_t grid;
+    size_t n = points->num_points, num_cells, size, cell, i;
+    const shp_pointgrid_point_t *p;
+
+    init_grid(&grid, points, bucket_size);
+    num_cells = grid.num_cols * grid.num_rows;
+
+    if (n > (SIZE_MAX - sizeof(*pointgrid)) / sizeof(*pointgrid->points) ||
+        num_cells + 1 >
+            (SIZE_MAX - sizeof(*pointgrid) - n * sizeof(*pointgrid->points)) /
+                sizeof(*pointgrid->cells)) {
+        shp_set_error(fh, "Cannot allocate memory");
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size = sizeof(*pointgrid) + n * sizeof(*pointgrid->points) +
+           (num_cells + 1) * sizeof(*pointgrid->cells);
+    pointgrid = (shp_pointgrid_t *) malloc(size);
+    if (pointgrid == NULL) {
+        shp_set_error(fh, "Cannot allocate %zu bytes", size);
+        return NULL;
+    }
+    pointgrid->grid = grid;
+    pointgrid->num_points = n;
+    pointgrid->points = (shp_pointgrid_point_t *) (pointgrid + 1);
+    pointgrid->cells = (size_t *) (pointgrid->points + n);
+
+    /* Count the points per cell and sort them by cell. */
+    for (cell = 0; cell <= num_cells; ++cell) {
+        pointgrid->cells[cell] = 0;
+    }
+    for (i = 0; i < n; ++i) {
+        p = &points->points[i];
+        cell = get_row(&grid, p->point.y) * grid.num_cols +
+               get_col(&grid, p->point.x);
+        ++pointgrid->cells[cell + 1];
+    }
+    for (cell = 0; cell < num_cells; ++cell) {
+        pointgrid->cells[cell + 1] += pointgrid->cells[cell];
+    }
+    for (i = 0; i < n; ++i) {
+        p = &points->points[i];
+        cell = get_row(&grid, p->point.y) * grid.num_cols +
+               get_col(&grid, p->point.x);
+        pointgrid->points[pointgrid->cells[cell]++] = *p;
+    }
+    /* The counters now point to the next cell's first point. */
+    for (cell = num_cells; cell > 0; --cell) {
+        pointgrid->cells[cell] = pointgrid->cells[cell - 1];
+    }
+    pointgrid->cells[0] = 0;
+
+    return pointgrid;
+}
+
+int
+shp_pointgrid_read(shp_file_t *fh, size_t bucket_size,
+                   shp_pointgrid_t **ppointgrid)
+{
+    int rc;
+    void *user_data;
+    points_t points = {0, 0, NULL};
+
+    assert(fh != NULL);
+    assert(ppointgrid != NULL);
+
+    *ppointgrid = NULL;
+
+    if (bucket_size == 0) {
+        bucket_size = DEFAULT_BUCKET_SIZE;
+    }
+
+    user_data = fh->user_data;
+    fh->user_data = &points;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc >= 0) {
+        *ppointgrid = build_pointgrid(fh, &points, bucket_size);
+        rc = (*ppointgrid != NULL) ? 1 : -1;
+    }
+
+    free(points.points);
+
+    return rc;
+}
+
+/*
+ * Visits the cells that overlap a rectangle.  If radius2 is not negative,
+ * only the points within the distance sqrt(radius2) from x, y are passed
+ * to the callback.
+ */
+static int
+search_cells(const shp_pointgrid_t *pointgrid, double x_min, double y_min,
+             double x_max, double y_max, double x, double y, double radius2,
+             shp_pointgrid_callback_t callback, void *user_data)
+{
+    const shp_grid_t *grid = &pointgrid->grid;
+    const shp_pointgrid_point_t *p;
+    size_t col_min, col_max, row_min, row_max, col, row, cell, i;
+    double dx, dy;
+
+    if (pointgrid->num_points == 0 || !(x_min <= x_max) ||
+        !(y_min <= y_max)) {
+        return 1;
+    }
+
+    /* Rectangles outside the grid are clamped to the outermost cells. */
+    col_min = get_col(grid, x_min);
+    col_max = get_col(grid, x_max);
+    row_min = get_row(grid, y_min);
+    row_max = get_row(grid, y_max);
+
+    for (row = row_min; row <= row_max; ++row) {
+        for (col = col_min; col <= col_max; ++col) {
+            cell = row * grid->num_cols + col;
+            for (i = pointgrid->cells[cell]; i < pointgrid->cells[cell + 1];
+                 ++i) {
+                p = &pointgrid->points[i];
+                if (p->point.x < x_min || p->point.x > x_max ||
+                    p->point.y < y_min || p->point.y > y_max) {
+                    continue;
+                }
+                if (radius2 >= 0.0) {
+                    dx = p->point.x - x;
+                    dy = p->point.y - y;
+                    if (dx * dx + dy * dy > radius2) {
+                        continue;
+                    }
+                }
+                if (!callback(pointgrid, p, user_data)) {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+int
+shp_pointgrid_search(const shp_pointgrid_t *pointgrid, double x_min,
+                     double y_min, double x_max, double y_max,
+                     shp_pointgrid_callback_t callback, void *user_data)
+{
+    assert(pointgrid != NULL);
+    assert(callback != NULL);
+
+    return search_cells(pointgrid, x_min, y_min, x_max, y_max, 0.0, 0.0,
+                        -1.0, callback, user_data);
+}
+
+int
+shp_pointgrid_radius(const shp_pointgrid_t *pointgrid, double x, double y,
+                     double radius, shp_pointgrid_callback_t callback,
+                     void *user_data)
+{
+    assert(pointgrid != NULL);
+    assert(callback != NULL);
+
+    if (!(radius >= 0.0)) {
+        return 1;
+    }
+
+    return search_cells(pointgrid, x - radius, y - radius, x + radius,
+                        y + radius, x, y, radius * radius, callback,
+                        user_data);
+}
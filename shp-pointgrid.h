@@ -0,0 +1,141 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_POINTGRID_H
+#define _SHAPEREADER_SHP_POINTGRID_H
+
+#include "shp-grid.h"
+#include "shp-pointz.h"
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Point in a bucket grid
+ *
+ * The Z coordinate and the measure are 0 if the file has no such values.
+ */
+typedef struct shp_pointgrid_point_t {
+    shp_pointz_t point;   /**< Coordinates */
+    size_t record_number; /**< Record number (beginning at 1) */
+    size_t file_offset;   /**< Offset in the ".shp" file in bytes */
+} shp_pointgrid_point_t;
+
+/**
+ * Bucket grid over points
+ *
+ * The points are sorted by the cells of a regular grid in row-major order.
+ * The points in the cell @a col, @a row are stored in @a points from
+ * @c cells[row*num_cols+col] to @c cells[row*num_cols+col+1].  Points on
+ * the top or right edge of the grid belong to the last row or column.
+ */
+typedef struct shp_pointgrid_t {
+    shp_grid_t grid;               /**< Grid */
+    size_t num_points;             /**< Number of points */
+    size_t *cells;                 /**< First point of each cell */
+    shp_pointgrid_point_t *points; /**< Points */
+} shp_pointgrid_t;
+
+/**
+ * Callback for bucket grid queries
+ *
+ * @param pointgrid a bucket grid.
+ * @param point a point.
+ * @param user_data callback data.
+ * @retval 1 to continue the query.
+ * @retval 0 to stop the query.
+ */
+typedef int (*shp_pointgrid_callback_t)(const shp_pointgrid_t *pointgrid,
+                                        const shp_pointgrid_point_t *point,
+                                        void *user_data);
+
+/**
+ * Build a bucket grid from a file
+ *
+ * Reads a file of the type Point, PointM or PointZ and sorts the points
+ * into the cells of a grid that covers the points.  The coordinates are
+ * copied so that queries do not have to read the ".shp" file.  Null shapes
+ * are skipped.
+ *
+ * The bucket grid is allocated in a single block of memory that has to be
+ * freed with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_pointgrid_t *pointgrid;
+ *
+ * shp_init_file(&fh, stream, NULL);
+ * if (shp_pointgrid_read(&fh, 0, &pointgrid) > 0) {
+ *   // Do something
+ *   free(pointgrid);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param bucket_size the average number of points per cell or 0 for the
+ *                    default of 8.
+ * @param[out] ppointgrid on success, a pointer to a shp_pointgrid_t
+ *                        structure.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ */
+extern int shp_pointgrid_read(shp_file_t *fh, size_t bucket_size,
+                              shp_pointgrid_t **ppointgrid);
+
+/**
+ * Find the points in a rectangle
+ *
+ * Calls a function for every point that is inside or on the edges of a
+ * rectangle.  Only the cells that overlap the rectangle are visited.
+ *
+ * @memberof shp_pointgrid_t
+ * @param pointgrid a bucket grid.
+ * @param x_min the minimum x coordinate of the rectangle.
+ * @param y_min the minimum y coordinate of the rectangle.
+ * @param x_max the maximum x coordinate of the rectangle.
+ * @param y_max the maximum y coordinate of the rectangle.
+ * @param callback a function that is called for every point.
+ * @param user_data callback data or NULL.
+ * @retval 1 if all points were found.
+ * @retval 0 if the callback stopped the query.
+ */
+extern int shp_pointgrid_search(const shp_pointgrid_t *pointgrid,
+                                double x_min, double y_min, double x_max,
+                                double y_max,
+                                shp_pointgrid_callback_t callback,
+                                void *user_data);
+
+/**
+ * Find the points within a distance
+ *
+ * Calls a function for every point whose Euclidean distance to a location
+ * is less than or equal to a radius.
+ *
+ * @memberof shp_pointgrid_t
+ * @param pointgrid a bucket grid.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param radius the maximum distance.
+ * @param callback a function that is called for every point.
+ * @param user_data callback data or NULL.
+ * @retval 1 if all points were found.
+ * @retval 0 if the callback stopped the query.
+ */
+extern int shp_pointgrid_radius(const shp_pointgrid_t *pointgrid, double x,
+                                double y, double radius,
+                                shp_pointgrid_callback_t callback,
+                                void *user_data);
+
+#endif
@@ -0,0 +1,712 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-predicate.h"
+#include "parts.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct box_t {
+    double x_min;
+    double y_min;
+    double x_max;
+    double y_max;
+} box_t;
+
+/* The segment from point_num to point_num + 1 */
+typedef struct segment_t {
+    box_t box;
+    size_t point_num;
+} segment_t;
+
+/* A point of the other shape's boundary on the segment at point_num */
+typedef struct touch_t {
+    size_t point_num;
+    double t;
+} touch_t;
+
+typedef struct touches_t {
+    size_t num_touches;
+    size_t max_touches;
+    touch_t *touches;
+} touches_t;
+
+/*
+ * A shape's parts and bounding box.
+ */
+typedef struct shape_t {
+    shp_parts_t view;
+    box_t box;
+} shape_t;
+
+static void
+init_polygon(shape_t *shape, const shp_polygon_t *polygon)
+{
+    shp_parts_init(&shape->view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    shape->box.x_min = polygon->x_min;
+    shape->box.y_min = polygon->y_min;
+    shape->box.x_max = polygon->x_max;
+    shape->box.y_max = polygon->y_max;
+}
+
+static void
+init_polyline(shape_t *shape, const shp_polyline_t *polyline)
+{
+    shp_parts_init(&shape->view, polyline->num_parts, polyline->num_points,
+                   polyline->parts, polyline->points);
+    shape->box.x_min = polyline->x_min;
+    shape->box.y_min = polyline->y_min;
+    shape->box.x_max = polyline->x_max;
+    shape->box.y_max = polyline->y_max;
+}
+
+static int
+boxes_overlap(const box_t *a, const box_t *b)
+{
+    return a->x_min <= b->x_max && b->x_min <= a->x_max &&
+           a->y_min <= b->y_max && b->y_min <= a->y_max;
+}
+
+static int
+box_inside(const box_t *inner, const box_t *outer)
+{
+    return inner->x_min >= outer->x_min && inner->x_max <= outer->x_max &&
+           inner->y_min >= outer->y_min && inner->y_max <= outer->y_max;
+}
+
+static size_t
+count_segments(const shp_parts_t *view)
+{
+    size_t n, part_num, start, end;
+
+    n = 0;
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) >= 2) {
+            n += end - start - 1;
+        }
+    }
+    return n;
+}
+
+/*
+ * Gets the segments that overlap a box.
+ */
+static size_t
+get_segments(const shp_parts_t *view, const box_t *box, segment_t *segments)
+{
+    size_t n, part_num, i, start, end;
+    double x0, y0, x1, y1;
+    segment_t *segment;
+
+    n = 0;
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) < 2) {
+            continue;
+        }
+        x1 = shp_parts_x(view, start);
+        y1 = shp_parts_y(view, start);
+        for (i = start; i + 1 < end; ++i) {
+            x0 = x1;
+            y0 = y1;
+            x1 = shp_parts_x(view, i + 1);
+            y1 = shp_parts_y(view, i + 1);
+            segment = &segments[n];
+            segment->box.x_min = (x0 < x1) ? x0 : x1;
+            segment->box.x_max = (x0 < x1) ? x1 : x0;
+            segment->box.y_min = (y0 < y1) ? y0 : y1;
+            segment->box.y_max = (y0 < y1) ? y1 : y0;
+            if (boxes_overlap(&segment->box, box)) {
+                segment->point_num = i;
+                ++n;
+            }
+        }
+    }
+
+    return n;
+}
+
+static int
+compare_segments(const void *a, const void *b)
+{
+    const segment_t *s1 = (const segment_t *) a;
+    const segment_t *s2 = (const segment_t *) b;
+
+    if (s1->box.x_min < s2->box.x_min) {
+        return -1;
+    }
+    if (s1->box.x_min > s2->box.x_min) {
+        return 1;
+    }
+    return 0;
+}
+
+static double
+orient(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+static int
+have_opposite_signs(double d1, double d2, int strict)
+{
+    if (strict) {
+        return (d1 < 0.0 && d2 > 0.0) || (d1 > 0.0 && d2 < 0.0);
+    }
+    return (d1 <= 0.0 && d2 >= 0.0) || (d1 >= 0.0 && d2 <= 0.0);
+}
+
+/*
+ * Tests two segments whose bounding boxes overlap.  If proper is set, only
+ * segments that cross in a point that is inside both segments are reported.
+ * Otherwise, segments that touch or overlap are reported, too.
+ */
+static int
+segments_intersect(const shp_parts_t *va, size_t i, const shp_parts_t *vb,
+                   size_t j, int proper)
+{
+    double ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, d1, d2, d3, d4;
+
+    ax0 = shp_parts_x(va, i);
+    ay0 = shp_parts_y(va, i);
+    ax1 = shp_parts_x(va, i + 1);
+    ay1 = shp_parts_y(va, i + 1);
+    bx0 = shp_parts_x(vb, j);
+    by0 = shp_parts_y(vb, j);
+    bx1 = shp_parts_x(vb, j + 1);
+    by1 = shp_parts_y(vb, j + 1);
+
+    d1 = orient(ax0, ay0, ax1, ay1, bx0, by0);
+    d2 = orient(ax0, ay0, ax1, ay1, bx1, by1);
+    d3 = orient(bx0, by0, bx1, by1, ax0, ay0);
+    d4 = orient(bx0, by0, bx1, by1, ax1, ay1);
+    if (d1 == 0.0 && d2 == 0.0 && d3 == 0.0 && d4 == 0.0) {
+        /* Collinear segments whose bounding boxes overlap */
+        return !proper;
+    }
+    return have_opposite_signs(d1, d2, proper) &&
+           have_opposite_signs(d3, d4, proper);
+}
+
+static int
+add_touch(touches_t *touches, size_t point_num, double t)
+{
+    touch_t *items;
+    size_t n;
+
+    if (touches->num_touches == touches->max_touches) {
+        n = (touches->max_touches > 0) ? 2 * touches->max_touches : 16;
+        if (n > SIZE_MAX / sizeof(*items)) {
+            errno = ENOMEM;
+            return -1;
+        }
+        items = (touch_t *) realloc(touches->touches, n * sizeof(*items));
+        if (items == NULL) {
+            return -1;
+        }
+        touches->touches = items;
+        touches->max_touches = n;
+    }
+
+    touches->touches[touches->num_touches].point_num = point_num;
+    touches->touches[touches->num_touches].t = t;
+    ++touches->num_touches;
+    return 0;
+}
+
+/*
+ * Gets the position of a point on the segment from point_num to
+ * point_num + 1 as a fraction of the segment's length.
+ */
+static double
+get_t(const shp_parts_t *view, size_t point_num, double x, double y)
+{
+    double x0, y0, dx, dy;
+
+    x0 = shp_parts_x(view, point_num);
+    y0 = shp_parts_y(view, point_num);
+    dx = shp_parts_x(view, point_num + 1) - x0;
+    dy = shp_parts_y(view, point_num + 1) - y0;
+    if (fabs(dx) >= fabs(dy)) {
+        return (x - x0) / dx;
+    }
+    return (y - y0) / dy;
+}
+
+/*
+ * Records that the segment j of the shape b touches the segment i of the
+ * polygon a.  The end points of i that lie on j split j into pieces.
+ */
+static int
+add_touches(const shp_parts_t *va, size_t i, const shp_parts_t *vb,
+            size_t j, touches_t *touches)
+{
+    double bx0, by0, bx1, by1, x, y, t;
+    size_t k;
+
+    if (add_touch(touches, j, 0.0) < 0) {
+        return -1;
+    }
+
+    bx0 = shp_parts_x(vb, j);
+    by0 = shp_parts_y(vb, j);
+    bx1 = shp_parts_x(vb, j + 1);
+    by1 = shp_parts_y(vb, j + 1);
+    for (k = i; k <= i + 1; ++k) {
+        x = shp_parts_x(va, k);
+        y = shp_parts_y(va, k);
+        if (orient(bx0, by0, bx1, by1, x, y) == 0.0) {
+            t = get_t(vb, j, x, y);
+            if (t > 0.0 && t < 1.0 && add_touch(touches, j, t) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Removes the segments that end left of a segment and tests the remaining
+ * segments against the segment.  If touches is not NULL, the segments that
+ * touch without crossing are recorded.  The flag is_b tells whether the
+ * segment belongs to the second shape.
+ */
+static int
+sweep(const shp_parts_t *view, const segment_t *segment,
+      const shp_parts_t *other_view, const segment_t *other_segments,
+      size_t *active, size_t *num_active, int proper, touches_t *touches,
+      int is_b)
+{
+    const segment_t *other;
+    size_t i, n;
+    int found = 0;
+
+    n = 0;
+    for (i = 0; i < *num_active; ++i) {
+        other = &other_segments[active[i]];
+        if (other->box.x_max < segment->box.x_min) {
+            continue;
+        }
+        active[n] = active[i];
+        ++n;
+        if (found || other->box.y_min > segment->box.y_max ||
+            segment->box.y_min > other->box.y_max) {
+            continue;
+        }
+        if (segments_intersect(view, segment->point_num, other_view,
+                               other->point_num, proper)) {
+            found = 1;
+        }
+        else if (touches != NULL &&
+                 segments_intersect(view, segment->point_num, other_view,
+                                    other->point_num, 0)) {
+            if (is_b ? add_touches(other_view, other->point_num, view,
+                                   segment->point_num, touches)
+                     : add_touches(view, segment->point_num, other_view,
+                                   other->point_num, touches)) {
+                found = -1;
+            }
+        }
+    }
+    *num_active = n;
+
+    return found;
+}
+
+/*
+ * Returns 1 if the shapes' boundaries intersect, 0 if they do not and -1 on
+ * error.
+ */
+static int
+find_intersection(const shape_t *a, const shape_t *b, int proper,
+                  touches_t *touches)
+{
+    int rc = -1;
+    box_t box;
+    segment_t *sa = NULL, *sb;
+    size_t *active_a, *active_b;
+    size_t na, nb, ia, ib, num_active_a, num_active_b;
+
+    box.x_min = (a->box.x_min > b->box.x_min) ? a->box.x_min : b->box.x_min;
+    box.y_min = (a->box.y_min > b->box.y_min) ? a->box.y_min : b->box.y_min;
+    box.x_max = (a->box.x_max < b->box.x_max) ? a->box.x_max : b->box.x_max;
+    box.y_max = (a->box.y_max < b->box.y_max) ? a->box.y_max : b->box.y_max;
+
+    na = count_segments(&a->view);
+    nb = count_segments(&b->view);
+    if (na == 0 || nb == 0) {
+        return 0;
+    }
+    if (na > SIZE_MAX - nb ||
+        na + nb > SIZE_MAX / (sizeof(*sa) + sizeof(*active_a))) {
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    sa = (segment_t *) malloc((na + nb) * (sizeof(*sa) + sizeof(*active_a)));
+    if (sa == NULL) {
+        goto cleanup;
+    }
+    sb = sa + na;
+    active_a = (size_t *) (sb + nb);
+    active_b = active_a + na;
+
+    na = get_segments(&a->view, &box, sa);
+    nb = get_segments(&b->view, &box, sb);
+    qsort(sa, na, sizeof(*sa), compare_segments);
+    qsort(sb, nb, sizeof(*sb), compare_segments);
+
+    rc = 0;
+    ia = 0;
+    ib = 0;
+    num_active_a = 0;
+    num_active_b = 0;
+    while (ia < na && ib < nb) {
+        if (sa[ia].box.x_min <= sb[ib].box.x_min) {
+            rc = sweep(&a->view, &sa[ia], &b->view, sb, active_b,
+                       &num_active_b, proper, touches, 0);
+            if (rc != 0) {
+                break;
+            }
+            active_a[num_active_a] = ia;
+            ++num_active_a;
+            ++ia;
+        }
+        else {
+            rc = sweep(&b->view, &sb[ib], &a->view, sa, active_a,
+                       &num_active_a, proper, touches, 1);
+            if (rc != 0) {
+                break;
+            }
+            active_b[num_active_b] = ib;
+            ++num_active_b;
+            ++ib;
+        }
+    }
+    /* The remaining segments can only intersect active segments */
+    while (rc == 0 && ia < na && num_active_b > 0) {
+        rc = sweep(&a->view, &sa[ia], &b->view, sb, active_b, &num_active_b,
+                   proper, touches, 0);
+        ++ia;
+    }
+    while (rc == 0 && ib < nb && num_active_a > 0) {
+        rc = sweep(&b->view, &sb[ib], &a->view, sa, active_a, &num_active_a,
+                   proper, touches, 1);
+        ++ib;
+    }
+
+cleanup:
+
+    free(sa);
+
+    return rc;
+}
+
+static int
+point_in_shape(const shp_parts_t *view, double x, double y)
+{
+    size_t part_num, start, end;
+    int k = 0, rc;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) < 4) {
+            continue;
+        }
+        rc = shp_parts_point_in_ring(view, start, end, x, y);
+        if (rc < 0) {
+            return -1;
+        }
+        k ^= rc;
+    }
+    return k;
+}
+
+/*
+ * Returns 1 if a part is inside a polygon, 0 if it is outside and -1 if it
+ * is on the polygon's boundary.  The boundaries must not cross.
+ */
+static int
+locate_part(const shp_parts_t *view, size_t start, size_t end,
+            const shp_parts_t *polygon)
+{
+    size_t i;
+    int rc;
+
+    for (i = start; i < end; ++i) {
+        rc = point_in_shape(polygon, shp_parts_x(view, i),
+                            shp_parts_y(view, i));
+        if (rc >= 0) {
+            return rc;
+        }
+    }
+    for (i = start; i + 1 < end; ++i) {
+        rc = point_in_shape(
+            polygon, 0.5 * (shp_parts_x(view, i) + shp_parts_x(view, i + 1)),
+            0.5 * (shp_parts_y(view, i) + shp_parts_y(view, i + 1)));
+        if (rc >= 0) {
+            return rc;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Locates a point of a polygon's interior next to a ring of the polygon in
+ * another polygon.  Used for rings that are on the other polygon's
+ * boundary.  Returns -1 if no such point is found.
+ */
+static int
+locate_interior(const shp_parts_t *view, size_t start, size_t end,
+                const shp_parts_t *polygon)
+{
+    size_t i;
+    double x0, y0, dx, dy, x, y, side;
+    int k, rc;
+
+    for (i = start; i + 1 < end; ++i) {
+        x0 = shp_parts_x(view, i);
+        y0 = shp_parts_y(view, i);
+        dx = shp_parts_x(view, i + 1) - x0;
+        dy = shp_parts_y(view, i + 1) - y0;
+        if (dx == 0.0 && dy == 0.0) {
+            continue;
+        }
+        /* Step off the edge's midpoint to either side */
+        for (k = 0; k < 2; ++k) {
+            side = (k == 0) ? 1e-6 : -1e-6;
+            x = x0 + 0.5 * dx + side * dy;
+            y = y0 + 0.5 * dy - side * dx;
+            if (point_in_shape(view, x, y) == 1) {
+                rc = point_in_shape(polygon, x, y);
+                if (rc >= 0) {
+                    return rc;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+static int
+compare_touches(const void *a, const void *b)
+{
+    const touch_t *t1 = (const touch_t *) a;
+    const touch_t *t2 = (const touch_t *) b;
+
+    if (t1->point_num != t2->point_num) {
+        return (t1->point_num < t2->point_num) ? -1 : 1;
+    }
+    if (t1->t != t2->t) {
+        return (t1->t < t2->t) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int
+is_piece_outside(const shp_parts_t *view, size_t point_num, double t0,
+                 double t1, const shp_parts_t *polygon)
+{
+    double x0, y0, t;
+
+    x0 = shp_parts_x(view, point_num);
+    y0 = shp_parts_y(view, point_num);
+    t = 0.5 * (t0 + t1);
+    return point_in_shape(polygon,
+                          x0 + t * (shp_parts_x(view, point_num + 1) - x0),
+                          y0 + t * (shp_parts_y(view, point_num + 1) - y0)) ==
+           0;
+}
+
+/*
+ * Returns 1 if no segment that touches a polygon's boundary leaves the
+ * polygon.  The pieces between the touching points are either inside,
+ * outside or on the boundary, so one point per piece is tested.
+ */
+static int
+touches_inside(const shp_parts_t *view, touches_t *touches,
+               const shp_parts_t *polygon)
+{
+    const touch_t *touch;
+    size_t i, n;
+    double t;
+
+    if (touches->num_touches == 0) {
+        return 1;
+    }
+
+    qsort(touches->touches, touches->num_touches, sizeof(*touches->touches),
+          compare_touches);
+
+    n = touches->num_touches;
+    for (i = 0; i < n; ++i) {
+        touch = &touches->touches[i];
+        if (i > 0 && touch[-1].point_num == touch->point_num) {
+            t = touch[-1].t;
+            if (touch->t > t &&
+                is_piece_outside(view, touch->point_num, t, touch->t,
+                                 polygon)) {
+                return 0;
+            }
+        }
+        if ((i + 1 == n || touch[1].point_num != touch->point_num) &&
+            is_piece_outside(view, touch->point_num, touch->t, 1.0,
+                             polygon)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Returns 1 if the first point of any part is inside a polygon.
+ */
+static int
+has_part_inside(const shp_parts_t *view, const shp_parts_t *polygon)
+{
+    size_t part_num, start, end;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) > 0 &&
+            point_in_shape(polygon, shp_parts_x(view, start),
+                           shp_parts_y(view, start)) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+intersects(const shape_t *a, const shape_t *b, int both_polygons)
+{
+    int rc;
+
+    if (!boxes_overlap(&a->box, &b->box)) {
+        return 0;
+    }
+    rc = find_intersection(a, b, 0, NULL);
+    if (rc != 0) {
+        return rc;
+    }
+    /* One shape might be inside the other shape */
+    if (has_part_inside(&a->view, &b->view)) {
+        return 1;
+    }
+    if (both_polygons && has_part_inside(&b->view, &a->view)) {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Checks whether the polygon a contains the shape b.
+ */
+static int
+contains(const shape_t *a, const shape_t *b, int b_is_polygon)
+{
+    touches_t touches = {0, 0, NULL};
+    size_t part_num, start, end;
+    int rc;
+
+    if (b->view.num_points == 0 || !box_inside(&b->box, &a->box)) {
+        return 0;
+    }
+    rc = find_intersection(a, b, 1, &touches);
+    if (rc == 0 && !touches_inside(&b->view, &touches, &a->view)) {
+        rc = 1;
+    }
+    free(touches.touches);
+    if (rc != 0) {
+        return (rc > 0) ? 0 : rc;
+    }
+    /* The boundaries do not cross, so every part is on one side */
+    for (part_num = 0; part_num < b->view.num_parts; ++part_num) {
+        if (shp_parts_points(&b->view, part_num, &start, &end) == 0) {
+            continue;
+        }
+        rc = locate_part(&b->view, start, end, &a->view);
+        /* A ring on a's boundary might enclose a hole in a */
+        if (rc < 0 && b_is_polygon) {
+            rc = locate_interior(&b->view, start, end, &a->view);
+        }
+        if (rc == 0) {
+            return 0;
+        }
+    }
+    /* A hole in a must not be inside b */
+    if (b_is_polygon) {
+        for (part_num = 0; part_num < a->view.num_parts; ++part_num) {
+            if (shp_parts_points(&a->view, part_num, &start, &end) > 0 &&
+                locate_part(&a->view, start, end, &b->view) == 1) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int
+shp_polygon_intersects(const shp_polygon_t *polygon,
+                       const shp_polygon_t *other)
+{
+    shape_t a, b;
+
+    assert(polygon != NULL);
+    assert(other != NULL);
+
+    init_polygon(&a, polygon);
+    init_polygon(&b, other);
+    return intersects(&a, &b, 1);
+}
+
+int
+shp_polygon_contains(const shp_polygon_t *polygon, const shp_polygon_t *other)
+{
+    shape_t a, b;
+
+    assert(polygon != NULL);
+    assert(other != NULL);
+
+    init_polygon(&a, polygon);
+    init_polygon(&b, other);
+    return contains(&a, &b, 1);
+}
+
+int
+shp_polyline_intersects_polygon(const shp_polyline_t *polyline,
+                                const shp_polygon_t *polygon)
+{
+    shape_t a, b;
+
+    assert(polyline != NULL);
+    assert(polygon != NULL);
+
+    init_polyline(&a, polyline);
+    init_polygon(&b, polygon);
+    return intersects(&a, &b, 0);
+}
+
+int
+shp_polygon_contains_polyline(const shp_polygon_t *polygon,
+                              const shp_polyline_t *polyline)
+{
+    shape_t a, b;
+
+    assert(polygon != NULL);
+    assert(polyline != NULL);
+
+    init_polygon(&a, polygon);
+    init_polyline(&b, polyline);
+    return contains(&a, &b, 0);
+}
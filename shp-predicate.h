@@ -0,0 +1,120 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_PREDICATE_H
+#define _SHAPEREADER_SHP_PREDICATE_H
+
+#include "shp-polygon.h"
+#include "shp-polyline.h"
+#include <stddef.h>
+
+/**
+ * Check whether two polygons intersect
+ *
+ * Determines whether two polygons have at least one point in common.
+ * Polygons that touch each other intersect.
+ *
+ * Polygons whose bounding boxes are disjoint are rejected first.  Then the
+ * segments that are inside both bounding boxes are sorted by their smallest
+ * X coordinate and swept from left to right.  Only segments whose bounding
+ * boxes overlap are tested for intersections.  The coordinates are read from
+ * the records and not copied.  If the boundaries do not intersect, one
+ * point of each polygon is tested for containment in the other polygon.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param other another polygon.
+ * @retval 1 if the polygons intersect.
+ * @retval 0 if the polygons are disjoint.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see shp_polygon_contains
+ */
+extern int shp_polygon_intersects(const shp_polygon_t *polygon,
+                                  const shp_polygon_t *other);
+
+/**
+ * Check whether a polygon contains another polygon
+ *
+ * Determines whether every point of @p other is inside @p polygon or on its
+ * boundary.  The boundaries may touch or overlap but must not cross.
+ *
+ * The segments are tested like in shp_polygon_intersects.  If no segments
+ * cross, the segments of @p other that touch the boundary of @p polygon
+ * are split at the touching points and the midpoints of the pieces must not
+ * be outside @p polygon.  Then every ring of @p other must be inside
+ * @p polygon and no ring of @p polygon may be inside @p other.  A ring's
+ * location is determined by the first point that is not on the other
+ * polygon's boundary.  If a ring is entirely on the boundary, the midpoints
+ * of its segments are tested.  If they are on the boundary, too, a point of
+ * @p other's interior next to the ring is tested, so that a polygon that
+ * fills a hole is not contained.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * // Keep the parcels that are inside a municipality
+ * if (shp_polygon_contains(municipality, parcel) > 0) {
+ *   // Do something
+ * }
+ * @endcode
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param other another polygon.
+ * @retval 1 if @p polygon contains @p other.
+ * @retval 0 if @p other is not inside @p polygon.
+ * @retval -1 if memory could not be allocated.
+ */
+extern int shp_polygon_contains(const shp_polygon_t *polygon,
+                                const shp_polygon_t *other);
+
+/**
+ * Check whether a PolyLine intersects a polygon
+ *
+ * Determines whether a PolyLine and a polygon have at least one point in
+ * common.  The segments are tested like in shp_polygon_intersects.  If the
+ * PolyLine does not intersect the polygon's boundary, the first point of
+ * every part is tested for containment in the polygon.
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param polygon a polygon.
+ * @retval 1 if the PolyLine intersects the polygon.
+ * @retval 0 if the PolyLine and the polygon are disjoint.
+ * @retval -1 if memory could not be allocated.
+ */
+extern int shp_polyline_intersects_polygon(const shp_polyline_t *polyline,
+                                           const shp_polygon_t *polygon);
+
+/**
+ * Check whether a polygon contains a PolyLine
+ *
+ * Determines whether every point of a PolyLine is inside a polygon or on its
+ * boundary.  The PolyLine must not cross the polygon's boundary and every
+ * part must be inside the polygon.  The parts' locations are determined
+ * like in shp_polygon_contains.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param polyline a PolyLine.
+ * @retval 1 if the polygon contains the PolyLine.
+ * @retval 0 if the PolyLine is not inside the polygon.
+ * @retval -1 if memory could not be allocated.
+ */
+extern int shp_polygon_contains_polyline(const shp_polygon_t *polygon,
+                                         const shp_polyline_t *polyline);
+
+#endif
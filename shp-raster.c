@@ -0,0 +1,367 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-raster.h"
+#include "parts.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * The coordinates are converted to grid units, i.e. column 0 and row 0 start
+ * at 0.0 and every cell has the size 1.0.
+ */
+
+typedef struct edge_t {
+    double y0;   /* Lower end */
+    double y1;   /* Upper end */
+    double x0;   /* X coordinate at y0 */
+    double dxdy; /* Inverse slope */
+} edge_t;
+
+static int
+compare_edges(const void *a, const void *b)
+{
+    const edge_t *e1 = (const edge_t *) a;
+    const edge_t *e2 = (const edge_t *) b;
+
+    if (e1->y0 < e2->y0) {
+        return -1;
+    }
+    if (e1->y0 > e2->y0) {
+        return 1;
+    }
+    return 0;
+}
+
+static size_t
+get_edges(const shp_parts_t *view, const shp_grid_t *grid, edge_t *edges)
+{
+    size_t num_edges, part_num, i, start, end;
+    double x0, y0, x1, y1, y_max;
+    edge_t *edge;
+
+    y_max = (double) grid->num_rows;
+
+    num_edges = 0;
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &start, &end) < 2) {
+            continue;
+        }
+        x1 = (shp_parts_x(view, end - 1) - grid->x_min) / grid->cell_width;
+        y1 = (shp_parts_y(view, end - 1) - grid->y_min) / grid->cell_height;
+        for (i = start; i < end; ++i) {
+            x0 = x1;
+            y0 = y1;
+            x1 = (shp_parts_x(view, i) - grid->x_min) / grid->cell_width;
+            y1 = (shp_parts_y(view, i) - grid->y_min) / grid->cell_height;
+
+            /* Skip horizontal edges and edges above or below the grid */
+            if (y0 == y1 || (y0 < 0.0 && y1 < 0.0) ||
+                (y0 > y_max && y1 > y_max)) {
+                continue;
+            }
+
+            edge = &edges[num_edges];
+            if (y0 < y1) {
+                edge->y0 = y0;
+                edge->y1 = y1;
+                edge->x0 = x0;
+            }
+            else {
+                edge->y0 = y1;
+                edge->y1 = y0;
+                edge->x0 = x1;
+            }
+            edge->dxdy = (x1 - x0) / (y1 - y0);
+            ++num_edges;
+        }
+    }
+
+    return num_edges;
+}
+
+static void
+set_bits(unsigned char *mask, size_t first, size_t last)
+{
+    size_t i;
+
+    for (i = first; i < last; ++i) {
+        mask[i / 8] |= (unsigned char) (1U << (i % 8));
+    }
+}
+
+static size_t
+get_col(double x, size_t num_cols)
+{
+    /* Index of the first cell whose center is not left of x */
+    x = ceil(x - 0.5);
+    if (!(x > 0.0)) {
+        return 0;
+    }
+    if (x > (double) num_cols) {
+        return num_cols;
+    }
+    return (size_t) x;
+}
+
+int
+shp_polygon_mask(const shp_polygon_t *polygon, const shp_grid_t *grid,
+                 unsigned char *mask)
+{
+    int rc = -1;
+    shp_parts_t view;
+    edge_t *edges = NULL, *edge;
+    size_t *active;
+    double *xs, x, yc;
+    size_t num_edges, num_active, next, row, i, j, n, first;
+
+    assert(polygon != NULL);
+    assert(grid != NULL);
+    assert(mask != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+
+    if (view.num_points == 0) {
+        return 1;
+    }
+
+    if (view.num_points >
+        SIZE_MAX / (sizeof(*edges) + sizeof(*active) + sizeof(*xs))) {
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    edges = (edge_t *) malloc(view.num_points * (sizeof(*edges) +
+                                                 sizeof(*active) +
+                                                 sizeof(*xs)));
+    if (edges == NULL) {
+        goto cleanup;
+    }
+    xs = (double *) (edges + view.num_points);
+    active = (size_t *) (xs + view.num_points);
+
+    num_edges = get_edges(&view, grid, edges);
+    qsort(edges, num_edges, sizeof(*edges), compare_edges);
+
+    next = 0;
+    num_active = 0;
+    for (row = 0; row < grid->num_rows; ++row) {
+        yc = (double) row + 0.5;
+
+        /* Add the edges that start below the cell centers */
+        while (next < num_edges && edges[next].y0 <= yc) {
+            active[num_active] = next;
+            ++num_active;
+            ++next;
+        }
+
+        /* Remove the edges that end below the cell centers and compute the
+         * intersections */
+        n = 0;
+        for (i = 0; i < num_active; ++i) {
+            edge = &edges[active[i]];
+            if (edge->y1 > yc) {
+                active[n] = active[i];
+                x = edge->x0 + (yc - edge->y0) * edge->dxdy;
+                for (j = n; j > 0 && xs[j - 1] > x; --j) {
+                    xs[j] = xs[j - 1];
+                }
+                xs[j] = x;
+                ++n;
+            }
+        }
+        num_active = n;
+
+        first = row * grid->num_cols;
+        for (i = 0; i + 1 < n; i += 2) {
+            set_bits(mask, first + get_col(xs[i], grid->num_cols),
+                     first + get_col(xs[i + 1], grid->num_cols));
+        }
+
+        if (num_active == 0 && next == num_edges) {
+            break;
+        }
+    }
+
+    rc = 1;
+
+cleanup:
+
+    free(edges);
+
+    return rc;
+}
+
+static void
+add_line(double *coverage, const shp_grid_t *grid, double x0, double y0,
+         double x1, double y1)
+{
+    double *cells, dir, dxdy, y_start, y_end, x, x_next, xa, xb, dy, d, s,
+        xa_floor, xb_ceil, xm, a0, a1, a2, am, w;
+    long row, row_end, col, col_a, col_b, num_cols;
+
+    if (y0 == y1) {
+        return;
+    }
+    dir = 1.0;
+    if (y0 > y1) {
+        dir = -1.0;
+        x = x0;
+        x0 = x1;
+        x1 = x;
+        x = y0;
+        y0 = y1;
+        y1 = x;
+    }
+
+    y_start = (y0 > 0.0) ? y0 : 0.0;
+    y_end = (y1 < (double) grid->num_rows) ? y1 : (double) grid->num_rows;
+    if (!(y_start < y_end)) {
+        return;
+    }
+
+    num_cols = (long) grid->num_cols;
+    w = (double) grid->num_cols;
+    dxdy = (x1 - x0) / (y1 - y0);
+    x = x0 + (y_start - y0) * dxdy;
+    row = (long) floor(y_start);
+    row_end = (long) ceil(y_end);
+    for (; row < row_end; ++row) {
+        cells = coverage + row * num_cols;
+        dy = (((double) row + 1.0 < y_end) ? (double) row + 1.0 : y_end) -
+             (((double) row > y_start) ? (double) row : y_start);
+        x_next = x + dxdy * dy;
+        d = dy * dir;
+
+        if (x < x_next) {
+            xa = x;
+            xb = x_next;
+        }
+        else {
+            xa = x_next;
+            xb = x;
+        }
+        xa = (xa > 0.0) ? ((xa < w) ? xa : w) : 0.0;
+        xb = (xb > 0.0) ? ((xb < w) ? xb : w) : 0.0;
+        xa_floor = floor(xa);
+        xb_ceil = ceil(xb);
+        col_a = (long) xa_floor;
+        col_b = (long) xb_ceil;
+
+        if (col_b <= col_a + 1) {
+            /* The line stays in one cell */
+            xm = 0.5 * (xa + xb) - xa_floor;
+            if (col_a < num_cols) {
+                cells[col_a] += d - d * xm;
+            }
+            if (col_a + 1 < num_cols) {
+                cells[col_a + 1] += d * xm;
+            }
+        }
+        else {
+            s = 1.0 / (xb - xa);
+            a0 = 0.5 * s * (1.0 - (xa - xa_floor)) * (1.0 - (xa - xa_floor));
+            am = 0.5 * s * (xb - xb_ceil + 1.0) * (xb - xb_ceil + 1.0);
+            cells[col_a] += d * a0;
+            if (col_b == col_a + 2) {
+                cells[col_a + 1] += d * (1.0 - a0 - am);
+            }
+            else {
+                a1 = s * (1.5 - (xa - xa_floor));
+                cells[col_a + 1] += d * (a1 - a0);
+                for (col = col_a + 2; col < col_b - 1; ++col) {
+                    cells[col] += d * s;
+                }
+                a2 = a1 + (double) (col_b - col_a - 3) * s;
+                cells[col_b - 1] += d * (1.0 - a2 - am);
+            }
+            if (col_b < num_cols) {
+                cells[col_b] += d * am;
+            }
+        }
+
+        x = x_next;
+    }
+}
+
+static void
+add_segment(double *coverage, const shp_grid_t *grid, double x0, double y0,
+            double x1, double y1)
+{
+    double w, y;
+
+    /* Parts that are left of the grid are projected onto the left edge,
+     * parts that are right of the grid do not cover any cells. */
+    w = (double) grid->num_cols;
+    if ((x0 < 0.0 && x1 > 0.0) || (x0 > 0.0 && x1 < 0.0)) {
+        y = y0 + (0.0 - x0) * (y1 - y0) / (x1 - x0);
+        add_segment(coverage, grid, x0, y0, 0.0, y);
+        add_segment(coverage, grid, 0.0, y, x1, y1);
+    }
+    else if ((x0 < w && x1 > w) || (x0 > w && x1 < w)) {
+        y = y0 + (w - x0) * (y1 - y0) / (x1 - x0);
+        add_segment(coverage, grid, x0, y0, w, y);
+        add_segment(coverage, grid, w, y, x1, y1);
+    }
+    else if (x0 < w || x1 < w) {
+        add_line(coverage, grid, (x0 > 0.0) ? x0 : 0.0, y0,
+                 (x1 > 0.0) ? x1 : 0.0, y1);
+    }
+}
+
+void
+shp_polygon_coverage(const shp_polygon_t *polygon, const shp_grid_t *grid,
+                     double *coverage)
+{
+    shp_parts_t view;
+    size_t part_num, row, col, i, n, start, end;
+    double *cells, x0, y0, x1, y1, sum;
+
+    assert(polygon != NULL);
+    assert(grid != NULL);
+    assert(coverage != NULL);
+
+    n = grid->num_cols * grid->num_rows;
+    for (i = 0; i < n; ++i) {
+        coverage[i] = 0.0;
+    }
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+
+    for (part_num = 0; part_num < view.num_parts; ++part_num) {
+        if (shp_parts_points(&view, part_num, &start, &end) < 2) {
+            continue;
+        }
+        x1 = (shp_parts_x(&view, end - 1) - grid->x_min) / grid->cell_width;
+        y1 = (shp_parts_y(&view, end - 1) - grid->y_min) / grid->cell_height;
+        for (i = start; i < end; ++i) {
+            x0 = x1;
+            y0 = y1;
+            x1 = (shp_parts_x(&view, i) - grid->x_min) / grid->cell_width;
+            y1 = (shp_parts_y(&view, i) - grid->y_min) / grid->cell_height;
+            add_segment(coverage, grid, x0, y0, x1, y1);
+        }
+    }
+
+    /* Sum up the areas from left to right */
+    for (row = 0; row < grid->num_rows; ++row) {
+        cells = coverage + row * grid->num_cols;
+        sum = 0.0;
+        for (col = 0; col < grid->num_cols; ++col) {
+            sum += cells[col];
+            cells[col] = (fabs(sum) < 1.0) ? fabs(sum) : 1.0;
+        }
+    }
+}
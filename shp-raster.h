@@ -0,0 +1,80 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_RASTER_H
+#define _SHAPEREADER_SHP_RASTER_H
+
+#include "shp-grid.h"
+#include "shp-polygon.h"
+#include <stddef.h>
+
+/**
+ * Rasterize a polygon into a bitmask
+ *
+ * Sets the bits of the grid cells whose centers are inside the polygon.  The
+ * cells are stored row by row starting with row 0.  Cell number
+ * @c row * @a num_cols + @c col is stored in bit @c cell % 8 of byte
+ * @c cell / 8.  The bits of the other cells are not changed, so that several
+ * polygons can be rasterized into the same bitmask.
+ *
+ * The polygon's edges are sorted by their lowest Y coordinate and an active
+ * edge table is maintained while the rows are scanned.  The even-odd rule is
+ * used.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * unsigned char *mask;
+ *
+ * mask = calloc((grid->num_cols * grid->num_rows + 7) / 8, 1);
+ * if (shp_polygon_mask(polygon, grid, mask) > 0) {
+ *   // Do something
+ * }
+ * free(mask);
+ * @endcode
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param grid a grid.
+ * @param[in,out] mask a bitmask with room for @a num_cols * @a num_rows
+ *                     bits.
+ * @retval 1 on success.
+ * @retval -1 if memory could not be allocated.
+ */
+extern int shp_polygon_mask(const shp_polygon_t *polygon,
+                            const shp_grid_t *grid, unsigned char *mask);
+
+/**
+ * Compute the coverage of grid cells by a polygon
+ *
+ * Computes the fraction of every grid cell's area that is covered by a
+ * polygon.  The fractions are stored row by row starting with row 0.  The
+ * array is overwritten.
+ *
+ * The signed areas between the polygon's edges and the cells' left edges are
+ * accumulated and summed up along the rows.  The results are exact if the
+ * outer rings are in clockwise order and the holes are in counterclockwise
+ * order.  No memory is allocated.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param grid a grid.
+ * @param[out] coverage an array with room for @a num_cols * @a num_rows
+ *                      values between 0 and 1.
+ */
+extern void shp_polygon_coverage(const shp_polygon_t *polygon,
+                                 const shp_grid_t *grid, double *coverage);
+
+#endif
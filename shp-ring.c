@@ -0,0 +1,158 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-ring.h"
+#include "parts.h"
+#include <assert.h>
+
+static void
+measure_ring(const shp_parts_t *view, size_t start, size_t end,
+             shp_ring_t *ring)
+{
+    double box[4];
+
+    ring->area = shp_parts_signed_area(view, start, end, box);
+    ring->x_min = box[0];
+    ring->y_min = box[1];
+    ring->x_max = box[2];
+    ring->y_max = box[3];
+}
+
+static int
+box_contains(const shp_ring_t *outer, const shp_ring_t *inner)
+{
+    return outer->x_min <= inner->x_min && outer->x_max >= inner->x_max &&
+           outer->y_min <= inner->y_min && outer->y_max >= inner->y_max;
+}
+
+static int
+ring_contains(const shp_parts_t *view, size_t outer_num, size_t hole_num)
+{
+    size_t i, n, k, m;
+    int rc = -1;
+
+    shp_parts_points(view, outer_num, &i, &n);
+    shp_parts_points(view, hole_num, &k, &m);
+
+    /* Points on the outer ring's edges are inconclusive. */
+    while (k < m && rc == -1) {
+        rc = shp_parts_point_in_ring(view, i, n, shp_parts_x(view, k),
+                                     shp_parts_y(view, k));
+        ++k;
+    }
+
+    return rc != 0;
+}
+
+static size_t
+classify_rings(const shp_parts_t *view, shp_ring_t *rings)
+{
+    size_t num_parts, num_outer_rings, part_num, outer_num, best, i, n;
+    shp_ring_t *ring;
+
+    num_parts = view->num_parts;
+    num_outer_rings = 0;
+
+    for (part_num = 0; part_num < num_parts; ++part_num) {
+        ring = &rings[part_num];
+        ring->outer_ring = SHP_RING_NONE;
+        ring->next_hole = SHP_RING_NONE;
+        if (shp_parts_points(view, part_num, &i, &n) >= 4) {
+            measure_ring(view, i, n, ring);
+            if (ring->area < 0.0) {
+                ring->outer_ring = part_num;
+                ++num_outer_rings;
+            }
+        }
+        else {
+            ring->area = 0.0;
+            ring->x_min = 0.0;
+            ring->x_max = 0.0;
+            ring->y_min = 0.0;
+            ring->y_max = 0.0;
+        }
+    }
+
+    /* Assign each hole to the smallest outer ring that contains it. */
+    for (part_num = 0; part_num < num_parts; ++part_num) {
+        ring = &rings[part_num];
+        if (!(ring->area > 0.0)) {
+            continue;
+        }
+        best = SHP_RING_NONE;
+        for (outer_num = 0; outer_num < num_parts; ++outer_num) {
+            if (rings[outer_num].outer_ring != outer_num ||
+                !box_contains(&rings[outer_num], ring)) {
+                continue;
+            }
+            if (best != SHP_RING_NONE &&
+                -rings[outer_num].area >= -rings[best].area) {
+                continue;
+            }
+            if (ring_contains(view, outer_num, part_num)) {
+                best = outer_num;
+            }
+        }
+        ring->outer_ring = best;
+    }
+
+    /* Link the holes in reverse order so that the lists are sorted. */
+    part_num = num_parts;
+    while (part_num-- > 0) {
+        ring = &rings[part_num];
+        outer_num = ring->outer_ring;
+        if (outer_num != SHP_RING_NONE && outer_num != part_num) {
+            ring->next_hole = rings[outer_num].next_hole;
+            rings[outer_num].next_hole = part_num;
+        }
+    }
+
+    return num_outer_rings;
+}
+
+size_t
+shp_polygon_rings(const shp_polygon_t *polygon, shp_ring_t *rings)
+{
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(rings != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    return classify_rings(&view, rings);
+}
+
+size_t
+shp_polygonm_rings(const shp_polygonm_t *polygonm, shp_ring_t *rings)
+{
+    shp_parts_t view;
+
+    assert(polygonm != NULL);
+    assert(rings != NULL);
+
+    shp_parts_init(&view, polygonm->num_parts, polygonm->num_points,
+                   polygonm->parts, polygonm->points);
+    return classify_rings(&view, rings);
+}
+
+size_t
+shp_polygonz_rings(const shp_polygonz_t *polygonz, shp_ring_t *rings)
+{
+    shp_parts_t view;
+
+    assert(polygonz != NULL);
+    assert(rings != NULL);
+
+    shp_parts_init(&view, polygonz->num_parts, polygonz->num_points,
+                   polygonz->parts, polygonz->points);
+    return classify_rings(&view, rings);
+}
@@ -0,0 +1,118 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_RING_H
+#define _SHAPEREADER_SHP_RING_H
+
+#include "shp-polygon.h"
+#include "shp-polygonm.h"
+#include "shp-polygonz.h"
+#include <stddef.h>
+
+/**
+ * No part
+ *
+ * Marks the end of a list of holes or a hole without an outer ring.
+ */
+#define SHP_RING_NONE ((size_t) -1)
+
+/**
+ * Ring
+ *
+ * Describes a part of a polygon.  The vertices of outer rings are in
+ * clockwise order, the vertices of holes are in counterclockwise order.
+ */
+typedef struct shp_ring_t {
+    double area;       /**< Signed area, negative if clockwise */
+    double x_min;      /**< X minimum value */
+    double x_max;      /**< X maximum value */
+    double y_min;      /**< Y minimum value */
+    double y_max;      /**< Y maximum value */
+    size_t outer_ring; /**< Part number of the outer ring */
+    size_t next_hole;  /**< Part number of the next hole */
+} shp_ring_t;
+
+/**
+ * Classify the rings of a polygon
+ *
+ * Computes the signed area and the bounding box of every part and assigns
+ * each hole to the smallest outer ring that contains it.
+ *
+ * For an outer ring, @a outer_ring is the ring's own part number and
+ * @a next_hole is the part number of the first hole.  For a hole,
+ * @a outer_ring is the part number of the enclosing outer ring and
+ * @a next_hole is the part number of the next hole of the same outer ring.
+ * Lists end with @c SHP_RING_NONE.  Holes that are not inside an outer ring
+ * and parts with less than four points have the outer ring
+ * @c SHP_RING_NONE.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_ring_t *rings;
+ * size_t part_num, hole;
+ *
+ * rings = malloc(polygon->num_parts * sizeof(*rings));
+ * shp_polygon_rings(polygon, rings);
+ * for (part_num = 0; part_num < polygon->num_parts; ++part_num) {
+ *   if (rings[part_num].outer_ring == part_num) {
+ *     hole = rings[part_num].next_hole;
+ *     while (hole != SHP_RING_NONE) {
+ *       // Do something
+ *       hole = rings[hole].next_hole;
+ *     }
+ *   }
+ * }
+ * free(rings);
+ * @endcode
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param[out] rings an array with room for @a num_parts shp_ring_t
+ *                   structures.
+ * @return the number of outer rings.
+ */
+extern size_t shp_polygon_rings(const shp_polygon_t *polygon,
+                                shp_ring_t *rings);
+
+/**
+ * Classify the rings of a PolygonM
+ *
+ * @memberof shp_polygonm_t
+ * @param polygonm a PolygonM.
+ * @param[out] rings an array with room for @a num_parts shp_ring_t
+ *                   structures.
+ * @return the number of outer rings.
+ *
+ * @see shp_polygon_rings
+ */
+extern size_t shp_polygonm_rings(const shp_polygonm_t *polygonm,
+                                 shp_ring_t *rings);
+
+/**
+ * Classify the rings of a PolygonZ
+ *
+ * @memberof shp_polygonz_t
+ * @param polygonz a PolygonZ.
+ * @param[out] rings an array with room for @a num_parts shp_ring_t
+ *                   structures.
+ * @return the number of outer rings.
+ *
+ * @see shp_polygon_rings
+ */
+extern size_t shp_polygonz_rings(const shp_polygonz_t *polygonz,
+                                 shp_ring_t *rings);
+
+#endif
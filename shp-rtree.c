@@ -0,0 +1,530 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-rtree.h"
+#include "record.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define UNUSED(x) (void) (x)
+
+#define DEFAULT_NODE_SIZE 16
+#define HILBERT_MAX 65535
+
+typedef struct item_t {
+    uint32_t hilbert;
+    shp_rtree_entry_t entry;
+} item_t;
+
+typedef struct entries_t {
+    size_t num_records;
+    size_t num_entries;
+    size_t max_entries;
+    shp_rtree_entry_t *entries;
+} entries_t;
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    UNUSED(fh);
+    UNUSED(header);
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    entries_t *entries = (entries_t *) fh->user_data;
+    size_t max_entries;
+    shp_rtree_entry_t *new_entries, *entry;
+    double box[4], range[4];
+
+    UNUSED(header);
+
+    ++entries->num_records;
+    if (!shp_record_box(record, box)) {
+        return 1;
+    }
+
+    if (entries->num_entries == entries->max_entries) {
+        max_entries = (entries->max_entries > 0) ? 2 * entries->max_entries
+                                                 : 64;
+        if (max_entries > SIZE_MAX / sizeof(*new_entries)) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            errno = ENOMEM;
+            return -1;
+        }
+        new_entries = (shp_rtree_entry_t *) realloc(
+            entries->entries, max_entries * sizeof(*new_entries));
+        if (new_entries == NULL) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            return -1;
+        }
+        entries->entries = new_entries;
+        entries->max_entries = max_entries;
+    }
+
+    entry = &entries->entries[entries->num_entries];
+    entry->x_min = box[0];
+    entry->y_min = box[1];
+    entry->x_max = box[2];
+    entry->y_max = box[3];
+    shp_record_zm(record, range);
+    entry->z_min = range[0];
+    entry->z_max = range[1];
+    entry->m_min = range[2];
+    entry->m_max = range[3];
+    entry->record_number = entries->num_records;
+    entry->file_offset = file_offset;
+    ++entries->num_entries;
+    return 1;
+}
+
+/*
+ * Converts a position on a grid of 65536 by 65536 cells to the distance
+ * along a Hilbert curve.
+ */
+static uint32_t
+hilbert(uint32_t x, uint32_t y)
+{
+    uint32_t s, rx, ry, t, d = 0;
+
+    for (s = (HILBERT_MAX + 1) / 2; s > 0; s /= 2) {
+        rx = (x & s) > 0;
+        ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = HILBERT_MAX - x;
+                y = HILBERT_MAX - y;
+            }
+            t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+static uint32_t
+scale(double value, double min, double max)
+{
+    double width = max - min, t;
+
+    if (!(width > 0.0)) {
+        return 0;
+    }
+    t = (value - min) / width * HILBERT_MAX;
+    return (t <= 0.0) ? 0 : (t >= HILBERT_MAX) ? HILBERT_MAX : (uint32_t) t;
+}
+
+static int
+compare_items(const void *a, const void *b)
+{
+    const item_t *i1 = (const item_t *) a;
+    const item_t *i2 = (const item_t *) b;
+
+    if (i1->hilbert != i2->hilbert) {
+        return (i1->hilbert > i2->hilbert) - (i1->hilbert < i2->hilbert);
+    }
+    return (i1->entry.record_number > i2->entry.record_number) -
+           (i1->entry.record_number < i2->entry.record_number);
+}
+
+static void
+sort_items(item_t *items, size_t num_items)
+{
+    item_t *item;
+    double x_min, y_min, x_max, y_max;
+    size_t i;
+
+    if (num_items == 0) {
+        return;
+    }
+
+    item = &items[0];
+    x_min = item->entry.x_min;
+    y_min = item->entry.y_min;
+    x_max = item->entry.x_max;
+    y_max = item->entry.y_max;
+    for (i = 1; i < num_items; ++i) {
+        item = &items[i];
+        if (x_min > item->entry.x_min) {
+            x_min = item->entry.x_min;
+        }
+        if (y_min > item->entry.y_min) {
+            y_min = item->entry.y_min;
+        }
+        if (x_max < item->entry.x_max) {
+            x_max = item->entry.x_max;
+        }
+        if (y_max < item->entry.y_max) {
+            y_max = item->entry.y_max;
+        }
+    }
+
+    for (i = 0; i < num_items; ++i) {
+        item = &items[i];
+        item->hilbert = hilbert(
+            scale((item->entry.x_min + item->entry.x_max) / 2.0, x_min,
+                  x_max),
+            scale((item->entry.y_min + item->entry.y_max) / 2.0, y_min,
+                  y_max));
+    }
+
+    qsort(items, num_items, sizeof(*items), compare_items);
+}
+
+static void
+extend_node(shp_rtree_node_t *node, double x_min, double y_min, double x_max,
+            double y_max, double z_min, double z_max, double m_min,
+            double m_max)
+{
+    if (node->x_min > x_min) {
+        node->x_min = x_min;
+    }
+    if (node->y_min > y_min) {
+        node->y_min = y_min;
+    }
+    if (node->x_max < x_max) {
+        node->x_max = x_max;
+    }
+    if (node->y_max < y_max) {
+        node->y_max = y_max;
+    }
+    if (node->z_min > z_min) {
+        node->z_min = z_min;
+    }
+    if (node->z_max < z_max) {
+        node->z_max = z_max;
+    }
+    if (node->m_min > m_min) {
+        node->m_min = m_min;
+    }
+    if (node->m_max < m_max) {
+        node->m_max = m_max;
+    }
+}
+
+static void
+pack_nodes(shp_rtree_t *rtree)
+{
+    size_t node_size = rtree->node_size, level, i, j, first, count;
+    shp_rtree_node_t *node, *child;
+    shp_rtree_entry_t *entry;
+
+    for (level = 0; level < rtree->num_levels; ++level) {
+        first = rtree->levels[level];
+        count = rtree->levels[level + 1] - first;
+        for (i = 0; i < count; ++i) {
+            node = &rtree->nodes[first + i];
+            if (level == 0) {
+                entry = &rtree->entries[i * node_size];
+                node->x_min = entry->x_min;
+                node->y_min = entry->y_min;
+                node->x_max = entry->x_max;
+                node->y_max = entry->y_max;
+                node->z_min = entry->z_min;
+                node->z_max = entry->z_max;
+                node->m_min = entry->m_min;
+                node->m_max = entry->m_max;
+                for (j = i * node_size + 1;
+                     j < (i + 1) * node_size && j < rtree->num_entries; ++j) {
+                    entry = &rtree->entries[j];
+                    extend_node(node, entry->x_min, entry->y_min,
+                                entry->x_max, entry->y_max, entry->z_min,
+                                entry->z_max, entry->m_min, entry->m_max);
+                }
+            }
+            else {
+                child = &rtree->nodes[rtree->levels[level - 1] +
+                                      i * node_size];
+                *node = *child;
+                for (j = rtree->levels[level - 1] + i * node_size + 1;
+                     j < rtree->levels[level - 1] + (i + 1) * node_size &&
+                     j < first;
+                     ++j) {
+                    child = &rtree->nodes[j];
+                    extend_node(node, child->x_min, child->y_min,
+                                child->x_max, child->y_max, child->z_min,
+                                child->z_max, child->m_min, child->m_max);
+                }
+            }
+        }
+    }
+}
+
+int
+shp_rtree_pack(const shp_rtree_entry_t *entries, size_t num_entries,
+               size_t node_size, shp_rtree_t **prtree)
+{
+    shp_rtree_t *rtree;
+    item_t *items;
+    size_t num_nodes = 0, num_levels = 0, n, size, i;
+
+    assert(entries != NULL || num_entries == 0);
+    assert(prtree != NULL);
+
+    *prtree = NULL;
+
+    if (node_size == 0) {
+        node_size = DEFAULT_NODE_SIZE;
+    }
+    if (node_size < 2) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Count the nodes per level up to the root. */
+    n = num_entries;
+    while (n > 0) {
+        n = n / node_size + (n % node_size != 0);
+        num_nodes += n;
+        ++num_levels;
+        if (n == 1) {
+            break;
+        }
+    }
+
+    size = sizeof(*rtree);
+    if (num_entries > (SIZE_MAX - size) / sizeof(*rtree->entries)) {
+        goto overflow;
+    }
+    size += num_entries * sizeof(*rtree->entries);
+    if (num_nodes > (SIZE_MAX - size) / sizeof(*rtree->nodes)) {
+        goto overflow;
+    }
+    size += num_nodes * sizeof(*rtree->nodes);
+    if (num_levels + 1 > (SIZE_MAX - size) / sizeof(*rtree->levels)) {
+        goto overflow;
+    }
+    size += (num_levels + 1) * sizeof(*rtree->levels);
+
+    if (num_entries > SIZE_MAX / sizeof(*items)) {
+        goto overflow;
+    }
+    items = (item_t *) malloc((num_entries > 0 ? num_entries : 1) *
+                              sizeof(*items));
+    if (items == NULL) {
+        return -1;
+    }
+    for (i = 0; i < num_entries; ++i) {
+        items[i].entry = entries[i];
+    }
+    sort_items(items, num_entries);
+
+    rtree = (shp_rtree_t *) malloc(size);
+    if (rtree == NULL) {
+        free(items);
+        return -1;
+    }
+
+    rtree->node_size = node_size;
+    rtree->num_entries = num_entries;
+    rtree->num_nodes = num_nodes;
+    rtree->num_levels = num_levels;
+    rtree->entries = (shp_rtree_entry_t *) (rtree + 1);
+    rtree->nodes = (shp_rtree_node_t *) (rtree->entries + num_entries);
+    rtree->levels = (size_t *) (rtree->nodes + num_nodes);
+
+    for (i = 0; i < num_entries; ++i) {
+        rtree->entries[i] = items[i].entry;
+    }
+    free(items);
+
+    rtree->levels[0] = 0;
+    n = num_entries;
+    for (i = 0; i < num_levels; ++i) {
+        n = n / node_size + (n % node_size != 0);
+        rtree->levels[i + 1] = rtree->levels[i] + n;
+    }
+
+    pack_nodes(rtree);
+
+    *prtree = rtree;
+    return 1;
+
+overflow:
+
+    errno = ENOMEM;
+    return -1;
+}
+
+int
+shp_rtree_read(shp_file_t *fh, size_t node_size, shp_rtree_t **prtree)
+{
+    int rc = -1;
+    void *user_data;
+    entries_t entries;
+
+    assert(fh != NULL);
+    assert(prtree != NULL);
+
+    *prtree = NULL;
+
+    entries.num_records = 0;
+    entries.num_entries = 0;
+    entries.max_entries = 0;
+    entries.entries = NULL;
+
+    if (node_size == 1) {
+        shp_set_error(fh, "Node size %zu is too small", node_size);
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    user_data = fh->user_data;
+    fh->user_data = &entries;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc < 0) {
+        goto cleanup;
+    }
+
+    rc = shp_rtree_pack(entries.entries, entries.num_entries, node_size,
+                        prtree);
+    if (rc < 0) {
+        shp_set_error(fh, "Cannot allocate memory");
+    }
+
+cleanup:
+
+    free(entries.entries);
+
+    return rc;
+}
+
+static int
+overlaps(const shp_rtree_node_t *node, const shp_rtree_node_t *box, int zm)
+{
+    return node->x_min <= box->x_max && node->x_max >= box->x_min &&
+           node->y_min <= box->y_max && node->y_max >= box->y_min &&
+           (!zm || (node->z_min <= box->z_max && node->z_max >= box->z_min &&
+                    node->m_min <= box->m_max && node->m_max >= box->m_min));
+}
+
+static int
+entry_overlaps(const shp_rtree_entry_t *entry, const shp_rtree_node_t *box,
+               int zm)
+{
+    return entry->x_min <= box->x_max && entry->x_max >= box->x_min &&
+           entry->y_min <= box->y_max && entry->y_max >= box->y_min &&
+           (!zm ||
+            (entry->z_min <= box->z_max && entry->z_max >= box->z_min &&
+             entry->m_min <= box->m_max && entry->m_max >= box->m_min));
+}
+
+static int
+search_node(const shp_rtree_t *rtree, size_t level, size_t node_num,
+            const shp_rtree_node_t *box, int zm,
+            shp_rtree_callback_t callback, void *user_data)
+{
+    const shp_rtree_entry_t *entry;
+    size_t node_size = rtree->node_size, first, end, i;
+    int rc;
+
+    if (level == 0) {
+        first = node_num * node_size;
+        end = first + node_size;
+        if (end > rtree->num_entries) {
+            end = rtree->num_entries;
+        }
+        for (i = first; i < end; ++i) {
+            entry = &rtree->entries[i];
+            if (entry_overlaps(entry, box, zm)) {
+                if (!(*callback)(rtree, entry, user_data)) {
+                    return 0;
+                }
+            }
+        }
+        return 1;
+    }
+
+    first = rtree->levels[level - 1] + node_num * node_size;
+    end = first + node_size;
+    if (end > rtree->levels[level]) {
+        end = rtree->levels[level];
+    }
+    for (i = first; i < end; ++i) {
+        if (overlaps(&rtree->nodes[i], box, zm)) {
+            rc = search_node(rtree, level - 1, i - rtree->levels[level - 1],
+                             box, zm, callback, user_data);
+            if (rc == 0) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static int
+search(const shp_rtree_t *rtree, const shp_rtree_node_t *box, int zm,
+       shp_rtree_callback_t callback, void *user_data)
+{
+    size_t top;
+
+    if (rtree->num_nodes == 0 ||
+        !overlaps(&rtree->nodes[rtree->num_nodes - 1], box, zm)) {
+        return 1;
+    }
+
+    top = rtree->num_levels - 1;
+    return search_node(rtree, top, 0, box, zm, callback, user_data);
+}
+
+int
+shp_rtree_search(const shp_rtree_t *rtree, double x_min, double y_min,
+                 double x_max, double y_max, shp_rtree_callback_t callback,
+                 void *user_data)
+{
+    shp_rtree_node_t box;
+
+    assert(rtree != NULL);
+    assert(callback != NULL);
+
+    box.x_min = x_min;
+    box.y_min = y_min;
+    box.x_max = x_max;
+    box.y_max = y_max;
+    box.z_min = -HUGE_VAL;
+    box.z_max = HUGE_VAL;
+    box.m_min = -HUGE_VAL;
+    box.m_max = HUGE_VAL;
+    return search(rtree, &box, 0, callback, user_data);
+}
+
+int
+shp_rtree_search_zm(const shp_rtree_t *rtree, double x_min, double y_min,
+                    double x_max, double y_max, double z_min, double z_max,
+                    double m_min, double m_max,
+                    shp_rtree_callback_t callback, void *user_data)
+{
+    shp_rtree_node_t box;
+
+    assert(rtree != NULL);
+    assert(callback != NULL);
+
+    box.x_min = x_min;
+    box.y_min = y_min;
+    box.x_max = x_max;
+    box.y_max = y_max;
+    box.z_min = z_min;
+    box.z_max = z_max;
+    box.m_min = m_min;
+    box.m_max = m_max;
+    return search(rtree, &box, 1, callback, user_data);
+}
@@ -0,0 +1,228 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_RTREE_H
+#define _SHAPEREADER_SHP_RTREE_H
+
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Entry in an R-tree
+ *
+ * Shapes without Z coordinates or measures, and measures that are all "no
+ * data", have empty ranges from HUGE_VAL to -HUGE_VAL.
+ */
+typedef struct shp_rtree_entry_t {
+    double x_min;         /**< Minimum X coordinate */
+    double y_min;         /**< Minimum Y coordinate */
+    double x_max;         /**< Maximum X coordinate */
+    double y_max;         /**< Maximum Y coordinate */
+    double z_min;         /**< Minimum Z coordinate */
+    double z_max;         /**< Maximum Z coordinate */
+    double m_min;         /**< Minimum measure */
+    double m_max;         /**< Maximum measure */
+    size_t record_number; /**< Record number (beginning at 1) */
+    size_t file_offset;   /**< Offset in the ".shp" file in bytes */
+} shp_rtree_entry_t;
+
+/**
+ * Node in an R-tree
+ */
+typedef struct shp_rtree_node_t {
+    double x_min; /**< Minimum X coordinate */
+    double y_min; /**< Minimum Y coordinate */
+    double x_max; /**< Maximum X coordinate */
+    double y_max; /**< Maximum Y coordinate */
+    double z_min; /**< Minimum Z coordinate */
+    double z_max; /**< Maximum Z coordinate */
+    double m_min; /**< Minimum measure */
+    double m_max; /**< Maximum measure */
+} shp_rtree_node_t;
+
+/**
+ * Packed R-tree
+ *
+ * The entries are sorted by the Hilbert value of their centers and are
+ * grouped into nodes of @a node_size children.  The nodes of level @c k are
+ * stored in @a nodes from @c levels[k] to @c levels[k+1].  Level 0 is just
+ * above the entries.  The children of the node @c i in level @c k are the
+ * entries or the nodes of level @c k-1 from @c i*node_size to
+ * @c (i+1)*node_size, counted from the beginning of their level.  The root
+ * is the last node.
+ */
+typedef struct shp_rtree_t {
+    size_t node_size;           /**< Maximum number of children */
+    size_t num_entries;         /**< Number of entries */
+    size_t num_nodes;           /**< Number of nodes */
+    size_t num_levels;          /**< Number of levels */
+    size_t *levels;             /**< First node of each level */
+    shp_rtree_node_t *nodes;    /**< Nodes */
+    shp_rtree_entry_t *entries; /**< Entries */
+} shp_rtree_t;
+
+/**
+ * Callback for R-tree queries
+ *
+ * @param rtree an R-tree.
+ * @param entry an entry.
+ * @param user_data callback data.
+ * @retval 1 to continue the query.
+ * @retval 0 to stop the query.
+ */
+typedef int (*shp_rtree_callback_t)(const shp_rtree_t *rtree,
+                                    const shp_rtree_entry_t *entry,
+                                    void *user_data);
+
+/**
+ * Pack entries into an R-tree
+ *
+ * Sorts a copy of the entries by the Hilbert value of their centers and
+ * packs them bottom-up into nodes.
+ *
+ * The R-tree is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @param entries the entries.
+ * @param num_entries the number of entries.
+ * @param node_size the maximum number of children per node or 0 for the
+ *                  default of 16.
+ * @param[out] prtree on success, a pointer to a shp_rtree_t structure.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see "Hilbert R-tree: An Improved R-tree Using Fractals"
+ *      @cite Kamel_Faloutsos
+ */
+extern int shp_rtree_pack(const shp_rtree_entry_t *entries,
+                          size_t num_entries, size_t node_size,
+                          shp_rtree_t **prtree);
+
+/**
+ * Build an R-tree from a file
+ *
+ * Reads a file that has the file extension ".shp" and packs the bounding
+ * boxes of the records into a static R-tree with shp_rtree_pack.  Null
+ * shapes are skipped.
+ *
+ * The R-tree is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_rtree_t *rtree;
+ *
+ * shp_init_file(&fh, stream, NULL);
+ * if (shp_rtree_read(&fh, 16, &rtree) > 0) {
+ *   // Do something
+ *   free(rtree);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param node_size the maximum number of children per node or 0 for the
+ *                  default of 16.
+ * @param[out] prtree on success, a pointer to a shp_rtree_t structure.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see "Hilbert R-tree: An Improved R-tree Using Fractals"
+ *      @cite Kamel_Faloutsos
+ */
+extern int shp_rtree_read(shp_file_t *fh, size_t node_size,
+                          shp_rtree_t **prtree);
+
+/**
+ * Find the entries that overlap a rectangle
+ *
+ * Calls a function for every entry whose bounding box intersects or touches
+ * a rectangle.  The entries provide the record numbers and the file offsets
+ * that can be passed to shp_seek_record.  No memory is allocated.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * int
+ * read_shape(const shp_rtree_t *rtree, const shp_rtree_entry_t *entry,
+ *            void *data)
+ * {
+ *   shp_file_t *fh = (shp_file_t *) data;
+ *   shp_record_t *record;
+ *
+ *   if (shp_seek_record(fh, entry->file_offset, &record) > 0) {
+ *     // Do something
+ *     free(record);
+ *   }
+ *   return 1;
+ * }
+ *
+ * shp_rtree_search(rtree, x_min, y_min, x_max, y_max, read_shape, fh);
+ * @endcode
+ *
+ * @memberof shp_rtree_t
+ * @param rtree an R-tree.
+ * @param x_min the minimum x coordinate of the rectangle.
+ * @param y_min the minimum y coordinate of the rectangle.
+ * @param x_max the maximum x coordinate of the rectangle.
+ * @param y_max the maximum y coordinate of the rectangle.
+ * @param callback a function that is called for every entry.
+ * @param user_data callback data or NULL.
+ * @retval 1 if all entries were found.
+ * @retval 0 if the callback stopped the query.
+ */
+extern int shp_rtree_search(const shp_rtree_t *rtree, double x_min,
+                            double y_min, double x_max, double y_max,
+                            shp_rtree_callback_t callback, void *user_data);
+
+/**
+ * Find the entries that overlap a rectangle and Z and M ranges
+ *
+ * Works like shp_rtree_search but also skips the nodes and entries whose
+ * Z or M range does not overlap the given ranges.  Pass -HUGE_VAL and
+ * HUGE_VAL for ranges that should not restrict the query.  Shapes without
+ * Z coordinates or measures are only found if the corresponding range is
+ * unbounded.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * // PolyLineZ shapes between 100 and 200 m elevation
+ * shp_rtree_search_zm(rtree, x_min, y_min, x_max, y_max, 100.0, 200.0,
+ *                     -HUGE_VAL, HUGE_VAL, read_shape, fh);
+ * @endcode
+ *
+ * @memberof shp_rtree_t
+ * @param rtree an R-tree.
+ * @param x_min the minimum x coordinate of the rectangle.
+ * @param y_min the minimum y coordinate of the rectangle.
+ * @param x_max the maximum x coordinate of the rectangle.
+ * @param y_max the maximum y coordinate of the rectangle.
+ * @param z_min the minimum z coordinate.
+ * @param z_max the maximum z coordinate.
+ * @param m_min the minimum measure.
+ * @param m_max the maximum measure.
+ * @param callback a function that is called for every entry.
+ * @param user_data callback data or NULL.
+ * @retval 1 if all entries were found.
+ * @retval 0 if the callback stopped the query.
+ */
+extern int shp_rtree_search_zm(const shp_rtree_t *rtree, double x_min,
+                               double y_min, double x_max, double y_max,
+                               double z_min, double z_max, double m_min,
+                               double m_max, shp_rtree_callback_t callback,
+                               void *user_data);
+
+#endif
@@ -0,0 +1,443 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-simplify.h"
+#include "parts.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct heap_t {
+    size_t size;
+    size_t *items;
+    size_t *pos;
+    const double *keys;
+} heap_t;
+
+static void
+heap_swap(heap_t *heap, size_t i, size_t j)
+{
+    size_t a = heap->items[i], b = heap->items[j];
+
+    heap->items[i] = b;
+    heap->items[j] = a;
+    heap->pos[b] = i;
+    heap->pos[a] = j;
+}
+
+static void
+heap_up(heap_t *heap, size_t i)
+{
+    size_t parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!(heap->keys[heap->items[i]] < heap->keys[heap->items[parent]])) {
+            break;
+        }
+        heap_swap(heap, i, parent);
+        i = parent;
+    }
+}
+
+static void
+heap_down(heap_t *heap, size_t i)
+{
+    size_t left, right, smallest;
+
+    for (;;) {
+        left = 2 * i + 1;
+        right = left + 1;
+        smallest = i;
+        if (left < heap->size && heap->keys[heap->items[left]] <
+                                     heap->keys[heap->items[smallest]]) {
+            smallest = left;
+        }
+        if (right < heap->size && heap->keys[heap->items[right]] <
+                                      heap->keys[heap->items[smallest]]) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        heap_swap(heap, i, smallest);
+        i = smallest;
+    }
+}
+
+static void
+heap_push(heap_t *heap, size_t item)
+{
+    size_t i = heap->size++;
+
+    heap->items[i] = item;
+    heap->pos[item] = i;
+    heap_up(heap, i);
+}
+
+static size_t
+heap_pop(heap_t *heap)
+{
+    size_t item = heap->items[0];
+
+    --heap->size;
+    if (heap->size > 0) {
+        heap_swap(heap, 0, heap->size);
+        heap_down(heap, 0);
+    }
+
+    return item;
+}
+
+static void
+heap_update(heap_t *heap, size_t item)
+{
+    size_t i = heap->pos[item];
+
+    heap_up(heap, i);
+    heap_down(heap, heap->pos[item]);
+}
+
+static double
+segment_distance2(const shp_parts_t *view, size_t a, size_t b, size_t i)
+{
+    double ax, ay, dx, dy, px, py, t, len2;
+
+    ax = shp_parts_x(view, a);
+    ay = shp_parts_y(view, a);
+    dx = shp_parts_x(view, b) - ax;
+    dy = shp_parts_y(view, b) - ay;
+    px = shp_parts_x(view, i) - ax;
+    py = shp_parts_y(view, i) - ay;
+
+    len2 = dx * dx + dy * dy;
+    if (len2 > 0.0) {
+        t = (px * dx + py * dy) / len2;
+        if (t > 1.0) {
+            t = 1.0;
+        }
+        else if (t < 0.0) {
+            t = 0.0;
+        }
+        px -= t * dx;
+        py -= t * dy;
+    }
+
+    return px * px + py * py;
+}
+
+static double
+triangle_area(const shp_parts_t *view, size_t a, size_t b, size_t c)
+{
+    double ax, ay;
+
+    ax = shp_parts_x(view, a);
+    ay = shp_parts_y(view, a);
+
+    return fabs((shp_parts_x(view, b) - ax) * (shp_parts_y(view, c) - ay) -
+                (shp_parts_x(view, c) - ax) * (shp_parts_y(view, b) - ay)) /
+           2.0;
+}
+
+/*
+ * The Douglas-Peucker algorithm is usually implemented recursively.  Here,
+ * the points that have not been ranked yet are marked with a negative
+ * importance, so that the next interval can be found without a stack.  A
+ * point's importance is limited by the importance of the interval's end
+ * points, which makes the ranking monotonic.
+ */
+static void
+rank_douglas_peucker(const shp_parts_t *view, size_t start, size_t end,
+                     double *importance)
+{
+    size_t a, b, i, k;
+    double d, d_max, bound;
+
+    for (i = start + 1; i < end - 1; ++i) {
+        importance[i] = -1.0;
+    }
+    importance[start] = HUGE_VAL;
+    importance[end - 1] = HUGE_VAL;
+
+    a = start;
+    while (a < end - 1) {
+        b = a + 1;
+        while (importance[b] < 0.0) {
+            ++b;
+        }
+        if (b == a + 1) {
+            a = b;
+            continue;
+        }
+
+        k = a + 1;
+        d_max = -1.0;
+        for (i = a + 1; i < b; ++i) {
+            d = segment_distance2(view, a, b, i);
+            if (d > d_max) {
+                d_max = d;
+                k = i;
+            }
+        }
+
+        d_max = sqrt(d_max);
+        bound = importance[a];
+        if (importance[b] < bound) {
+            bound = importance[b];
+        }
+        importance[k] = (d_max < bound) ? d_max : bound;
+    }
+}
+
+static void
+rank_visvalingam(const shp_parts_t *view, size_t start, size_t end,
+                 double *importance, size_t *scratch)
+{
+    heap_t heap;
+    size_t *prev, *next, i, p, q, n;
+    double area, last;
+
+    importance[start] = HUGE_VAL;
+    importance[end - 1] = HUGE_VAL;
+    if (end - start < 3) {
+        return;
+    }
+
+    n = view->num_points;
+    heap.size = 0;
+    heap.items = scratch;
+    heap.pos = scratch + n;
+    heap.keys = importance;
+    prev = scratch + 2 * n;
+    next = scratch + 3 * n;
+
+    next[start] = start + 1;
+    prev[end - 1] = end - 2;
+    for (i = start + 1; i < end - 1; ++i) {
+        prev[i] = i - 1;
+        next[i] = i + 1;
+        importance[i] = triangle_area(view, i - 1, i, i + 1);
+        heap_push(&heap, i);
+    }
+
+    /* Eliminate the point with the smallest effective area.  The area is
+     * never smaller than the area of a previously eliminated point. */
+    last = 0.0;
+    while (heap.size > 0) {
+        i = heap_pop(&heap);
+        area = importance[i];
+        if (area < last) {
+            importance[i] = last;
+        }
+        else {
+            last = area;
+        }
+
+        p = prev[i];
+        q = next[i];
+        next[p] = q;
+        prev[q] = p;
+        if (p != start) {
+            importance[p] = triangle_area(view, prev[p], p, q);
+            heap_update(&heap, p);
+        }
+        if (q != end - 1) {
+            importance[q] = triangle_area(view, p, q, next[q]);
+            heap_update(&heap, q);
+        }
+    }
+}
+
+static int
+rank_parts(const shp_parts_t *view, shp_simplify_method_t method,
+           double *importance)
+{
+    size_t *scratch = NULL;
+    size_t part_num, i, n;
+
+    if (method == SHP_SIMPLIFY_VISVALINGAM && view->num_points > 0) {
+        if (view->num_points > SIZE_MAX / (4 * sizeof(*scratch))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        scratch =
+            (size_t *) malloc(4 * view->num_points * sizeof(*scratch));
+        if (scratch == NULL) {
+            return -1;
+        }
+    }
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &i, &n) > 0) {
+            if (method == SHP_SIMPLIFY_VISVALINGAM) {
+                rank_visvalingam(view, i, n, importance, scratch);
+            }
+            else {
+                rank_douglas_peucker(view, i, n, importance);
+            }
+        }
+    }
+
+    free(scratch);
+
+    return 1;
+}
+
+static int
+select_parts(const shp_parts_t *view, const double *importance,
+             double tolerance, size_t min_points, shp_buffer_t *buffer)
+{
+    size_t part_num, part_start, count, i, n;
+
+    buffer->num_parts = 0;
+    buffer->num_points = 0;
+
+    for (part_num = 0; part_num < view->num_parts; ++part_num) {
+        if (shp_parts_points(view, part_num, &i, &n) < min_points) {
+            continue;
+        }
+        part_start = shp_buffer_add_part(buffer);
+        count = 0;
+        for (; i < n; ++i) {
+            if (importance[i] > tolerance) {
+                shp_buffer_add_point(buffer, shp_parts_x(view, i),
+                                     shp_parts_y(view, i));
+                ++count;
+            }
+        }
+        if (count < min_points) {
+            shp_buffer_remove_part(buffer, part_start);
+        }
+    }
+
+    return shp_buffer_is_complete(buffer);
+}
+
+static int
+simplify_parts(const shp_parts_t *view, shp_simplify_method_t method,
+               double tolerance, size_t min_points, shp_buffer_t *buffer)
+{
+    int rc = -1;
+    double *importance = NULL;
+
+    if (view->num_points > 0) {
+        if (view->num_points > SIZE_MAX / sizeof(*importance)) {
+            errno = ENOMEM;
+            goto cleanup;
+        }
+        importance =
+            (double *) malloc(view->num_points * sizeof(*importance));
+        if (importance == NULL) {
+            goto cleanup;
+        }
+        if (rank_parts(view, method, importance) < 0) {
+            goto cleanup;
+        }
+    }
+
+    rc = select_parts(view, importance, tolerance, min_points, buffer);
+
+cleanup:
+
+    free(importance);
+
+    return rc;
+}
+
+int
+shp_polyline_rank(const shp_polyline_t *polyline,
+                  shp_simplify_method_t method, double *importance)
+{
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(importance != NULL || polyline->num_points == 0);
+
+    shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                   polyline->parts, polyline->points);
+    return rank_parts(&view, method, importance);
+}
+
+int
+shp_polyline_select(const shp_polyline_t *polyline, const double *importance,
+                    double tolerance, shp_buffer_t *buffer)
+{
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(importance != NULL || polyline->num_points == 0);
+    assert(buffer != NULL);
+
+    shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                   polyline->parts, polyline->points);
+    return select_parts(&view, importance, tolerance, 2, buffer);
+}
+
+int
+shp_polyline_simplify(const shp_polyline_t *polyline,
+                      shp_simplify_method_t method, double tolerance,
+                      shp_buffer_t *buffer)
+{
+    shp_parts_t view;
+
+    assert(polyline != NULL);
+    assert(buffer != NULL);
+
+    shp_parts_init(&view, polyline->num_parts, polyline->num_points,
+                   polyline->parts, polyline->points);
+    return simplify_parts(&view, method, tolerance, 2, buffer);
+}
+
+int
+shp_polygon_rank(const shp_polygon_t *polygon, shp_simplify_method_t method,
+                 double *importance)
+{
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(importance != NULL || polygon->num_points == 0);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    return rank_parts(&view, method, importance);
+}
+
+int
+shp_polygon_select(const shp_polygon_t *polygon, const double *importance,
+                   double tolerance, shp_buffer_t *buffer)
+{
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(importance != NULL || polygon->num_points == 0);
+    assert(buffer != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    return select_parts(&view, importance, tolerance, 4, buffer);
+}
+
+int
+shp_polygon_simplify(const shp_polygon_t *polygon,
+                     shp_simplify_method_t method, double tolerance,
+                     shp_buffer_t *buffer)
+{
+    shp_parts_t view;
+
+    assert(polygon != NULL);
+    assert(buffer != NULL);
+
+    shp_parts_init(&view, polygon->num_parts, polygon->num_points,
+                   polygon->parts, polygon->points);
+    return simplify_parts(&view, method, tolerance, 4, buffer);
+}
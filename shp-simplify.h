@@ -0,0 +1,182 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_SIMPLIFY_H
+#define _SHAPEREADER_SHP_SIMPLIFY_H
+
+#include "shp-buffer.h"
+#include "shp-polygon.h"
+#include "shp-polyline.h"
+#include <stddef.h>
+
+/**
+ * Simplification methods
+ */
+typedef enum shp_simplify_method_t {
+    /**
+     * The Douglas-Peucker algorithm.  The tolerance is a distance.
+     */
+    SHP_SIMPLIFY_DOUGLAS_PEUCKER = 0,
+    /**
+     * The Visvalingam-Whyatt algorithm.  The tolerance is an area.
+     */
+    SHP_SIMPLIFY_VISVALINGAM = 1
+} shp_simplify_method_t;
+
+/**
+ * Rank the points of a PolyLine
+ *
+ * Computes the importance of every point.  A point is kept by the
+ * simplification if its importance is greater than the tolerance.  The
+ * first and last point of each part have the importance @c HUGE_VAL.
+ *
+ * The importance values are monotonic, i.e. the points that are kept at a
+ * tolerance are a subset of the points that are kept at a smaller
+ * tolerance.  Compute the importance once and call shp_polyline_select for
+ * every zoom level.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * double *importance;
+ * int zoom;
+ *
+ * importance = malloc(polyline->num_points * sizeof(*importance));
+ * if (shp_polyline_rank(polyline, SHP_SIMPLIFY_DOUGLAS_PEUCKER,
+ *                       importance) > 0) {
+ *   for (zoom = 0; zoom < 15; ++zoom) {
+ *     shp_polyline_select(polyline, importance, tolerance[zoom], buffer);
+ *     // Do something
+ *   }
+ * }
+ * free(importance);
+ * @endcode
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param method a simplification method.
+ * @param[out] importance an array with room for @a num_points values.
+ * @retval 1 on success.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see "Algorithms for the Reduction of the Number of Points Required to
+ *      Represent a Digitized Line or its Caricature" @cite Douglas_Peucker
+ * @see "Line Generalisation by Repeated Elimination of Points"
+ *      @cite Visvalingam_Whyatt
+ */
+extern int shp_polyline_rank(const shp_polyline_t *polyline,
+                             shp_simplify_method_t method,
+                             double *importance);
+
+/**
+ * Select the points of a PolyLine by importance
+ *
+ * Copies the points whose importance is greater than the tolerance to a
+ * buffer.
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param importance the importance values from shp_polyline_rank.
+ * @param tolerance a distance or area.
+ * @param[out] buffer a buffer that receives the simplified parts.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see shp_polyline_rank
+ */
+extern int shp_polyline_select(const shp_polyline_t *polyline,
+                               const double *importance, double tolerance,
+                               shp_buffer_t *buffer);
+
+/**
+ * Simplify a PolyLine
+ *
+ * Simplifies the parts of a PolyLine and writes them to a buffer.
+ *
+ * @memberof shp_polyline_t
+ * @param polyline a PolyLine.
+ * @param method a simplification method.
+ * @param tolerance a distance or area.
+ * @param[out] buffer a buffer that receives the simplified parts.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see shp_polyline_rank
+ */
+extern int shp_polyline_simplify(const shp_polyline_t *polyline,
+                                 shp_simplify_method_t method,
+                                 double tolerance, shp_buffer_t *buffer);
+
+/**
+ * Rank the points of a polygon
+ *
+ * Computes the importance of every point.  The first and last point of each
+ * ring have the importance @c HUGE_VAL.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param method a simplification method.
+ * @param[out] importance an array with room for @a num_points values.
+ * @retval 1 on success.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see shp_polyline_rank
+ */
+extern int shp_polygon_rank(const shp_polygon_t *polygon,
+                            shp_simplify_method_t method, double *importance);
+
+/**
+ * Select the points of a polygon by importance
+ *
+ * Copies the points whose importance is greater than the tolerance to a
+ * buffer.  Rings that are reduced to less than four points are omitted.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param importance the importance values from shp_polygon_rank.
+ * @param tolerance a distance or area.
+ * @param[out] buffer a buffer that receives the simplified rings.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ *
+ * @see shp_polygon_rank
+ */
+extern int shp_polygon_select(const shp_polygon_t *polygon,
+                              const double *importance, double tolerance,
+                              shp_buffer_t *buffer);
+
+/**
+ * Simplify a polygon
+ *
+ * Simplifies the rings of a polygon and writes them to a buffer.  Rings
+ * that are reduced to less than four points are omitted.
+ *
+ * @memberof shp_polygon_t
+ * @param polygon a polygon.
+ * @param method a simplification method.
+ * @param tolerance a distance or area.
+ * @param[out] buffer a buffer that receives the simplified rings.
+ * @retval 1 on success.
+ * @retval 0 if the buffer is too small.
+ * @retval -1 if memory could not be allocated.
+ *
+ * @see shp_polygon_rank
+ */
+extern int shp_polygon_simplify(const shp_polygon_t *polygon,
+                                shp_simplify_method_t method,
+                                double tolerance, shp_buffer_t *buffer);
+
+#endif
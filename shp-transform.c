@@ -0,0 +1,154 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+#include "shp-transform.h"
+#include "byteorder.h"
+#include "record.h"
+#include <assert.h>
+#include <math.h>
+
+#define BLOCK_SIZE 256
+
+#define PI 3.14159265358979323846
+
+/* WGS 84 semi-major axis in meters */
+#define EARTH_RADIUS 6378137.0
+
+/* Latitude at which the Web Mercator projection becomes a square */
+#define MAX_LATITUDE 85.051128779806592
+
+shp_transform_t *
+shp_transform_init(shp_transform_t *transform, shp_projection_t projection)
+{
+    assert(transform != NULL);
+
+    transform->projection = projection;
+    transform->matrix[0] = 1.0;
+    transform->matrix[1] = 0.0;
+    transform->matrix[2] = 0.0;
+    transform->matrix[3] = 0.0;
+    transform->matrix[4] = 1.0;
+    transform->matrix[5] = 0.0;
+    return transform;
+}
+
+static void
+project(shp_projection_t projection, shp_point_t *points, size_t n)
+{
+    const double to_radians = PI / 180.0;
+    const double to_degrees = 180.0 / PI;
+    double lat, s;
+    size_t i;
+
+    switch (projection) {
+    case SHP_PROJECTION_WEB_MERCATOR:
+        for (i = 0; i < n; ++i) {
+            lat = points[i].y;
+            lat = (lat < MAX_LATITUDE) ? lat : MAX_LATITUDE;
+            lat = (lat > -MAX_LATITUDE) ? lat : -MAX_LATITUDE;
+            s = sin(lat * to_radians);
+            points[i].x = EARTH_RADIUS * to_radians * points[i].x;
+            points[i].y = 0.5 * EARTH_RADIUS * log((1.0 + s) / (1.0 - s));
+        }
+        break;
+    case SHP_PROJECTION_INVERSE_MERCATOR:
+        for (i = 0; i < n; ++i) {
+            points[i].x = to_degrees * points[i].x / EARTH_RADIUS;
+            points[i].y =
+                to_degrees *
+                (2.0 * atan(exp(points[i].y / EARTH_RADIUS)) - 0.5 * PI);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+apply_matrix(const double *matrix, shp_point_t *points, size_t n)
+{
+    const double a = matrix[0], b = matrix[1], c = matrix[2];
+    const double d = matrix[3], e = matrix[4], f = matrix[5];
+    double x, y;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        x = points[i].x;
+        y = points[i].y;
+        points[i].x = a * x + b * y + c;
+        points[i].y = d * x + e * y + f;
+    }
+}
+
+static int
+is_identity(const double *matrix)
+{
+    return matrix[0] == 1.0 && matrix[1] == 0.0 && matrix[2] == 0.0 &&
+           matrix[3] == 0.0 && matrix[4] == 1.0 && matrix[5] == 0.0;
+}
+
+void
+shp_transform_point(const shp_transform_t *transform, shp_point_t *point)
+{
+    assert(transform != NULL);
+    assert(point != NULL);
+
+    project(transform->projection, point, 1);
+    apply_matrix(transform->matrix, point, 1);
+}
+
+size_t
+shp_record_transform(const shp_record_t *record, size_t point_num,
+                     size_t num_points, const shp_transform_t *transform,
+                     shp_point_t *points)
+{
+    const char *buf, *p;
+    shp_point_t point;
+    size_t n, i, j, m;
+    int affine;
+
+    assert(record != NULL);
+    assert(points != NULL);
+
+    n = shp_record_xy(record, &buf, &point);
+    if (point_num >= n) {
+        return 0;
+    }
+    if (num_points > n - point_num) {
+        num_points = n - point_num;
+    }
+
+    affine = transform != NULL && !is_identity(transform->matrix);
+    for (i = 0; i < num_points; i += m) {
+        m = num_points - i;
+        if (m > BLOCK_SIZE) {
+            m = BLOCK_SIZE;
+        }
+        if (buf == NULL) {
+            points[i] = point;
+        }
+        else {
+            for (j = 0; j < m; ++j) {
+                p = buf + 16 * (point_num + i + j);
+                points[i + j].x = shp_le64_to_double(p);
+                points[i + j].y = shp_le64_to_double(p + 8);
+            }
+        }
+        if (transform != NULL) {
+            project(transform->projection, &points[i], m);
+            if (affine) {
+                apply_matrix(transform->matrix, &points[i], m);
+            }
+        }
+    }
+
+    return num_points;
+}
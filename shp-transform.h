@@ -0,0 +1,121 @@
+/*
+ * Read ESRI shapefiles
+ *
+ * Copyright (C) 2023 Andreas Vögele
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under either the terms of the ISC License or the same terms as Perl.
+ */
+
+/* SPDX-License-Identifier: ISC OR Artistic-1.0-Perl OR GPL-1.0-or-later */
+
+/**
+ * @file
+ */
+
+#ifndef _SHAPEREADER_SHP_TRANSFORM_H
+#define _SHAPEREADER_SHP_TRANSFORM_H
+
+#include "shp.h"
+#include <stddef.h>
+
+/**
+ * Projections
+ */
+typedef enum shp_projection_t {
+    SHP_PROJECTION_NONE = 0,        /**< Keep the coordinates */
+    SHP_PROJECTION_WEB_MERCATOR,    /**< Longitude/latitude to EPSG:3857 */
+    SHP_PROJECTION_INVERSE_MERCATOR /**< EPSG:3857 to longitude/latitude */
+} shp_projection_t;
+
+/**
+ * Coordinate transformation
+ *
+ * A projection followed by an affine transformation.  The projected
+ * coordinates x and y are mapped to
+ *
+ * @code{.c}
+ * x' = matrix[0] * x + matrix[1] * y + matrix[2]
+ * y' = matrix[3] * x + matrix[4] * y + matrix[5]
+ * @endcode
+ *
+ * Longitudes and latitudes are given in degrees, Web Mercator coordinates
+ * in meters.  Latitudes beyond 85.0511 degrees north or south are
+ * clamped.
+ */
+typedef struct shp_transform_t {
+    shp_projection_t projection; /**< Projection */
+    double matrix[6];            /**< Affine transformation */
+} shp_transform_t;
+
+/**
+ * Initialize a transformation
+ *
+ * Sets the projection and the identity matrix.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * // Project to Web Mercator and convert to kilometers
+ * shp_transform_t transform;
+ *
+ * shp_transform_init(&transform, SHP_PROJECTION_WEB_MERCATOR);
+ * transform.matrix[0] = 0.001;
+ * transform.matrix[4] = 0.001;
+ * @endcode
+ *
+ * @memberof shp_transform_t
+ * @param transform an uninitialized transformation.
+ * @param projection a projection.
+ * @return the initialized transformation.
+ */
+extern shp_transform_t *shp_transform_init(shp_transform_t *transform,
+                                           shp_projection_t projection);
+
+/**
+ * Transform a point
+ *
+ * @memberof shp_transform_t
+ * @param transform a transformation.
+ * @param[in,out] point a point.
+ */
+extern void shp_transform_point(const shp_transform_t *transform,
+                                shp_point_t *point);
+
+/**
+ * Copy and transform a record's points
+ *
+ * Copies up to @p num_points X and Y coordinates from a record of any
+ * shape type to an array, starting with point @p point_num.  The points are
+ * decoded and transformed in blocks that fit into the CPU cache, so that
+ * the coordinates are transformed while they are copied.  The affine
+ * transformation is applied in a loop without branches that compilers can
+ * vectorize.
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shp_point_t points[1024];
+ * size_t n, point_num = 0;
+ *
+ * while ((n = shp_record_transform(record, point_num, 1024, &transform,
+ *                                  points)) > 0) {
+ *   // Do something
+ *   point_num += n;
+ * }
+ * @endcode
+ *
+ * @memberof shp_record_t
+ * @param record a record.
+ * @param point_num a zero-based point number.
+ * @param num_points the maximum number of points.
+ * @param transform a transformation or NULL.
+ * @param[out] points an array with room for @p num_points points.
+ * @return the number of points that were copied.
+ */
+extern size_t shp_record_transform(const shp_record_t *record,
+                                   size_t point_num, size_t num_points,
+                                   const shp_transform_t *transform,
+                                   shp_point_t *points);
+
+#endif
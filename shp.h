@@ -16,6 +16,13 @@
 #ifndef _SHAPEREADER_SHP_H
 #define _SHAPEREADER_SHP_H
 
+#include "shp-buffer.h"
+#include "shp-check.h"
+#include "shp-clip.h"
+#include "shp-distance.h"
+#include "shp-grid.h"
+#include "shp-measure.h"
+#include "shp-mesh.h"
 #include "shp-multipatch.h"
 #include "shp-multipoint.h"
 #include "shp-multipointm.h"
@@ -29,6 +36,10 @@
 #include "shp-polyline.h"
 #include "shp-polylinem.h"
 #include "shp-polylinez.h"
+#include "shp-predicate.h"
+#include "shp-raster.h"
+#include "shp-ring.h"
+#include "shp-simplify.h"
 #include <stddef.h>
 #include <stdio.h>
 
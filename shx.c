@@ -14,7 +14,17 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#define UNUSED(x) (void) (x)
+
+typedef struct builder_t {
+    shp_header_t header;
+    size_t max_records;
+    shx_table_t *table;
+} builder_t;
 
 shx_file_t *
 shx_init_file(shx_file_t *fh, FILE *stream, void *user_data)
@@ -188,3 +198,256 @@ cleanup:
 
     return rc;
 }
+
+int
+shx_load(shx_file_t *fh, shx_table_t **ptable)
+{
+    int rc = -1;
+    shx_header_t header;
+    shx_table_t *table = NULL;
+    size_t num_records, size, nr, offset, content_length, i;
+    char *buf;
+
+    assert(fh != NULL);
+    assert(ptable != NULL);
+
+    *ptable = NULL;
+
+    rc = shx_read_header(fh, &header);
+    if (rc <= 0) {
+        goto cleanup;
+    }
+    rc = -1;
+
+    num_records = (header.file_size > 100) ? (header.file_size - 100) / 8 : 0;
+    if (num_records > (SIZE_MAX - sizeof(*table)) / 8) {
+        shx_set_error(fh, "Cannot allocate memory");
+        errno = ENOMEM;
+        goto cleanup;
+    }
+    size = sizeof(*table) + 2 * num_records * sizeof(*table->offsets);
+    table = (shx_table_t *) malloc(size);
+    if (table == NULL) {
+        shx_set_error(fh, "Cannot allocate %zu bytes", size);
+        goto cleanup;
+    }
+    table->offsets = (uint32_t *) (table + 1);
+
+    /* Read the records into the table and convert them in place. */
+    buf = (char *) table->offsets;
+    size = 8 * num_records;
+    nr = (size > 0) ? (*fh->fread)(fh, buf, size) : 0;
+    if ((*fh->ferror)(fh)) {
+        shx_set_error(fh, "Cannot read index records");
+        goto cleanup;
+    }
+    if (nr != size) {
+        shx_set_error(fh, "Expected index records of %zu bytes, got %zu",
+                      size, nr);
+        errno = EINVAL;
+        goto cleanup;
+    }
+
+    table->num_records = num_records;
+    for (i = 0; i < table->num_records; ++i) {
+        offset = shp_be32_to_uint32(&buf[8 * i]);
+        content_length = shp_be32_to_uint32(&buf[8 * i + 4]);
+
+        if (offset < 50) {
+            shx_set_error(fh, "Offset %zu is invalid in record %zu", offset,
+                          i + 1);
+            errno = EINVAL;
+            goto cleanup;
+        }
+
+        if (content_length < 2) {
+            shx_set_error(fh, "Content length %zu is invalid in record %zu",
+                          content_length, i + 1);
+            errno = EINVAL;
+            goto cleanup;
+        }
+
+        table->offsets[2 * i] = (uint32_t) offset;
+        table->offsets[2 * i + 1] = (uint32_t) content_length;
+    }
+
+    *ptable = table;
+    table = NULL;
+    rc = 1;
+
+cleanup:
+
+    free(table);
+
+    return rc;
+}
+
+static int
+handle_header(shp_file_t *fh, const shp_header_t *header)
+{
+    builder_t *builder = (builder_t *) fh->user_data;
+
+    builder->header = *header;
+    return 1;
+}
+
+static int
+handle_record(shp_file_t *fh, const shp_header_t *header,
+              const shp_record_t *record, size_t file_offset)
+{
+    builder_t *builder = (builder_t *) fh->user_data;
+    shx_table_t *table = builder->table;
+    size_t n;
+
+    UNUSED(header);
+
+    if (file_offset / 2 > UINT32_MAX ||
+        record->record_size / 2 > UINT32_MAX) {
+        shp_set_error(fh, "File offset %zu is too big in record %zu",
+                      file_offset, record->record_number);
+        errno = EFBIG;
+        return -1;
+    }
+
+    /* The offsets follow the structure, so the block grows as a whole. */
+    if (table->num_records == builder->max_records) {
+        n = 2 * builder->max_records;
+        if (n > (SIZE_MAX - sizeof(*table)) / (2 * sizeof(*table->offsets))) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            errno = ENOMEM;
+            return -1;
+        }
+        table = (shx_table_t *) realloc(
+            table, sizeof(*table) + n * 2 * sizeof(*table->offsets));
+        if (table == NULL) {
+            shp_set_error(fh, "Cannot allocate memory in record %zu",
+                          record->record_number);
+            return -1;
+        }
+        table->offsets = (uint32_t *) (table + 1);
+        builder->table = table;
+        builder->max_records = n;
+    }
+
+    table->offsets[2 * table->num_records] = (uint32_t) (file_offset / 2);
+    table->offsets[2 * table->num_records + 1] =
+        (uint32_t) (record->record_size / 2);
+    ++table->num_records;
+    return 1;
+}
+
+static int
+write_table(shp_file_t *fh, const shp_header_t *header,
+            const shx_table_t *table, FILE *stream)
+{
+    char buf[100] = {0};
+    size_t file_size, i;
+
+    file_size = 100 + 8 * table->num_records;
+    if (file_size / 2 > UINT32_MAX) {
+        shp_set_error(fh, "Index file of %zu bytes is too big", file_size);
+        errno = EFBIG;
+        return -1;
+    }
+
+    shp_uint32_to_be32(9994, &buf[0]);
+    shp_uint32_to_be32((uint32_t) (file_size / 2), &buf[24]);
+    shp_uint32_to_le32(1000, &buf[28]);
+    shp_uint32_to_le32((uint32_t) header->type, &buf[32]);
+    shp_double_to_le64(header->x_min, &buf[36]);
+    shp_double_to_le64(header->y_min, &buf[44]);
+    shp_double_to_le64(header->x_max, &buf[52]);
+    shp_double_to_le64(header->y_max, &buf[60]);
+    shp_double_to_le64(header->z_min, &buf[68]);
+    shp_double_to_le64(header->z_max, &buf[76]);
+    shp_double_to_le64(header->m_min, &buf[84]);
+    shp_double_to_le64(header->m_max, &buf[92]);
+    if (fwrite(buf, 1, 100, stream) != 100) {
+        goto error;
+    }
+
+    for (i = 0; i < table->num_records; ++i) {
+        shp_uint32_to_be32(table->offsets[2 * i], &buf[0]);
+        shp_uint32_to_be32(table->offsets[2 * i + 1], &buf[4]);
+        if (fwrite(buf, 1, 8, stream) != 8) {
+            goto error;
+        }
+    }
+
+    return 1;
+
+error:
+
+    shp_set_error(fh, "Cannot write index file");
+    return -1;
+}
+
+int
+shx_build(shp_file_t *fh, FILE *stream, shx_table_t **ptable)
+{
+    int rc = -1;
+    void *user_data;
+    builder_t builder;
+    size_t size;
+
+    assert(fh != NULL);
+
+    if (ptable != NULL) {
+        *ptable = NULL;
+    }
+
+    builder.max_records = 64;
+    size = sizeof(*builder.table) +
+           builder.max_records * 2 * sizeof(*builder.table->offsets);
+    builder.table = (shx_table_t *) malloc(size);
+    if (builder.table == NULL) {
+        shp_set_error(fh, "Cannot allocate %zu bytes", size);
+        goto cleanup;
+    }
+    builder.table->num_records = 0;
+    builder.table->offsets = (uint32_t *) (builder.table + 1);
+
+    user_data = fh->user_data;
+    fh->user_data = &builder;
+    rc = shp_read(fh, handle_header, handle_record);
+    fh->user_data = user_data;
+    if (rc < 0) {
+        goto cleanup;
+    }
+
+    if (stream != NULL) {
+        rc = write_table(fh, &builder.header, builder.table, stream);
+        if (rc < 0) {
+            goto cleanup;
+        }
+    }
+
+    if (ptable != NULL) {
+        *ptable = builder.table;
+        builder.table = NULL;
+    }
+    rc = 1;
+
+cleanup:
+
+    free(builder.table);
+
+    return rc;
+}
+
+int
+shx_table_record(const shx_table_t *table, size_t record_number,
+                 shx_record_t *record)
+{
+    assert(table != NULL);
+    assert(record != NULL);
+
+    if (record_number >= table->num_records) {
+        return 0;
+    }
+
+    record->file_offset = 2 * (size_t) table->offsets[2 * record_number];
+    record->record_size = 2 * (size_t) table->offsets[2 * record_number + 1];
+    return 1;
+}
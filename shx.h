@@ -18,6 +18,7 @@
 
 #include "shp.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 /**
@@ -38,6 +39,18 @@ typedef struct shx_record_t {
  */
 typedef shp_file_t shx_file_t;
 
+/**
+ * Index records in memory
+ *
+ * The offset and the content length of the zero-based record @c i are
+ * stored in @c offsets[2*i] and @c offsets[2*i+1] in 16-bit words like in
+ * a ".shx" file, but in the machine's byte order.
+ */
+typedef struct shx_table_t {
+    size_t num_records; /**< Number of records */
+    uint32_t *offsets;  /**< Offsets and content lengths */
+} shx_table_t;
+
 /**
  * Initialize a file handle
  *
@@ -202,4 +215,98 @@ extern int shx_read_record(shx_file_t *fh, shx_record_t *record);
 extern int shx_seek_record(shx_file_t *fh, size_t record_number,
                            shx_record_t *record);
 
+/**
+ * Load an index file
+ *
+ * Reads all index records from a file that has the file extension ".shx"
+ * with a single read and keeps them in memory.  The number of records is
+ * taken from the file size in the file header.  Each record takes 8 bytes.
+ * A file that is shorter than the file header states is an error.
+ *
+ * The table is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shx_table_t *table;
+ * shx_record_t index;
+ * shp_record_t *record;
+ *
+ * if (shx_load(shx_fh, &table) > 0) {
+ *   if (shx_table_record(table, record_number, &index) > 0 &&
+ *       shp_seek_record(shp_fh, index.file_offset, &record) > 0) {
+ *     // Do something
+ *     free(record);
+ *   }
+ *   free(table);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle.
+ * @param[out] ptable on success, a pointer to a shx_table_t structure.
+ * @retval 1 on success.
+ * @retval 0 on end of file.
+ * @retval -1 on error.
+ *
+ * @see shx_table_record
+ */
+extern int shx_load(shx_file_t *fh, shx_table_t **ptable);
+
+/**
+ * Build index records from a main file
+ *
+ * Reads a file that has the file extension ".shp" sequentially and records
+ * the offset and the content length of every record.  Use this function if
+ * a dataset comes without a ".shx" file.  The file handle has to be
+ * positioned at the beginning of the file.  If a stream is given, an index
+ * file is also written so that the work does not have to be repeated.
+ *
+ * The table is allocated in a single block of memory that has to be freed
+ * with free().
+ *
+ * @b Example
+ *
+ * @code{.c}
+ * shx_table_t *table;
+ *
+ * shp_init_file(shp_fh, shp_stream, NULL);
+ * if (shx_build(shp_fh, shx_stream, &table) > 0) {
+ *   // Use table like a loaded ".shx" file
+ *   free(table);
+ * }
+ * @endcode
+ *
+ * @param fh a file handle for the ".shp" file.
+ * @param stream a file pointer that is opened for writing or NULL.
+ * @param[out] ptable on success, a pointer to a shx_table_t structure, or
+ *                    NULL if only the index file is needed.
+ * @retval 1 on success.
+ * @retval -1 on error.
+ *
+ * @see shx_load
+ */
+extern int shx_build(shp_file_t *fh, FILE *stream, shx_table_t **ptable);
+
+/**
+ * Get an index record from memory
+ *
+ * Gets an index record by record number without reading from a file.
+ *
+ * Please note that this function uses zero-based record numbers, whereas the
+ * record numbers in shapefiles begin at 1.
+ *
+ * @memberof shx_table_t
+ * @param table index records.
+ * @param record_number a zero-based record number.
+ * @param[out] record a shx_record_t structure.
+ * @retval 1 on success.
+ * @retval 0 if the record number is too big.
+ *
+ * @see shx_load
+ * @see shx_build
+ */
+extern int shx_table_record(const shx_table_t *table, size_t record_number,
+                            shx_record_t *record);
+
 #endif
@@ -6,7 +6,8 @@ use utf8;
 
 use Encode                qw(encode);
 use File::Spec::Functions qw(catfile);
-use List::Util 1.54       qw(any reduce reductions);
+use List::Util 1.54       qw(any max min reduce reductions);
+use POSIX                 qw(ceil floor);
 use Time::Piece;
 
 my $SHP_TYPE_NULL        = 0;
@@ -646,12 +647,115 @@ sub write_shp_and_shx {
     return;
 }
 
+sub scale_to_byte {
+    my ($value, $min, $max, $round) = @_;
+
+    my $byte = $round->(($value - $min) / ($max - $min) * 255);
+    return $byte < 0 ? 0 : $byte > 255 ? 255 : $byte;
+}
+
+sub write_sbn {
+    my (%args) = @_;
+
+    my $sbn_file = $args{sbn_file};
+    my $depth    = $args{depth};
+    my @boxes    = @{$args{boxes}};
+
+    my $x_min = min map { $_->[0] } @boxes;
+    my $y_min = min map { $_->[1] } @boxes;
+    my $x_max = max map { $_->[2] } @boxes;
+    my $y_max = max map { $_->[3] } @boxes;
+
+    # Put each feature into the deepest node that contains it.
+    my $num_nodes = 2**$depth - 1;
+    my @nodes     = map { [] } 1 .. $num_nodes;
+    my $record_number = 1;
+    for my $box (@boxes) {
+        my @feature = (
+            scale_to_byte($box->[0], $x_min, $x_max, \&floor),
+            scale_to_byte($box->[1], $y_min, $y_max, \&floor),
+            scale_to_byte($box->[2], $x_min, $x_max, \&ceil),
+            scale_to_byte($box->[3], $y_min, $y_max, \&ceil),
+            $record_number
+        );
+        my @range = (0, 0, 255, 255);
+        my $node  = 0;
+        for my $level (1 .. $depth - 1) {
+            my $axis = ($level - 1) % 2;
+            my $mid  = int(($range[$axis] + $range[$axis + 2]) / 2);
+            if ($feature[$axis + 2] <= $mid) {
+                $range[$axis + 2] = $mid;
+                $node = 2 * $node + 1;
+            }
+            elsif ($feature[$axis] > $mid) {
+                $range[$axis] = $mid + 1;
+                $node = 2 * $node + 2;
+            }
+            else {
+                last;
+            }
+        }
+        push @{$nodes[$node]}, \@feature;
+        ++$record_number;
+    }
+
+    # Split the features into bins of up to 100 features.
+    my $bin_index = q{};
+    my $bins      = q{};
+    my $bin_id    = 1;
+    for my $features (@nodes) {
+        my $count = @{$features};
+        $bin_index .= pack 'N N', ($count > 0 ? $bin_id : 0), $count;
+        for (my $i = 0; $i < $count; $i += 100) {
+            my @bin = @{$features}[$i .. min($i + 99, $count - 1)];
+            $bins .= pack 'N N', $bin_id, 4 * @bin;
+            $bins .= pack 'C4 N', @{$_} for @bin;
+            ++$bin_id;
+        }
+    }
+
+    my $file_length = (100 + 8 + length($bin_index) + length $bins) / 2;
+    my $header = pack 'N N x16 N N d>4 x36', 9994, -400 & 0xffffffff,
+        $file_length, scalar @boxes, $x_min, $y_min, $x_max, $y_max;
+
+    open my $sbn_fh, '>:raw', $sbn_file or die "Can't open $sbn_file: $!";
+    print {$sbn_fh} $header, pack('N N', 1, length($bin_index) / 2),
+        $bin_index, $bins;
+    close $sbn_fh;
+    return;
+}
+
 sub strptime {
     my $time = shift;
 
     return Time::Piece->strptime($time, "%Y-%m-%d %H:%M:%S");
 }
 
+# The same generator as in the tests, which regenerate the coordinates.
+sub next_random {
+    my $state = shift;
+
+    ${$state} = (${$state} * 1664525 + 1013904223) & 0xffffffff;
+    return (${$state} >> 8) / 16777216;
+}
+
+sub write_ids {
+    my ($dbf_file, $count) = @_;
+
+    write_dbf(
+        file   => $dbf_file,
+        header => {
+            fields => [{
+                name   => 'id',
+                type   => 'N',
+                length => 10,
+            }],
+        },
+        records => [map { [q{ }, $_] } 1 .. $count]
+    );
+    return;
+}
+
 #
 # types.dbf
 #
@@ -1199,6 +1303,46 @@ write_shp_and_shx(
     ]
 );
 
+#
+# nodata.shp
+#
+
+write_dbf(
+    file   => catfile(qw(data nodata.dbf)),
+    header => {
+        fields => [{
+            name   => 'id',
+            type   => 'N',
+            length => 10,
+        }],
+    },
+    records => [[q{ }, 1]]
+);
+
+write_shp_and_shx(
+    shp_file => catfile(qw(data nodata.shp)),
+    shx_file => catfile(qw(data nodata.shx)),
+    header   => {
+        type  => $SHP_TYPE_POLYLINEM,
+        x_min => 0,
+        y_min => 0,
+        x_max => 3,
+        y_max => 1,
+        m_min => 2,
+        m_max => 5,
+    },
+    shapes => [
+        {   type    => $SHP_TYPE_POLYLINEM,
+            box     => [0, 0, 3, 1],
+            m_range => [2, 5],
+            parts   => [
+                [[0, 0, -1e39], [1, 0, 2], [2, 0, -1e39], [3, 0, 5]],
+                [[3, 0, -1e39], [3, 1, -1e39]],    # no measures
+            ]
+        },
+    ]
+);
+
 #
 # polylinez.shp
 #
@@ -1342,6 +1486,19 @@ write_shp_and_shx(
     ]
 );
 
+write_sbn(
+    sbn_file => catfile(qw(data polygon.sbn)),
+    depth    => 3,
+    boxes    => [
+        [0,     0,    1,     1],
+        [0,     0,    1,     1],
+        [-126,  33,   -114,  49],
+        [23.45, 3.49, 35.95, 12.24],
+        [21.81, 8.69, 39.06, 22.22],
+        [10,    59,   11,    60],
+    ]
+);
+
 #
 # polygonm.shp
 #
@@ -1540,3 +1697,337 @@ write_shp_and_shx(
         },
     ]
 );
+
+#
+# islands.shp
+#
+
+write_dbf(
+    file   => catfile(qw(data islands.dbf)),
+    header => {
+        fields => [{
+            name   => 'id',
+            type   => 'N',
+            length => 10,
+        }],
+    },
+    records => [[q{ }, 1]]
+);
+
+write_shp_and_shx(
+    shp_file => catfile(qw(data islands.shp)),
+    shx_file => catfile(qw(data islands.shx)),
+    header   => {
+        type  => $SHP_TYPE_POLYGON,
+        x_min => 0,
+        y_min => 0,
+        x_max => 42,
+        y_max => 10,
+    },
+    shapes => [
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 42, 10],
+            parts => [
+                [[0,  0], [0,  10], [10, 10], [10, 0], [0,  0]],    # outer
+                [[20, 0], [20, 10], [30, 10], [30, 0], [20, 0]],    # outer
+                [[2,  2], [8,  2],  [8,  8],  [2,  8], [2,  2]],    # hole
+                [[4,  4], [4,  6],  [6,  6],  [6,  4], [4,  4]],    # island
+                [[22, 2], [24, 2],  [24, 4],  [22, 4], [22, 2]],    # hole
+                [[40, 0], [42, 0],  [42, 2],  [40, 2], [40, 0]],    # orphan
+            ]
+        },
+    ]
+);
+
+#
+# patches.shp
+#
+
+write_dbf(
+    file   => catfile(qw(data patches.dbf)),
+    header => {
+        fields => [{
+            name   => 'id',
+            type   => 'N',
+            length => 10,
+        }],
+    },
+    records => [[q{ }, 1]]
+);
+
+write_shp_and_shx(
+    shp_file => catfile(qw(data patches.shp)),
+    shx_file => catfile(qw(data patches.shx)),
+    header   => {
+        type  => $SHP_TYPE_MULTIPATCH,
+        x_min => 0,
+        y_min => 0,
+        x_max => 4,
+        y_max => 5,
+        z_min => 0,
+        z_max => 2,
+        m_min => 0,
+        m_max => 0,
+    },
+    shapes => [
+        {   type       => $SHP_TYPE_MULTIPATCH,
+            box        => [0, 0, 4, 5],
+            z_range    => [0, 2],
+            m_range    => [0, 0],
+            part_types => [
+                $SHP_PART_TYPE_TRIANGLE_STRIP, $SHP_PART_TYPE_TRIANGLE_FAN,
+                $SHP_PART_TYPE_OUTER_RING,     $SHP_PART_TYPE_INNER_RING,
+                $SHP_PART_TYPE_FIRST_RING,     $SHP_PART_TYPE_RING,
+                $SHP_PART_TYPE_RING,
+            ],
+            parts => [
+                [   [0, 0, 0, 0],
+                    [1, 0, 0, 0],
+                    [0, 1, 0, 0],
+                    [1, 1, 0, 0]
+                ],
+                [   [1, 0, 0, 0],
+                    [2, 0, 0, 0],
+                    [2, 1, 0, 0],
+                    [1, 1, 0, 0]
+                ],
+                [   [0, 0, 1, 0],
+                    [0, 4, 1, 0],
+                    [4, 4, 1, 0],
+                    [4, 0, 1, 0],
+                    [0, 0, 1, 0]
+                ],
+                [   [1, 1, 1, 0],
+                    [3, 1, 1, 0],
+                    [3, 3, 1, 0],
+                    [1, 3, 1, 0],
+                    [1, 1, 1, 0]
+                ],
+                [   [0, 5, 0, 0],
+                    [0, 5, 2, 0],
+                    [2, 5, 2, 0],
+                    [2, 5, 0, 0],
+                    [0, 5, 0, 0]
+                ],
+                [   [0.5, 5, 0.5, 0],
+                    [1.5, 5, 0.5, 0],
+                    [1.5, 5, 1.5, 0],
+                    [0.5, 5, 1.5, 0],
+                    [0.5, 5, 0.5, 0]
+                ],
+                [   [3, 5, 0, 0],
+                    [3, 5, 1, 0],
+                    [4, 5, 1, 0],
+                    [4, 5, 0, 0],
+                    [3, 5, 0, 0]
+                ],
+            ]
+        },
+    ]
+);
+
+#
+# invalid.shp
+#
+
+write_dbf(
+    file   => catfile(qw(data invalid.dbf)),
+    header => {
+        fields => [{
+            name   => 'id',
+            type   => 'N',
+            length => 10,
+        }],
+    },
+    records => [[q{ }, 1], [q{ }, 2], [q{ }, 3], [q{ }, 4], [q{ }, 5],
+        [q{ }, 6], [q{ }, 7], [q{ }, 8]]
+);
+
+write_shp_and_shx(
+    shp_file => catfile(qw(data invalid.shp)),
+    shx_file => catfile(qw(data invalid.shx)),
+    header   => {
+        type  => $SHP_TYPE_POLYGON,
+        x_min => 0,
+        y_min => 0,
+        x_max => 15,
+        y_max => 10,
+    },
+    shapes => [
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 1, 1],
+            parts => [
+                [[0, 0], [0, 1], [1, 0], [1, 1], [0, 0]],    # bowtie
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 1, 1],
+            parts => [
+                [[0, 0], [0, 1], [1, 1], [1, 0]],    # unclosed
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 1, 1],
+            parts => [
+                [[0, 0], [0, 1], [0, 1], [1, 1], [1, 0], [0, 0]],
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 3, 3],
+            parts => [
+                [[0, 0], [0, 2], [2, 2], [2, 0], [0, 0]],
+                [[1, 1], [1, 3], [3, 3], [3, 1], [1, 1]],
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 2, 1],
+            parts => [
+                [[0, 0], [0, 1], [1, 1], [1, 0], [2, 0], [1, 0], [0, 0]],
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 2, 2],
+            parts => [
+                [[0, 0], [0, 1], [1, 1], [1, 0], [0, 0]],    # touching
+                [[1, 1], [1, 2], [2, 2], [2, 1], [1, 1]],
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 15, 10],
+            parts => [
+                [[0, 0], [0, 10], [10, 10], [10, 0], [0, 0]],
+                [[5, 5], [10, 7], [15, 5], [10, 3], [5, 5]],    # crosses
+            ]
+        },
+        {   type  => $SHP_TYPE_POLYGON,
+            box   => [0, 0, 2, 2],
+            parts => [
+                [[0, 0], [0, 2], [1, 1], [2, 2], [2, 0], [1, 1], [0, 0]],
+            ]
+        },
+    ]
+);
+
+#
+# boxes.shp
+#
+
+{
+    my $state = 1;
+    my @boxes;
+    for (1 .. 1000) {
+        my $x = 100 * next_random(\$state);
+        my $y = 100 * next_random(\$state);
+        push @boxes,
+            [$x, $y, $x + 5 * next_random(\$state),
+            $y + 5 * next_random(\$state)];
+    }
+
+    write_ids(catfile(qw(data boxes.dbf)), scalar @boxes);
+
+    write_shp_and_shx(
+        shp_file => catfile(qw(data boxes.shp)),
+        shx_file => catfile(qw(data boxes.shx)),
+        header   => {
+            type  => $SHP_TYPE_MULTIPOINT,
+            x_min => min(map { $_->[0] } @boxes),
+            y_min => min(map { $_->[1] } @boxes),
+            x_max => max(map { $_->[2] } @boxes),
+            y_max => max(map { $_->[3] } @boxes),
+        },
+        shapes => [
+            map {
+                {   type   => $SHP_TYPE_MULTIPOINT,
+                    box    => $_,
+                    points => [[$_->[0], $_->[1]], [$_->[2], $_->[3]]],
+                }
+            } @boxes
+        ]
+    );
+}
+
+#
+# scatter.shp
+#
+
+{
+    my $state = 1;
+    my @points;
+    for (1 .. 2000) {
+        push @points,
+            [100 * next_random(\$state), 50 * next_random(\$state)];
+    }
+
+    write_ids(catfile(qw(data scatter.dbf)), scalar @points);
+
+    write_shp_and_shx(
+        shp_file => catfile(qw(data scatter.shp)),
+        shx_file => catfile(qw(data scatter.shx)),
+        header   => {
+            type  => $SHP_TYPE_POINT,
+            x_min => min(map { $_->[0] } @points),
+            y_min => min(map { $_->[1] } @points),
+            x_max => max(map { $_->[0] } @points),
+            y_max => max(map { $_->[1] } @points),
+        },
+        shapes => [
+            map { {type => $SHP_TYPE_POINT, point => $_} } @points
+        ]
+    );
+}
+
+#
+# triangles.shp
+#
+
+{
+    my $state = 1;
+    my @triangles;
+    for (1 .. 1000) {
+        my $x = 100 * next_random(\$state);
+        my $y = 100 * next_random(\$state);
+        my $z = 10 * next_random(\$state);
+        push @triangles, [
+            map {
+                [   $x + 4 * next_random(\$state),
+                    $y + 4 * next_random(\$state),
+                    $z + 4 * next_random(\$state), 0
+                ]
+            } 1 .. 3
+        ];
+    }
+
+    my @points = map { @{$_} } @triangles;
+
+    write_ids(catfile(qw(data triangles.dbf)), scalar @triangles);
+
+    write_shp_and_shx(
+        shp_file => catfile(qw(data triangles.shp)),
+        shx_file => catfile(qw(data triangles.shx)),
+        header   => {
+            type  => $SHP_TYPE_MULTIPATCH,
+            x_min => min(map { $_->[0] } @points),
+            y_min => min(map { $_->[1] } @points),
+            x_max => max(map { $_->[0] } @points),
+            y_max => max(map { $_->[1] } @points),
+            z_min => min(map { $_->[2] } @points),
+            z_max => max(map { $_->[2] } @points),
+        },
+        shapes => [
+            map {
+                my @p = @{$_};
+                {   type       => $SHP_TYPE_MULTIPATCH,
+                    box        => [
+                        min(map { $_->[0] } @p), min(map { $_->[1] } @p),
+                        max(map { $_->[0] } @p), max(map { $_->[1] } @p)
+                    ],
+                    z_range    => [
+                        min(map { $_->[2] } @p), max(map { $_->[2] } @p)
+                    ],
+                    part_types => [$SHP_PART_TYPE_TRIANGLE_STRIP],
+                    parts      => [\@p],
+                }
+            } @triangles
+        ]
+    );
+}
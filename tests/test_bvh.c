@@ -0,0 +1,292 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_TRIANGLES 1000
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_bvh_t *cube;
+
+static int
+read_bvh(FILE *stream, shp_bvh_t **pbvh)
+{
+    shp_file_t fh;
+    int rc;
+
+    shp_init_file(&fh, stream, NULL);
+    rc = shp_bvh_read(&fh, pbvh);
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file: %s\n", fh.error);
+    }
+
+    return rc;
+}
+
+static int
+read_file(const char *filename, shp_bvh_t **pbvh)
+{
+    FILE *stream;
+    int rc;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    rc = read_bvh(stream, pbvh);
+
+    fclose(stream);
+
+    return rc;
+}
+
+static double
+next_random(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return (double) (*state >> 8) / 16777216.0;
+}
+
+static int
+count_triangle(const shp_bvh_t *bvh, size_t triangle_num, void *user_data)
+{
+    size_t *count = (size_t *) user_data;
+
+    (void) bvh;
+    (void) triangle_num;
+    ++*count;
+    return 1;
+}
+
+static int
+stop_query(const shp_bvh_t *bvh, size_t triangle_num, void *user_data)
+{
+    (void) bvh;
+    (void) triangle_num;
+    (void) user_data;
+    return 0;
+}
+
+static size_t
+count_box(const shp_bvh_t *bvh, double x_min, double y_min, double z_min,
+          double x_max, double y_max, double z_max)
+{
+    double box_min[3], box_max[3];
+    size_t count = 0;
+
+    box_min[0] = x_min;
+    box_min[1] = y_min;
+    box_min[2] = z_min;
+    box_max[0] = x_max;
+    box_max[1] = y_max;
+    box_max[2] = z_max;
+    shp_bvh_box(bvh, box_min, box_max, count_triangle, &count);
+    return count;
+}
+
+static int
+test_cube(void)
+{
+    size_t i;
+
+    if (cube->num_triangles != 12 || cube->num_nodes == 0) {
+        return 0;
+    }
+    for (i = 0; i < cube->num_triangles; ++i) {
+        if (cube->triangles[i].record_number != 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+test_ray(void)
+{
+    const double above[3] = {0.5, 0.5, 5.0};
+    const double inside[3] = {0.25, 0.5, 0.75};
+    const double down[3] = {0.0, 0.0, -1.0};
+    const double up[3] = {0.0, 0.0, 1.0};
+    const double side[3] = {-1.0, 0.0, 0.0};
+    shp_hit_t hit;
+    const shp_triangle_t *triangle;
+
+    /* The top face is hit first */
+    if (shp_bvh_ray(cube, above, down, HUGE_VAL, &hit) != 1 ||
+        fabs(hit.t - 4.0) > 1e-9) {
+        return 0;
+    }
+    triangle = &cube->triangles[hit.triangle_num];
+    if (triangle->points[0].z != 1.0 || triangle->points[1].z != 1.0 ||
+        triangle->points[2].z != 1.0) {
+        return 0;
+    }
+
+    /* The ray is too short */
+    if (shp_bvh_ray(cube, above, down, 3.5, &hit) != 0) {
+        return 0;
+    }
+
+    /* The ray points away from the cube */
+    if (shp_bvh_ray(cube, above, up, HUGE_VAL, &hit) != 0) {
+        return 0;
+    }
+
+    /* The faces are hit from the inside */
+    return shp_bvh_ray(cube, inside, side, HUGE_VAL, &hit) == 1 &&
+           fabs(hit.t - 0.25) < 1e-9;
+}
+
+static int
+test_box(void)
+{
+    const double box_min[3] = {-1.0, -1.0, -1.0};
+    const double box_max[3] = {2.0, 2.0, 2.0};
+
+    /* Both triangles of the top face touch its center */
+    if (count_box(cube, 0.4, 0.4, 0.9, 0.6, 0.6, 1.1) != 2) {
+        return 0;
+    }
+
+    /* The box is inside the cube */
+    if (count_box(cube, 0.2, 0.2, 0.2, 0.8, 0.8, 0.8) != 0) {
+        return 0;
+    }
+
+    /* Only one triangle of the left face overlaps the box */
+    if (count_box(cube, -0.01, 0.08, 0.01, 0.01, 0.12, 0.04) != 1) {
+        return 0;
+    }
+
+    return count_box(cube, -1.0, -1.0, -1.0, 2.0, 2.0, 2.0) == 12 &&
+           shp_bvh_box(cube, box_min, box_max, stop_query, NULL) == 0;
+}
+
+static int
+intersect(const shp_pointz_t *triangle, const double origin[3],
+          const double direction[3], double *t)
+{
+    double e1[3], e2[3], p[3], q[3], s[3], det, u, v;
+
+    e1[0] = triangle[1].x - triangle[0].x;
+    e1[1] = triangle[1].y - triangle[0].y;
+    e1[2] = triangle[1].z - triangle[0].z;
+    e2[0] = triangle[2].x - triangle[0].x;
+    e2[1] = triangle[2].y - triangle[0].y;
+    e2[2] = triangle[2].z - triangle[0].z;
+    p[0] = direction[1] * e2[2] - direction[2] * e2[1];
+    p[1] = direction[2] * e2[0] - direction[0] * e2[2];
+    p[2] = direction[0] * e2[1] - direction[1] * e2[0];
+    det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (det == 0.0) {
+        return 0;
+    }
+    s[0] = origin[0] - triangle[0].x;
+    s[1] = origin[1] - triangle[0].y;
+    s[2] = origin[2] - triangle[0].z;
+    u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+    q[0] = s[1] * e1[2] - s[2] * e1[1];
+    q[1] = s[2] * e1[0] - s[0] * e1[2];
+    q[2] = s[0] * e1[1] - s[1] * e1[0];
+    v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) /
+        det;
+    *t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+    return u >= 0.0 && v >= 0.0 && u + v <= 1.0 && *t > 0.0;
+}
+
+static int
+test_random(void)
+{
+    static shp_pointz_t triangles[NUM_TRIANGLES][3];
+    shp_bvh_t *bvh = NULL;
+    shp_hit_t hit;
+    double origin[3], direction[3], x, y, z, t, best_t;
+    uint32_t state = 1;
+    size_t i, j, best;
+    int found, ok = 0;
+
+    for (i = 0; i < NUM_TRIANGLES; ++i) {
+        x = 100.0 * next_random(&state);
+        y = 100.0 * next_random(&state);
+        z = 10.0 * next_random(&state);
+        for (j = 0; j < 3; ++j) {
+            triangles[i][j].x = x + 4.0 * next_random(&state);
+            triangles[i][j].y = y + 4.0 * next_random(&state);
+            triangles[i][j].z = z + 4.0 * next_random(&state);
+            triangles[i][j].m = 0.0;
+        }
+    }
+
+    /* The triangles in triangles.shp are drawn from the same sequence */
+    if (read_file("triangles.shp", &bvh) > 0 &&
+        bvh->num_triangles == NUM_TRIANGLES) {
+        ok = 1;
+        for (i = 0; ok && i < 1000; ++i) {
+            origin[0] = 100.0 * next_random(&state);
+            origin[1] = 100.0 * next_random(&state);
+            origin[2] = 20.0 * next_random(&state);
+            direction[0] = next_random(&state) - 0.5;
+            direction[1] = next_random(&state) - 0.5;
+            direction[2] = next_random(&state) - 0.5;
+
+            best = NUM_TRIANGLES;
+            best_t = HUGE_VAL;
+            for (j = 0; j < NUM_TRIANGLES; ++j) {
+                if (intersect(triangles[j], origin, direction, &t) &&
+                    t < best_t) {
+                    best = j;
+                    best_t = t;
+                }
+            }
+
+            found = shp_bvh_ray(bvh, origin, direction, HUGE_VAL, &hit);
+            if (best == NUM_TRIANGLES) {
+                ok = !found;
+            }
+            else {
+                ok = found &&
+                     bvh->triangles[hit.triangle_num].record_number ==
+                         best + 1 &&
+                     fabs(hit.t - best_t) < 1e-9;
+            }
+        }
+    }
+
+    free(bvh);
+
+    return ok;
+}
+
+static int
+test_polygon(void)
+{
+    shp_bvh_t *bvh;
+
+    return read_file("polygon.shp", &bvh) == -1 && bvh == NULL;
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    if (read_file("multipatch.shp", &cube) > 0) {
+        ok(test_cube, "cube is split into triangles");
+        ok(test_ray, "rays hit the nearest triangle");
+        ok(test_box, "box queries find triangles");
+        free(cube);
+    }
+    ok(test_random, "rays hit the same triangles as a linear search");
+    ok(test_polygon, "polygons are rejected");
+
+    done_testing();
+}
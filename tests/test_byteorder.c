@@ -1,6 +1,7 @@
 #include "../byteorder.h"
 #include "tap.h"
 #include <float.h>
+#include <string.h>
 
 #define SUNDAY 0
 #define MONDAY 1
@@ -51,22 +52,59 @@ test_le64_to_int64(void)
            -8589934592LL;
 }
 
+static int
+test_be64_to_double(void)
+{
+    return shp_be64_to_double("\x7f\xef\xff\xff\xff\xff\xff\xff") == DBL_MAX;
+}
+
 static int
 test_le64_to_double(void)
 {
     return shp_le64_to_double("\xff\xff\xff\xff\xff\xff\xef\x7f") == DBL_MAX;
 }
 
+static int
+test_uint32_to_be32(void)
+{
+    char buf[4];
+
+    shp_uint32_to_be32(4294967294U, buf);
+    return memcmp(buf, "\xff\xff\xff\xfe", 4) == 0;
+}
+
+static int
+test_uint32_to_le32(void)
+{
+    char buf[4];
+
+    shp_uint32_to_le32(4294967294U, buf);
+    return memcmp(buf, "\xfe\xff\xff\xff", 4) == 0;
+}
+
+static int
+test_double_to_le64(void)
+{
+    char buf[8];
+
+    shp_double_to_le64(DBL_MAX, buf);
+    return memcmp(buf, "\xff\xff\xff\xff\xff\xff\xef\x7f", 8) == 0;
+}
+
 int
 main(void)
 {
-    plan(7);
+    plan(11);
     ok(test_le16_to_uint16, "test shp_le16_to_uint16");
     ok(test_be32_to_int32, "test shp_be32_to_int32");
     ok(test_le32_to_int32, "test shp_le32_to_int32");
     ok(test_be32_to_uint32, "test shp_be32_to_uint32");
     ok(test_le32_to_uint32, "test shp_le32_to_uint32");
     ok(test_le64_to_int64, "test shp_le64_to_int64");
+    ok(test_be64_to_double, "test shp_be64_to_double");
     ok(test_le64_to_double, "test shp_le64_to_double");
+    ok(test_uint32_to_be32, "test shp_uint32_to_be32");
+    ok(test_uint32_to_le32, "test shp_uint32_to_le32");
+    ok(test_double_to_le64, "test shp_double_to_le64");
     done_testing();
 }
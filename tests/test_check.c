@@ -0,0 +1,231 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *polygon_records[2];
+shp_record_t *islands_records[1];
+shp_record_t *invalid_records[8];
+
+#define NUM_TEETH 200
+
+char comb_parts[4];
+char comb_points[16 * (NUM_TEETH + 3)];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static void
+put_point(size_t point_num, double x, double y)
+{
+    shp_double_to_le64(x, &comb_points[16 * point_num]);
+    shp_double_to_le64(y, &comb_points[16 * point_num + 8]);
+}
+
+static int
+is_valid(const shp_record_t *record)
+{
+    shp_problem_t problem;
+    return shp_polygon_check(&record->shape.polygon, &problem) == 1 &&
+           problem.type == SHP_PROBLEM_NONE;
+}
+
+static int
+has_problem(const shp_record_t *record, shp_problem_type_t type,
+            size_t part_num, size_t point_num)
+{
+    shp_problem_t problem;
+    return shp_polygon_check(&record->shape.polygon, &problem) == 0 &&
+           problem.type == type && problem.part_num == part_num &&
+           problem.point_num == point_num;
+}
+
+static int
+test_valid_polygons(void)
+{
+    return is_valid(polygon_records[0]) && is_valid(polygon_records[1]) &&
+           is_valid(islands_records[0]);
+}
+
+static int
+test_touching_rings(void)
+{
+    return is_valid(invalid_records[5]);
+}
+
+static int
+test_self_intersection(void)
+{
+    shp_problem_t problem;
+    return shp_polygon_check(&invalid_records[0]->shape.polygon,
+                             &problem) == 0 &&
+           problem.type == SHP_PROBLEM_SELF_INTERSECTION &&
+           problem.part_num == 0 && problem.point_num == 1 &&
+           problem.other_part_num == 0 && problem.other_point_num == 3;
+}
+
+static int
+test_unclosed_ring(void)
+{
+    return has_problem(invalid_records[1], SHP_PROBLEM_UNCLOSED_RING, 0, 3);
+}
+
+static int
+test_duplicate_point(void)
+{
+    return has_problem(invalid_records[2], SHP_PROBLEM_DUPLICATE_POINT, 0,
+                       2);
+}
+
+static int
+test_crossing_rings(void)
+{
+    shp_problem_t problem;
+    return shp_polygon_check(&invalid_records[3]->shape.polygon,
+                             &problem) == 0 &&
+           problem.type == SHP_PROBLEM_CROSSING_RINGS &&
+           problem.part_num == 0 && problem.other_part_num == 1;
+}
+
+static int
+test_crossing_at_vertices(void)
+{
+    /* The diamond's vertices are on the square's right edge */
+    shp_problem_t problem;
+    return shp_polygon_check(&invalid_records[6]->shape.polygon,
+                             &problem) == 0 &&
+           problem.type == SHP_PROBLEM_CROSSING_RINGS &&
+           problem.part_num == 0 && problem.point_num == 2 &&
+           problem.other_part_num == 1 && problem.other_point_num == 8;
+}
+
+static int
+test_self_touching_ring(void)
+{
+    return has_problem(invalid_records[7], SHP_PROBLEM_SELF_INTERSECTION, 0,
+                       2);
+}
+
+static int
+test_overlapping_segments(void)
+{
+    shp_problem_t problem;
+    return shp_polygon_check(&invalid_records[4]->shape.polygon,
+                             &problem) == 0 &&
+           problem.type == SHP_PROBLEM_SELF_INTERSECTION &&
+           problem.point_num == 3 && problem.other_point_num == 4;
+}
+
+static int
+test_many_segments(void)
+{
+    shp_polygon_t polygon;
+    shp_problem_t problem;
+    size_t i;
+    int rc;
+
+    /* A comb whose teeth point upwards */
+    memset(comb_parts, 0, sizeof(comb_parts));
+    for (i = 0; i < NUM_TEETH; ++i) {
+        put_point(i, (double) i, (double) (1 + i % 2));
+    }
+    put_point(NUM_TEETH, NUM_TEETH - 1, 0.0);
+    put_point(NUM_TEETH + 1, 0.0, 0.0);
+    put_point(NUM_TEETH + 2, 0.0, 1.0);
+
+    polygon.x_min = 0.0;
+    polygon.x_max = NUM_TEETH - 1;
+    polygon.y_min = 0.0;
+    polygon.y_max = 2.0;
+    polygon.num_parts = 1;
+    polygon.num_points = NUM_TEETH + 3;
+    polygon.parts = comb_parts;
+    polygon.points = comb_points;
+
+    rc = shp_polygon_check(&polygon, &problem);
+    if (rc != 1) {
+        return 0;
+    }
+
+    /* Let a tooth cross the bottom edge */
+    put_point(100, 100.0, -1.0);
+    polygon.y_min = -1.0;
+
+    rc = shp_polygon_check(&polygon, &problem);
+    return rc == 0 && problem.type == SHP_PROBLEM_SELF_INTERSECTION &&
+           (problem.point_num == 99 || problem.point_num == 100) &&
+           problem.other_point_num == NUM_TEETH;
+}
+
+int
+main(void)
+{
+    size_t i;
+
+    plan(10);
+
+    if (read_records("polygon.shp", polygon_records, 2) <= 0 ||
+        read_records("islands.shp", islands_records, 1) <= 0 ||
+        read_records("invalid.shp", invalid_records, 8) <= 0) {
+        return 1;
+    }
+
+    ok(test_valid_polygons, "valid polygons are accepted");
+    ok(test_touching_rings, "rings may touch in a point");
+    ok(test_self_intersection, "self-intersection is found");
+    ok(test_unclosed_ring, "unclosed ring is found");
+    ok(test_duplicate_point, "duplicate point is found");
+    ok(test_crossing_rings, "crossing rings are found");
+    ok(test_crossing_at_vertices, "rings crossing at vertices are found");
+    ok(test_self_touching_ring, "ring touching itself is found");
+    ok(test_overlapping_segments, "overlapping segments are found");
+    ok(test_many_segments, "intersection in a long ring is found");
+
+    for (i = 0; i < 2; ++i) {
+        free(polygon_records[i]);
+    }
+    free(islands_records[0]);
+    for (i = 0; i < 8; ++i) {
+        free(invalid_records[i]);
+    }
+
+    done_testing();
+}
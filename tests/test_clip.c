@@ -0,0 +1,235 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *polyline_records[2];
+shp_record_t *polygon_records[2];
+
+size_t parts[16];
+shp_point_t points[64];
+shp_buffer_t buffer;
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+point_equals(size_t i, double x, double y)
+{
+    return points[i].x == x && points[i].y == y;
+}
+
+static int
+part_equals(size_t part_num, size_t size)
+{
+    size_t start, end;
+    return shp_buffer_points(&buffer, part_num, &start, &end) == size;
+}
+
+static double
+ring_area(size_t part_num)
+{
+    size_t i, start, end;
+    double sum = 0.0;
+
+    shp_buffer_points(&buffer, part_num, &start, &end);
+    for (i = start; i + 1 < end; ++i) {
+        sum += points[i].x * points[i + 1].y - points[i + 1].x * points[i].y;
+    }
+    return sum / 2.0;
+}
+
+/*
+ * PolyLine tests
+ */
+
+static int
+test_crossing_lines(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    return shp_polyline_clip(polyline, 1.5, 1.5, 2.5, 2.5, &buffer) == 1 &&
+           buffer.num_parts == 2 && buffer.num_points == 4 &&
+           point_equals(0, 1.5, 1.5) && point_equals(1, 2.5, 2.5) &&
+           point_equals(2, 1.5, 2.5) && point_equals(3, 2.5, 1.5);
+}
+
+static int
+test_line_enters_and_leaves(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[1]->shape.polyline;
+    return shp_polyline_clip(polyline, 1.5, 1.5, 3.0, 2.5, &buffer) == 1 &&
+           buffer.num_parts == 2 && part_equals(0, 3) &&
+           point_equals(0, 1.5, 2.0) && point_equals(1, 2.0, 2.0) &&
+           point_equals(2, 2.0, 2.5) && part_equals(1, 3) &&
+           point_equals(3, 2.0, 1.5) && point_equals(4, 2.0, 2.0) &&
+           point_equals(5, 3.0, 2.0);
+}
+
+static int
+test_line_outside(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    return shp_polyline_clip(polyline, 5.0, 5.0, 6.0, 6.0, &buffer) == 1 &&
+           buffer.num_parts == 0 && buffer.num_points == 0;
+}
+
+static int
+test_buffer_too_small(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[1]->shape.polyline;
+    shp_buffer_t small;
+    shp_buffer_init(&small, parts, 1, points, 2);
+    return shp_polyline_clip(polyline, 0.0, 0.0, 4.0, 4.0, &small) == 0 &&
+           small.num_parts == 2 && small.num_points == 6 &&
+           shp_buffer_is_complete(&small) == 0;
+}
+
+static int
+test_line_tiles(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    const shp_grid_t grid = {1.0, 1.0, 1.0, 1.0, 2, 2};
+    shp_cell_t cells[4], tile = {1, 0};
+    shp_polyline_cells(polyline, &grid, cells);
+    return cells[0].col == 0 && cells[0].row == 0 && cells[1].col == 2 &&
+           cells[1].row == 2 &&
+           shp_polyline_clip_cell(polyline, &grid, cells, &tile, &buffer) ==
+               1 &&
+           buffer.num_parts == 1 && point_equals(0, 2.0, 2.0) &&
+           point_equals(1, 3.0, 1.0);
+}
+
+/*
+ * Polygon tests
+ */
+
+static int
+test_rectangle_corner(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    size_t start, end;
+    return shp_polygon_clip(polygon, 0.5, 0.5, 1.0, 1.0, &buffer) == 1 &&
+           buffer.num_parts == 1 &&
+           shp_buffer_points(&buffer, 0, &start, &end) == 5 &&
+           points[start].x == points[end - 1].x &&
+           points[start].y == points[end - 1].y &&
+           ring_area(0) < -0.0899 && ring_area(0) > -0.0901;
+}
+
+static int
+test_rectangle_inside(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    return shp_polygon_clip(polygon, 0.0, 0.0, 1.0, 1.0, &buffer) == 1 &&
+           buffer.num_parts == 1 && buffer.num_points == 5 &&
+           point_equals(0, 0.2, 0.2) && point_equals(2, 0.8, 0.8);
+}
+
+static int
+test_box_inside_rectangle(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    return shp_polygon_clip(polygon, 0.4, 0.4, 0.6, 0.6, &buffer) == 1 &&
+           buffer.num_parts == 1 && buffer.num_points == 5 &&
+           ring_area(0) < -0.0399 && ring_area(0) > -0.0401;
+}
+
+static int
+test_triangle_with_hole(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[1]->shape.polygon;
+    return shp_polygon_clip(polygon, 0.0, 0.0, 0.5, 1.0, &buffer) == 1 &&
+           buffer.num_parts == 2 && ring_area(0) < 0.0 &&
+           ring_area(1) < 0.0;
+}
+
+static int
+test_polygon_tiles(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    const shp_grid_t grid = {0.0, 0.0, 0.5, 0.5, 2, 2};
+    shp_cell_t cells[5], tile;
+    double area;
+    int rc = 1;
+
+    shp_polygon_cells(polygon, &grid, cells);
+    for (tile.row = 0; tile.row < 2; ++tile.row) {
+        for (tile.col = 0; tile.col < 2; ++tile.col) {
+            rc = rc && shp_polygon_clip_cell(polygon, &grid, cells, &tile,
+                                             &buffer) == 1;
+            rc = rc && buffer.num_parts == 1;
+            area = ring_area(0);
+            rc = rc && area < -0.0899 && area > -0.0901;
+        }
+    }
+    return rc;
+}
+
+int
+main(void)
+{
+    size_t i;
+
+    plan(10);
+
+    if (read_records("polyline.shp", polyline_records, 2) <= 0 ||
+        read_records("polygon.shp", polygon_records, 2) <= 0) {
+        return 1;
+    }
+
+    shp_buffer_init(&buffer, parts, 16, points, 64);
+
+    ok(test_crossing_lines, "crossing lines are clipped");
+    ok(test_line_enters_and_leaves, "line enters and leaves the box");
+    ok(test_line_outside, "line outside the box is removed");
+    ok(test_buffer_too_small, "required buffer size is returned");
+    ok(test_line_tiles, "line is clipped to tile");
+    ok(test_rectangle_corner, "rectangle is clipped");
+    ok(test_rectangle_inside, "rectangle inside the box is kept");
+    ok(test_box_inside_rectangle, "box inside the rectangle is returned");
+    ok(test_triangle_with_hole, "triangle with hole is clipped");
+    ok(test_polygon_tiles, "rectangle is clipped to tiles");
+
+    for (i = 0; i < 2; ++i) {
+        free(polyline_records[i]);
+        free(polygon_records[i]);
+    }
+
+    done_testing();
+}
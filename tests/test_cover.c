@@ -0,0 +1,272 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *point_records[1];
+shp_record_t *multipoint_records[1];
+shp_record_t *polygon_records[3];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+/*
+ * Fills a PolyLine or polygon.  The parts and points buffers must have room
+ * for the part indices and coordinates.
+ */
+static void
+make_record(shp_record_t *record, shp_type_t type, const size_t *parts,
+            size_t num_parts, const double *xy, size_t num_points,
+            char *parts_buf, char *points_buf)
+{
+    shp_polyline_t *polyline = &record->shape.polyline;
+    size_t i;
+
+    for (i = 0; i < num_parts; ++i) {
+        shp_uint32_to_le32((uint32_t) parts[i], &parts_buf[4 * i]);
+    }
+    for (i = 0; i < 2 * num_points; ++i) {
+        shp_double_to_le64(xy[i], &points_buf[8 * i]);
+    }
+
+    /* PolyLines and polygons have the same layout */
+    memset(record, 0, sizeof(*record));
+    record->record_number = 1;
+    record->type = type;
+    polyline->num_parts = num_parts;
+    polyline->num_points = num_points;
+    polyline->parts = parts_buf;
+    polyline->points = points_buf;
+}
+
+static int
+keys_equal(const shp_cover_t *cover, const char *const *keys, size_t n)
+{
+    size_t i;
+
+    if (cover->num_keys != n) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        if (strcmp(cover->keys + i * cover->key_size, keys[i]) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+test_point(void)
+{
+    const char *geohash[] = {"u0t94"};
+    const char *quadkey[] = {"1202210132"};
+    shp_cover_t *cover;
+    int ok;
+
+    if (shp_record_cover(point_records[0], SHP_COVER_GEOHASH, 5, &cover) !=
+        1) {
+        return 0;
+    }
+    ok = cover->key_size == 6 && keys_equal(cover, geohash, 1);
+    free(cover);
+    if (!ok) {
+        return 0;
+    }
+
+    if (shp_record_cover(point_records[0], SHP_COVER_QUADKEY, 10, &cover) !=
+        1) {
+        return 0;
+    }
+    ok = keys_equal(cover, quadkey, 1);
+    free(cover);
+    return ok;
+}
+
+static int
+test_multipoint(void)
+{
+    const char *keys[] = {"u0wmqv", "u0wmqy"};
+    shp_cover_t *cover;
+    int ok;
+
+    if (shp_record_cover(multipoint_records[0], SHP_COVER_GEOHASH, 6,
+                         &cover) != 1) {
+        return 0;
+    }
+    ok = keys_equal(cover, keys, 2);
+    free(cover);
+    return ok;
+}
+
+static int
+test_polygon(void)
+{
+    const char *geohash[] = {"9", "c"};
+    const char *quadkey[] = {"02"};
+    const shp_record_t *record = polygon_records[2];
+    shp_cover_t *cover;
+    int ok;
+
+    /* Los Angeles is in the cells 9 and c */
+    if (shp_record_cover(record, SHP_COVER_GEOHASH, 1, &cover) != 1) {
+        return 0;
+    }
+    ok = keys_equal(cover, geohash, 2);
+    free(cover);
+    if (!ok) {
+        return 0;
+    }
+
+    if (shp_record_cover(record, SHP_COVER_QUADKEY, 2, &cover) != 1) {
+        return 0;
+    }
+    ok = keys_equal(cover, quadkey, 1);
+    free(cover);
+    return ok;
+}
+
+static int
+test_triangle(void)
+{
+    /* The bounding box overlaps four cells but the triangle only three */
+    const size_t parts[] = {0};
+    const double xy[] = {0.5, 0.5, 0.5, 10.0, 21.0, 0.5, 0.5, 0.5};
+    const char *keys[] = {"s0", "s1", "s2"};
+    char parts_buf[4], points_buf[16 * 4];
+    shp_record_t record;
+    shp_cover_t *cover;
+    int ok;
+
+    make_record(&record, SHP_TYPE_POLYGON, parts, 1, xy, 4, parts_buf,
+                points_buf);
+    if (shp_record_cover(&record, SHP_COVER_GEOHASH, 2, &cover) != 1) {
+        return 0;
+    }
+    ok = keys_equal(cover, keys, 3);
+    free(cover);
+    return ok;
+}
+
+static int
+test_hole(void)
+{
+    /* The hole contains the cell in the middle */
+    const size_t parts[] = {0, 5};
+    const double xy[] = {0.5,  0.5,  0.5,  16.5, 33.5, 16.5, 33.5, 0.5,
+                         0.5,  0.5,  10.0, 5.0,  24.0, 5.0,  24.0, 12.0,
+                         10.0, 12.0, 10.0, 5.0};
+    const char *keys[] = {"s0", "s1", "s2", "s4", "s6", "s8", "s9", "sd"};
+    char parts_buf[8], points_buf[16 * 10];
+    shp_record_t record;
+    shp_cover_t *cover;
+    int ok;
+
+    make_record(&record, SHP_TYPE_POLYGON, parts, 2, xy, 10, parts_buf,
+                points_buf);
+    if (shp_record_cover(&record, SHP_COVER_GEOHASH, 2, &cover) != 1) {
+        return 0;
+    }
+    ok = keys_equal(cover, keys, 8);
+    free(cover);
+    return ok;
+}
+
+static int
+test_polyline(void)
+{
+    const size_t parts[] = {0};
+    const double xy[] = {-170.0, 10.0, 170.0, 10.0};
+    const char *keys[] = {"8", "9", "d", "e", "s", "t", "w", "x"};
+    char parts_buf[4], points_buf[16 * 2];
+    shp_record_t record;
+    shp_cover_t *cover;
+    int ok;
+
+    make_record(&record, SHP_TYPE_POLYLINE, parts, 1, xy, 2, parts_buf,
+                points_buf);
+    if (shp_record_cover(&record, SHP_COVER_GEOHASH, 1, &cover) != 1) {
+        return 0;
+    }
+    ok = keys_equal(cover, keys, 8);
+    free(cover);
+    return ok;
+}
+
+static int
+test_level(void)
+{
+    shp_cover_t *cover;
+
+    errno = 0;
+    return shp_record_cover(point_records[0], SHP_COVER_GEOHASH, 13,
+                            &cover) == -1 &&
+           errno == EINVAL && cover == NULL &&
+           shp_record_cover(point_records[0], SHP_COVER_QUADKEY, 0,
+                            &cover) == -1;
+}
+
+int
+main(void)
+{
+    plan(7);
+
+    if (read_records("point.shp", point_records, 1) <= 0 ||
+        read_records("multipoint.shp", multipoint_records, 1) <= 0 ||
+        read_records("polygon.shp", polygon_records, 3) <= 0) {
+        return 1;
+    }
+
+    ok(test_point, "points are covered by one cell");
+    ok(test_multipoint, "multipoints are covered");
+    ok(test_polygon, "polygons are covered");
+    ok(test_triangle, "cells outside a triangle are left out");
+    ok(test_hole, "cells inside a hole are left out");
+    ok(test_polyline, "PolyLines are covered");
+    ok(test_level, "invalid levels are rejected");
+
+    free(polygon_records[2]);
+    free(polygon_records[1]);
+    free(polygon_records[0]);
+    free(multipoint_records[0]);
+    free(point_records[0]);
+
+    done_testing();
+}
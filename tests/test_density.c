@@ -0,0 +1,163 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+static int
+read_density(const char *basename, const shp_grid_t *grid,
+             const char *field_name, size_t *counts, double *sums)
+{
+    char filename[64];
+    FILE *shp_stream = NULL, *dbf_stream = NULL;
+    shp_file_t shp_fh;
+    dbf_file_t dbf_fh;
+    dbf_header_t *header = NULL;
+    const dbf_field_t *field = NULL;
+    int rc = -1;
+
+    snprintf(filename, sizeof(filename), "%s.shp", basename);
+    shp_stream = fopen(filename, "rb");
+    if (shp_stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        goto cleanup;
+    }
+    shp_init_file(&shp_fh, shp_stream, NULL);
+
+    if (field_name != NULL) {
+        snprintf(filename, sizeof(filename), "%s.dbf", basename);
+        dbf_stream = fopen(filename, "rb");
+        if (dbf_stream == NULL) {
+            fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                    strerror(errno));
+            goto cleanup;
+        }
+        dbf_init_file(&dbf_fh, dbf_stream, NULL);
+        if (dbf_read_header(&dbf_fh, &header) <= 0) {
+            goto cleanup;
+        }
+        for (field = header->fields; field != NULL; field = field->next) {
+            if (strcmp(field->name, field_name) == 0) {
+                break;
+            }
+        }
+        if (field == NULL) {
+            goto cleanup;
+        }
+    }
+
+    rc = shp_density_read(&shp_fh, grid,
+                          (dbf_stream != NULL) ? &dbf_fh : NULL, field,
+                          counts, sums);
+
+cleanup:
+    free(header);
+    if (dbf_stream != NULL) {
+        fclose(dbf_stream);
+    }
+    if (shp_stream != NULL) {
+        fclose(shp_stream);
+    }
+
+    return rc;
+}
+
+static int
+test_count(void)
+{
+    const shp_grid_t grid = {8.9, 48.5, 0.1, 0.1, 3, 3};
+    const size_t expected[9] = {1, 2, 0, 0, 1, 0, 0, 2, 0};
+    size_t counts[9] = {0};
+    size_t i;
+
+    if (read_density("multipoint", &grid, NULL, counts, NULL) != 1) {
+        return 0;
+    }
+
+    for (i = 0; i < 9; ++i) {
+        if (counts[i] != expected[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+test_sum(void)
+{
+    const shp_grid_t grid = {7.0, 47.0, 1.0, 1.0, 3, 3};
+    const size_t expected_counts[9] = {1, 0, 0, 0, 0, 1, 0, 2, 0};
+    const double expected_sums[9] = {2925177, 0, 0, 0, 0, 2825297,
+                                     0,       5766685, 0};
+    size_t counts[9] = {0};
+    double sums[9] = {0.0};
+    size_t i;
+
+    if (read_density("point", &grid, "geoname_id", counts, sums) != 1) {
+        return 0;
+    }
+
+    for (i = 0; i < 9; ++i) {
+        if (counts[i] != expected_counts[i] || sums[i] != expected_sums[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+test_accumulate(void)
+{
+    const shp_grid_t grid = {7.0, 47.0, 3.0, 3.0, 1, 1};
+    size_t counts[1] = {0};
+    double sums[1] = {0.0};
+
+    if (read_density("point", &grid, NULL, counts, sums) != 1 ||
+        read_density("multipoint", &grid, NULL, counts, sums) != 1) {
+        return 0;
+    }
+
+    return counts[0] == 10 && sums[0] == 10.0;
+}
+
+static int
+test_outside(void)
+{
+    const shp_grid_t grid = {0.0, 0.0, 1.0, 1.0, 2, 2};
+    size_t counts[4] = {0};
+
+    if (read_density("point", &grid, NULL, counts, NULL) != 1) {
+        return 0;
+    }
+
+    return counts[0] == 0 && counts[1] == 0 && counts[2] == 0 &&
+           counts[3] == 0;
+}
+
+static int
+test_errors(void)
+{
+    const shp_grid_t grid = {7.0, 47.0, 1.0, 1.0, 3, 3};
+    size_t counts[9] = {0};
+
+    return read_density("point", &grid, "name", counts, NULL) == -1 &&
+           read_density("polygon", &grid, NULL, counts, NULL) == -1;
+}
+
+int
+main(void)
+{
+    plan(5);
+    ok(test_count, "multipoints are counted");
+    ok(test_sum, "weights are summed up");
+    ok(test_accumulate, "several files are aggregated");
+    ok(test_outside, "points outside the grid are skipped");
+    ok(test_errors, "text fields and polygons are rejected");
+    done_testing();
+}
@@ -0,0 +1,153 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *polyline_records[1];
+shp_record_t *polygon_records[1];
+
+#define NUM_ZIGZAG 200
+
+char zigzag_parts[4];
+char zigzag_points[16 * NUM_ZIGZAG];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+nearest_equals(const shp_nearest_t *nearest, double distance,
+               size_t part_num, size_t point_num, double x, double y)
+{
+    return fabs(nearest->distance - distance) < 1e-9 &&
+           nearest->part_num == part_num && nearest->point_num == point_num &&
+           fabs(nearest->point.x - x) < 1e-9 &&
+           fabs(nearest->point.y - y) < 1e-9;
+}
+
+static int
+test_polyline_segment(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    shp_nearest_t nearest;
+    return shp_polyline_nearest(polyline, 3.0, 2.0, &nearest) == 1 &&
+           nearest_equals(&nearest, sqrt(0.5), 0, 0, 2.5, 2.5);
+}
+
+static int
+test_polyline_end_point(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    shp_nearest_t nearest;
+    return shp_polyline_nearest(polyline, 0.0, 0.0, &nearest) == 1 &&
+           nearest_equals(&nearest, sqrt(2.0), 0, 0, 1.0, 1.0) &&
+           shp_polyline_nearest(polyline, 3.0, 0.5, &nearest) == 1 &&
+           nearest_equals(&nearest, 0.5, 1, 2, 3.0, 1.0);
+}
+
+static int
+test_polygon_inside(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    shp_nearest_t nearest;
+    return shp_polygon_nearest(polygon, 0.5, 0.5, &nearest) == 1 &&
+           nearest_equals(&nearest, 0.3, 0, 0, 0.2, 0.5);
+}
+
+static int
+test_polygon_outside(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    shp_nearest_t nearest;
+    return shp_polygon_nearest(polygon, 1.0, 0.5, &nearest) == 1 &&
+           nearest_equals(&nearest, 0.2, 0, 2, 0.8, 0.5);
+}
+
+static int
+test_many_segments(void)
+{
+    shp_polyline_t polyline;
+    shp_nearest_t nearest;
+    size_t i;
+
+    /* A zigzag line that spans several blocks of points */
+    memset(zigzag_parts, 0, sizeof(zigzag_parts));
+    for (i = 0; i < NUM_ZIGZAG; ++i) {
+        shp_double_to_le64((double) i, &zigzag_points[16 * i]);
+        shp_double_to_le64((double) (i % 2), &zigzag_points[16 * i + 8]);
+    }
+
+    polyline.x_min = 0.0;
+    polyline.x_max = NUM_ZIGZAG - 1;
+    polyline.y_min = 0.0;
+    polyline.y_max = 1.0;
+    polyline.num_parts = 1;
+    polyline.num_points = NUM_ZIGZAG;
+    polyline.parts = zigzag_parts;
+    polyline.points = zigzag_points;
+
+    return shp_polyline_nearest(&polyline, 150.5, 1.0, &nearest) == 1 &&
+           nearest_equals(&nearest, sqrt(0.125), 0, 150, 150.75, 0.75) &&
+           shp_polyline_nearest(&polyline, 300.0, 1.0, &nearest) == 1 &&
+           nearest_equals(&nearest, 101.0, 0, NUM_ZIGZAG - 2, 199.0, 1.0);
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    if (read_records("polyline.shp", polyline_records, 1) <= 0 ||
+        read_records("polygon.shp", polygon_records, 1) <= 0) {
+        return 1;
+    }
+
+    ok(test_polyline_segment, "point is projected onto a segment");
+    ok(test_polyline_end_point, "nearest end point is found");
+    ok(test_polygon_inside, "distance to boundary from inside");
+    ok(test_polygon_outside, "distance to boundary from outside");
+    ok(test_many_segments, "nearest segment in a long line is found");
+
+    free(polyline_records[0]);
+    free(polygon_records[0]);
+
+    done_testing();
+}
@@ -0,0 +1,186 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+static int
+read_graph(const char *filename, double tolerance, shp_graph_t **pgraph)
+{
+    FILE *stream;
+    shp_file_t fh;
+    int rc;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    rc = shp_graph_read(&fh, tolerance, pgraph);
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+point_equals(const shp_point_t *point, double x, double y)
+{
+    return fabs(point->x - x) < 1e-9 && fabs(point->y - y) < 1e-9;
+}
+
+static int
+test_polylinem(void)
+{
+    shp_graph_t *graph;
+    const shp_edge_t *edge;
+    int ok;
+
+    if (read_graph("polylinem.shp", 0.0, &graph) != 1) {
+        return 0;
+    }
+
+    ok = graph->num_nodes == 3 && graph->num_edges == 2 &&
+         point_equals(&graph->nodes[0], 1, 1) &&
+         point_equals(&graph->nodes[1], 2, 2) &&
+         point_equals(&graph->nodes[2], 4, 1);
+    if (ok) {
+        edge = &graph->edges[0];
+        ok = edge->from == 0 && edge->to == 1 && edge->record_number == 1 &&
+             edge->part_num == 0 && fabs(edge->length - 2.0) < 1e-9 &&
+             edge->m_min == 1.0 && edge->m_max == 3.0;
+    }
+    if (ok) {
+        edge = &graph->edges[1];
+        ok = edge->from == 1 && edge->to == 2 && edge->record_number == 1 &&
+             edge->part_num == 1 && fabs(edge->length - 3.0) < 1e-9 &&
+             edge->m_min == 4.0 && edge->m_max == 7.0;
+    }
+
+    free(graph);
+
+    return ok;
+}
+
+static int
+test_adjacency(void)
+{
+    shp_graph_t *graph;
+    int ok;
+
+    if (read_graph("polylinem.shp", 0.0, &graph) != 1) {
+        return 0;
+    }
+
+    /* The middle node connects both edges */
+    ok = graph->offsets[0] == 0 && graph->offsets[1] == 1 &&
+         graph->offsets[2] == 3 && graph->offsets[3] == 4 &&
+         graph->adjacency[0] == 0 && graph->adjacency[1] == 0 &&
+         graph->adjacency[2] == 1 && graph->adjacency[3] == 1;
+
+    free(graph);
+
+    return ok;
+}
+
+static int
+test_tolerance(void)
+{
+    shp_graph_t *graph;
+    size_t i;
+    int ok;
+
+    /* The end points are 1 or more apart */
+    if (read_graph("polyline.shp", 0.5, &graph) != 1) {
+        return 0;
+    }
+    ok = graph->num_nodes == 8 && graph->num_edges == 4;
+    free(graph);
+    if (!ok) {
+        return 0;
+    }
+
+    /* All end points are within 3 of the first node */
+    if (read_graph("polyline.shp", 3.0, &graph) != 1) {
+        return 0;
+    }
+    ok = graph->num_nodes == 1 && graph->num_edges == 4 &&
+         graph->offsets[1] == 8;
+    for (i = 0; ok && i < graph->num_edges; ++i) {
+        ok = graph->edges[i].from == 0 && graph->edges[i].to == 0 &&
+             graph->edges[i].m_min == 0.0 && graph->edges[i].m_max == 0.0;
+    }
+    free(graph);
+
+    return ok;
+}
+
+static int
+test_polylinez(void)
+{
+    shp_graph_t *graph;
+    int ok;
+
+    if (read_graph("polylinez.shp", 0.0, &graph) != 1) {
+        return 0;
+    }
+
+    ok = graph->num_nodes == 4 && graph->num_edges == 2 &&
+         graph->edges[0].m_min == 0.0 && graph->edges[0].m_max == 2.02 &&
+         graph->edges[1].m_min == 0.0 && graph->edges[1].m_max == 1.43 &&
+         graph->edges[1].length > 0.0;
+
+    free(graph);
+
+    return ok;
+}
+
+static int
+test_no_data(void)
+{
+    shp_graph_t *graph;
+    int ok;
+
+    if (read_graph("nodata.shp", 0.0, &graph) != 1) {
+        return 0;
+    }
+
+    /* Measures below -10^38 are skipped */
+    ok = graph->num_edges == 2 && graph->edges[0].m_min == 2.0 &&
+         graph->edges[0].m_max == 5.0 &&
+         graph->edges[1].m_min == HUGE_VAL &&
+         graph->edges[1].m_max == -HUGE_VAL;
+
+    free(graph);
+
+    return ok;
+}
+
+static int
+test_polygon(void)
+{
+    shp_graph_t *graph;
+
+    return read_graph("polygon.shp", 0.0, &graph) == -1 && graph == NULL;
+}
+
+int
+main(void)
+{
+    plan(6);
+    ok(test_polylinem, "PolyLineM graph has lengths and measures");
+    ok(test_adjacency, "adjacency lists are correct");
+    ok(test_tolerance, "end points are snapped");
+    ok(test_polylinez, "PolyLineZ graph has measures");
+    ok(test_no_data, "\"no data\" measures are skipped");
+    ok(test_polygon, "polygons are rejected");
+    done_testing();
+}
@@ -0,0 +1,208 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *point_records[1];
+shp_record_t *multipoint_records[1];
+shp_record_t *polygon_records[2];
+shp_record_t *multipatch_records[1];
+
+char diamond_points[16 * 5];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+point_equals(const shp_point_t *point, double x, double y)
+{
+    return fabs(point->x - x) < 1e-9 && fabs(point->y - y) < 1e-9;
+}
+
+static int
+test_point(void)
+{
+    const shp_record_t *record = point_records[0];
+    shp_hull_t *hull;
+    shp_rectangle_t rectangle;
+    int ok;
+
+    if (shp_record_hull(record, &hull) != 1) {
+        return 0;
+    }
+    shp_hull_rectangle(hull, &rectangle);
+    ok = hull->num_points == 1 &&
+         point_equals(&hull->points[0], record->shape.point.x,
+                      record->shape.point.y) &&
+         rectangle.area == 0.0;
+    free(hull);
+    return ok;
+}
+
+static int
+test_two_points(void)
+{
+    shp_hull_t *hull;
+    shp_rectangle_t rectangle;
+    int ok;
+
+    if (shp_record_hull(multipoint_records[0], &hull) != 1) {
+        return 0;
+    }
+    shp_hull_rectangle(hull, &rectangle);
+    ok = hull->num_points == 2 &&
+         point_equals(&hull->points[0], 9.0909, 48.7642) &&
+         point_equals(&hull->points[1], 9.0911, 48.7719) &&
+         rectangle.area == 0.0 &&
+         point_equals(&rectangle.points[1], 9.0911, 48.7719);
+    free(hull);
+    return ok;
+}
+
+static int
+test_polygon(void)
+{
+    shp_hull_t *hull;
+    shp_rectangle_t rectangle;
+    int ok;
+
+    /* The hole does not contribute to the hull */
+    if (shp_record_hull(polygon_records[1], &hull) != 1) {
+        return 0;
+    }
+    shp_hull_rectangle(hull, &rectangle);
+    ok = hull->num_points == 3 &&
+         point_equals(&hull->points[0], 0.2, 0.2) &&
+         point_equals(&hull->points[1], 0.8, 0.2) &&
+         point_equals(&hull->points[2], 0.5, 0.8) &&
+         fabs(rectangle.area - 0.36) < 1e-9;
+    free(hull);
+    return ok;
+}
+
+static int
+test_multipatch(void)
+{
+    shp_hull_t *hull;
+    shp_rectangle_t rectangle;
+    int ok;
+
+    if (shp_record_hull(multipatch_records[0], &hull) != 1) {
+        return 0;
+    }
+    shp_hull_rectangle(hull, &rectangle);
+    ok = hull->num_points == 4 && point_equals(&hull->points[0], 0.0, 0.0) &&
+         point_equals(&hull->points[1], 1.0, 0.0) &&
+         point_equals(&hull->points[2], 1.0, 1.0) &&
+         point_equals(&hull->points[3], 0.0, 1.0) &&
+         fabs(rectangle.area - 1.0) < 1e-9;
+    free(hull);
+    return ok;
+}
+
+static int
+test_rotated_rectangle(void)
+{
+    shp_record_t record;
+    shp_multipoint_t *multipoint = &record.shape.multipoint;
+    shp_hull_t *hull;
+    shp_rectangle_t rectangle;
+    const double xy[] = {1.0, 0.0, 2.0, 1.0, 1.0, 2.0, 0.0, 1.0, 1.0, 1.0};
+    size_t i;
+    int ok;
+
+    for (i = 0; i < 10; ++i) {
+        shp_double_to_le64(xy[i], &diamond_points[8 * i]);
+    }
+
+    record.record_number = 1;
+    record.record_size = 0;
+    record.type = SHP_TYPE_MULTIPOINT;
+    multipoint->x_min = 0.0;
+    multipoint->y_min = 0.0;
+    multipoint->x_max = 2.0;
+    multipoint->y_max = 2.0;
+    multipoint->num_points = 5;
+    multipoint->points = diamond_points;
+
+    if (shp_record_hull(&record, &hull) != 1) {
+        return 0;
+    }
+    shp_hull_rectangle(hull, &rectangle);
+    /* The rectangle is half as large as the bounding box */
+    ok = hull->num_points == 4 && point_equals(&hull->points[0], 0.0, 1.0) &&
+         point_equals(&hull->points[1], 1.0, 0.0) &&
+         fabs(rectangle.area - 2.0) < 1e-9 &&
+         point_equals(&rectangle.points[0], 0.0, 1.0) &&
+         point_equals(&rectangle.points[1], 1.0, 0.0) &&
+         point_equals(&rectangle.points[2], 2.0, 1.0) &&
+         point_equals(&rectangle.points[3], 1.0, 2.0);
+    free(hull);
+    return ok;
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    if (read_records("point.shp", point_records, 1) <= 0 ||
+        read_records("multipoint.shp", multipoint_records, 1) <= 0 ||
+        read_records("polygon.shp", polygon_records, 2) <= 0 ||
+        read_records("multipatch.shp", multipatch_records, 1) <= 0) {
+        return 1;
+    }
+
+    ok(test_point, "hull of a point");
+    ok(test_two_points, "hull of two points");
+    ok(test_polygon, "hull of a polygon");
+    ok(test_multipatch, "hull of a MultiPatch");
+    ok(test_rotated_rectangle, "rectangle is rotated");
+
+    free(point_records[0]);
+    free(multipoint_records[0]);
+    free(polygon_records[0]);
+    free(polygon_records[1]);
+    free(multipatch_records[0]);
+
+    done_testing();
+}
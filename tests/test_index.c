@@ -0,0 +1,496 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MTIME 1700000000
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+typedef struct found_t {
+    size_t count;
+    size_t record_numbers[16];
+} found_t;
+
+typedef struct index_file_t {
+    shp_header_t header;
+    size_t file_size;
+    size_t size;
+    uint64_t *data;
+} index_file_t;
+
+static double
+next_random(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return (double) (*state >> 8) / 16777216.0;
+}
+
+/*
+ * Writes a MultiPoint file with the corners of a box in every record.
+ */
+static int
+write_boxes(FILE *stream, double (*boxes)[4], size_t n)
+{
+    char header[100] = {0}, record[80] = {0};
+    double box[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i;
+
+    rewind(stream);
+
+    for (i = 0; i < n; ++i) {
+        box[0] = (i == 0 || boxes[i][0] < box[0]) ? boxes[i][0] : box[0];
+        box[1] = (i == 0 || boxes[i][1] < box[1]) ? boxes[i][1] : box[1];
+        box[2] = (i == 0 || boxes[i][2] > box[2]) ? boxes[i][2] : box[2];
+        box[3] = (i == 0 || boxes[i][3] > box[3]) ? boxes[i][3] : box[3];
+    }
+
+    shp_uint32_to_be32(9994, &header[0]);
+    shp_uint32_to_be32((uint32_t) (50 + n * 40), &header[24]);
+    shp_uint32_to_le32(1000, &header[28]);
+    shp_uint32_to_le32(SHP_TYPE_MULTIPOINT, &header[32]);
+    for (i = 0; i < 4; ++i) {
+        shp_double_to_le64(box[i], &header[36 + 8 * i]);
+    }
+    if (fwrite(header, sizeof(header), 1, stream) != 1) {
+        return 0;
+    }
+
+    for (i = 0; i < n; ++i) {
+        shp_uint32_to_be32((uint32_t) (i + 1), &record[0]);
+        shp_uint32_to_be32(36, &record[4]);
+        shp_uint32_to_le32(SHP_TYPE_MULTIPOINT, &record[8]);
+        shp_double_to_le64(boxes[i][0], &record[12]);
+        shp_double_to_le64(boxes[i][1], &record[20]);
+        shp_double_to_le64(boxes[i][2], &record[28]);
+        shp_double_to_le64(boxes[i][3], &record[36]);
+        shp_uint32_to_le32(2, &record[44]);
+        shp_double_to_le64(boxes[i][0], &record[48]);
+        shp_double_to_le64(boxes[i][1], &record[56]);
+        shp_double_to_le64(boxes[i][2], &record[64]);
+        shp_double_to_le64(boxes[i][3], &record[72]);
+        if (fwrite(record, sizeof(record), 1, stream) != 1) {
+            return 0;
+        }
+    }
+
+    rewind(stream);
+
+    return 1;
+}
+
+/*
+ * Reads a file into memory that is aligned like mapped memory.
+ */
+static uint64_t *
+read_stream(FILE *stream, size_t *psize)
+{
+    uint64_t *data;
+    long size;
+
+    if ((size = ftell(stream)) < 0) {
+        return NULL;
+    }
+    *psize = (size_t) size;
+    data = (uint64_t *) calloc(*psize / 8 + 1, 8);
+    if (data == NULL) {
+        return NULL;
+    }
+    rewind(stream);
+    if (fread(data, 1, *psize, stream) != *psize) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+/*
+ * Writes an index for a file and reads the index into memory.
+ */
+static int
+write_index(const char *filename, index_file_t *file)
+{
+    FILE *stream, *index_stream;
+    shp_file_t fh;
+    long size;
+    int rc = -1;
+
+    file->data = NULL;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    index_stream = tmpfile();
+    if (index_stream == NULL) {
+        fclose(stream);
+        return -1;
+    }
+
+    if (fseek(stream, 0, SEEK_END) != 0 || (size = ftell(stream)) < 0) {
+        goto cleanup;
+    }
+    file->file_size = (size_t) size;
+    rewind(stream);
+
+    shp_init_file(&fh, stream, NULL);
+    if (shp_index_write(&fh, 2, file->file_size, MTIME, index_stream) < 0) {
+        fprintf(stderr, "# Cannot write index: %s\n", fh.error);
+        goto cleanup;
+    }
+
+    rewind(stream);
+    if (shp_read_header(&fh, &file->header) <= 0) {
+        goto cleanup;
+    }
+
+    file->data = read_stream(index_stream, &file->size);
+    if (file->data == NULL) {
+        goto cleanup;
+    }
+
+    rc = 1;
+
+cleanup:
+
+    fclose(index_stream);
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+open_index(index_file_t *file, shp_index_t *index)
+{
+    return shp_index_open(index, file->data, file->size, &file->header,
+                          file->file_size, MTIME);
+}
+
+static int
+add_entry(const shp_rtree_t *rtree, const shp_rtree_entry_t *entry,
+          void *user_data)
+{
+    found_t *found = (found_t *) user_data;
+
+    (void) rtree;
+    if (found->count < 16) {
+        found->record_numbers[found->count] = entry->record_number;
+        ++found->count;
+    }
+    return 1;
+}
+
+static int
+contains(const found_t *found, size_t record_number)
+{
+    size_t i;
+
+    for (i = 0; i < found->count; ++i) {
+        if (found->record_numbers[i] == record_number) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+test_search(void)
+{
+    index_file_t file;
+    shp_index_t index;
+    found_t found;
+    int ok;
+
+    if (write_index("polygon.shp", &file) < 0) {
+        free(file.data);
+        return 0;
+    }
+
+    /* Africa */
+    found.count = 0;
+    ok = open_index(&file, &index) == 1 && index.num_records == 6 &&
+         index.rtree.num_entries == 6 && index.rtree.node_size == 2 &&
+         shp_rtree_search(&index.rtree, 30.0, 10.0, 31.0, 11.0, add_entry,
+                          &found) == 1 &&
+         found.count == 2 && contains(&found, 4) && contains(&found, 5);
+
+    free(file.data);
+
+    return ok;
+}
+
+static int
+test_record(void)
+{
+    index_file_t file;
+    shp_index_t index;
+    FILE *stream;
+    shx_file_t fh;
+    shx_record_t expected, record;
+    size_t i;
+    int ok = 0;
+
+    if (write_index("polygon.shp", &file) < 0) {
+        free(file.data);
+        return 0;
+    }
+
+    stream = fopen("polygon.shx", "rb");
+    if (stream != NULL) {
+        shx_init_file(&fh, stream, NULL);
+        ok = open_index(&file, &index) == 1;
+        for (i = 0; ok && i < 6; ++i) {
+            ok = shx_seek_record(&fh, i, &expected) > 0 &&
+                 shp_index_record(&index, i, &record) == 1 &&
+                 record.file_offset == expected.file_offset &&
+                 record.record_size == expected.record_size;
+        }
+        ok = ok && shp_index_record(&index, 6, &record) == 0;
+        fclose(stream);
+    }
+
+    free(file.data);
+
+    return ok;
+}
+
+static int
+test_stale(void)
+{
+    index_file_t file;
+    shp_index_t index;
+    shp_header_t header;
+    uint32_t version;
+    int ok;
+
+    if (write_index("polygon.shp", &file) < 0) {
+        free(file.data);
+        return 0;
+    }
+
+    ok = shp_index_open(&index, file.data, file.size, &file.header,
+                        file.file_size, MTIME + 1) == 0 &&
+         shp_index_open(&index, file.data, file.size, &file.header,
+                        file.file_size + 100, MTIME) == 0;
+
+    header = file.header;
+    header.x_min = -179.0;
+    ok = ok && shp_index_open(&index, file.data, file.size, &header,
+                              file.file_size, MTIME) == 0;
+
+    /* The version follows the magic number */
+    memcpy(&version, (char *) file.data + 8, sizeof(version));
+    ++version;
+    memcpy((char *) file.data + 8, &version, sizeof(version));
+    ok = ok && open_index(&file, &index) == 0;
+
+    free(file.data);
+
+    return ok;
+}
+
+static int
+test_invalid(void)
+{
+    index_file_t file;
+    shp_index_t index;
+    int ok;
+
+    if (write_index("polygon.shp", &file) < 0) {
+        free(file.data);
+        return 0;
+    }
+
+    errno = 0;
+    ok = shp_index_open(&index, file.data, file.size - 8, &file.header,
+                        file.file_size, MTIME) == -1 &&
+         errno == EINVAL &&
+         shp_index_open(&index, file.data, 16, &file.header, file.file_size,
+                        MTIME) == -1;
+
+    memmove((char *) file.data + 4, file.data, file.size);
+    ok = ok && shp_index_open(&index, (char *) file.data + 4, file.size,
+                              &file.header, file.file_size, MTIME) == -1;
+
+    memcpy(file.data, "SHPINDEY", 8);
+    ok = ok && open_index(&file, &index) == -1;
+
+    free(file.data);
+
+    return ok;
+}
+
+/*
+ * Indexes a file, replaces the file and compares the updated index with a
+ * new index.
+ */
+static int
+update_index(double (*old_boxes)[4], size_t n1, double (*new_boxes)[4],
+             size_t n2, size_t *pnum_bytes)
+{
+    FILE *old_shp = NULL, *new_shp = NULL;
+    FILE *old_stream = NULL, *new_stream = NULL, *ref_stream = NULL;
+    uint64_t *old_data = NULL, *new_data = NULL, *ref_data = NULL;
+    size_t old_size, new_size, ref_size, file_size;
+    shp_file_t fh;
+    int ok = 0;
+
+    old_shp = tmpfile();
+    new_shp = tmpfile();
+    old_stream = tmpfile();
+    new_stream = tmpfile();
+    ref_stream = tmpfile();
+    if (old_shp == NULL || new_shp == NULL || old_stream == NULL ||
+        new_stream == NULL || ref_stream == NULL) {
+        goto cleanup;
+    }
+
+    file_size = 100 + n1 * 80;
+    shp_init_file(&fh, old_shp, NULL);
+    if (!write_boxes(old_shp, old_boxes, n1) ||
+        shp_index_write(&fh, 4, file_size, MTIME, old_stream) < 0 ||
+        (old_data = read_stream(old_stream, &old_size)) == NULL) {
+        goto cleanup;
+    }
+
+    file_size = 100 + n2 * 80;
+    shp_init_file(&fh, new_shp, NULL);
+    if (!write_boxes(new_shp, new_boxes, n2) ||
+        shp_index_update(&fh, old_data, old_size, file_size, MTIME + 1,
+                         new_stream) != 1 ||
+        (new_data = read_stream(new_stream, &new_size)) == NULL) {
+        fprintf(stderr, "# Cannot update index: %s\n", fh.error);
+        goto cleanup;
+    }
+    *pnum_bytes = fh.num_bytes;
+
+    rewind(new_shp);
+    shp_init_file(&fh, new_shp, NULL);
+    if (shp_index_write(&fh, 4, file_size, MTIME + 1, ref_stream) < 0 ||
+        (ref_data = read_stream(ref_stream, &ref_size)) == NULL) {
+        goto cleanup;
+    }
+
+    /* An index that is up to date is not written again */
+    rewind(new_shp);
+    shp_init_file(&fh, new_shp, NULL);
+    ok = new_size == ref_size && memcmp(new_data, ref_data, new_size) == 0 &&
+         shp_index_update(&fh, new_data, new_size, file_size, MTIME + 1,
+                          old_stream) == 0;
+
+cleanup:
+
+    free(ref_data);
+    free(new_data);
+    free(old_data);
+    if (ref_stream != NULL) {
+        fclose(ref_stream);
+    }
+    if (new_stream != NULL) {
+        fclose(new_stream);
+    }
+    if (old_stream != NULL) {
+        fclose(old_stream);
+    }
+    if (new_shp != NULL) {
+        fclose(new_shp);
+    }
+    if (old_shp != NULL) {
+        fclose(old_shp);
+    }
+
+    return ok;
+}
+
+static int
+test_update(void)
+{
+    static double boxes[300][4], moved[300][4];
+    double x, y;
+    uint32_t state = 1;
+    size_t i, num_bytes = 0;
+    int ok;
+
+    for (i = 0; i < 300; ++i) {
+        x = 100.0 * next_random(&state);
+        y = 100.0 * next_random(&state);
+        boxes[i][0] = x;
+        boxes[i][1] = y;
+        boxes[i][2] = x + 5.0 * next_random(&state);
+        boxes[i][3] = y + 5.0 * next_random(&state);
+    }
+
+    /* Only the header, the last indexed record and the new records are
+     * read after an append */
+    ok = update_index(boxes, 200, boxes, 300, &num_bytes) &&
+         num_bytes == 100 + 80 + 100 * 80;
+
+    /* Files that shrink are indexed again */
+    ok = ok && update_index(boxes, 300, boxes, 200, &num_bytes) &&
+         num_bytes == 100 + 200 * 80;
+
+    /* So are files whose records were changed in place */
+    memcpy(moved, boxes, sizeof(moved));
+    moved[0][0] = 1000.0;
+    moved[0][2] = 1001.0;
+    ok = ok && update_index(boxes, 200, moved, 200, &num_bytes) &&
+         num_bytes == 100 + 200 * 80;
+
+    /* Even if the bounding box does not change */
+    memcpy(moved, boxes, sizeof(moved));
+    memcpy(moved[0], boxes[1], sizeof(moved[0]));
+    ok = ok && update_index(boxes, 200, moved, 200, &num_bytes) &&
+         num_bytes == 100 + 200 * 80;
+
+    return ok;
+}
+
+static int
+test_empty(void)
+{
+    index_file_t file;
+    shp_index_t index;
+    found_t found;
+    int ok;
+
+    /* Null shapes have offsets but no entries */
+    if (write_index("null.shp", &file) < 0) {
+        free(file.data);
+        return 0;
+    }
+
+    found.count = 0;
+    ok = open_index(&file, &index) == 1 && index.num_records > 0 &&
+         index.rtree.num_entries == 0 && index.rtree.num_nodes == 0 &&
+         shp_rtree_search(&index.rtree, -180.0, -90.0, 180.0, 90.0,
+                          add_entry, &found) == 1 &&
+         found.count == 0;
+
+    free(file.data);
+
+    return ok;
+}
+
+int
+main(void)
+{
+    plan(6);
+
+    ok(test_search, "R-tree can be searched without copying");
+    ok(test_record, "records have the offsets from the index");
+    ok(test_stale, "changes to the shp file are detected");
+    ok(test_invalid, "invalid data is rejected");
+    ok(test_empty, "null shapes are skipped");
+    ok(test_update, "appended records are added to the index");
+
+    done_testing();
+}
@@ -0,0 +1,259 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_BOXES 1000
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+static double
+next_random(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return (double) (*state >> 8) / 16777216.0;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static int
+is_sorted(const shp_knn_neighbor_t *neighbors, size_t n)
+{
+    size_t i;
+
+    for (i = 1; i < n; ++i) {
+        if (neighbors[i].distance < neighbors[i - 1].distance) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+test_polygon(void)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_rtree_t *rtree = NULL;
+    shp_knn_neighbor_t *neighbors = NULL;
+    size_t n;
+    int ok = 0;
+
+    stream = fopen("polygon.shp", "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", "polygon.shp",
+                strerror(errno));
+        return 0;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if (shp_rtree_read(&fh, 2, &rtree) > 0) {
+        /* Oslo */
+        ok = shp_knn_search(rtree, &fh, 10.5, 59.5, 1, &neighbors, &n) > 0 &&
+             n == 1 && neighbors[0].record_number == 6 &&
+             neighbors[0].distance == 0.0;
+        free(neighbors);
+
+        /* Copenhagen is nearer to Oslo than to Africa */
+        ok = ok &&
+             shp_knn_search(rtree, &fh, 12.5, 55.7, 6, &neighbors, &n) > 0 &&
+             n == 6 && neighbors[0].record_number == 6 &&
+             neighbors[0].distance > 3.0 && is_sorted(neighbors, n);
+        free(neighbors);
+    }
+    else {
+        fprintf(stderr, "# Cannot read file: %s\n", fh.error);
+    }
+
+    free(rtree);
+    fclose(stream);
+
+    return ok;
+}
+
+static int
+test_random(void)
+{
+    static double boxes[NUM_BOXES][4];
+    static double distances[NUM_BOXES];
+    shp_rtree_t *rtree = NULL;
+    shp_knn_neighbor_t *neighbors;
+    shp_file_t fh;
+    FILE *stream;
+    double x, y, d1, d2;
+    uint32_t state = 1;
+    size_t i, j, n, k;
+    int ok = 0;
+
+    for (i = 0; i < NUM_BOXES; ++i) {
+        x = 100.0 * next_random(&state);
+        y = 100.0 * next_random(&state);
+        boxes[i][0] = x;
+        boxes[i][1] = y;
+        boxes[i][2] = x + 5.0 * next_random(&state);
+        boxes[i][3] = y + 5.0 * next_random(&state);
+    }
+
+    /* The boxes in boxes.shp are drawn from the same sequence */
+    stream = fopen("boxes.shp", "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", "boxes.shp",
+                strerror(errno));
+        return 0;
+    }
+    shp_init_file(&fh, stream, NULL);
+    if (shp_rtree_read(&fh, 7, &rtree) > 0) {
+        ok = 1;
+        for (i = 0; ok && i < 50; ++i) {
+            x = 110.0 * next_random(&state) - 5.0;
+            y = 110.0 * next_random(&state) - 5.0;
+            k = 1 + i % 20;
+
+            /* The distance to the nearer corner of each box */
+            for (j = 0; j < NUM_BOXES; ++j) {
+                d1 = hypot(boxes[j][0] - x, boxes[j][1] - y);
+                d2 = hypot(boxes[j][2] - x, boxes[j][3] - y);
+                distances[j] = (d1 < d2) ? d1 : d2;
+            }
+            qsort(distances, NUM_BOXES, sizeof(distances[0]),
+                  compare_doubles);
+
+            ok = shp_knn_search(rtree, &fh, x, y, k, &neighbors, &n) > 0;
+            if (ok) {
+                ok = n == k;
+                for (j = 0; ok && j < n; ++j) {
+                    ok = fabs(neighbors[j].distance - distances[j]) < 1e-9;
+                }
+                free(neighbors);
+            }
+        }
+    }
+
+    free(rtree);
+    fclose(stream);
+
+    return ok;
+}
+
+static int
+test_polyline(void)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_record_t *record;
+    shp_rtree_t *rtree = NULL;
+    shp_knn_neighbor_t *neighbors = NULL;
+    shp_nearest_t nearest;
+    size_t n;
+    int ok = 0;
+
+    stream = fopen("polyline.shp", "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", "polyline.shp",
+                strerror(errno));
+        return 0;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if (shp_rtree_read(&fh, 0, &rtree) > 0 &&
+        shp_knn_search(rtree, &fh, 0.0, 0.0, 1, &neighbors, &n) > 0 &&
+        n == 1) {
+        if (shp_seek_record(&fh, neighbors[0].file_offset, &record) > 0) {
+            ok = shp_polyline_nearest(&record->shape.polyline, 0.0, 0.0,
+                                      &nearest) &&
+                 nearest.distance == neighbors[0].distance;
+            free(record);
+        }
+    }
+    free(neighbors);
+    free(rtree);
+    fclose(stream);
+
+    return ok;
+}
+
+static int
+test_limits(void)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_rtree_t *rtree = NULL;
+    shp_knn_neighbor_t *neighbors = NULL;
+    size_t n;
+    int ok = 0;
+
+    stream = fopen("polygon.shp", "rb");
+    if (stream == NULL) {
+        return 0;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if (shp_rtree_read(&fh, 0, &rtree) > 0) {
+        ok = shp_knn_search(rtree, &fh, 0.0, 0.0, 0, &neighbors, &n) > 0 &&
+             n == 0;
+        free(neighbors);
+        ok = ok &&
+             shp_knn_search(rtree, &fh, 0.0, 0.0, 100, &neighbors, &n) > 0 &&
+             n == 6 && is_sorted(neighbors, n);
+        free(neighbors);
+    }
+
+    free(rtree);
+    fclose(stream);
+
+    return ok;
+}
+
+static int
+test_empty(void)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_rtree_t *rtree = NULL;
+    shp_knn_neighbor_t *neighbors = NULL;
+    size_t n = 1;
+    int ok = 0;
+
+    /* Null shapes are not in the R-tree */
+    stream = fopen("null.shp", "rb");
+    if (stream == NULL) {
+        return 0;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if (shp_rtree_read(&fh, 0, &rtree) > 0) {
+        ok = shp_knn_search(rtree, &fh, 0.0, 0.0, 5, &neighbors, &n) > 0 &&
+             n == 0;
+        free(neighbors);
+    }
+
+    free(rtree);
+    fclose(stream);
+
+    return ok;
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    ok(test_polygon, "points inside polygons have the distance 0");
+    ok(test_random, "search finds the same distances as a linear search");
+    ok(test_polyline, "distances to PolyLines are exact");
+    ok(test_limits, "k is limited to the number of entries");
+    ok(test_empty, "null shapes are skipped");
+
+    done_testing();
+}
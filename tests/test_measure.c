@@ -0,0 +1,199 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *shp_record;
+shp_polylinem_t polylinem;
+int order;
+
+size_t parts[4];
+shp_point_t points[16];
+double measures[16];
+shp_buffer_t buffer;
+
+static int
+read_record(const char *filename, shp_record_t **precord)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        rc = shp_read_record(&fh, precord);
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+locate_equals(double m, double x, double y)
+{
+    shp_pointm_t pointm;
+    return shp_polylinem_locate(&polylinem, order, m, &pointm) == 1 &&
+           pointm.x == x && pointm.y == y && pointm.m == m;
+}
+
+static int
+locate_fails(double m)
+{
+    shp_pointm_t pointm;
+    return shp_polylinem_locate(&polylinem, order, m, &pointm) == 0;
+}
+
+static int
+point_equals(size_t i, double x, double y, double m)
+{
+    return points[i].x == x && points[i].y == y && measures[i] == m;
+}
+
+static int
+test_locate(void)
+{
+    return locate_equals(1.0, 1.0, 1.0) && locate_equals(1.5, 1.5, 1.0) &&
+           locate_equals(3.0, 2.0, 2.0) && locate_equals(5.5, 3.0, 1.5) &&
+           locate_equals(7.0, 4.0, 1.0);
+}
+
+static int
+test_locate_outside(void)
+{
+    return locate_fails(0.5) && locate_fails(3.5) && locate_fails(7.5);
+}
+
+static int
+test_extract(void)
+{
+    size_t start, end;
+    return shp_polylinem_extract(&polylinem, order, 5.5, 1.5, &buffer,
+                                 measures) == 1 &&
+           buffer.num_parts == 2 && buffer.num_points == 6 &&
+           shp_buffer_points(&buffer, 1, &start, &end) == 3 &&
+           point_equals(0, 1.5, 1.0, 1.5) && point_equals(1, 2.0, 1.0, 2.0) &&
+           point_equals(2, 2.0, 2.0, 3.0) && point_equals(3, 2.0, 2.0, 4.0) &&
+           point_equals(4, 3.0, 2.0, 5.0) && point_equals(5, 3.0, 1.5, 5.5);
+}
+
+static int
+test_extract_within_segment(void)
+{
+    return shp_polylinem_extract(&polylinem, order, 6.25, 6.75, &buffer,
+                                 NULL) == 1 &&
+           buffer.num_parts == 1 && buffer.num_points == 2 &&
+           points[0].x == 3.25 && points[1].x == 3.75;
+}
+
+static int
+test_extract_outside(void)
+{
+    return shp_polylinem_extract(&polylinem, order, 3.25, 3.75, &buffer,
+                                 NULL) == 1 &&
+           buffer.num_parts == 0 && buffer.num_points == 0;
+}
+
+static int
+test_order(void)
+{
+    /* Measures that do not match their bounds are not bisected */
+    shp_polylinem_t copy = polylinem;
+    copy.m_min = 0.0;
+    return order == 1 && shp_polylinem_order(&copy) == 0;
+}
+
+static int
+test_scan(void)
+{
+    shp_pointm_t pointm;
+    return shp_polylinem_locate(&polylinem, 0, 5.5, &pointm) == 1 &&
+           pointm.x == 3.0 && pointm.y == 1.5 &&
+           shp_polylinem_locate(&polylinem, 0, 3.5, &pointm) == 0 &&
+           shp_polylinem_extract(&polylinem, 0, 1.5, 5.5, &buffer, NULL) ==
+               1 &&
+           buffer.num_parts == 2 && buffer.num_points == 6;
+}
+
+static int
+test_not_monotonic(void)
+{
+    /* The first and the last measure are the minimum and the maximum */
+    static const double m[4] = {0.0, 5.0, 3.0, 10.0};
+    char parts_buf[4] = {0}, points_buf[4 * 16], m_buf[4 * 8];
+    shp_polylinem_t line = {0.0, 3.0, 0.0, 0.0, 0.0, 10.0, 1, 4,
+                            NULL, NULL, NULL};
+    shp_pointm_t pointm;
+    size_t i;
+
+    for (i = 0; i < 4; ++i) {
+        shp_double_to_le64((double) i, &points_buf[16 * i]);
+        shp_double_to_le64(0.0, &points_buf[16 * i + 8]);
+        shp_double_to_le64(m[i], &m_buf[8 * i]);
+    }
+    line.parts = parts_buf;
+    line.points = points_buf;
+    line.m_array = m_buf;
+
+    return shp_polylinem_order(&line) == 0 &&
+           shp_polylinem_locate(&line, 0, 4.0, &pointm) == 1 &&
+           pointm.x == 0.8 && pointm.y == 0.0 &&
+           shp_polylinem_extract(&line, 0, 4.0, 4.5, &buffer, NULL) == 1 &&
+           buffer.num_parts == 3 && buffer.num_points == 6;
+}
+
+static int
+test_buffer_too_small(void)
+{
+    shp_buffer_t small;
+    shp_buffer_init(&small, parts, 1, points, 2);
+    return shp_polylinem_extract(&polylinem, order, 1.0, 7.0, &small,
+                                 measures) == 0 &&
+           small.num_parts == 2 && small.num_points == 7;
+}
+
+int
+main(void)
+{
+    plan(9);
+
+    if (read_record("polylinem.shp", &shp_record) <= 0) {
+        return 1;
+    }
+
+    polylinem = shp_record->shape.polylinem;
+    order = shp_polylinem_order(&polylinem);
+    shp_buffer_init(&buffer, parts, 4, points, 16);
+
+    ok(test_locate, "points are located");
+    ok(test_locate_outside, "measures outside the parts are not found");
+    ok(test_extract, "lines are extracted");
+    ok(test_extract_within_segment, "line within a segment is extracted");
+    ok(test_extract_outside, "measures between parts yield no lines");
+    ok(test_order, "order of the measures is determined");
+    ok(test_scan, "measures are scanned");
+    ok(test_not_monotonic, "measures that are not monotonic are scanned");
+    ok(test_buffer_too_small, "required buffer size is returned");
+
+    free(shp_record);
+
+    done_testing();
+}
@@ -0,0 +1,193 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *cube_record;
+shp_record_t *patches_record;
+
+static int
+read_record(const char *filename, shp_record_t **precord)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        rc = shp_read_record(&fh, precord);
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static void
+get_normal(const shp_mesh_t *mesh, size_t i, double n[3])
+{
+    const shp_pointz_t *a, *b, *c;
+    double u[3], v[3];
+
+    a = &mesh->vertices[mesh->indices[3 * i]];
+    b = &mesh->vertices[mesh->indices[3 * i + 1]];
+    c = &mesh->vertices[mesh->indices[3 * i + 2]];
+
+    u[0] = b->x - a->x;
+    u[1] = b->y - a->y;
+    u[2] = b->z - a->z;
+    v[0] = c->x - a->x;
+    v[1] = c->y - a->y;
+    v[2] = c->z - a->z;
+
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static double
+surface_area(const shp_mesh_t *mesh)
+{
+    size_t i;
+    double n[3], sum = 0.0;
+
+    for (i = 0; i < mesh->num_triangles; ++i) {
+        get_normal(mesh, i, n);
+        sum += sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) / 2.0;
+    }
+    return sum;
+}
+
+static double
+volume(const shp_mesh_t *mesh)
+{
+    const shp_pointz_t *a;
+    size_t i;
+    double n[3], sum = 0.0;
+
+    for (i = 0; i < mesh->num_triangles; ++i) {
+        get_normal(mesh, i, n);
+        a = &mesh->vertices[mesh->indices[3 * i]];
+        sum += a->x * n[0] + a->y * n[1] + a->z * n[2];
+    }
+    return sum / 6.0;
+}
+
+static int
+test_cube(void)
+{
+    const shp_multipatch_t *multipatch = &cube_record->shape.multipatch;
+    shp_mesh_t *mesh;
+    int rc;
+
+    if (shp_multipatch_mesh(multipatch, &mesh) <= 0) {
+        return 0;
+    }
+    rc = mesh->num_vertices == 8 && mesh->num_triangles == 12 &&
+         fabs(surface_area(mesh) - 6.0) < 1e-9 &&
+         fabs(fabs(volume(mesh)) - 1.0) < 1e-9;
+    free(mesh);
+    return rc;
+}
+
+static int
+test_patches(void)
+{
+    const shp_multipatch_t *multipatch = &patches_record->shape.multipatch;
+    shp_mesh_t *mesh;
+    int rc;
+
+    if (shp_multipatch_mesh(multipatch, &mesh) <= 0) {
+        return 0;
+    }
+    rc = mesh->num_vertices == 26 && mesh->num_triangles == 22 &&
+         fabs(surface_area(mesh) - 18.0) < 1e-9;
+    free(mesh);
+    return rc;
+}
+
+static int
+test_orientation(void)
+{
+    const shp_multipatch_t *multipatch = &patches_record->shape.multipatch;
+    shp_mesh_t *mesh;
+    size_t i;
+    double n[3];
+    int rc = 1;
+
+    if (shp_multipatch_mesh(multipatch, &mesh) <= 0) {
+        return 0;
+    }
+    /* The strip and the fan face up, the clockwise outer ring faces down */
+    for (i = 0; i < 12; ++i) {
+        get_normal(mesh, i, n);
+        rc = rc && n[0] == 0.0 && n[1] == 0.0 && n[2] != 0.0 &&
+             (i < 4) == (n[2] > 0.0);
+    }
+    free(mesh);
+    return rc;
+}
+
+static int
+test_hole(void)
+{
+    const shp_multipatch_t *multipatch = &patches_record->shape.multipatch;
+    shp_mesh_t *mesh;
+    const shp_pointz_t *a, *b, *c;
+    size_t i;
+    double x, y;
+    int rc = 1;
+
+    if (shp_multipatch_mesh(multipatch, &mesh) <= 0) {
+        return 0;
+    }
+    for (i = 4; i < 12; ++i) {
+        a = &mesh->vertices[mesh->indices[3 * i]];
+        b = &mesh->vertices[mesh->indices[3 * i + 1]];
+        c = &mesh->vertices[mesh->indices[3 * i + 2]];
+        x = (a->x + b->x + c->x) / 3.0;
+        y = (a->y + b->y + c->y) / 3.0;
+        rc = rc && a->z == 1.0 && !(x > 1.0 && x < 3.0 && y > 1.0 && y < 3.0);
+    }
+    free(mesh);
+    return rc;
+}
+
+int
+main(void)
+{
+    plan(4);
+
+    if (read_record("multipatch.shp", &cube_record) <= 0 ||
+        read_record("patches.shp", &patches_record) <= 0) {
+        return 1;
+    }
+
+    ok(test_cube, "cube is converted");
+    ok(test_patches, "strips, fans and rings are converted");
+    ok(test_orientation, "triangles keep their orientation");
+    ok(test_hole, "holes are not filled");
+
+    free(cube_record);
+    free(patches_record);
+
+    done_testing();
+}
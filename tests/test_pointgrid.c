@@ -0,0 +1,262 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_POINTS 2000
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+typedef struct found_t {
+    size_t count;
+    size_t record_numbers[NUM_POINTS];
+} found_t;
+
+static int
+read_pointgrid(FILE *stream, size_t bucket_size,
+               shp_pointgrid_t **ppointgrid)
+{
+    shp_file_t fh;
+    int rc;
+
+    shp_init_file(&fh, stream, NULL);
+    rc = shp_pointgrid_read(&fh, bucket_size, ppointgrid);
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file: %s\n", fh.error);
+    }
+
+    return rc;
+}
+
+static int
+read_file(const char *filename, size_t bucket_size,
+          shp_pointgrid_t **ppointgrid)
+{
+    FILE *stream;
+    int rc;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    rc = read_pointgrid(stream, bucket_size, ppointgrid);
+
+    fclose(stream);
+
+    return rc;
+}
+
+static double
+next_random(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return (double) (*state >> 8) / 16777216.0;
+}
+
+static int
+add_point(const shp_pointgrid_t *pointgrid,
+          const shp_pointgrid_point_t *point, void *user_data)
+{
+    found_t *found = (found_t *) user_data;
+
+    (void) pointgrid;
+    if (found->count < NUM_POINTS) {
+        found->record_numbers[found->count] = point->record_number;
+        ++found->count;
+    }
+    return 1;
+}
+
+static int
+stop_query(const shp_pointgrid_t *pointgrid,
+           const shp_pointgrid_point_t *point, void *user_data)
+{
+    (void) pointgrid;
+    (void) point;
+    ++*(size_t *) user_data;
+    return 0;
+}
+
+static int
+contains(const found_t *found, size_t record_number)
+{
+    size_t i;
+
+    for (i = 0; i < found->count; ++i) {
+        if (found->record_numbers[i] == record_number) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+test_point(void)
+{
+    shp_pointgrid_t *pointgrid;
+    static found_t found;
+    int ok;
+
+    if (read_file("point.shp", 1, &pointgrid) < 0) {
+        return 0;
+    }
+
+    /* Karlsruhe and Mannheim */
+    found.count = 0;
+    ok = pointgrid->num_points == 4 &&
+         shp_pointgrid_search(pointgrid, 8.0, 49.0, 9.0, 49.5, add_point,
+                              &found) == 1 &&
+         found.count == 2 && contains(&found, 2) && contains(&found, 3);
+
+    /* Points on the edges of the grid */
+    found.count = 0;
+    ok = ok &&
+         shp_pointgrid_search(pointgrid, 9.1770, 48.7823, 9.1770, 48.7823,
+                              add_point, &found) == 1 &&
+         found.count == 1 && contains(&found, 4);
+
+    free(pointgrid);
+
+    return ok;
+}
+
+static int
+test_pointz(void)
+{
+    shp_pointgrid_t *pointgrid;
+    const shp_pointgrid_point_t *p;
+    size_t i;
+    int ok;
+
+    if (read_file("pointz.shp", 0, &pointgrid) < 0) {
+        return 0;
+    }
+
+    ok = pointgrid->num_points == 3;
+    for (i = 0; ok && i < pointgrid->num_points; ++i) {
+        p = &pointgrid->points[i];
+        if (p->record_number == 2) {
+            ok = p->point.x == 6.864325 && p->point.y == 45.832544 &&
+                 p->point.z == 4807.81 && p->point.m == 2812 &&
+                 p->file_offset == 100 + 44;
+        }
+    }
+
+    free(pointgrid);
+
+    return ok;
+}
+
+static int
+test_random(void)
+{
+    static double points[NUM_POINTS][2];
+    static found_t found;
+    shp_pointgrid_t *pointgrid = NULL;
+    double x, y, r, dx, dy;
+    uint32_t state = 1;
+    size_t i, j, count;
+    int ok = 0, inside;
+
+    for (i = 0; i < NUM_POINTS; ++i) {
+        points[i][0] = 100.0 * next_random(&state);
+        points[i][1] = 50.0 * next_random(&state);
+    }
+
+    /* The points in scatter.shp are drawn from the same sequence */
+    if (read_file("scatter.shp", 0, &pointgrid) > 0 &&
+        pointgrid->num_points == NUM_POINTS) {
+        ok = 1;
+        for (i = 0; ok && i < 200; ++i) {
+            x = 120.0 * next_random(&state) - 10.0;
+            y = 70.0 * next_random(&state) - 10.0;
+            r = 10.0 * next_random(&state);
+            found.count = 0;
+            if (i % 2 == 0) {
+                shp_pointgrid_search(pointgrid, x, y, x + r, y + r,
+                                     add_point, &found);
+            }
+            else {
+                shp_pointgrid_radius(pointgrid, x, y, r, add_point, &found);
+            }
+            count = 0;
+            for (j = 0; ok && j < NUM_POINTS; ++j) {
+                dx = points[j][0] - x;
+                dy = points[j][1] - y;
+                if (i % 2 == 0) {
+                    inside = dx >= 0.0 && dx <= r && dy >= 0.0 && dy <= r;
+                }
+                else {
+                    inside = dx * dx + dy * dy <= r * r;
+                }
+                if (inside) {
+                    ok = contains(&found, j + 1);
+                    ++count;
+                }
+            }
+            ok = ok && count == found.count;
+        }
+    }
+
+    free(pointgrid);
+
+    return ok;
+}
+
+static int
+test_stop(void)
+{
+    shp_pointgrid_t *pointgrid;
+    size_t count = 0;
+    int ok;
+
+    if (read_file("point.shp", 0, &pointgrid) < 0) {
+        return 0;
+    }
+    ok = shp_pointgrid_radius(pointgrid, 8.5, 48.5, 10.0, stop_query,
+                              &count) == 0 &&
+         count == 1;
+    free(pointgrid);
+    return ok;
+}
+
+static int
+test_invalid(void)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_pointgrid_t *pointgrid;
+    int rc;
+
+    stream = fopen("polygon.shp", "rb");
+    if (stream == NULL) {
+        return 0;
+    }
+    shp_init_file(&fh, stream, NULL);
+    errno = 0;
+    rc = shp_pointgrid_read(&fh, 0, &pointgrid);
+    fclose(stream);
+
+    return rc == -1 && errno == EINVAL && pointgrid == NULL;
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    ok(test_point, "points are found in rectangles");
+    ok(test_pointz, "coordinates are stored inline");
+    ok(test_random, "search finds the same points as a linear search");
+    ok(test_stop, "callback stops the search");
+    ok(test_invalid, "other shape types are rejected");
+
+    done_testing();
+}
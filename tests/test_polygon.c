@@ -2,6 +2,7 @@
 #include "tap.h"
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define UNUSED(x) (void)(x)
@@ -16,6 +17,9 @@ const shp_polygon_t *polygon;
 
 const shx_header_t *shx_header;
 shx_record_t shx_records[6];
+shx_table_t *shx_table;
+FILE *shx_copy;
+FILE *shx_original;
 
 size_t file_offset;
 size_t record_number;
@@ -253,6 +257,82 @@ test_record_size(void)
     return shp_record->record_size == shx_records[record_number].record_size;
 }
 
+static int
+test_load(void)
+{
+    shx_record_t record;
+    size_t i;
+    int ok;
+
+    ok = shx_table != NULL && shx_table->num_records == 6;
+    for (i = 0; ok && i < 6; ++i) {
+        ok = shx_table_record(shx_table, i, &record) == 1 &&
+             record.file_offset == shx_records[i].file_offset &&
+             record.record_size == shx_records[i].record_size;
+    }
+    return ok;
+}
+
+static int
+test_load_eof(void)
+{
+    shx_record_t record;
+
+    return shx_table != NULL && shx_table_record(shx_table, 6, &record) == 0;
+}
+
+static int
+test_load_truncated(void)
+{
+    char buf[100 + 3 * 8];
+    FILE *stream;
+    shx_file_t fh;
+    shx_table_t *table;
+    int ok = 0;
+
+    stream = tmpfile();
+    if (stream == NULL) {
+        return 0;
+    }
+    rewind(shx_original);
+    if (fread(buf, sizeof(buf), 1, shx_original) == 1 &&
+        fwrite(buf, sizeof(buf), 1, stream) == 1) {
+        rewind(stream);
+        shx_init_file(&fh, stream, NULL);
+        errno = 0;
+        ok = shx_load(&fh, &table) == -1 && errno == EINVAL &&
+             table == NULL;
+    }
+    fclose(stream);
+    return ok;
+}
+
+static int
+test_build(void)
+{
+    return test_load() && test_load_eof();
+}
+
+static int
+test_build_write(void)
+{
+    char buf1[BUFSIZ], buf2[BUFSIZ];
+    size_t n1, n2;
+    int ok = 1;
+
+    if (shx_copy == NULL) {
+        return 0;
+    }
+    rewind(shx_copy);
+    rewind(shx_original);
+    do {
+        n1 = fread(buf1, 1, sizeof(buf1), shx_copy);
+        n2 = fread(buf2, 1, sizeof(buf2), shx_original);
+        ok = n1 == n2 && memcmp(buf1, buf2, n1) == 0;
+    } while (ok && n1 > 0);
+    return ok;
+}
+
 static int
 test_seek_first(void)
 {
@@ -371,7 +451,7 @@ main(void)
     shp_file_t shp_fh;
     shx_file_t shx_fh;
 
-    plan(50);
+    plan(55);
 
     shp_stream = fopen(shp_filename, "rb");
     if (shp_stream == NULL) {
@@ -410,6 +490,32 @@ main(void)
     num_bytes = shp_fh.num_bytes;
     ok(test_entire_file_read, "entire file has been read");
 
+    rewind(shx_stream);
+    if (shx_load(&shx_fh, &shx_table) == -1) {
+        fprintf(stderr, "# Cannot load file \"%s\": %s\n", shx_filename,
+                shx_fh.error);
+    }
+    ok(test_load, "index records are loaded");
+    ok(test_load_eof, "record number beyond the loaded records");
+    free(shx_table);
+
+    shx_original = shx_stream;
+    ok(test_load_truncated, "truncated index file is rejected");
+
+    rewind(shp_stream);
+    shp_init_file(&shp_fh, shp_stream, NULL);
+    shx_copy = tmpfile();
+    if (shx_build(&shp_fh, shx_copy, &shx_table) == -1) {
+        fprintf(stderr, "# Cannot build index from \"%s\": %s\n",
+                shp_filename, shp_fh.error);
+    }
+    ok(test_build, "index records are built from the main file");
+    ok(test_build_write, "built index file matches the index file");
+    free(shx_table);
+    if (shx_copy != NULL) {
+        fclose(shx_copy);
+    }
+
     rc = shx_seek_record(&shx_fh, 1, &shx_records[0]);
     ok(test_seek_first, "seek to first record");
 
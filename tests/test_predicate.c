@@ -0,0 +1,310 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *polygon_records[6];
+shp_record_t *islands_records[1];
+shp_record_t *polyline_records[1];
+
+#define NUM_CIRCLE 1000
+
+char square_parts[4];
+char square_points[16 * 5];
+char circle_parts[2][4];
+char circle_points[2][16 * (NUM_CIRCLE + 1)];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static const shp_polygon_t *
+make_square(shp_polygon_t *polygon, double x_min, double y_min, double x_max,
+            double y_max)
+{
+    const double xy[] = {x_min, y_min, x_min, y_max, x_max, y_max,
+                         x_max, y_min, x_min, y_min};
+    size_t i;
+
+    memset(square_parts, 0, sizeof(square_parts));
+    for (i = 0; i < 10; ++i) {
+        shp_double_to_le64(xy[i], &square_points[8 * i]);
+    }
+
+    polygon->x_min = x_min;
+    polygon->y_min = y_min;
+    polygon->x_max = x_max;
+    polygon->y_max = y_max;
+    polygon->num_parts = 1;
+    polygon->num_points = 5;
+    polygon->parts = square_parts;
+    polygon->points = square_points;
+    return polygon;
+}
+
+static const shp_polygon_t *
+make_circle(shp_polygon_t *polygon, int k, double cx, double cy, double r)
+{
+    const double pi = 3.14159265358979323846;
+    double a;
+    size_t i;
+
+    memset(circle_parts[k], 0, sizeof(circle_parts[k]));
+    for (i = 0; i <= NUM_CIRCLE; ++i) {
+        /* Clockwise */
+        a = -2.0 * pi * (double) (i % NUM_CIRCLE) / NUM_CIRCLE;
+        shp_double_to_le64(cx + r * cos(a), &circle_points[k][16 * i]);
+        shp_double_to_le64(cy + r * sin(a), &circle_points[k][16 * i + 8]);
+    }
+
+    polygon->x_min = cx - r;
+    polygon->y_min = cy - r;
+    polygon->x_max = cx + r;
+    polygon->y_max = cy + r;
+    polygon->num_parts = 1;
+    polygon->num_points = NUM_CIRCLE + 1;
+    polygon->parts = circle_parts[k];
+    polygon->points = circle_points[k];
+    return polygon;
+}
+
+static const shp_polygon_t *
+make_ring(shp_polygon_t *polygon, int k, const double (*xy)[2], size_t n)
+{
+    size_t i;
+
+    memset(circle_parts[k], 0, sizeof(circle_parts[k]));
+    polygon->x_min = polygon->x_max = xy[0][0];
+    polygon->y_min = polygon->y_max = xy[0][1];
+    for (i = 0; i < n; ++i) {
+        shp_double_to_le64(xy[i][0], &circle_points[k][16 * i]);
+        shp_double_to_le64(xy[i][1], &circle_points[k][16 * i + 8]);
+        polygon->x_min = fmin(polygon->x_min, xy[i][0]);
+        polygon->y_min = fmin(polygon->y_min, xy[i][1]);
+        polygon->x_max = fmax(polygon->x_max, xy[i][0]);
+        polygon->y_max = fmax(polygon->y_max, xy[i][1]);
+    }
+
+    polygon->num_parts = 1;
+    polygon->num_points = n;
+    polygon->parts = circle_parts[k];
+    polygon->points = circle_points[k];
+    return polygon;
+}
+
+static int
+test_touching_polygons(void)
+{
+    const shp_polygon_t *rectangle = &polygon_records[0]->shape.polygon;
+    const shp_polygon_t *triangle = &polygon_records[1]->shape.polygon;
+
+    /* The triangle's base is on the rectangle's bottom edge and its apex
+     * touches the top edge */
+    return shp_polygon_intersects(rectangle, triangle) == 1 &&
+           shp_polygon_intersects(triangle, rectangle) == 1 &&
+           shp_polygon_contains(rectangle, triangle) == 1 &&
+           shp_polygon_contains(triangle, rectangle) == 0 &&
+           shp_polygon_contains(rectangle, rectangle) == 1;
+}
+
+static int
+test_crossing_polygons(void)
+{
+    const shp_polygon_t *juba = &polygon_records[3]->shape.polygon;
+    const shp_polygon_t *khartoum = &polygon_records[4]->shape.polygon;
+
+    return shp_polygon_intersects(juba, khartoum) == 1 &&
+           shp_polygon_contains(juba, khartoum) == 0 &&
+           shp_polygon_contains(khartoum, juba) == 0;
+}
+
+static int
+test_disjoint_polygons(void)
+{
+    const shp_polygon_t *los_angeles = &polygon_records[2]->shape.polygon;
+    const shp_polygon_t *oslo = &polygon_records[5]->shape.polygon;
+
+    return shp_polygon_intersects(los_angeles, oslo) == 0 &&
+           shp_polygon_contains(los_angeles, oslo) == 0;
+}
+
+static int
+test_holes(void)
+{
+    const shp_polygon_t *islands = &islands_records[0]->shape.polygon;
+    shp_polygon_t square;
+
+    /* In a hole */
+    make_square(&square, 3.0, 3.0, 3.5, 3.5);
+    if (shp_polygon_intersects(islands, &square) != 0 ||
+        shp_polygon_contains(islands, &square) != 0) {
+        return 0;
+    }
+
+    /* On the island in the hole */
+    make_square(&square, 4.5, 4.5, 5.5, 5.5);
+    if (shp_polygon_intersects(islands, &square) != 1 ||
+        shp_polygon_contains(islands, &square) != 1) {
+        return 0;
+    }
+
+    /* Exactly the hole */
+    make_square(&square, 22.0, 2.0, 24.0, 4.0);
+    if (shp_polygon_intersects(islands, &square) != 1 ||
+        shp_polygon_contains(islands, &square) != 0) {
+        return 0;
+    }
+
+    /* Around the hole */
+    make_square(&square, 1.0, 1.0, 9.0, 9.0);
+    return shp_polygon_intersects(islands, &square) == 1 &&
+           shp_polygon_intersects(&square, islands) == 1 &&
+           shp_polygon_contains(islands, &square) == 0 &&
+           shp_polygon_contains(&square, islands) == 0;
+}
+
+static int
+test_polyline(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    shp_polygon_t square;
+
+    make_square(&square, 0.0, 0.0, 4.0, 4.0);
+    if (shp_polyline_intersects_polygon(polyline, &square) != 1 ||
+        shp_polygon_contains_polyline(&square, polyline) != 1) {
+        return 0;
+    }
+
+    make_square(&square, 2.5, 0.0, 4.0, 4.0);
+    if (shp_polyline_intersects_polygon(polyline, &square) != 1 ||
+        shp_polygon_contains_polyline(&square, polyline) != 0) {
+        return 0;
+    }
+
+    make_square(&square, 1.5, 1.9, 2.5, 2.1);
+    if (shp_polyline_intersects_polygon(polyline, &square) != 1 ||
+        shp_polygon_contains_polyline(&square, polyline) != 0) {
+        return 0;
+    }
+
+    make_square(&square, 3.5, 0.0, 4.0, 4.0);
+    return shp_polyline_intersects_polygon(polyline, &square) == 0 &&
+           shp_polygon_contains_polyline(&square, polyline) == 0;
+}
+
+static int
+test_notch(void)
+{
+    static const double u[][2] = {{0, 0},  {0, 10}, {4, 10},
+                                  {4, 4},  {6, 4},  {6, 10},
+                                  {10, 10}, {10, 0}, {0, 0}};
+    static const double bridge[][2] = {{2, 6}, {2, 8}, {4, 8},
+                                       {6, 8}, {8, 8}, {8, 6},
+                                       {6, 6}, {4, 6}, {2, 6}};
+    static const double arm[][2] = {{1, 6}, {1, 8}, {4, 8},
+                                    {4, 6}, {1, 6}};
+    shp_polygon_t outer, inner;
+
+    /* The rectangle's boundary meets the notch only in vertices */
+    make_ring(&outer, 0, u, 9);
+    make_ring(&inner, 1, bridge, 9);
+    if (shp_polygon_intersects(&outer, &inner) != 1 ||
+        shp_polygon_contains(&outer, &inner) != 0) {
+        return 0;
+    }
+
+    /* A rectangle that shares an edge with the notch */
+    make_ring(&inner, 1, arm, 5);
+    return shp_polygon_contains(&outer, &inner) == 1;
+}
+
+static int
+test_many_segments(void)
+{
+    shp_polygon_t outer, inner;
+
+    make_circle(&outer, 0, 0.0, 0.0, 1.0);
+    make_circle(&inner, 1, 0.0, 0.0, 0.5);
+    if (shp_polygon_intersects(&outer, &inner) != 1 ||
+        shp_polygon_contains(&outer, &inner) != 1 ||
+        shp_polygon_contains(&inner, &outer) != 0) {
+        return 0;
+    }
+
+    make_circle(&inner, 1, 0.75, 0.0, 0.5);
+    if (shp_polygon_intersects(&outer, &inner) != 1 ||
+        shp_polygon_contains(&outer, &inner) != 0) {
+        return 0;
+    }
+
+    make_circle(&inner, 1, 1.75, 0.0, 0.5);
+    return shp_polygon_intersects(&outer, &inner) == 0;
+}
+
+int
+main(void)
+{
+    size_t i;
+
+    plan(7);
+
+    if (read_records("polygon.shp", polygon_records, 6) <= 0 ||
+        read_records("islands.shp", islands_records, 1) <= 0 ||
+        read_records("polyline.shp", polyline_records, 1) <= 0) {
+        return 1;
+    }
+
+    ok(test_touching_polygons, "touching polygons");
+    ok(test_crossing_polygons, "crossing polygons");
+    ok(test_disjoint_polygons, "disjoint polygons");
+    ok(test_holes, "polygons with holes");
+    ok(test_polyline, "PolyLine and polygon");
+    ok(test_notch, "polygon bridging a notch");
+    ok(test_many_segments, "polygons with many segments");
+
+    for (i = 0; i < 6; ++i) {
+        free(polygon_records[i]);
+    }
+    free(islands_records[0]);
+    free(polyline_records[0]);
+
+    done_testing();
+}
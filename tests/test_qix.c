@@ -0,0 +1,303 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_BOXES 1000
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+static int
+write_index(const char *filename, unsigned int max_depth, FILE *qix_stream)
+{
+    FILE *stream;
+    shp_file_t fh;
+    int rc;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    rc = qix_write_index(&fh, max_depth, qix_stream);
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot write index: %s\n", fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+search(FILE *stream, double x_min, double y_min, double x_max, double y_max,
+       size_t **precord_numbers, size_t *pnum_records)
+{
+    qix_file_t fh;
+    int rc;
+
+    qix_init_file(&fh, stream, NULL);
+    rc = qix_search(&fh, x_min, y_min, x_max, y_max, precord_numbers,
+                    pnum_records);
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot search index: %s\n", fh.error);
+    }
+
+    return rc;
+}
+
+static int
+contains(const size_t *record_numbers, size_t num_records,
+         size_t record_number)
+{
+    size_t i;
+
+    for (i = 0; i < num_records; ++i) {
+        if (record_numbers[i] == record_number) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static double
+next_random(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return (double) (*state >> 8) / 16777216.0;
+}
+
+static int
+test_polygon(void)
+{
+    FILE *stream;
+    char buf[16];
+    size_t *record_numbers = NULL, num_records, i;
+    int ok = 0;
+
+    stream = tmpfile();
+    if (stream == NULL) {
+        return 0;
+    }
+    if (write_index("polygon.shp", 4, stream) < 0) {
+        goto cleanup;
+    }
+
+    rewind(stream);
+    if (fread(buf, 1, 16, stream) != 16 || memcmp(buf, "SQT\1\1", 5) != 0 ||
+        buf[8] != 6 || buf[12] != 4) {
+        goto cleanup;
+    }
+
+    if (search(stream, -180.0, -90.0, 180.0, 90.0, &record_numbers,
+               &num_records) < 0 ||
+        num_records != 6) {
+        goto cleanup;
+    }
+    for (i = 0; i < num_records; ++i) {
+        if (record_numbers[i] != i) {
+            goto cleanup;
+        }
+    }
+    free(record_numbers);
+    record_numbers = NULL;
+
+    /* Africa */
+    if (search(stream, 30.0, 10.0, 31.0, 11.0, &record_numbers,
+               &num_records) < 0 ||
+        !contains(record_numbers, num_records, 3) ||
+        !contains(record_numbers, num_records, 4) ||
+        contains(record_numbers, num_records, 2)) {
+        goto cleanup;
+    }
+    free(record_numbers);
+    record_numbers = NULL;
+
+    if (search(stream, 200.0, 0.0, 210.0, 10.0, &record_numbers,
+               &num_records) < 0) {
+        goto cleanup;
+    }
+    ok = num_records == 0;
+
+cleanup:
+
+    free(record_numbers);
+    fclose(stream);
+
+    return ok;
+}
+
+static int
+test_random(void)
+{
+    static double boxes[NUM_BOXES][4];
+    FILE *qix_stream;
+    size_t *record_numbers, num_records, total = 0, i, j;
+    double query[4], x, y;
+    uint32_t state = 1;
+    int ok = 0, overlaps;
+
+    for (i = 0; i < NUM_BOXES; ++i) {
+        x = 100.0 * next_random(&state);
+        y = 100.0 * next_random(&state);
+        boxes[i][0] = x;
+        boxes[i][1] = y;
+        boxes[i][2] = x + 5.0 * next_random(&state);
+        boxes[i][3] = y + 5.0 * next_random(&state);
+    }
+
+    qix_stream = tmpfile();
+    if (qix_stream == NULL) {
+        return 0;
+    }
+
+    /* The boxes in boxes.shp are drawn from the same sequence */
+    if (write_index("boxes.shp", 0, qix_stream) < 0) {
+        goto cleanup;
+    }
+
+    ok = 1;
+    for (i = 0; ok && i < 200; ++i) {
+        query[0] = 100.0 * next_random(&state);
+        query[1] = 100.0 * next_random(&state);
+        query[2] = query[0] + 10.0 * next_random(&state);
+        query[3] = query[1] + 10.0 * next_random(&state);
+        if (search(qix_stream, query[0], query[1], query[2], query[3],
+                   &record_numbers, &num_records) < 0) {
+            ok = 0;
+            break;
+        }
+        for (j = 1; ok && j < num_records; ++j) {
+            ok = record_numbers[j - 1] < record_numbers[j];
+        }
+        for (j = 0; ok && j < NUM_BOXES; ++j) {
+            overlaps = boxes[j][0] <= query[2] && boxes[j][2] >= query[0] &&
+                       boxes[j][1] <= query[3] && boxes[j][3] >= query[1];
+            ok = !overlaps || contains(record_numbers, num_records, j);
+        }
+        total += num_records;
+        free(record_numbers);
+    }
+
+    /* Most records are skipped */
+    ok = ok && total < 200 * NUM_BOXES / 4;
+
+cleanup:
+
+    fclose(qix_stream);
+
+    return ok;
+}
+
+static int
+test_old_format(void)
+{
+    FILE *stream, *old_stream;
+    char buf[4096];
+    size_t *record_numbers = NULL, num_records, n;
+    int ok = 0;
+
+    stream = tmpfile();
+    old_stream = tmpfile();
+    if (stream == NULL || old_stream == NULL) {
+        goto cleanup;
+    }
+    if (write_index("polygon.shp", 4, stream) < 0) {
+        goto cleanup;
+    }
+
+    /* Older files have no signature. */
+    rewind(stream);
+    n = fread(buf, 1, sizeof(buf), stream);
+    if (n <= 8 || fwrite(&buf[8], 1, n - 8, old_stream) != n - 8) {
+        goto cleanup;
+    }
+
+    if (search(old_stream, 10.5, 59.5, 10.6, 59.6, &record_numbers,
+               &num_records) < 0) {
+        goto cleanup;
+    }
+    ok = contains(record_numbers, num_records, 5) &&
+         !contains(record_numbers, num_records, 2);
+
+cleanup:
+
+    free(record_numbers);
+    if (old_stream != NULL) {
+        fclose(old_stream);
+    }
+    if (stream != NULL) {
+        fclose(stream);
+    }
+
+    return ok;
+}
+
+static int
+test_invalid(void)
+{
+    FILE *stream;
+    qix_file_t fh;
+    size_t *record_numbers, num_records;
+    int ok = 0;
+
+    stream = tmpfile();
+    if (stream == NULL) {
+        return 0;
+    }
+
+    /* Unsupported version */
+    qix_init_file(&fh, stream, NULL);
+    if (fwrite("SQT\1\2\0\0\0\0\0\0\0\0\0\0\0", 16, 1, stream) == 1 &&
+        qix_search(&fh, 0.0, 0.0, 1.0, 1.0, &record_numbers,
+                   &num_records) == -1 &&
+        record_numbers == NULL) {
+        /* Truncated node */
+        rewind(stream);
+        ok = fwrite("SQT\1\1\0\0\0\0\0\0\0\0\0\0\0", 16, 1, stream) == 1 &&
+             qix_search(&fh, 0.0, 0.0, 1.0, 1.0, &record_numbers,
+                        &num_records) == -1 &&
+             errno == EINVAL;
+    }
+
+    fclose(stream);
+
+    return ok;
+}
+
+static int
+test_depth(void)
+{
+    FILE *stream;
+    int ok = 0;
+
+    stream = tmpfile();
+    if (stream != NULL) {
+        errno = 0;
+        ok = write_index("polygon.shp", 65, stream) == -1 && errno == EINVAL;
+        fclose(stream);
+    }
+
+    return ok;
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    ok(test_polygon, "polygons are indexed");
+    ok(test_random, "search finds the same boxes as a linear search");
+    ok(test_old_format, "files without signature are read");
+    ok(test_invalid, "invalid files are rejected");
+    ok(test_depth, "invalid depths are rejected");
+
+    done_testing();
+}
@@ -0,0 +1,173 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *polygon_records[1];
+shp_record_t *islands_records[1];
+
+unsigned char mask[16];
+double coverage[100];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static size_t
+count_bits(size_t n)
+{
+    size_t i, count = 0;
+
+    for (i = 0; i < n; ++i) {
+        if (mask[i / 8] & (1U << (i % 8))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+static int
+is_set(const shp_grid_t *grid, size_t col, size_t row)
+{
+    size_t i = row * grid->num_cols + col;
+    return (mask[i / 8] & (1U << (i % 8))) != 0;
+}
+
+static double
+sum_coverage(size_t n)
+{
+    size_t i;
+    double sum = 0.0;
+
+    for (i = 0; i < n; ++i) {
+        sum += coverage[i];
+    }
+    return sum;
+}
+
+static int
+is_close(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+static int
+test_rectangle_mask(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    const shp_grid_t grid = {0.0, 0.0, 0.1, 0.1, 10, 10};
+    memset(mask, 0, sizeof(mask));
+    return shp_polygon_mask(polygon, &grid, mask) == 1 &&
+           count_bits(100) == 36 && is_set(&grid, 2, 2) &&
+           is_set(&grid, 7, 7) && !is_set(&grid, 1, 2) &&
+           !is_set(&grid, 8, 7);
+}
+
+static int
+test_rectangle_coverage(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    const shp_grid_t grid = {0.05, 0.05, 0.1, 0.1, 10, 10};
+    shp_polygon_coverage(polygon, &grid, coverage);
+    return is_close(sum_coverage(100), 36.0) &&
+           is_close(coverage[1 * 10 + 1], 0.25) &&
+           is_close(coverage[1 * 10 + 2], 0.5) &&
+           is_close(coverage[3 * 10 + 3], 1.0) &&
+           is_close(coverage[8 * 10 + 8], 0.0);
+}
+
+static int
+test_grid_larger_than_polygon(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    const shp_grid_t grid = {-1.0, -1.0, 1.0, 1.0, 4, 4};
+    memset(mask, 0, sizeof(mask));
+    shp_polygon_coverage(polygon, &grid, coverage);
+    return shp_polygon_mask(polygon, &grid, mask) == 1 &&
+           count_bits(16) == 1 && is_set(&grid, 1, 1) &&
+           is_close(sum_coverage(16), 0.36) &&
+           is_close(coverage[1 * 4 + 1], 0.36);
+}
+
+static int
+test_polygon_larger_than_grid(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    const shp_grid_t grid = {0.3, 0.4, 0.1, 0.1, 4, 2};
+    memset(mask, 0, sizeof(mask));
+    shp_polygon_coverage(polygon, &grid, coverage);
+    return shp_polygon_mask(polygon, &grid, mask) == 1 &&
+           count_bits(8) == 8 && is_close(sum_coverage(8), 8.0);
+}
+
+static int
+test_holes(void)
+{
+    const shp_polygon_t *polygon = &islands_records[0]->shape.polygon;
+    const shp_grid_t grid = {0.0, 0.0, 1.0, 1.0, 10, 10};
+    memset(mask, 0, sizeof(mask));
+    shp_polygon_coverage(polygon, &grid, coverage);
+    return shp_polygon_mask(polygon, &grid, mask) == 1 &&
+           count_bits(100) == 68 && !is_set(&grid, 3, 3) &&
+           is_set(&grid, 5, 5) && is_close(sum_coverage(100), 68.0) &&
+           is_close(coverage[3 * 10 + 3], 0.0) &&
+           is_close(coverage[5 * 10 + 5], 1.0);
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    if (read_records("polygon.shp", polygon_records, 1) <= 0 ||
+        read_records("islands.shp", islands_records, 1) <= 0) {
+        return 1;
+    }
+
+    ok(test_rectangle_mask, "rectangle is rasterized");
+    ok(test_rectangle_coverage, "coverage of rectangle is computed");
+    ok(test_grid_larger_than_polygon, "polygon inside a cell");
+    ok(test_polygon_larger_than_grid, "grid inside the polygon");
+    ok(test_holes, "holes are not covered");
+
+    free(polygon_records[0]);
+    free(islands_records[0]);
+
+    done_testing();
+}
@@ -0,0 +1,115 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_header_t shp_header;
+shp_record_t *shp_record;
+const shp_polygon_t *polygon;
+
+shp_ring_t rings[6];
+size_t num_outer_rings;
+
+static int
+test_num_outer_rings(void)
+{
+    return num_outer_rings == 3;
+}
+
+static int
+test_areas(void)
+{
+    return rings[0].area == -100.0 && rings[1].area == -100.0 &&
+           rings[2].area == 36.0 && rings[3].area == -4.0 &&
+           rings[4].area == 4.0 && rings[5].area == 4.0;
+}
+
+static int
+test_bounding_box(void)
+{
+    return rings[2].x_min == 2.0 && rings[2].x_max == 8.0 &&
+           rings[2].y_min == 2.0 && rings[2].y_max == 8.0;
+}
+
+static int
+test_outer_rings(void)
+{
+    return rings[0].outer_ring == 0 && rings[1].outer_ring == 1 &&
+           rings[3].outer_ring == 3;
+}
+
+static int
+test_hole_in_first_ring(void)
+{
+    return rings[2].outer_ring == 0 && rings[0].next_hole == 2 &&
+           rings[2].next_hole == SHP_RING_NONE;
+}
+
+static int
+test_hole_in_second_ring(void)
+{
+    return rings[4].outer_ring == 1 && rings[1].next_hole == 4 &&
+           rings[4].next_hole == SHP_RING_NONE;
+}
+
+static int
+test_island_has_no_holes(void)
+{
+    return rings[3].next_hole == SHP_RING_NONE;
+}
+
+static int
+test_orphan_hole(void)
+{
+    return rings[5].outer_ring == SHP_RING_NONE &&
+           rings[5].next_hole == SHP_RING_NONE;
+}
+
+int
+main(void)
+{
+    const char *shp_filename = "islands.shp";
+    FILE *shp_stream;
+    shp_file_t shp_fh;
+
+    plan(8);
+
+    shp_stream = fopen(shp_filename, "rb");
+    if (shp_stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", shp_filename,
+                strerror(errno));
+        return 1;
+    }
+
+    shp_init_file(&shp_fh, shp_stream, NULL);
+
+    if (shp_read_header(&shp_fh, &shp_header) <= 0 ||
+        shp_read_record(&shp_fh, &shp_record) <= 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", shp_filename,
+                shp_fh.error);
+        return 1;
+    }
+
+    polygon = &shp_record->shape.polygon;
+    num_outer_rings = shp_polygon_rings(polygon, rings);
+
+    ok(test_num_outer_rings, "polygon has three outer rings");
+    ok(test_areas, "signed areas match");
+    ok(test_bounding_box, "bounding box matches");
+    ok(test_outer_rings, "outer rings are their own outer rings");
+    ok(test_hole_in_first_ring, "hole belongs to first ring");
+    ok(test_hole_in_second_ring, "hole belongs to second ring");
+    ok(test_island_has_no_holes, "island has no holes");
+    ok(test_orphan_hole, "hole without outer ring is detected");
+
+    free(shp_record);
+
+    fclose(shp_stream);
+
+    done_testing();
+}
@@ -0,0 +1,320 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_BOXES 1000
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+typedef struct found_t {
+    size_t count;
+    size_t record_numbers[NUM_BOXES];
+    size_t file_offsets[NUM_BOXES];
+} found_t;
+
+static int
+read_rtree(FILE *stream, size_t node_size, shp_rtree_t **prtree)
+{
+    shp_file_t fh;
+    int rc;
+
+    shp_init_file(&fh, stream, NULL);
+    rc = shp_rtree_read(&fh, node_size, prtree);
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file: %s\n", fh.error);
+    }
+
+    return rc;
+}
+
+static int
+read_file(const char *filename, size_t node_size, shp_rtree_t **prtree)
+{
+    FILE *stream;
+    int rc;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    rc = read_rtree(stream, node_size, prtree);
+
+    fclose(stream);
+
+    return rc;
+}
+
+static double
+next_random(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return (double) (*state >> 8) / 16777216.0;
+}
+
+static int
+add_entry(const shp_rtree_t *rtree, const shp_rtree_entry_t *entry,
+          void *user_data)
+{
+    found_t *found = (found_t *) user_data;
+
+    (void) rtree;
+    if (found->count < NUM_BOXES) {
+        found->record_numbers[found->count] = entry->record_number;
+        found->file_offsets[found->count] = entry->file_offset;
+        ++found->count;
+    }
+    return 1;
+}
+
+static int
+stop_query(const shp_rtree_t *rtree, const shp_rtree_entry_t *entry,
+           void *user_data)
+{
+    (void) rtree;
+    (void) entry;
+    ++*(size_t *) user_data;
+    return 0;
+}
+
+static int
+contains(const found_t *found, size_t record_number)
+{
+    size_t i;
+
+    for (i = 0; i < found->count; ++i) {
+        if (found->record_numbers[i] == record_number) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+test_polygon(void)
+{
+    shp_rtree_t *rtree;
+    static found_t found;
+    int ok;
+
+    if (read_file("polygon.shp", 2, &rtree) < 0) {
+        return 0;
+    }
+
+    /* 6 entries, 3 nodes, 2 nodes and the root */
+    ok = rtree->num_entries == 6 && rtree->num_nodes == 6 &&
+         rtree->num_levels == 3 && rtree->levels[3] == 6 &&
+         rtree->nodes[5].x_min == -126.0 && rtree->nodes[5].y_max == 60.0;
+
+    /* Africa */
+    found.count = 0;
+    ok = ok &&
+         shp_rtree_search(rtree, 30.0, 10.0, 31.0, 11.0, add_entry,
+                          &found) == 1 &&
+         found.count == 2 && contains(&found, 4) && contains(&found, 5);
+
+    free(rtree);
+
+    return ok;
+}
+
+static int
+test_file_offset(void)
+{
+    FILE *stream;
+    shx_file_t fh;
+    shx_record_t index;
+    shp_rtree_t *rtree;
+    static found_t found;
+    size_t i;
+    int ok = 0;
+
+    if (read_file("polygon.shp", 0, &rtree) < 0) {
+        return 0;
+    }
+
+    found.count = 0;
+    shp_rtree_search(rtree, -180.0, -90.0, 180.0, 90.0, add_entry, &found);
+
+    stream = fopen("polygon.shx", "rb");
+    if (stream != NULL) {
+        shx_init_file(&fh, stream, NULL);
+        ok = found.count == 6;
+        for (i = 0; ok && i < found.count; ++i) {
+            ok = shx_seek_record(&fh, found.record_numbers[i] - 1, &index) >
+                     0 &&
+                 index.file_offset == found.file_offsets[i];
+        }
+        fclose(stream);
+    }
+
+    free(rtree);
+
+    return ok;
+}
+
+static int
+test_random(void)
+{
+    static double boxes[NUM_BOXES][4];
+    static found_t found;
+    shp_rtree_t *rtree = NULL;
+    double query[4], x, y;
+    uint32_t state = 1;
+    size_t i, j, count;
+    int ok = 0, overlaps;
+
+    for (i = 0; i < NUM_BOXES; ++i) {
+        x = 100.0 * next_random(&state);
+        y = 100.0 * next_random(&state);
+        boxes[i][0] = x;
+        boxes[i][1] = y;
+        boxes[i][2] = x + 5.0 * next_random(&state);
+        boxes[i][3] = y + 5.0 * next_random(&state);
+    }
+
+    /* The boxes in boxes.shp are drawn from the same sequence */
+    if (read_file("boxes.shp", 7, &rtree) > 0 &&
+        rtree->num_entries == NUM_BOXES) {
+        ok = 1;
+        for (i = 0; ok && i < 200; ++i) {
+            query[0] = 100.0 * next_random(&state);
+            query[1] = 100.0 * next_random(&state);
+            query[2] = query[0] + 10.0 * next_random(&state);
+            query[3] = query[1] + 10.0 * next_random(&state);
+            found.count = 0;
+            shp_rtree_search(rtree, query[0], query[1], query[2], query[3],
+                             add_entry, &found);
+            count = 0;
+            for (j = 0; ok && j < NUM_BOXES; ++j) {
+                overlaps = boxes[j][0] <= query[2] &&
+                           boxes[j][2] >= query[0] &&
+                           boxes[j][1] <= query[3] &&
+                           boxes[j][3] >= query[1];
+                if (overlaps) {
+                    ok = contains(&found, j + 1);
+                    ++count;
+                }
+            }
+            ok = ok && count == found.count;
+        }
+    }
+
+    free(rtree);
+
+    return ok;
+}
+
+static int
+test_stop(void)
+{
+    shp_rtree_t *rtree;
+    size_t count = 0;
+    int ok;
+
+    if (read_file("polygon.shp", 2, &rtree) < 0) {
+        return 0;
+    }
+    ok = shp_rtree_search(rtree, -180.0, -90.0, 180.0, 90.0, stop_query,
+                          &count) == 0 &&
+         count == 1;
+    free(rtree);
+    return ok;
+}
+
+static int
+test_empty(void)
+{
+    shp_rtree_t *rtree;
+    size_t count = 0;
+    int ok;
+
+    /* Null shapes are skipped */
+    if (read_file("null.shp", 0, &rtree) < 0) {
+        return 0;
+    }
+    ok = rtree->num_entries == 0 && rtree->num_nodes == 0 &&
+         shp_rtree_search(rtree, -180.0, -90.0, 180.0, 90.0, stop_query,
+                          &count) == 1 &&
+         count == 0;
+    free(rtree);
+    if (!ok) {
+        return 0;
+    }
+
+    errno = 0;
+    return read_file("polygon.shp", 1, &rtree) == -1 && errno == EINVAL &&
+           rtree == NULL;
+}
+
+static int
+test_zm(void)
+{
+    shp_rtree_t *rtree;
+    static found_t found;
+    int ok;
+
+    if (read_file("pointz.shp", 0, &rtree) < 0) {
+        return 0;
+    }
+
+    /* Mountains between 3000 and 4000 m */
+    found.count = 0;
+    ok = shp_rtree_search_zm(rtree, -180.0, -90.0, 180.0, 90.0, 3000.0,
+                             4000.0, -HUGE_VAL, HUGE_VAL, add_entry,
+                             &found) == 1 &&
+         found.count == 1 && contains(&found, 1);
+
+    /* Measures up to 200 */
+    found.count = 0;
+    ok = ok &&
+         shp_rtree_search_zm(rtree, -180.0, -90.0, 180.0, 90.0, -HUGE_VAL,
+                             HUGE_VAL, 0.0, 200.0, add_entry, &found) == 1 &&
+         found.count == 2 && contains(&found, 1) && contains(&found, 3);
+
+    ok = ok && rtree->nodes[rtree->num_nodes - 1].z_min == 2962.06 &&
+         rtree->nodes[rtree->num_nodes - 1].m_max == 2812;
+    free(rtree);
+    if (!ok) {
+        return 0;
+    }
+
+    /* Shapes without Z coordinates are only found by unbounded ranges */
+    if (read_file("polygon.shp", 0, &rtree) < 0) {
+        return 0;
+    }
+    found.count = 0;
+    ok = shp_rtree_search_zm(rtree, -180.0, -90.0, 180.0, 90.0, 0.0, 1.0,
+                             -HUGE_VAL, HUGE_VAL, add_entry, &found) == 1 &&
+         found.count == 0 &&
+         shp_rtree_search_zm(rtree, -180.0, -90.0, 180.0, 90.0, -HUGE_VAL,
+                             HUGE_VAL, -HUGE_VAL, HUGE_VAL, add_entry,
+                             &found) == 1 &&
+         found.count == 6;
+    free(rtree);
+
+    return ok;
+}
+
+int
+main(void)
+{
+    plan(6);
+
+    ok(test_polygon, "polygons are packed");
+    ok(test_file_offset, "entries have the file offsets from the index");
+    ok(test_random, "search finds the same boxes as a linear search");
+    ok(test_stop, "callback stops the search");
+    ok(test_empty, "empty trees and invalid node sizes are handled");
+    ok(test_zm, "Z and M ranges prune the search");
+
+    done_testing();
+}
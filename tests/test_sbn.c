@@ -0,0 +1,215 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+sbn_index_t *polygon_index;
+
+static int
+read_index(FILE *stream, sbn_index_t **pindex)
+{
+    sbn_file_t fh;
+    int rc;
+
+    sbn_init_file(&fh, stream, NULL);
+    rc = sbn_read_index(&fh, pindex);
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file: %s\n", fh.error);
+    }
+
+    return rc;
+}
+
+static int
+read_file(const char *filename, sbn_index_t **pindex)
+{
+    FILE *stream;
+    int rc;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    rc = read_index(stream, pindex);
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+records_equal(const size_t *record_numbers, size_t num_records,
+              const size_t *expected, size_t n)
+{
+    size_t i;
+
+    if (num_records != n) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        if (record_numbers[i] != expected[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+test_index(void)
+{
+    const sbn_index_t *index = polygon_index;
+
+    return index->num_shapes == 6 && index->num_nodes == 7 &&
+           index->num_features == 6 && index->offsets[7] == 6 &&
+           index->x_min == -126.0 && index->y_min == 0.0 &&
+           index->x_max == 39.06 && index->y_max == 60.0;
+}
+
+static int
+test_search(void)
+{
+    const size_t all[] = {0, 1, 2, 3, 4, 5};
+    const size_t africa[] = {3, 4};
+    size_t *record_numbers, num_records;
+    int ok;
+
+    if (sbn_search(polygon_index, -180.0, -90.0, 180.0, 90.0,
+                   &record_numbers, &num_records) != 1) {
+        return 0;
+    }
+    ok = records_equal(record_numbers, num_records, all, 6);
+    free(record_numbers);
+    if (!ok) {
+        return 0;
+    }
+
+    if (sbn_search(polygon_index, 30.0, 10.0, 31.0, 11.0, &record_numbers,
+                   &num_records) != 1) {
+        return 0;
+    }
+    ok = records_equal(record_numbers, num_records, africa, 2);
+    free(record_numbers);
+    return ok;
+}
+
+static int
+test_outside(void)
+{
+    size_t *record_numbers, num_records;
+    int ok;
+
+    if (sbn_search(polygon_index, 100.0, 0.0, 110.0, 10.0, &record_numbers,
+                   &num_records) != 1) {
+        return 0;
+    }
+    ok = num_records == 0;
+    free(record_numbers);
+    return ok;
+}
+
+static int
+test_seek(void)
+{
+    FILE *shp_stream = NULL, *shx_stream = NULL;
+    shp_file_t shp_fh;
+    shx_file_t shx_fh;
+    shx_record_t index;
+    shp_record_t *record = NULL;
+    size_t *record_numbers = NULL, num_records;
+    int ok = 0;
+
+    /* Oslo */
+    if (sbn_search(polygon_index, 10.5, 59.5, 10.6, 59.6, &record_numbers,
+                   &num_records) != 1 ||
+        num_records != 1 || record_numbers[0] != 5) {
+        goto cleanup;
+    }
+
+    shp_stream = fopen("polygon.shp", "rb");
+    shx_stream = fopen("polygon.shx", "rb");
+    if (shp_stream == NULL || shx_stream == NULL) {
+        goto cleanup;
+    }
+
+    shp_init_file(&shp_fh, shp_stream, NULL);
+    shx_init_file(&shx_fh, shx_stream, NULL);
+    if (shx_seek_record(&shx_fh, record_numbers[0], &index) > 0 &&
+        shp_seek_record(&shp_fh, index.file_offset, &record) > 0) {
+        ok = record->record_number == 6 &&
+             record->shape.polygon.x_min == 10.0;
+        free(record);
+    }
+
+cleanup:
+
+    if (shx_stream != NULL) {
+        fclose(shx_stream);
+    }
+    if (shp_stream != NULL) {
+        fclose(shp_stream);
+    }
+    free(record_numbers);
+
+    return ok;
+}
+
+static int
+test_invalid(void)
+{
+    char buf[120];
+    sbn_index_t *index;
+    FILE *stream;
+    size_t n = 0;
+    int ok = 0;
+
+    if (read_file("polygon.shp", &index) != -1 || index != NULL) {
+        return 0;
+    }
+
+    /* A truncated file */
+    stream = fopen("polygon.sbn", "rb");
+    if (stream != NULL) {
+        n = fread(buf, 1, sizeof(buf), stream);
+        fclose(stream);
+    }
+    if (n != sizeof(buf)) {
+        return 0;
+    }
+
+    stream = tmpfile();
+    if (stream == NULL) {
+        return 0;
+    }
+    if (fwrite(buf, sizeof(buf), 1, stream) == 1) {
+        rewind(stream);
+        ok = read_index(stream, &index) == -1 && index == NULL;
+    }
+    fclose(stream);
+
+    return ok;
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    if (read_file("polygon.sbn", &polygon_index) > 0) {
+        ok(test_index, "index is read");
+        ok(test_search, "search returns candidates");
+        ok(test_outside, "search outside the extent returns nothing");
+        ok(test_seek, "candidates are passed to shx_seek_record");
+        free(polygon_index);
+    }
+    ok(test_invalid, "invalid files are rejected");
+
+    done_testing();
+}
@@ -0,0 +1,183 @@
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *polyline_records[2];
+shp_record_t *polygon_records[1];
+
+double importance[16];
+size_t parts[16];
+shp_point_t points[64];
+shp_buffer_t buffer;
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+is_close(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+/*
+ * PolyLine tests
+ */
+
+static int
+test_douglas_peucker_rank(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[1]->shape.polyline;
+    return shp_polyline_rank(polyline, SHP_SIMPLIFY_DOUGLAS_PEUCKER,
+                             importance) == 1 &&
+           importance[0] == HUGE_VAL && importance[2] == HUGE_VAL &&
+           is_close(importance[1], sqrt(0.5)) && importance[3] == HUGE_VAL &&
+           is_close(importance[4], sqrt(0.5));
+}
+
+static int
+test_visvalingam_rank(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[1]->shape.polyline;
+    return shp_polyline_rank(polyline, SHP_SIMPLIFY_VISVALINGAM,
+                             importance) == 1 &&
+           importance[0] == HUGE_VAL && is_close(importance[1], 0.5) &&
+           is_close(importance[4], 0.5);
+}
+
+static int
+test_select_points(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[1]->shape.polyline;
+    size_t start, end;
+    return shp_polyline_rank(polyline, SHP_SIMPLIFY_DOUGLAS_PEUCKER,
+                             importance) == 1 &&
+           shp_polyline_select(polyline, importance, 0.8, &buffer) == 1 &&
+           buffer.num_parts == 2 && buffer.num_points == 4 &&
+           shp_buffer_points(&buffer, 1, &start, &end) == 2 &&
+           points[start].x == 2.0 && points[start].y == 1.0 &&
+           points[end - 1].x == 3.0 && points[end - 1].y == 2.0 &&
+           shp_polyline_select(polyline, importance, 0.5, &buffer) == 1 &&
+           buffer.num_points == 6;
+}
+
+static int
+test_straight_lines(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[0]->shape.polyline;
+    return shp_polyline_simplify(polyline, SHP_SIMPLIFY_VISVALINGAM, 100.0,
+                                 &buffer) == 1 &&
+           buffer.num_parts == 2 && buffer.num_points == 4;
+}
+
+static int
+test_buffer_too_small(void)
+{
+    const shp_polyline_t *polyline = &polyline_records[1]->shape.polyline;
+    shp_buffer_t small;
+    shp_buffer_init(&small, parts, 1, points, 2);
+    return shp_polyline_simplify(polyline, SHP_SIMPLIFY_DOUGLAS_PEUCKER, 0.0,
+                                 &small) == 0 &&
+           small.num_parts == 2 && small.num_points == 6;
+}
+
+/*
+ * Polygon tests
+ */
+
+static int
+test_polygon_rank(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    return shp_polygon_rank(polygon, SHP_SIMPLIFY_DOUGLAS_PEUCKER,
+                            importance) == 1 &&
+           importance[0] == HUGE_VAL && importance[4] == HUGE_VAL &&
+           is_close(importance[2], sqrt(0.72)) &&
+           is_close(importance[1], sqrt(0.18)) &&
+           is_close(importance[3], sqrt(0.18));
+}
+
+static int
+test_collapsed_ring(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    return shp_polygon_simplify(polygon, SHP_SIMPLIFY_DOUGLAS_PEUCKER, 0.4,
+                                &buffer) == 1 &&
+           buffer.num_parts == 1 && buffer.num_points == 5 &&
+           shp_polygon_simplify(polygon, SHP_SIMPLIFY_DOUGLAS_PEUCKER, 0.5,
+                                &buffer) == 1 &&
+           buffer.num_parts == 0 && buffer.num_points == 0 &&
+           shp_polygon_simplify(polygon, SHP_SIMPLIFY_VISVALINGAM, 0.1,
+                                &buffer) == 1 &&
+           buffer.num_parts == 1 && buffer.num_points == 5 &&
+           shp_polygon_simplify(polygon, SHP_SIMPLIFY_VISVALINGAM, 0.2,
+                                &buffer) == 1 &&
+           buffer.num_parts == 0;
+}
+
+int
+main(void)
+{
+    size_t i;
+
+    plan(7);
+
+    if (read_records("polyline.shp", polyline_records, 2) <= 0 ||
+        read_records("polygon.shp", polygon_records, 1) <= 0) {
+        return 1;
+    }
+
+    shp_buffer_init(&buffer, parts, 16, points, 64);
+
+    ok(test_douglas_peucker_rank, "Douglas-Peucker importance is computed");
+    ok(test_visvalingam_rank, "Visvalingam-Whyatt importance is computed");
+    ok(test_select_points, "points are selected by importance");
+    ok(test_straight_lines, "end points are kept");
+    ok(test_buffer_too_small, "required buffer size is returned");
+    ok(test_polygon_rank, "polygon importance is computed");
+    ok(test_collapsed_ring, "collapsed rings are removed");
+
+    for (i = 0; i < 2; ++i) {
+        free(polyline_records[i]);
+    }
+    free(polygon_records[0]);
+
+    done_testing();
+}
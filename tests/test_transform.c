@@ -0,0 +1,207 @@
+#include "../byteorder.h"
+#include "../shapereader.h"
+#include "tap.h"
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int tests_planned = 0;
+int tests_run = 0;
+int tests_failed = 0;
+
+shp_record_t *point_records[1];
+shp_record_t *polygon_records[1];
+
+#define NUM_LINE 1000
+
+char line_parts[4];
+char line_points[16 * NUM_LINE];
+shp_point_t points[NUM_LINE];
+
+static int
+read_records(const char *filename, shp_record_t **records, size_t n)
+{
+    FILE *stream;
+    shp_file_t fh;
+    shp_header_t header;
+    size_t i;
+    int rc = -1;
+
+    stream = fopen(filename, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "# Cannot open file \"%s\": %s\n", filename,
+                strerror(errno));
+        return -1;
+    }
+
+    shp_init_file(&fh, stream, NULL);
+    if ((rc = shp_read_header(&fh, &header)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if ((rc = shp_read_record(&fh, &records[i])) <= 0) {
+                break;
+            }
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "# Cannot read file \"%s\": %s\n", filename,
+                fh.error);
+    }
+
+    fclose(stream);
+
+    return rc;
+}
+
+static int
+is_close(double a, double b, double eps)
+{
+    return fabs(a - b) <= eps * (1.0 + fabs(b));
+}
+
+static int
+test_web_mercator(void)
+{
+    shp_transform_t transform;
+    shp_point_t point;
+
+    shp_transform_init(&transform, SHP_PROJECTION_WEB_MERCATOR);
+    return shp_record_transform(point_records[0], 0, 1, &transform,
+                                &point) == 1 &&
+           is_close(point.x, 874102.9056069427, 1e-12) &&
+           is_close(point.y, 6106172.768076354, 1e-12);
+}
+
+static int
+test_inverse_mercator(void)
+{
+    shp_transform_t transform;
+    shp_point_t point;
+
+    shp_transform_init(&transform, SHP_PROJECTION_INVERSE_MERCATOR);
+    point.x = 874102.9056069427;
+    point.y = 6106172.768076354;
+    shp_transform_point(&transform, &point);
+    return is_close(point.x, 7.8522, 1e-12) &&
+           is_close(point.y, 47.9959, 1e-12);
+}
+
+static int
+test_clamped_latitude(void)
+{
+    shp_transform_t transform;
+    shp_point_t point;
+
+    shp_transform_init(&transform, SHP_PROJECTION_WEB_MERCATOR);
+    point.x = 180.0;
+    point.y = 90.0;
+    shp_transform_point(&transform, &point);
+    return is_close(point.x, 20037508.342789244, 1e-12) &&
+           is_close(point.y, 20037508.342789244, 1e-9);
+}
+
+static int
+test_affine(void)
+{
+    const shp_polygon_t *polygon = &polygon_records[0]->shape.polygon;
+    shp_transform_t transform;
+    shp_point_t point;
+    size_t i, n;
+
+    shp_transform_init(&transform, SHP_PROJECTION_NONE);
+    transform.matrix[0] = 2.0;
+    transform.matrix[2] = 1.0;
+    transform.matrix[4] = -2.0;
+    transform.matrix[5] = 3.0;
+
+    /* The range is clipped */
+    n = shp_record_transform(polygon_records[0], 1, 10, &transform, points);
+    if (n != polygon->num_points - 1) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        shp_polygon_point(polygon, i + 1, &point);
+        if (points[i].x != 2.0 * point.x + 1.0 ||
+            points[i].y != -2.0 * point.y + 3.0) {
+            return 0;
+        }
+    }
+    return shp_record_transform(polygon_records[0], polygon->num_points, 1,
+                                &transform, points) == 0;
+}
+
+static int
+test_many_points(void)
+{
+    shp_record_t record;
+    shp_polyline_t *polyline = &record.shape.polyline;
+    shp_transform_t transform;
+    shp_point_t point;
+    size_t i;
+
+    memset(line_parts, 0, sizeof(line_parts));
+    for (i = 0; i < NUM_LINE; ++i) {
+        shp_double_to_le64(-180.0 + 0.36 * (double) i, &line_points[16 * i]);
+        shp_double_to_le64(-80.0 + 0.16 * (double) i,
+                           &line_points[16 * i + 8]);
+    }
+
+    record.record_number = 1;
+    record.record_size = 0;
+    record.type = SHP_TYPE_POLYLINE;
+    polyline->x_min = -180.0;
+    polyline->y_min = -80.0;
+    polyline->x_max = 180.0;
+    polyline->y_max = 80.0;
+    polyline->num_parts = 1;
+    polyline->num_points = NUM_LINE;
+    polyline->parts = line_parts;
+    polyline->points = line_points;
+
+    /* Web Mercator tile coordinates at zoom level 0 */
+    shp_transform_init(&transform, SHP_PROJECTION_WEB_MERCATOR);
+    transform.matrix[0] = 256.0 / (2.0 * 20037508.342789244);
+    transform.matrix[2] = 128.0;
+    transform.matrix[4] = -transform.matrix[0];
+    transform.matrix[5] = 128.0;
+
+    if (shp_record_transform(&record, 0, NUM_LINE, &transform, points) !=
+        NUM_LINE) {
+        return 0;
+    }
+    for (i = 0; i < NUM_LINE; ++i) {
+        shp_polyline_point(polyline, i, &point);
+        shp_transform_point(&transform, &point);
+        if (!is_close(points[i].x, point.x, 1e-12) ||
+            !is_close(points[i].y, point.y, 1e-12)) {
+            return 0;
+        }
+    }
+    /* The point at longitude and latitude 0 is in the tile's center */
+    return is_close(points[0].x, 0.0, 1e-12) &&
+           is_close(points[NUM_LINE / 2].x, 128.0, 1e-12) &&
+           is_close(points[NUM_LINE / 2].y, 128.0, 1e-12);
+}
+
+int
+main(void)
+{
+    plan(5);
+
+    if (read_records("point.shp", point_records, 1) <= 0 ||
+        read_records("polygon.shp", polygon_records, 1) <= 0) {
+        return 1;
+    }
+
+    ok(test_web_mercator, "point is projected to Web Mercator");
+    ok(test_inverse_mercator, "point is projected back");
+    ok(test_clamped_latitude, "latitude is clamped");
+    ok(test_affine, "affine transformation is applied");
+    ok(test_many_points, "points are transformed in blocks");
+
+    free(point_records[0]);
+    free(polygon_records[0]);
+
+    done_testing();
+}